@@ -0,0 +1,105 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+
+#define ARENA_ALIGN (_Alignof(max_align_t))
+#define ALIGN_UP(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;
+    size_t used;
+    size_t last; // Offset of the most recent allocation, so it can grow in place.
+    _Alignas(max_align_t) unsigned char data[];
+};
+
+static ArenaBlock *create_block(Arena *arena, size_t min_size) {
+    size_t size = arena->block_size;
+
+    // Oversized allocations get a block of their own.
+    if (min_size > size)
+        size = min_size;
+
+    ArenaBlock *block = calloc(1, sizeof(ArenaBlock) + size);
+
+    if (block == NULL) {
+        fprintf(stderr, "cobc: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    block->next = arena->head;
+    block->size = size;
+    block->used = block->last = 0;
+
+    arena->head = block;
+    arena->bytes_reserved += size;
+    arena->block_count++;
+    return block;
+}
+
+Arena create_arena(size_t block_size) {
+    return (Arena){ .head = NULL, .block_size = block_size, .allocations = 0, .bytes_used = 0, .bytes_reserved = 0, .block_count = 0 };
+}
+
+void delete_arena(Arena *arena) {
+    ArenaBlock *block = arena->head;
+
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->head = NULL;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = ALIGN_UP(size == 0 ? 1 : size);
+    ArenaBlock *block = arena->head;
+
+    if (block == NULL || block->used + size > block->size)
+        block = create_block(arena, size);
+
+    void *ptr = block->data + block->used;
+    block->last = block->used;
+    block->used += size;
+
+    arena->allocations++;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL)
+        return arena_alloc(arena, new_size);
+
+    ArenaBlock *block = arena->head;
+    const size_t new_aligned = ALIGN_UP(new_size == 0 ? 1 : new_size);
+
+    // Growing the most recent allocation is common when lexing tokens and
+    // pushing to lists, so extend it in place whenever the block has room.
+    if (block != NULL && (unsigned char *)ptr == block->data + block->last &&
+            block->last + new_aligned <= block->size) {
+
+        arena->bytes_used = arena->bytes_used - (block->used - block->last) + new_aligned;
+        block->used = block->last + new_aligned;
+        return ptr;
+    }
+
+    if (new_size <= old_size)
+        return ptr;
+
+    void *new_ptr = arena_alloc(arena, new_size);
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+char *arena_strdup(Arena *arena, char *str) {
+    const size_t len = strlen(str);
+    char *dup = arena_alloc(arena, len + 1);
+    memcpy(dup, str, len + 1);
+    return dup;
+}
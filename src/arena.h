@@ -0,0 +1,27 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t block_size;
+
+    // Statistics for -fmem-report.
+    size_t allocations;
+    size_t bytes_used;
+    size_t bytes_reserved;
+    size_t block_count;
+} Arena;
+
+Arena create_arena(size_t block_size);
+void delete_arena(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+char *arena_strdup(Arena *arena, char *str);
+
+#endif
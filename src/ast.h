@@ -55,6 +55,12 @@ typedef struct Variable {
     struct Variable *struct_sym;
     size_t uid;
     bool pointer_been_set;
+    unsigned int performs; // PERFORM statements naming this paragraph.
+    unsigned int organization; // An FD's ORGANIZATION from its SELECT, ORG_SORT for an SD.
+    struct Variable *record; // An FD's record description.
+    struct Variable *fd; // The FD a record description belongs to.
+    unsigned int access; // An FD's ACCESS MODE from its SELECT.
+    struct Variable *record_key; // An indexed FD's RECORD KEY or a relative FD's RELATIVE KEY.
 } Variable;
 
 typedef enum {
@@ -85,6 +91,8 @@ typedef enum {
     AST_PERFORM_COUNT,
     AST_PERFORM_VARYING,
     AST_PERFORM_UNTIL,
+    AST_PERFORM_THRU,
+    AST_GOTO,
     AST_SUBSCRIPT,
     AST_CALL,
     AST_NULL,
@@ -96,6 +104,12 @@ typedef enum {
     AST_SELECT,
     AST_READ,
     AST_WRITE,
+    AST_REWRITE,
+    AST_START,
+    AST_DELETE,
+    AST_SORT,
+    AST_RELEASE,
+    AST_RETURN,
     AST_INSPECT,
     AST_ACCEPT,
     AST_ZERO,
@@ -168,6 +182,11 @@ typedef struct {
     size_t replace_capacity;
 } InspectReplacing;
 
+typedef struct {
+    Variable *key;
+    bool descending;
+} SortKey;
+
 typedef struct AST {
     ASTType type;
     size_t ln;
@@ -201,6 +220,7 @@ typedef struct AST {
             unsigned int count;
             bool is_index;
             bool is_fd;
+            bool is_sort;
             bool is_linkage_src;
             ASTList fields;
         } pic;
@@ -217,8 +237,7 @@ typedef struct AST {
             AST *right;
             AST *dst;
             bool implicit_giving;
-            bool cloned_left;
-            bool cloned_right;
+            bool rounded;
         } arithmetic;
 
         TokenType oper;
@@ -226,6 +245,7 @@ typedef struct AST {
         struct {
             AST *dst;
             AST *math;
+            bool rounded;
         } compute;
 
         ASTList math;
@@ -241,9 +261,16 @@ typedef struct AST {
         AST *not_value;
         char *label;
         AST *perform;
+        AST *go;
+
+        struct {
+            AST *first;
+            AST *last;
+        } perform_thru;
 
         struct {
             char *name;
+            Variable *sym;
             ASTList body;
         } proc;
 
@@ -320,21 +347,64 @@ typedef struct AST {
 
             enum {
                 ORG_NONE,
-                ORG_LINE_SEQUENTIAL
+                ORG_LINE_SEQUENTIAL,
+                ORG_SEQUENTIAL,
+                ORG_INDEXED,
+                ORG_RELATIVE,
+                ORG_SORT
             } organization;
+
+            enum {
+                ACCESS_SEQUENTIAL,
+                ACCESS_RANDOM,
+                ACCESS_DYNAMIC
+            } access;
         } select;
 
+        // READ and RETURN. Keyed reads put INVALID KEY in at_end_stmts and
+        // NOT INVALID KEY in not_at_end_stmts.
         struct {
             AST *fd;
             AST *into;
+            bool next;
             ASTList at_end_stmts;
             ASTList not_at_end_stmts;
         } read;
 
+        // WRITE and REWRITE.
         struct {
             AST *value;
+            ASTList invalid_key_stmts;
+            ASTList not_invalid_key_stmts;
         } write;
 
+        // START and DELETE on an indexed or relative file, DELETE ignores the relation.
+        struct {
+            AST *fd;
+            TokenType relation;
+            ASTList invalid_key_stmts;
+            ASTList not_invalid_key_stmts;
+        } keyed;
+
+        // USING files or an INPUT PROCEDURE fill the sort file, GIVING or an
+        // OUTPUT PROCEDURE empties it. The procedures are PERFORM statements.
+        struct {
+            AST *fd;
+            SortKey *keys;
+            size_t key_count;
+            size_t key_capacity;
+            ASTList using_files;
+            AST *input_procedure;
+            AST *giving_file;
+            AST *output_procedure;
+        } sort;
+
+        // RELEASE a sort file's record or the FROM item.
+        struct {
+            AST *fd;
+            AST *from;
+        } release;
+
         struct {
             enum {
                 INSPECT_TALLYING,
@@ -373,12 +443,12 @@ typedef struct AST {
     };
 } AST;
 
+// ASTs are allocated from the current compilation's arena and
+// released all at once when it is deleted.
 AST *create_ast(ASTType type, size_t ln, size_t col);
-void delete_ast(AST *ast);
 char *asttype_to_string(ASTType type);
 
 ASTList create_astlist();
-void delete_astlist(ASTList *list);
 void astlist_push(ASTList *list, AST *item);
 
 #endif
\ No newline at end of file
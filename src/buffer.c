@@ -0,0 +1,79 @@
+#include "buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+static void buffer_reserve(Buffer *buf, size_t extra) {
+    if (buf->len + extra + 1 <= buf->cap)
+        return;
+
+    while (buf->len + extra + 1 > buf->cap)
+        buf->cap *= 2;
+
+    buf->data = realloc(buf->data, buf->cap);
+
+    if (buf->data == NULL) {
+        fprintf(stderr, "cobc: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+Buffer create_buffer(size_t cap) {
+    Buffer buf = { .data = malloc(cap), .len = 0, .cap = cap };
+
+    if (buf.data == NULL) {
+        fprintf(stderr, "cobc: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    buf.data[0] = '\0';
+    return buf;
+}
+
+void delete_buffer(Buffer *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+void buffer_append_n(Buffer *buf, const char *str, size_t len) {
+    buffer_reserve(buf, len);
+    memcpy(buf->data + buf->len, str, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+void buffer_append(Buffer *buf, const char *str) {
+    buffer_append_n(buf, str, strlen(str));
+}
+
+void buffer_appendc(Buffer *buf, char c) {
+    buffer_reserve(buf, 1);
+    buf->data[buf->len++] = c;
+    buf->data[buf->len] = '\0';
+}
+
+void buffer_appendf(Buffer *buf, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+    va_end(args);
+
+    if (len < 0)
+        return;
+
+    // Didn't fit, grow and format again.
+    if ((size_t)len >= buf->cap - buf->len) {
+        buffer_reserve(buf, len);
+        va_start(args, fmt);
+        vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+        va_end(args);
+    }
+
+    buf->len += len;
+}
+
+size_t buffer_write(Buffer *buf, FILE *out) {
+    return fwrite(buf->data, 1, buf->len, out);
+}
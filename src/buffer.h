@@ -0,0 +1,22 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stdio.h>
+
+// A length-tracked, growable output buffer. Appends are amortised O(1)
+// so the transpiler can emit code without rescanning what it already wrote.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+Buffer create_buffer(size_t cap);
+void delete_buffer(Buffer *buf);
+void buffer_append(Buffer *buf, const char *str);
+void buffer_append_n(Buffer *buf, const char *str, size_t len);
+void buffer_appendc(Buffer *buf, char c);
+void buffer_appendf(Buffer *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+size_t buffer_write(Buffer *buf, FILE *out);
+
+#endif
@@ -0,0 +1,1775 @@
+#include "bytecode.h"
+#include "ast.h"
+#include "parser.h"
+#include "transpiler.h"
+#include "buffer.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define IS_STRING(ttype) ((ttype.type == TYPE_ALPHABETIC || ttype.type == TYPE_ALPHANUMERIC) && ttype.count > 0)
+#define SLOT_TABLE_INITIAL_SIZE 256
+
+// Where a picture, group field, FD or procedure lives once lowered.
+typedef struct Slot {
+    char *name;
+    size_t offset;
+    CType type;
+    size_t width;       // Bytes in each string, 0 if it isn't one.
+    size_t size;        // Bytes in each element.
+    unsigned int count; // OCCURS count, 0 if it isn't a table.
+    bool is_group;
+    struct Slot *group; // The group a field belongs to, its offset is inside it.
+    AST *pic;
+
+    bool is_file;
+    size_t file;
+    AST *filename;
+    struct Slot *status;
+
+    bool is_proc;
+    size_t address;
+} Slot;
+
+// Describes the storage an address on the stack points at.
+typedef struct {
+    CType type;
+    size_t width;
+    size_t size;
+    unsigned int count;
+    bool is_group;
+} LValue;
+
+typedef struct {
+    size_t at;
+    char *label;
+} PendingCall;
+
+static Program *prog;
+
+// Cleared as soon as the program uses something the interpreter can't run,
+// lowering carries on so the caller can just fall back to gcc.
+static bool supported;
+
+// What was being laid out or lowered, the first one the interpreter can't run is reported.
+static AST *cur_node;
+static AST *unsupported_node;
+
+static Slot **slots;
+static size_t slot_cap;
+static size_t slot_count;
+
+static PendingCall *calls;
+static size_t call_count;
+static size_t call_cap;
+
+static ASTList procs;
+static size_t status_offset;
+
+static void unsupported() {
+    if (supported)
+        unsupported_node = cur_node;
+
+    supported = false;
+}
+
+static uint32_t hash_name(char *name) {
+    uint32_t hash = 2166136261u;
+
+    for (char *c = name; *c != '\0'; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static Slot *find_slot(char *name) {
+    for (size_t i = hash_name(name) & (slot_cap - 1); slots[i] != NULL; i = (i + 1) & (slot_cap - 1)) {
+        if (strcmp(slots[i]->name, name) == 0)
+            return slots[i];
+    }
+
+    return NULL;
+}
+
+// Returns NULL if the name is taken, which the C compiler wouldn't allow either.
+static Slot *add_slot(char *name) {
+    if (find_slot(name) != NULL)
+        return NULL;
+
+    if ((slot_count + 1) * 2 > slot_cap) {
+        Slot **old = slots;
+        const size_t old_cap = slot_cap;
+        slot_cap *= 2;
+        slots = calloc(slot_cap, sizeof(Slot *));
+
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i] == NULL)
+                continue;
+
+            size_t j = hash_name(old[i]->name) & (slot_cap - 1);
+
+            while (slots[j] != NULL)
+                j = (j + 1) & (slot_cap - 1);
+
+            slots[j] = old[i];
+        }
+
+        free(old);
+    }
+
+    Slot *slot = arena_alloc(&prog->arena, sizeof(Slot));
+    memset(slot, 0, sizeof(Slot));
+    slot->name = name;
+
+    size_t i = hash_name(name) & (slot_cap - 1);
+
+    while (slots[i] != NULL)
+        i = (i + 1) & (slot_cap - 1);
+
+    slots[i] = slot;
+    slot_count++;
+    return slot;
+}
+
+static Instruction *emit(Opcode op) {
+    if (prog->count == prog->cap) {
+        prog->cap *= 2;
+        prog->code = realloc(prog->code, prog->cap * sizeof(Instruction));
+    }
+
+    Instruction *ins = &prog->code[prog->count++];
+    memset(ins, 0, sizeof(Instruction));
+    ins->op = op;
+    return ins;
+}
+
+static size_t emit_jump(Opcode op) {
+    emit(op);
+    return prog->count - 1;
+}
+
+static void patch_jump(size_t at) {
+    prog->code[at].arg = prog->count;
+}
+
+static void emit_jump_to(Opcode op, size_t target) {
+    emit(op)->arg = target;
+}
+
+static void emit_push(Kind kind, Value value) {
+    Instruction *ins = emit(OP_PUSH);
+    ins->type = kind;
+    ins->val = value;
+}
+
+static void emit_addr(size_t offset) {
+    emit(OP_ADDR)->val.u = offset;
+}
+
+static void emit_convert(Kind from, Kind to, size_t depth) {
+    if (from == to)
+        return;
+
+    if (from == KIND_PTR || to == KIND_PTR) {
+        unsupported();
+        return;
+    }
+
+    Instruction *ins = emit(OP_CONV);
+    ins->type = to;
+    ins->from = from;
+    ins->arg = depth;
+}
+
+static void emit_store(CType type, Kind from) {
+    if (from == KIND_PTR) {
+        unsupported();
+        return;
+    }
+
+    Instruction *ins = emit(OP_STORE);
+    ins->type = type;
+    ins->from = from;
+}
+
+static bool is_signed_kind(Kind kind) {
+    return kind == KIND_I32 || kind == KIND_I64;
+}
+
+static uint64_t float_to_bits(double f, bool to_unsigned) {
+    if (to_unsigned && f >= 0.0)
+        return f < 18446744073709551616.0 ? (uint64_t)f : 0;
+    else if (f >= -9223372036854775808.0 && f < 9223372036854775808.0)
+        return (uint64_t)(int64_t)f;
+
+    return (uint64_t)INT64_MIN;
+}
+
+Value convert_value(Value value, Kind from, Kind to) {
+    if (from == to)
+        return value;
+
+    Value out;
+
+    if (to == KIND_FLOAT || to == KIND_DOUBLE) {
+        if (from == KIND_FLOAT || from == KIND_DOUBLE)
+            out.f = value.f;
+        else if (is_signed_kind(from))
+            out.f = to == KIND_FLOAT ? (float)value.i : (double)value.i;
+        else
+            out.f = to == KIND_FLOAT ? (float)value.u : (double)value.u;
+
+        if (to == KIND_FLOAT)
+            out.f = (float)out.f;
+
+        return out;
+    }
+
+    uint64_t bits;
+
+    if (from == KIND_FLOAT || from == KIND_DOUBLE)
+        bits = float_to_bits(value.f, to == KIND_U32 || to == KIND_U64);
+    else if (from == KIND_PTR)
+        bits = (uint64_t)(uintptr_t)value.p;
+    else
+        bits = is_signed_kind(from) ? (uint64_t)value.i : value.u;
+
+    switch (to) {
+        case KIND_I32: out.i = (int32_t)(uint32_t)bits; break;
+        case KIND_U32: out.u = (uint32_t)bits; break;
+        case KIND_I64: out.i = (int64_t)bits; break;
+        default: out.u = bits; break;
+    }
+
+    return out;
+}
+
+Kind promoted_kind(CType type) {
+    switch (type) {
+        case CTYPE_U32: return KIND_U32;
+        case CTYPE_I64: return KIND_I64;
+        case CTYPE_U64: return KIND_U64;
+        case CTYPE_FLOAT: return KIND_FLOAT;
+        case CTYPE_DOUBLE: return KIND_DOUBLE;
+        default: break;
+    }
+
+    return KIND_I32;
+}
+
+Value load_value(unsigned char *src, CType type) {
+    Value value = { 0 };
+
+    switch (type) {
+        case CTYPE_CHAR: { char x; memcpy(&x, src, sizeof(x)); value.i = x; break; }
+        case CTYPE_I16: { int16_t x; memcpy(&x, src, sizeof(x)); value.i = x; break; }
+        case CTYPE_U16: { uint16_t x; memcpy(&x, src, sizeof(x)); value.i = x; break; }
+        case CTYPE_I32: { int32_t x; memcpy(&x, src, sizeof(x)); value.i = x; break; }
+        case CTYPE_U32: { uint32_t x; memcpy(&x, src, sizeof(x)); value.u = x; break; }
+        case CTYPE_I64: { int64_t x; memcpy(&x, src, sizeof(x)); value.i = x; break; }
+        case CTYPE_U64: { uint64_t x; memcpy(&x, src, sizeof(x)); value.u = x; break; }
+        case CTYPE_FLOAT: { float x; memcpy(&x, src, sizeof(x)); value.f = x; break; }
+        case CTYPE_DOUBLE: { double x; memcpy(&x, src, sizeof(x)); value.f = x; break; }
+    }
+
+    return value;
+}
+
+// Stores with the conversion a C assignment would do.
+void store_value(unsigned char *dst, CType type, Value value, Kind from) {
+    switch (type) {
+        case CTYPE_CHAR: { char x = (char)convert_value(value, from, KIND_I64).i; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_I16: { int16_t x = (int16_t)convert_value(value, from, KIND_I64).i; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_U16: { uint16_t x = (uint16_t)convert_value(value, from, KIND_U64).u; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_I32: { int32_t x = (int32_t)convert_value(value, from, KIND_I64).i; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_U32: { uint32_t x = (uint32_t)convert_value(value, from, KIND_U64).u; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_I64: { int64_t x = convert_value(value, from, KIND_I64).i; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_U64: { uint64_t x = convert_value(value, from, KIND_U64).u; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_FLOAT: { float x = (float)convert_value(value, from, KIND_FLOAT).f; memcpy(dst, &x, sizeof(x)); break; }
+        case CTYPE_DOUBLE: { double x = convert_value(value, from, KIND_DOUBLE).f; memcpy(dst, &x, sizeof(x)); break; }
+    }
+}
+
+static size_t ctype_size(CType type) {
+    switch (type) {
+        case CTYPE_CHAR: return 1;
+        case CTYPE_I16:
+        case CTYPE_U16: return 2;
+        case CTYPE_I32:
+        case CTYPE_U32:
+        case CTYPE_FLOAT: return 4;
+        default: break;
+    }
+
+    return 8;
+}
+
+static size_t align_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+// Mirrors picturetype_to_c().
+static CType picture_ctype(PictureType *type) {
+    if (type->type == TYPE_DECIMAL_NUMERIC || type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC || type->comp_type == COMP1 || type->comp_type == COMP2)
+        return type->comp_type == COMP1 ? CTYPE_FLOAT : CTYPE_DOUBLE;
+
+    if (type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_SIGNED_SUPRESSED_NUMERIC) {
+        if (type->places <= 4)
+            return CTYPE_I16;
+        else if (type->places <= 9)
+            return CTYPE_I32;
+        else
+            return CTYPE_I64;
+    } else if (type->type == TYPE_UNSIGNED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC) {
+        if (type->places <= 4)
+            return CTYPE_U16;
+        else if (type->places <= 9)
+            return CTYPE_U32;
+        else
+            return CTYPE_U64;
+    }
+
+    return CTYPE_CHAR;
+}
+
+// Lays out one picture's element, returns its alignment.
+static size_t layout_element(Slot *slot, AST *pic) {
+    // Fixed point decimals, __int128 numbers and packed decimals only have the code gcc gets.
+    if (pic->pic.type.comp_type == COMP_POINTER || pic->pic.type.type == TYPE_POINTER || pic->pic.is_linkage_src ||
+            is_fixed_point(&pic->pic.type) || is_wide_numeric(&pic->pic.type) || is_packed(&pic->pic.type))
+        unsupported();
+
+    slot->pic = pic;
+    slot->type = picture_ctype(&pic->pic.type);
+    slot->count = pic->pic.count;
+
+    if (IS_STRING(pic->pic.type)) {
+        slot->width = pic->pic.type.count + 1;
+        slot->size = slot->width;
+        return 1;
+    }
+
+    slot->size = ctype_size(slot->type);
+    return slot->size;
+}
+
+static size_t slot_total_size(Slot *slot) {
+    return slot->count > 0 ? slot->size * slot->count : slot->size;
+}
+
+static void layout_group(AST *pic) {
+    Slot *group = add_slot(pic->pic.name);
+
+    if (group == NULL) {
+        unsupported();
+        return;
+    }
+
+    group->is_group = true;
+    group->count = pic->pic.count;
+    size_t size = 0;
+    size_t align = 1;
+
+    for (size_t i = 0; i < pic->pic.fields.size; i++) {
+        AST *field_pic = pic->pic.fields.items[i];
+        Slot *field = add_slot(field_pic->pic.name);
+
+        // Nested groups and field values don't compile as C either.
+        if (field == NULL || field_pic->pic.fields.size > 0 || field_pic->pic.value != NULL) {
+            unsupported();
+            return;
+        }
+
+        const size_t field_align = layout_element(field, field_pic);
+        field->group = group;
+        field->offset = align_up(size, field_align);
+        size = field->offset + slot_total_size(field);
+
+        if (field_align > align)
+            align = field_align;
+    }
+
+    group->size = align_up(size == 0 ? 1 : size, align);
+    group->offset = align_up(prog->data_size, align);
+    prog->data_size = group->offset + slot_total_size(group);
+}
+
+static void layout_pic(AST *pic) {
+    cur_node = pic;
+
+    if (pic->pic.fields.size > 0) {
+        layout_group(pic);
+        return;
+    }
+
+    Slot *slot = add_slot(pic->pic.name);
+
+    if (slot == NULL) {
+        unsupported();
+        return;
+    }
+
+    if (pic->pic.value != NULL && pic->pic.is_fd) {
+        slot->is_file = true;
+        slot->file = prog->file_count++;
+        return;
+    }
+
+    const size_t align = layout_element(slot, pic);
+    slot->offset = align_up(prog->data_size, align);
+    prog->data_size = slot->offset + slot_total_size(slot);
+}
+
+static bool is_plain_string(Slot *slot) {
+    return slot != NULL && !slot->is_file && !slot->is_proc && !slot->is_group && slot->group == NULL && slot->width > 0 && slot->count == 0;
+}
+
+static void select_file(AST *ast) {
+    Slot *file = find_slot(ast->select.fd_var->var.name);
+
+    // Only text files, records of sequential and indexed files are raw memory.
+    if (file == NULL || !file->is_file || (ast->select.organization != ORG_NONE && ast->select.organization != ORG_LINE_SEQUENTIAL)) {
+        unsupported();
+        return;
+    }
+
+    file->filename = ast->select.filename;
+    file->status = NULL;
+
+    if (ast->select.filestatus_var == NULL)
+        return;
+
+    file->status = find_slot(ast->select.filestatus_var->var.name);
+
+    // The status is strcpy()'d in, it has to fit.
+    if (!is_plain_string(file->status) || file->status->width < 3)
+        unsupported();
+}
+
+// String literals are kept as C source text.
+static char *unescape_string(char *raw, size_t *out_len) {
+    char *str = arena_alloc(&prog->arena, strlen(raw) + 1);
+    size_t len = 0;
+
+    for (char *c = raw; *c != '\0'; c++) {
+        if (*c != '\\' || c[1] == '\0') {
+            str[len++] = *c;
+            continue;
+        }
+
+        c++;
+
+        switch (*c) {
+            case 'n': str[len++] = '\n'; break;
+            case 't': str[len++] = '\t'; break;
+            case 'r': str[len++] = '\r'; break;
+            case 'a': str[len++] = '\a'; break;
+            case 'b': str[len++] = '\b'; break;
+            case 'f': str[len++] = '\f'; break;
+            case 'v': str[len++] = '\v'; break;
+            case 'x': {
+                int value = 0;
+
+                while (strchr("0123456789abcdefABCDEF", c[1]) != NULL && c[1] != '\0') {
+                    c++;
+                    value = value * 16 + (*c <= '9' ? *c - '0' : (*c | 0x20) - 'a' + 10);
+                }
+
+                str[len++] = (char)value;
+                break;
+            }
+            default:
+                if (*c >= '0' && *c <= '7') {
+                    int value = *c - '0';
+
+                    for (int i = 0; i < 2 && c[1] >= '0' && c[1] <= '7'; i++) {
+                        c++;
+                        value = value * 8 + *c - '0';
+                    }
+
+                    str[len++] = (char)value;
+                } else
+                    str[len++] = *c;
+
+                break;
+        }
+    }
+
+    str[len] = '\0';
+
+    if (out_len != NULL)
+        *out_len = len;
+
+    return str;
+}
+
+// Float constants go through the text emit_value() writes for them.
+static double float_constant(double f) {
+    char text[512];
+    snprintf(text, sizeof(text), "%lf", f);
+    return strtod(text, NULL);
+}
+
+static bool constant_value(AST *ast, Value *out, Kind *out_kind) {
+    switch (ast->type) {
+        case AST_INT: out->i = ast->constant.i32; *out_kind = KIND_I32; return true;
+        case AST_ZERO: out->i = 0; *out_kind = KIND_I32; return true;
+        case AST_BOOL: out->i = ast->bool_value; *out_kind = KIND_I32; return true;
+        case AST_FLOAT:
+            // The generated C works these out in scaled integers, gcc builds them.
+            if (is_long_integer(ast)) {
+                unsupported();
+                return false;
+            }
+
+            out->f = float_constant(ast->constant.f64);
+            *out_kind = KIND_DOUBLE;
+            return true;
+        default: break;
+    }
+
+    return false;
+}
+
+static void init_slot(Slot *slot) {
+    AST *pic = slot->pic;
+
+    // Tables of strings can't be initialised from a single value.
+    if (pic == NULL || pic->pic.value == NULL || (pic->pic.type.count > 0 && pic->pic.count > 0))
+        return;
+
+    unsigned char *dst = prog->data + slot->offset;
+    AST *value = pic->pic.value;
+    Value constant;
+    Kind kind;
+
+    if (slot->count > 0)
+        // Not a valid initializer for a C array.
+        unsupported();
+    else if (value->type == AST_STRING && slot->width > 0) {
+        size_t len;
+        char *str = unescape_string(value->constant.string, &len);
+        memcpy(dst, str, len < slot->width ? len : slot->width);
+    } else if (slot->width == 0 && constant_value(value, &constant, &kind))
+        store_value(dst, slot->type, constant, kind);
+    else
+        unsupported();
+}
+
+static void layout_root(ASTList *root) {
+    for (size_t i = 0; i < root->size; i++) {
+        if (root->items[i]->type == AST_PIC)
+            layout_pic(root->items[i]);
+    }
+
+    for (size_t i = 0; i < root->size; i++) {
+        if (root->items[i]->type == AST_SELECT) {
+            cur_node = root->items[i];
+            select_file(root->items[i]);
+        }
+    }
+
+    // The junk buffer for files without a status variable.
+    status_offset = prog->data_size;
+    prog->data_size += 3;
+    prog->data = calloc(prog->data_size, sizeof(unsigned char));
+
+    if (!supported)
+        return;
+
+    for (size_t i = 0; i < slot_cap; i++) {
+        if (slots[i] != NULL && !slots[i]->is_group && slots[i]->group == NULL && !slots[i]->is_file)
+            init_slot(slots[i]);
+    }
+}
+
+static bool is_value(AST *ast) {
+    switch (ast->type) {
+        case AST_INT:
+        case AST_FLOAT:
+        case AST_STRING:
+        case AST_VAR:
+        case AST_BOOL:
+        case AST_ZERO:
+        case AST_MATH:
+        case AST_CONDITION:
+        case AST_NOT:
+        case AST_LENGTHOF: return true;
+        case AST_PARENS: return is_value(ast->parens);
+        case AST_FIELD: return ast->field.base->type == AST_VAR;
+        case AST_SUBSCRIPT:
+            return ast->subscript.base->type == AST_VAR ||
+                (ast->subscript.base->type == AST_FIELD && ast->subscript.base->field.base->type == AST_VAR);
+        default: break;
+    }
+
+    return false;
+}
+
+// get_value_type() for values is_value() accepts, anything else isn't supported.
+static PictureType value_type(AST *ast) {
+    if (!is_value(ast)) {
+        unsupported();
+        return (PictureType){ .type = TYPE_SIGNED_NUMERIC, .count = 0 };
+    }
+
+    return get_value_type(ast);
+}
+
+static Kind lower_value(AST *ast);
+
+static void describe_slot(Slot *slot, LValue *out) {
+    *out = (LValue){ .type = slot->type, .width = slot->width, .size = slot->size, .count = slot->count, .is_group = slot->is_group };
+}
+
+static void lower_index(AST *index, unsigned int bound, size_t stride) {
+    Kind kind = lower_value(index);
+
+    if (kind == KIND_PTR) {
+        unsupported();
+        return;
+    }
+
+    emit_convert(kind, KIND_I64, 0);
+    Instruction *ins = emit(OP_INDEX);
+    ins->arg = bound;
+    ins->val.u = stride;
+}
+
+static Slot *find_field(AST *ast) {
+    Slot *field = find_slot(ast->field.sym->name);
+
+    if (field == NULL || field->group == NULL || ast->field.value != NULL || ast->field.base->type != AST_VAR ||
+            strcmp(field->group->name, ast->field.base->var.name) != 0) {
+        unsupported();
+        return NULL;
+    }
+
+    return field;
+}
+
+// Pushes the address of a storage value.
+static void lower_address(AST *ast, LValue *out) {
+    *out = (LValue){ .type = CTYPE_I32, .size = 4 };
+
+    switch (ast->type) {
+        case AST_VAR: {
+            Slot *slot = find_slot(ast->var.name);
+
+            if (slot == NULL || slot->is_proc || slot->is_file || slot->group != NULL) {
+                unsupported();
+                return;
+            }
+
+            emit_addr(slot->offset);
+            describe_slot(slot, out);
+            return;
+        }
+        case AST_FIELD: {
+            Slot *field = find_field(ast);
+
+            // A table of groups needs a subscript.
+            if (field == NULL || field->group->count > 0) {
+                unsupported();
+                return;
+            }
+
+            emit_addr(field->group->offset + field->offset);
+            describe_slot(field, out);
+            return;
+        }
+        case AST_SUBSCRIPT: {
+            AST *base = ast->subscript.base;
+
+            if (ast->subscript.value != NULL) {
+                unsupported();
+                return;
+            }
+
+            if (base->type == AST_FIELD) {
+                Slot *field = find_field(base);
+
+                if (field == NULL || field->group->count == 0) {
+                    unsupported();
+                    return;
+                }
+
+                emit_addr(field->group->offset);
+                lower_index(ast->subscript.index, field->group->count, field->group->size);
+                emit(OP_OFFSET)->val.u = field->offset;
+                describe_slot(field, out);
+                return;
+            }
+
+            Slot *slot = base->type == AST_VAR ? find_slot(base->var.name) : NULL;
+
+            if (slot == NULL || slot->is_proc || slot->is_file || slot->is_group || slot->group != NULL) {
+                unsupported();
+                return;
+            }
+
+            emit_addr(slot->offset);
+
+            if (slot->count > 0) {
+                lower_index(ast->subscript.index, slot->count, slot->size);
+                describe_slot(slot, out);
+                out->count = 0;
+            } else if (slot->width > 0) {
+                // Indexing a string gives one of its characters.
+                lower_index(ast->subscript.index, slot->width, 1);
+                *out = (LValue){ .type = CTYPE_CHAR, .size = 1 };
+            } else
+                unsupported();
+
+            return;
+        }
+        default: break;
+    }
+
+    unsupported();
+}
+
+// Pushes the address of a single numeric value that can be assigned to.
+static void lower_storage(AST *ast, LValue *out) {
+    lower_address(ast, out);
+
+    if (out->width > 0 || out->count > 0 || out->is_group)
+        unsupported();
+}
+
+// Pushes the address of a string that isn't part of a table.
+static void lower_string_storage(AST *ast, LValue *out) {
+    lower_address(ast, out);
+
+    if (out->width == 0 || out->count > 0 || out->is_group)
+        unsupported();
+}
+
+Kind common_kind(Kind left, Kind right) {
+    if (left == KIND_DOUBLE || right == KIND_DOUBLE)
+        return KIND_DOUBLE;
+    else if (left == KIND_FLOAT || right == KIND_FLOAT)
+        return KIND_FLOAT;
+
+    return left > right ? left : right;
+}
+
+// Both operands are on the stack, converts them as C would and applies op.
+static Kind lower_binary(Opcode op, Kind left, Kind right) {
+    if (left == KIND_PTR || right == KIND_PTR) {
+        unsupported();
+        return KIND_I32;
+    }
+
+    Kind kind = common_kind(left, right);
+
+    if (op == OP_MOD && (kind == KIND_FLOAT || kind == KIND_DOUBLE))
+        unsupported();
+
+    emit_convert(left, kind, 1);
+    emit_convert(right, kind, 0);
+    emit(op)->type = kind;
+    return op >= OP_EQ && op <= OP_GTE ? KIND_I32 : kind;
+}
+
+static void emit_bool(Kind kind) {
+    emit(OP_BOOL)->type = kind;
+}
+
+static int math_precedence(TokenType oper) {
+    return oper == TOK_STAR || oper == TOK_SLASH || oper == TOK_MOD ? 2 : 1;
+}
+
+static Opcode math_opcode(TokenType oper) {
+    switch (oper) {
+        case TOK_PLUS: return OP_ADD;
+        case TOK_MINUS: return OP_SUB;
+        case TOK_STAR: return OP_MUL;
+        case TOK_SLASH: return OP_DIV;
+        default: break;
+    }
+
+    return OP_MOD;
+}
+
+// emit_math() writes nested math out without parentheses, so it's
+// flattened back into the token stream C would see.
+typedef struct {
+    AST *value;
+    bool cast;
+} MathToken;
+
+typedef struct {
+    MathToken *items;
+    size_t size;
+    size_t cap;
+} MathTokens;
+
+static void flatten_math(MathTokens *toks, AST *ast, bool cast_first) {
+    bool has_mod = false;
+
+    for (size_t i = 1; i < ast->math.size; i += 2) {
+        if (ast->math.items[i]->oper == TOK_MOD) {
+            has_mod = true;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < ast->math.size; i++) {
+        AST *value = ast->math.items[i];
+
+        // Every operand is cast to long long when there's a MOD, the cast only
+        // reaches the first token of a nested expression.
+        const bool cast = value->type != AST_OPER && (has_mod || (i == 0 && cast_first));
+
+        if (value->type == AST_MATH) {
+            flatten_math(toks, value, cast);
+            continue;
+        }
+
+        if (toks->size == toks->cap) {
+            toks->cap = toks->cap == 0 ? 16 : toks->cap * 2;
+            toks->items = realloc(toks->items, toks->cap * sizeof(MathToken));
+        }
+
+        toks->items[toks->size++] = (MathToken){ .value = value, .cast = cast };
+    }
+}
+
+static Kind lower_math_operand(MathToken *tok) {
+    if (tok->value->type == AST_OPER) {
+        unsupported();
+        return KIND_I32;
+    }
+
+    Kind kind = lower_value(tok->value);
+
+    if (!tok->cast)
+        return kind;
+
+    emit_convert(kind, KIND_I64, 0);
+    return KIND_I64;
+}
+
+static Kind lower_math_expr(MathTokens *toks, size_t *pos, int min_prec) {
+    Kind left = lower_math_operand(&toks->items[(*pos)++]);
+
+    while (*pos + 1 < toks->size && toks->items[*pos].value->type == AST_OPER && math_precedence(toks->items[*pos].value->oper) >= min_prec) {
+        TokenType oper = toks->items[(*pos)++].value->oper;
+        Kind right = lower_math_expr(toks, pos, math_precedence(oper) + 1);
+        left = lower_binary(math_opcode(oper), left, right);
+    }
+
+    return left;
+}
+
+static Kind lower_math(AST *ast) {
+    MathTokens toks = { 0 };
+    flatten_math(&toks, ast, false);
+
+    size_t pos = 0;
+    Kind kind = lower_math_expr(&toks, &pos, 1);
+
+    if (pos != toks.size)
+        unsupported();
+
+    free(toks.items);
+    return kind;
+}
+
+// emit_condition() writes the values and operators out as C tokens, string
+// comparisons are folded into 'strcmp(a, b) op 0' first.
+typedef struct {
+    enum {
+        COND_VALUE,
+        COND_STRCMP,
+        COND_ZERO,
+        COND_OPER
+    } type;
+
+    AST *left;
+    AST *right;
+    TokenType oper;
+} CondToken;
+
+static int condition_precedence(TokenType oper) {
+    switch (oper) {
+        case TOK_EQ:
+        case TOK_EQUAL:
+        case TOK_NEQ: return 3;
+        case TOK_LT:
+        case TOK_LTE:
+        case TOK_GT:
+        case TOK_GTE: return 4;
+        case TOK_AND: return 2;
+        default: break;
+    }
+
+    // Anything else is emitted as '||'.
+    return 1;
+}
+
+static Opcode condition_opcode(TokenType oper) {
+    switch (oper) {
+        case TOK_NEQ: return OP_NEQ;
+        case TOK_LT: return OP_LT;
+        case TOK_LTE: return OP_LTE;
+        case TOK_GT: return OP_GT;
+        case TOK_GTE: return OP_GTE;
+        default: break;
+    }
+
+    return OP_EQ;
+}
+
+static Kind lower_condition_operand(CondToken *tok) {
+    switch (tok->type) {
+        case COND_VALUE: return lower_value(tok->left);
+        case COND_STRCMP: {
+            Kind left = lower_value(tok->left);
+            Kind right = lower_value(tok->right);
+
+            if (left != KIND_PTR || right != KIND_PTR)
+                unsupported();
+
+            emit(OP_STRCMP);
+            return KIND_I32;
+        }
+        case COND_ZERO:
+            emit_push(KIND_I32, (Value){ .i = 0 });
+            return KIND_I32;
+        default: break;
+    }
+
+    unsupported();
+    return KIND_I32;
+}
+
+static Kind lower_condition_expr(CondToken *toks, size_t count, size_t *pos, int min_prec) {
+    Kind left = lower_condition_operand(&toks[(*pos)++]);
+
+    while (*pos + 1 < count && toks[*pos].type == COND_OPER && condition_precedence(toks[*pos].oper) >= min_prec) {
+        TokenType oper = toks[(*pos)++].oper;
+        const int prec = condition_precedence(oper);
+
+        if (prec > 2) {
+            Kind right = lower_condition_expr(toks, count, pos, prec + 1);
+            left = lower_binary(condition_opcode(oper), left, right);
+            continue;
+        }
+
+        // && and || only evaluate the right side when they have to.
+        emit_bool(left);
+        const size_t jump = emit_jump(oper == TOK_AND ? OP_JZK : OP_JNZK);
+        Kind right = lower_condition_expr(toks, count, pos, prec + 1);
+        emit_bool(right);
+        patch_jump(jump);
+        left = KIND_I32;
+    }
+
+    return left;
+}
+
+static Kind lower_condition(AST *ast) {
+    ASTList *items = &ast->condition;
+    CondToken *toks = malloc((items->size + 2) * sizeof(CondToken));
+    size_t count = 0;
+
+    for (size_t i = 0; i < items->size; i++) {
+        AST *value = items->items[i];
+
+        if (value->type == AST_OPER) {
+            toks[count++] = (CondToken){ .type = COND_OPER, .oper = value->oper };
+            continue;
+        }
+
+        PictureType type = value_type(value);
+
+        if (i + 2 < items->size && (type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC) && type.count > 0) {
+            if (items->items[i + 1]->type != AST_OPER) {
+                unsupported();
+                break;
+            }
+
+            toks[count++] = (CondToken){ .type = COND_STRCMP, .left = value, .right = items->items[i + 2] };
+            toks[count++] = (CondToken){ .type = COND_OPER, .oper = items->items[i + 1]->oper };
+            toks[count++] = (CondToken){ .type = COND_ZERO };
+            i += 2;
+        } else
+            toks[count++] = (CondToken){ .type = COND_VALUE, .left = value };
+    }
+
+    Kind kind = KIND_I32;
+
+    if (supported && count > 0) {
+        size_t pos = 0;
+        kind = lower_condition_expr(toks, count, &pos, 1);
+
+        if (pos != count)
+            unsupported();
+    }
+
+    free(toks);
+    return kind;
+}
+
+static Kind lower_lengthof(AST *ast) {
+    AST *value = ast->lengthof_value;
+    PictureType type = value_type(value);
+
+    if (IS_STRING(type)) {
+        if (lower_value(value) != KIND_PTR)
+            unsupported();
+
+        emit(OP_STRLEN);
+        return KIND_U64;
+    }
+
+    size_t size = 0;
+
+    if (value->type == AST_INT || value->type == AST_BOOL || value->type == AST_ZERO)
+        size = sizeof(int);
+    else if (value->type == AST_FLOAT)
+        size = sizeof(double);
+    else if (value->type == AST_VAR || value->type == AST_FIELD || value->type == AST_SUBSCRIPT) {
+        // sizeof doesn't evaluate its operand, only the layout is needed.
+        const size_t start = prog->count;
+        LValue lv;
+        lower_address(value, &lv);
+        prog->count = start;
+        size = lv.count > 0 ? lv.size * lv.count : lv.size;
+    } else
+        unsupported();
+
+    emit_push(KIND_U64, (Value){ .u = size });
+    return KIND_U64;
+}
+
+// Pushes a value, strings are pushed as a pointer to their first character.
+static Kind lower_value(AST *ast) {
+    Value constant;
+    Kind kind;
+
+    if (constant_value(ast, &constant, &kind)) {
+        emit_push(kind, constant);
+        return kind;
+    }
+
+    switch (ast->type) {
+        case AST_STRING:
+            emit_push(KIND_PTR, (Value){ .s = unescape_string(ast->constant.string, NULL) });
+            return KIND_PTR;
+        case AST_VAR:
+        case AST_FIELD:
+        case AST_SUBSCRIPT: {
+            LValue lv;
+            lower_address(ast, &lv);
+
+            if (lv.count > 0 || lv.is_group) {
+                unsupported();
+                return KIND_I32;
+            } else if (lv.width > 0)
+                return KIND_PTR;
+
+            emit(OP_LOAD)->type = lv.type;
+            return promoted_kind(lv.type);
+        }
+        case AST_PARENS: return lower_value(ast->parens);
+        case AST_MATH: return lower_math(ast);
+        case AST_CONDITION: return lower_condition(ast);
+        case AST_NOT:
+            emit(OP_NOT)->type = lower_value(ast->not_value);
+            return KIND_I32;
+        case AST_LENGTHOF: return lower_lengthof(ast);
+        default: break;
+    }
+
+    unsupported();
+    emit_push(KIND_I32, (Value){ .i = 0 });
+    return KIND_I32;
+}
+
+// Pushes a condition jumps can test.
+static void lower_test(AST *ast) {
+    Kind kind = lower_value(ast);
+
+    if (kind != KIND_I32)
+        emit_bool(kind);
+}
+
+static Format *create_format(PictureType *type, Kind from) {
+    Buffer text = create_buffer(16);
+    emit_format_specifier(&text, type);
+
+    Format *format = arena_alloc(&prog->arena, sizeof(Format));
+    format->text = arena_strdup(&prog->arena, text.data);
+    format->from = from;
+    delete_buffer(&text);
+
+    const size_t len = strlen(format->text);
+    const char conv = format->text[len - 1];
+    unsigned int longs = 0;
+
+    for (char *c = format->text; *c != '\0'; c++) {
+        if (*c == 'l')
+            longs++;
+    }
+
+    switch (conv) {
+        case 'd':
+        case 'c': format->arg = longs == 0 ? ARG_INT : (longs == 1 ? ARG_LONG : ARG_LLONG); break;
+        case 'u':
+            if (strchr(format->text, 'z') != NULL)
+                format->arg = ARG_SIZE;
+            else
+                format->arg = longs == 0 ? ARG_UINT : (longs == 1 ? ARG_ULONG : ARG_ULLONG);
+            break;
+        case 'f':
+        case 'g': format->arg = ARG_DOUBLE; break;
+        case 's': format->arg = ARG_STRING; break;
+        default:
+            unsupported();
+            format->arg = ARG_INT;
+            break;
+    }
+
+    // printf() would read the wrong register, only the C backend gets that exactly right.
+    if ((format->arg == ARG_STRING) != (from == KIND_PTR) || (format->arg == ARG_DOUBLE) != (from == KIND_FLOAT || from == KIND_DOUBLE))
+        unsupported();
+
+    return format;
+}
+
+static ParseType parse_type(PictureType *type) {
+    if (type->type == TYPE_SIGNED_NUMERIC)
+        return PARSE_SIGNED;
+    else if (type->type == TYPE_DECIMAL_NUMERIC)
+        return PARSE_DECIMAL;
+
+    return PARSE_UNSIGNED;
+}
+
+static void lower_list(ASTList *list);
+static void lower_stmt(AST *ast);
+
+static void lower_display(AST *ast) {
+    PictureType type = value_type(ast->display.value);
+    Kind kind = lower_value(ast->display.value);
+    emit(OP_DISPLAY)->val.p = create_format(&type, kind);
+
+    if (ast->display.add_newline)
+        emit(OP_NEWLINE);
+}
+
+// Stores the value of kind on the stack the way emit_assign_math() stores
+// dst = items, with the result truncated to the digits of dst's picture.
+static void emit_assign(LValue *lv, AST *dst, AST **items, size_t count, bool rounded, Kind kind) {
+    unsigned int digits;
+
+    // Scaled integer math only has the code gcc gets.
+    if (!is_plain_assign(dst, items, count, rounded, &digits)) {
+        unsupported();
+        return;
+    }
+
+    if (digits > 0) {
+        int64_t power = 1;
+
+        for (unsigned int i = 0; i < digits; i++)
+            power *= 10;
+
+        emit_convert(kind, KIND_I64, 0);
+        emit_push(KIND_I64, (Value){ .i = power });
+        kind = lower_binary(OP_MOD, KIND_I64, KIND_I64);
+    }
+
+    emit_store(lv->type, kind);
+}
+
+static void lower_move(AST *ast) {
+    AST *dst = ast->move.dst;
+    AST *src = ast->move.src;
+
+    PictureType dst_type = value_type(dst);
+    PictureType src_type = value_type(src);
+
+    if (!supported || dst_type.comp_type == COMP_POINTER || src_type.comp_type == COMP_POINTER) {
+        unsupported();
+        return;
+    }
+
+    LValue lv;
+
+    if (IS_STRING(dst_type)) {
+        lower_string_storage(dst, &lv);
+
+        if (dst_type.count + 1 > lv.width)
+            unsupported();
+
+        Kind kind = lower_value(src);
+
+        if (IS_STRING(src_type)) {
+            if (kind != KIND_PTR)
+                unsupported();
+
+            emit(OP_STRNCPY)->arg = dst_type.count + 1;
+            return;
+        }
+
+        Instruction *ins = emit(OP_FORMAT);
+        ins->arg = dst_type.count + 1;
+        ins->val.p = create_format(&src_type, kind);
+    } else if (IS_STRING(src_type)) {
+        // Anything but these would pass strtod() a base.
+        if (dst_type.type != TYPE_SIGNED_NUMERIC && dst_type.type != TYPE_UNSIGNED_NUMERIC && dst_type.type != TYPE_DECIMAL_NUMERIC)
+            unsupported();
+
+        lower_storage(dst, &lv);
+
+        if (lower_value(src) != KIND_PTR)
+            unsupported();
+
+        Instruction *ins = emit(OP_PARSE);
+        ins->type = lv.type;
+        ins->from = parse_type(&dst_type);
+    } else {
+        lower_storage(dst, &lv);
+        emit_assign(&lv, dst, &src, 1, false, lower_value(src));
+    }
+}
+
+static void lower_arithmetic(AST *ast) {
+    AST *left = ast->arithmetic.left;
+    AST *right = ast->arithmetic.right;
+    AST *dst = ast->arithmetic.implicit_giving ? right : ast->arithmetic.dst;
+    char *name = ast->arithmetic.name;
+
+    if (dst == NULL) {
+        unsupported();
+        return;
+    }
+
+    LValue lv;
+    lower_storage(dst, &lv);
+    Kind kind;
+
+    // The same expression emit_arithmetic() hands emit_assign_math().
+    AST oper = { .type = AST_OPER };
+    AST *items[3] = { left, &oper, right };
+
+    if (strcmp(name, "SUBTRACT") == 0) {
+        items[0] = right;
+        oper.oper = TOK_MINUS;
+        items[2] = left;
+        Kind a = lower_value(right);
+        kind = lower_binary(OP_SUB, a, lower_value(left));
+    } else if (strcmp(name, "ADD") == 0 || strcmp(name, "MULTIPLY") == 0 || strcmp(name, "DIVIDE") == 0) {
+        Opcode op = name[0] == 'A' ? OP_ADD : (name[0] == 'M' ? OP_MUL : OP_DIV);
+        oper.oper = name[0] == 'A' ? TOK_PLUS : (name[0] == 'M' ? TOK_STAR : TOK_SLASH);
+        Kind a = lower_value(left);
+        kind = lower_binary(op, a, lower_value(right));
+    } else {
+        oper.oper = TOK_MOD;
+        Kind a = lower_value(left);
+        emit_convert(a, KIND_I64, 0);
+        kind = lower_binary(OP_MOD, KIND_I64, lower_value(right));
+    }
+
+    emit_assign(&lv, dst, items, 3, ast->arithmetic.rounded, kind);
+}
+
+static void lower_compute(AST *ast) {
+    AST *math = ast->compute.math;
+    LValue lv;
+    lower_storage(ast->compute.dst, &lv);
+    emit_assign(&lv, ast->compute.dst, math->math.items, math->math.size, ast->compute.rounded, lower_value(math));
+}
+
+static void lower_if(AST *ast) {
+    lower_test(ast->if_stmt.condition);
+    const size_t jump = emit_jump(OP_JZ);
+    lower_list(&ast->if_stmt.body);
+
+    if (ast->if_stmt.else_body.size == 0) {
+        patch_jump(jump);
+        return;
+    }
+
+    const size_t end = emit_jump(OP_JMP);
+    patch_jump(jump);
+    lower_list(&ast->if_stmt.else_body);
+    patch_jump(end);
+}
+
+static void lower_perform(AST *ast) {
+    if (ast->perform->type != AST_LABEL) {
+        unsupported();
+        return;
+    }
+
+    if (call_count == call_cap) {
+        call_cap = call_cap == 0 ? 16 : call_cap * 2;
+        calls = realloc(calls, call_cap * sizeof(PendingCall));
+    }
+
+    calls[call_count++] = (PendingCall){ .at = prog->count, .label = ast->perform->label };
+    emit(OP_CALL);
+}
+
+static void lower_perform_condition(AST *ast) {
+    const size_t loop = prog->count;
+    lower_test(ast->perform_condition.condition);
+    const size_t end = emit_jump(OP_JNZ);
+    lower_stmt(ast->perform_condition.proc);
+    emit_jump_to(OP_JMP, loop);
+    patch_jump(end);
+}
+
+static void lower_perform_count(AST *ast) {
+    // The counter stays on the stack for the whole loop.
+    emit_push(KIND_U32, (Value){ .u = ast->perform_count.times });
+    const size_t loop = prog->count;
+    emit(OP_DUP);
+    const size_t end = emit_jump(OP_JZ);
+    lower_stmt(ast->perform_count.proc);
+    emit(OP_DEC);
+    emit_jump_to(OP_JMP, loop);
+    patch_jump(end);
+    emit(OP_POP);
+}
+
+static void lower_perform_varying(AST *ast) {
+    AST *var = ast->perform_varying.var;
+    LValue lv;
+
+    lower_storage(var, &lv);
+    emit_store(lv.type, lower_value(ast->perform_varying.from));
+
+    const size_t loop = prog->count;
+    lower_test(ast->perform_varying.until);
+    const size_t end = emit_jump(OP_JNZ);
+    lower_list(&ast->perform_varying.body);
+
+    lower_storage(var, &lv);
+    Kind current = lower_value(var);
+    emit_store(lv.type, lower_binary(OP_ADD, current, lower_value(ast->perform_varying.by)));
+    emit_jump_to(OP_JMP, loop);
+    patch_jump(end);
+}
+
+static void lower_perform_until(AST *ast) {
+    const size_t loop = prog->count;
+    lower_test(ast->perform_until.until);
+    const size_t end = emit_jump(OP_JNZ);
+    lower_list(&ast->perform_until.body);
+    emit_jump_to(OP_JMP, loop);
+    patch_jump(end);
+}
+
+// Mirrors emit_string_stmt() and the sizes emit_string_stmt_previous_size() picks.
+static void lower_string_part(StringStatement *stmt, StringPart *part) {
+    AST *value = stmt->value;
+    PictureType type = value_type(value);
+    *part = (StringPart){ .type = PART_NCAT };
+
+    if (value->type == AST_STRING && stmt->delimit == DELIM_SIZE) {
+        part->type = PART_CAT;
+        part->const_size = true;
+        part->size = strlen(value->constant.string);
+    } else if (type.type != TYPE_ALPHABETIC && type.type != TYPE_ALPHANUMERIC && type.count == 0) {
+        part->type = PART_FORMAT;
+        part->format = create_format(&type, lower_value(value));
+        return;
+    } else if (value->type == AST_STRING) {
+        part->const_size = true;
+        part->size = strcspn(value->constant.string, " ");
+    } else if (!IS_STRING(type))
+        unsupported();
+
+    if (lower_value(value) != KIND_PTR)
+        unsupported();
+}
+
+static void lower_string_builder(AST *ast) {
+    StringOp *op = arena_alloc(&prog->arena, sizeof(StringOp));
+    op->part_count = ast->string_builder.stmt_count + 1;
+    op->parts = arena_alloc(&prog->arena, op->part_count * sizeof(StringPart));
+    op->push_pointer = ast->string_builder.with_pointer != NULL;
+
+    LValue pointer;
+
+    if (op->push_pointer)
+        lower_storage(ast->string_builder.with_pointer, &pointer);
+
+    lower_string_part(&ast->string_builder.base, &op->parts[0]);
+
+    for (size_t i = 0; i < ast->string_builder.stmt_count; i++)
+        lower_string_part(&ast->string_builder.stmts[i], &op->parts[i + 1]);
+
+    PictureType type = value_type(ast->string_builder.into_var);
+    LValue into;
+    lower_string_storage(ast->string_builder.into_var, &into);
+    op->into_width = type.count + 1;
+
+    if (op->into_width > into.width)
+        unsupported();
+
+    emit(OP_STRING)->val.p = op;
+
+    if (op->push_pointer)
+        emit_store(pointer.type, KIND_U64);
+}
+
+static void lower_unstring(AST *ast) {
+    UnstringOp *op = arena_alloc(&prog->arena, sizeof(UnstringOp));
+    ASTList *into_vars = &ast->string_splitter.into_vars;
+    op->delim_space = ast->string_splitter.base.delimit == DELIM_SPACE;
+    op->into_count = into_vars->size;
+    op->widths = arena_alloc(&prog->arena, (into_vars->size + 1) * sizeof(size_t));
+
+    if (lower_value(ast->string_splitter.base.value) != KIND_PTR)
+        unsupported();
+
+    for (size_t i = 0; i < into_vars->size; i++) {
+        PictureType type = value_type(into_vars->items[i]);
+        LValue into;
+        lower_string_storage(into_vars->items[i], &into);
+        op->widths[i] = type.count + 1;
+
+        if (op->widths[i] > into.width)
+            unsupported();
+    }
+
+    emit(OP_UNSTRING)->val.p = op;
+}
+
+static void lower_open(AST *ast) {
+    Slot *file = find_slot(ast->open.filename->var.name);
+
+    if (file == NULL || !file->is_file || file->filename == NULL) {
+        unsupported();
+        return;
+    }
+
+    if (lower_value(file->filename) != KIND_PTR)
+        unsupported();
+
+    emit_addr(file->status != NULL ? file->status->offset : status_offset);
+
+    Instruction *ins = emit(OP_OPEN);
+    ins->type = ast->open.type;
+    ins->arg = file->file;
+}
+
+static Slot *find_file(AST *ast) {
+    Slot *file = ast->type == AST_VAR ? find_slot(ast->var.name) : NULL;
+
+    if (file == NULL || !file->is_file) {
+        unsupported();
+        return NULL;
+    }
+
+    return file;
+}
+
+static void lower_close(AST *ast) {
+    Slot *file = find_file(ast->close_filename);
+
+    if (file != NULL)
+        emit(OP_CLOSE)->arg = file->file;
+}
+
+static void lower_read(AST *ast) {
+    Slot *file = find_file(ast->read.fd);
+    Slot *into = ast->read.into->type == AST_VAR ? find_slot(ast->read.into->var.name) : NULL;
+
+    if (file == NULL || !is_plain_string(into)) {
+        unsupported();
+        return;
+    }
+
+    emit_addr(into->offset);
+    Instruction *ins = emit(OP_READ);
+    ins->arg = file->file;
+    ins->val.u = into->width - 1;
+
+    ASTList *at_end = &ast->read.at_end_stmts;
+    ASTList *not_at_end = &ast->read.not_at_end_stmts;
+
+    if (at_end->size == 0 && not_at_end->size == 0) {
+        emit(OP_POP);
+        return;
+    } else if (at_end->size == 0) {
+        const size_t end = emit_jump(OP_JZ);
+        lower_list(not_at_end);
+        patch_jump(end);
+        return;
+    }
+
+    const size_t jump = emit_jump(OP_JNZ);
+    lower_list(at_end);
+
+    if (not_at_end->size == 0) {
+        patch_jump(jump);
+        return;
+    }
+
+    const size_t end = emit_jump(OP_JMP);
+    patch_jump(jump);
+    lower_list(not_at_end);
+    patch_jump(end);
+}
+
+static void lower_write(AST *ast) {
+    PictureType type = value_type(ast->write.value);
+    Kind kind = lower_value(ast->write.value);
+    emit(OP_WRITE)->val.p = create_format(&type, kind);
+}
+
+static void lower_inspect(AST *ast) {
+    // Only TALLYING and REPLACING generate any code.
+    if (ast->inspect.type != INSPECT_TALLYING && ast->inspect.type != INSPECT_REPLACING)
+        return;
+
+    InspectOp *op = arena_alloc(&prog->arena, sizeof(InspectOp));
+    memset(op, 0, sizeof(InspectOp));
+    op->replacing = ast->inspect.type == INSPECT_REPLACING;
+    op->operand_count = 1;
+
+    // Replacing writes through the pointer.
+    if (lower_value(ast->inspect.input_string) != KIND_PTR || (op->replacing && ast->inspect.input_string->type == AST_STRING))
+        unsupported();
+
+    if (!op->replacing) {
+        InspectTallying *tallying = &ast->inspect.tallying;
+        op->tallies = arena_alloc(&prog->arena, (tallying->tally_count + 1) * sizeof(TallyOp));
+
+        for (size_t i = 0; i < tallying->tally_count; i++) {
+            StringTally *tally = &tallying->tallies[i];
+            TallyOp *tally_op = &op->tallies[op->count];
+
+            if (tally->type == TALLY_CHARACTERS) {
+                *tally_op = (TallyOp){ .type = TALLY_OP_CHARACTERS };
+                op->count++;
+                continue;
+            } else if (tally->type != TALLY_ALL)
+                continue;
+
+            *tally_op = (TallyOp){ .type = TALLY_OP_ALL, .before = tally->phase.before, .after = tally->phase.after,
+                .has_modifier = tally->phase.modifier != NULL };
+
+            tally_op->value = lower_value(tally->phase.value);
+            op->operand_count += 2;
+
+            if (tally_op->has_modifier) {
+                tally_op->modifier = lower_value(tally->phase.modifier);
+                op->operand_count++;
+            }
+
+            LValue output;
+            lower_storage(tally->output_count, &output);
+            tally_op->output = output.type;
+
+            if (tally_op->value == KIND_PTR || (tally_op->has_modifier && tally_op->modifier == KIND_PTR))
+                unsupported();
+
+            op->count++;
+        }
+    } else {
+        InspectReplacing *replacing = &ast->inspect.replacing;
+        op->replaces = arena_alloc(&prog->arena, (replacing->replace_count + 1) * sizeof(ReplaceOp));
+        op->count = replacing->replace_count;
+
+        for (size_t i = 0; i < replacing->replace_count; i++) {
+            StringReplace *replace = &replacing->replaces[i];
+            ReplaceOp *replace_op = &op->replaces[i];
+            *replace_op = (ReplaceOp){ .first = replace->type == REPLACING_FIRST, .before = replace->before, .after = replace->after };
+
+            if (replace->before || replace->after) {
+                if (replace->modifier == NULL) {
+                    unsupported();
+                    return;
+                }
+
+                replace_op->modifier = lower_value(replace->modifier);
+                op->operand_count++;
+            }
+
+            replace_op->old = lower_value(replace->old);
+            replace_op->new = lower_value(replace->new);
+            op->operand_count += 2;
+
+            if (replace_op->old == KIND_PTR || replace_op->new == KIND_PTR || ((replace->before || replace->after) && replace_op->modifier == KIND_PTR))
+                unsupported();
+        }
+    }
+
+    emit(OP_INSPECT)->val.p = op;
+}
+
+static void lower_accept(AST *ast) {
+    AST *dst = ast->accept.dst;
+    LValue lv;
+
+    if (dst->type != AST_VAR) {
+        unsupported();
+        return;
+    }
+
+    if (ast->accept.from != NULL && ast->accept.from->type == AST_ARGV) {
+        lower_string_storage(dst, &lv);
+        emit(OP_ACCEPT_ARGV)->arg = lv.width;
+        return;
+    }
+
+    PictureType type = value_type(dst);
+
+    if (IS_STRING(type)) {
+        lower_string_storage(dst, &lv);
+
+        if (type.count + 1 > lv.width)
+            unsupported();
+
+        emit(OP_ACCEPT)->arg = type.count + 1;
+        return;
+    }
+
+    lower_storage(dst, &lv);
+    Instruction *ins = emit(OP_ACCEPT_NUM);
+    ins->type = lv.type;
+    ins->from = parse_type(&type);
+}
+
+static void lower_stmt(AST *ast) {
+    cur_node = ast;
+
+    switch (ast->type) {
+        case AST_NOP:
+        case AST_LABEL: return;
+        // Laid out up front.
+        case AST_PIC:
+            if (find_slot(ast->pic.name) == NULL)
+                unsupported();
+            return;
+        case AST_SELECT: return;
+        // Both return from the current procedure, or end the program in main.
+        case AST_STOP:
+        case AST_STOP_RUN: emit(OP_RET); return;
+        case AST_EXIT: emit(OP_HALT); return;
+        case AST_DISPLAY: lower_display(ast); return;
+        case AST_MOVE: lower_move(ast); return;
+        case AST_ARITHMETIC: lower_arithmetic(ast); return;
+        case AST_COMPUTE: lower_compute(ast); return;
+        case AST_IF: lower_if(ast); return;
+        case AST_PERFORM: lower_perform(ast); return;
+        case AST_PROC: astlist_push(&procs, ast); return;
+        case AST_PERFORM_CONDITION: lower_perform_condition(ast); return;
+        case AST_PERFORM_COUNT: lower_perform_count(ast); return;
+        case AST_PERFORM_VARYING: lower_perform_varying(ast); return;
+        case AST_PERFORM_UNTIL: lower_perform_until(ast); return;
+        case AST_STRING_BUILDER: lower_string_builder(ast); return;
+        case AST_STRING_SPLITTER: lower_unstring(ast); return;
+        case AST_OPEN: lower_open(ast); return;
+        case AST_CLOSE: lower_close(ast); return;
+        case AST_READ: lower_read(ast); return;
+        case AST_WRITE: lower_write(ast); return;
+        case AST_INSPECT: lower_inspect(ast); return;
+        case AST_ACCEPT: lower_accept(ast); return;
+        default: break;
+    }
+
+    // CALL and pointers need the C backend.
+    unsupported();
+}
+
+static void lower_list(ASTList *list) {
+    for (size_t i = 0; i < list->size && supported; i++)
+        lower_stmt(list->items[i]);
+}
+
+static void lower_procedure(AST *ast) {
+    cur_node = ast;
+    Slot *slot = add_slot(ast->proc.name);
+
+    if (slot == NULL) {
+        unsupported();
+        return;
+    }
+
+    slot->is_proc = true;
+    slot->address = prog->count;
+    lower_list(&ast->proc.body);
+    emit(OP_RET);
+}
+
+static void resolve_calls() {
+    for (size_t i = 0; i < call_count; i++) {
+        Slot *slot = find_slot(calls[i].label);
+
+        if (slot == NULL || !slot->is_proc) {
+            unsupported();
+            return;
+        }
+
+        prog->code[calls[i].at].arg = slot->address;
+    }
+}
+
+Program *create_program(AST *root, AST **fallback) {
+    prog = calloc(1, sizeof(Program));
+    prog->arena = create_arena(ARENA_BLOCK_SIZE);
+    prog->cap = 256;
+    prog->code = malloc(prog->cap * sizeof(Instruction));
+
+    supported = true;
+    cur_node = root;
+    unsupported_node = NULL;
+    slot_cap = SLOT_TABLE_INITIAL_SIZE;
+    slot_count = 0;
+    slots = calloc(slot_cap, sizeof(Slot *));
+    call_count = call_cap = 0;
+    calls = NULL;
+    procs = create_astlist();
+
+    layout_root(&root->root);
+    lower_list(&root->root);
+    emit(OP_HALT);
+
+    // Procedures can nest, so this grows as it goes.
+    for (size_t i = 0; i < procs.size && supported; i++)
+        lower_procedure(procs.items[i]);
+
+    if (supported) {
+        cur_node = root;
+        resolve_calls();
+    }
+
+    free(slots);
+    free(calls);
+    slots = NULL;
+    calls = NULL;
+
+    Program *out = prog;
+    prog = NULL;
+
+    if (!supported) {
+        *fallback = unsupported_node;
+        delete_program(out);
+        return NULL;
+    }
+
+    return out;
+}
+
+void delete_program(Program *prog) {
+    free(prog->code);
+    free(prog->data);
+    delete_arena(&prog->arena);
+    free(prog);
+}
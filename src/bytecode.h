@@ -0,0 +1,210 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ast.h"
+#include "arena.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// How a picture is stored, the same C type picturetype_to_c() gives it.
+typedef enum {
+    CTYPE_CHAR,
+    CTYPE_I16,
+    CTYPE_U16,
+    CTYPE_I32,
+    CTYPE_U32,
+    CTYPE_I64,
+    CTYPE_U64,
+    CTYPE_FLOAT,
+    CTYPE_DOUBLE
+} CType;
+
+// What a value on the interpreter's stack is once C's integer promotions
+// are applied. Strings are pointers to their storage.
+typedef enum {
+    KIND_I32,
+    KIND_U32,
+    KIND_I64,
+    KIND_U64,
+    KIND_FLOAT,
+    KIND_DOUBLE,
+    KIND_PTR
+} Kind;
+
+typedef enum {
+    OP_PUSH,
+    OP_ADDR,
+    OP_INDEX,
+    OP_OFFSET,
+    OP_LOAD,
+    OP_STORE,
+    OP_CONV,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_EQ,
+    OP_NEQ,
+    OP_LT,
+    OP_LTE,
+    OP_GT,
+    OP_GTE,
+    OP_NOT,
+    OP_BOOL,
+    OP_STRCMP,
+    OP_STRLEN,
+    OP_JMP,
+    OP_JZ,
+    OP_JNZ,
+    OP_JZK,
+    OP_JNZK,
+    OP_POP,
+    OP_DUP,
+    OP_DEC,
+    OP_CALL,
+    OP_RET,
+    OP_HALT,
+    OP_DISPLAY,
+    OP_NEWLINE,
+    OP_WRITE,
+    OP_FORMAT,
+    OP_STRNCPY,
+    OP_PARSE,
+    OP_OPEN,
+    OP_CLOSE,
+    OP_READ,
+    OP_ACCEPT,
+    OP_ACCEPT_NUM,
+    OP_ACCEPT_ARGV,
+    OP_STRING,
+    OP_UNSTRING,
+    OP_INSPECT
+} Opcode;
+
+typedef union {
+    int64_t i;
+    uint64_t u;
+    double f;
+    char *s;
+    void *p;
+} Value;
+
+typedef struct {
+    uint8_t op;
+    uint8_t type;  // The Kind or CType the instruction works on.
+    uint8_t from;  // The Kind being converted from.
+    uint32_t arg;  // Jump target, bound, width or table index.
+    Value val;
+} Instruction;
+
+// A printf() format and the C type its argument has to be passed as.
+typedef struct {
+    char *text;
+    Kind from;
+
+    enum {
+        ARG_INT,
+        ARG_UINT,
+        ARG_LONG,
+        ARG_ULONG,
+        ARG_LLONG,
+        ARG_ULLONG,
+        ARG_SIZE,
+        ARG_DOUBLE,
+        ARG_STRING
+    } arg;
+} Format;
+
+// How strtol(), strtoul() or strtod() style conversions parse a string.
+typedef enum {
+    PARSE_SIGNED,
+    PARSE_UNSIGNED,
+    PARSE_DECIMAL
+} ParseType;
+
+// One sending item of a STRING statement.
+typedef struct {
+    enum {
+        PART_CAT,
+        PART_FORMAT,
+        PART_NCAT
+    } type;
+
+    // Sizes known at compile time come from the literal as written.
+    bool const_size;
+    size_t size;
+    Format *format;
+} StringPart;
+
+typedef struct {
+    StringPart *parts;
+    size_t part_count;
+    size_t into_width;
+    bool push_pointer;
+} StringOp;
+
+typedef struct {
+    bool delim_space;
+    size_t *widths;
+    size_t into_count;
+} UnstringOp;
+
+typedef struct {
+    enum {
+        TALLY_OP_CHARACTERS,
+        TALLY_OP_ALL
+    } type;
+
+    bool before;
+    bool after;
+    bool has_modifier;
+    Kind value;
+    Kind modifier;
+    CType output;
+} TallyOp;
+
+typedef struct {
+    bool first;
+    bool before;
+    bool after;
+    Kind modifier;
+    Kind old;
+    Kind new;
+} ReplaceOp;
+
+typedef struct {
+    bool replacing;
+    TallyOp *tallies;
+    ReplaceOp *replaces;
+    size_t count;
+    size_t operand_count;
+} InspectOp;
+
+// A program lowered from the AST, ready for run_program().
+typedef struct {
+    Instruction *code;
+    size_t count;
+    size_t cap;
+
+    // Every picture laid out as the generated C would lay out its globals.
+    unsigned char *data;
+    size_t data_size;
+    size_t file_count;
+
+    // Constants, formats and operand tables.
+    Arena arena;
+} Program;
+
+// Returns NULL if root uses something only the C backend can build, fallback is then the node it couldn't lower.
+Program *create_program(AST *root, AST **fallback);
+void delete_program(Program *prog);
+
+// The conversions C does on assignment and in arithmetic.
+Value convert_value(Value value, Kind from, Kind to);
+Kind promoted_kind(CType type);
+Kind common_kind(Kind left, Kind right);
+Value load_value(unsigned char *src, CType type);
+void store_value(unsigned char *dst, CType type, Value value, Kind from);
+
+#endif
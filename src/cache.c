@@ -0,0 +1,331 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "cache.h"
+#include "compile.h"
+#include "hash.h"
+#include "buffer.h"
+#include "process.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+extern char *cc_path;
+
+// An object waiting for its gcc job before it can be copied into the cache.
+typedef struct {
+    char source_key[HASH_HEX_LEN + 1];
+    char object_key[HASH_HEX_LEN + 1];
+    char *manifest;
+    char *objfile;
+} PendingEntry;
+
+// Entries live in two files: '<source key>.dep' lists the object key and the hash of every
+// copybook the source pulled in, '<object key>.o' is the object built from all of them.
+// The source key covers the source and everything that changes the generated code,
+// the object key adds the copybooks so editing one misses even if the source is unchanged.
+static char *cache_dir = NULL;
+static Hash config_hash;
+
+// The file going through the front end after a miss.
+static bool recording = false;
+static Hash source_hash;
+static Hash object_hash;
+static Buffer deps;
+
+static PendingEntry *pending = NULL;
+static size_t pending_count = 0;
+
+static char *entry_path(const char *key, const char *extension) {
+    char *path = malloc(strlen(cache_dir) + strlen(key) + strlen(extension) + 3);
+    sprintf(path, "%s/%s.%s", cache_dir, key, extension);
+    return path;
+}
+
+static bool copy_file(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+
+    if (in == NULL)
+        return false;
+
+    FILE *out = fopen(to, "wb");
+
+    if (out == NULL) {
+        fclose(in);
+        return false;
+    }
+
+    char buf[64 * 1024];
+    size_t len;
+    bool ok = true;
+
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, len, out) != len) {
+            ok = false;
+            break;
+        }
+    }
+
+    fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+// Writes through a temporary so other cobc processes sharing the cache never see half an entry.
+static void store_file(const char *from, const char *data, const char *key, const char *extension) {
+    char *path = entry_path(key, extension);
+    char *tmp = malloc(strlen(path) + 32);
+    sprintf(tmp, "%s.%ld.tmp", path, (long)getpid());
+
+    bool ok;
+
+    if (from != NULL)
+        ok = copy_file(from, tmp);
+    else {
+        FILE *out = fopen(tmp, "wb");
+        ok = out != NULL && fputs(data, out) >= 0;
+
+        if (out != NULL && fclose(out) != 0)
+            ok = false;
+    }
+
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+
+    if (!ok || rename(tmp, path) != 0)
+        remove(tmp);
+
+    free(tmp);
+    free(path);
+}
+
+// The compiler's version is part of every key, an upgrade shouldn't reuse old objects.
+static bool hash_compiler(Hash *hash) {
+    ArgList args = create_arglist();
+    arglist_push(&args, cc_path);
+    arglist_push(&args, "--version");
+
+    char *version = command_output(&args);
+    delete_arglist(&args);
+
+    if (version == NULL)
+        return false;
+
+    hash_string(hash, version);
+    free(version);
+    return true;
+}
+
+// -march=native builds for whatever CPU cobc runs on, so a cache shared between machines
+// is keyed by the options it resolves to on this one rather than the word 'native'.
+static bool hash_native_target(Hash *hash) {
+    ArgList args = create_arglist();
+    arglist_push(&args, cc_path);
+    arglist_push(&args, "-march=native");
+    arglist_push(&args, "-Q");
+    arglist_push(&args, "--help=target");
+
+    char *target = command_output(&args);
+    delete_arglist(&args);
+
+    if (target == NULL)
+        return false;
+
+    hash_string(hash, target);
+    free(target);
+    return true;
+}
+
+// Which cobc made something, anything cached by another build is stale.
+void hash_build(Hash *hash) {
+    hash_string(hash, CACHE_VERSION " " __DATE__ " " __TIME__);
+}
+
+// Enables the cache for this run, any failure just leaves it off.
+void cache_init(char *dir, char *cflags, char *libs, char *source_includes, unsigned int flags) {
+#ifdef _WIN32
+    if (_mkdir(dir) != 0 && errno != EEXIST)
+#else
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+#endif
+        return;
+
+    config_hash = create_hash();
+    hash_build(&config_hash);
+    hash_string(&config_hash, cc_path);
+
+    if (!hash_compiler(&config_hash))
+        return;
+
+    const unsigned int emit_flags = flags & (COMP_NO_MAIN | COMP_DEBUG | COMP_WHOLE_PROGRAM | COMP_COMPUTED_GOTO);
+    hash_string(&config_hash, cflags);
+
+    // A compiler that can't say what native means gets no cache rather than a wrong one.
+    if (strstr(cflags, "-march=native") != NULL && !hash_native_target(&config_hash))
+        return;
+
+    hash_string(&config_hash, libs);
+    hash_string(&config_hash, source_includes);
+    hash_update(&config_hash, &emit_flags, sizeof(emit_flags));
+
+    cache_dir = dir;
+}
+
+// Adds something else the generated code depends on to every key.
+void cache_add_config(char *str) {
+    if (cache_dir != NULL)
+        hash_string(&config_hash, str);
+}
+
+// Checks every copybook listed in the manifest still hashes the same and adds them to the object key.
+static bool check_manifest(FILE *f, Hash *object, char *object_key) {
+    char line[4096];
+
+    if (fgets(line, sizeof(line), f) == NULL || strlen(line) != HASH_HEX_LEN + 1)
+        return false;
+
+    memcpy(object_key, line, HASH_HEX_LEN);
+    object_key[HASH_HEX_LEN] = '\0';
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (strlen(line) < HASH_HEX_LEN + 2 || line[HASH_HEX_LEN] != ' ')
+            return false;
+
+        Hash copybook = create_hash();
+        char hex[HASH_HEX_LEN + 1];
+
+        if (!hash_file(&copybook, line + HASH_HEX_LEN + 1))
+            return false;
+
+        hash_to_hex(&copybook, hex);
+
+        if (strncmp(hex, line, HASH_HEX_LEN) != 0)
+            return false;
+
+        hash_string(object, hex);
+    }
+
+    char hex[HASH_HEX_LEN + 1];
+    hash_to_hex(object, hex);
+    return strcmp(hex, object_key) == 0;
+}
+
+// Copies a cached object for infile to objfile if nothing it was built from has changed.
+// On a miss the front end's copybooks are recorded until cache_finish_file().
+bool cache_fetch(char *infile, char *basefile, char *objfile) {
+    recording = false;
+
+    if (cache_dir == NULL)
+        return false;
+
+    source_hash = config_hash;
+    hash_string(&source_hash, basefile);
+
+    if (!hash_file(&source_hash, infile))
+        return false;
+
+    char source_key[HASH_HEX_LEN + 1];
+    hash_to_hex(&source_hash, source_key);
+
+    char *manifest = entry_path(source_key, "dep");
+    FILE *f = fopen(manifest, "r");
+    free(manifest);
+
+    if (f != NULL) {
+        Hash object = source_hash;
+        char object_key[HASH_HEX_LEN + 1];
+        bool hit = check_manifest(f, &object, object_key);
+        fclose(f);
+
+        if (hit) {
+            char *path = entry_path(object_key, "o");
+            hit = copy_file(path, objfile);
+            free(path);
+
+            if (hit)
+                return true;
+        }
+    }
+
+    recording = true;
+    object_hash = source_hash;
+
+    if (deps.data == NULL)
+        deps = create_buffer(256);
+
+    deps.len = 0;
+    deps.data[0] = '\0';
+    return false;
+}
+
+void cache_add_copybook(char *path) {
+    if (!recording)
+        return;
+
+    Hash copybook = create_hash();
+    char hex[HASH_HEX_LEN + 1];
+
+    // A missing copybook is an error anyway, there's nothing to cache.
+    if (!hash_file(&copybook, path)) {
+        recording = false;
+        return;
+    }
+
+    hash_to_hex(&copybook, hex);
+    hash_string(&object_hash, hex);
+    buffer_appendf(&deps, "%s %s\n", hex, path);
+}
+
+// Queues the object the current file's gcc job will produce.
+void cache_finish_file(char *objfile) {
+    if (!recording)
+        return;
+
+    recording = false;
+    pending = realloc(pending, (pending_count + 1) * sizeof(PendingEntry));
+    PendingEntry *entry = &pending[pending_count++];
+
+    hash_to_hex(&source_hash, entry->source_key);
+    hash_to_hex(&object_hash, entry->object_key);
+
+    entry->manifest = malloc(HASH_HEX_LEN + deps.len + 2);
+    sprintf(entry->manifest, "%s\n%s", entry->object_key, deps.data);
+    entry->objfile = mystrdup(objfile);
+}
+
+// Copies every queued object into the cache once all jobs are done, or drops them if store is false.
+void cache_commit(bool store) {
+    for (size_t i = 0; i < pending_count; i++) {
+        PendingEntry *entry = &pending[i];
+
+        // The object goes in first so a manifest never points at a missing object.
+        if (store) {
+            store_file(entry->objfile, NULL, entry->object_key, "o");
+            store_file(NULL, entry->manifest, entry->source_key, "dep");
+        }
+
+        free(entry->manifest);
+        free(entry->objfile);
+    }
+
+    free(pending);
+    pending = NULL;
+    pending_count = 0;
+    delete_buffer(&deps);
+}
@@ -0,0 +1,18 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "hash.h"
+
+#define CACHE_VERSION "1"
+
+void hash_build(Hash *hash);
+void cache_init(char *dir, char *cflags, char *libs, char *source_includes, unsigned int flags);
+void cache_add_config(char *str);
+bool cache_fetch(char *infile, char *basefile, char *objfile);
+void cache_add_copybook(char *path);
+void cache_finish_file(char *objfile);
+void cache_commit(bool store);
+
+#endif
@@ -4,131 +4,350 @@
 #include "ast.h"
 #include "transpiler.h"
 #include "error.h"
+#include "arena.h"
+#include "process.h"
+#include "cache.h"
+#include "copybook.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "report.h"
+#include "symtab.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
 
-#define RELEASE_CFLAGS "-std=c99 -O1 -w"
+// SORT makes its runs on worker threads where there are pthreads, only
+// files with an SD are compiled with them.
+#ifdef _WIN32
+#define THREAD_FLAGS ""
+#else
+#define THREAD_FLAGS "-pthread"
+#endif
+
+#define RELEASE_CFLAGS "-std=c99 -w"
 #define DEBUG_CFLAGS "-std=c99 -g"
 
+// Release builds without -O<level>.
+#define DEFAULT_OPT_LEVEL "-O1"
+
 extern char *cc_path;
+extern char *cache_dir;
+extern char *opt_level;
+extern char *march;
+
+// What every C compiler job of this build is given.
+static char *cflags;
+
+// Code generation flags, which an LTO link needs too.
+static char *codegen_flags;
+
+// Whether an object of this build may start threads. Cached objects skip
+// the front end, so one of them is taken to.
+static bool link_threads;
+
+// Names any input file's LINKAGE SECTION declares, for -fwhole-program.
+SymbolTable *linked_names = NULL;
+static SymbolTable linked_name_table;
+static Arena linked_name_arena;
 
 char *cur_dir;
 
+// Everything the front end allocates for the file being compiled
+// lives here and is released in one go once it has been emitted.
+Arena *cur_arena;
+
 void extract_cur_dir_and_basefile(char *path, char **out_filename);
 
 int compile_one_file(AST *root, char *basefile, char *infile, char *outfile, unsigned int flags, char *libs, char *source_includes, char **out_finalfile);
 
+// How the executable is run from the current directory.
+static char *exec_name(char *outfile) {
+    char *exec = malloc(strlen(outfile) + 3);
+
+#ifdef _WIN32
+    sprintf(exec, ".\\%s", outfile);
+#else
+    sprintf(exec, "./%s", outfile);
+#endif
+
+    return exec;
+}
+
+// Runs the program with the argv the built executable would get from 'run'.
+static int interpret_program(Program *prog, char *outfile) {
+    char *exec = exec_name(outfile);
+    char *argv[] = { exec, NULL };
+    Timer timer = start_timer();
+    int run_status = run_program(prog, 1, argv);
+    report_phase(PHASE_RUN, &timer);
+    (void)run_status; // Don't care about the result, same as a built executable.
+    delete_program(prog);
+    free(exec);
+    return EXIT_SUCCESS;
+}
+
+void print_mem_report(char *infile, Arena *arena) {
+    fprintf(stderr, "cobc: memory report for '%s':\n"
+                    "    allocations         %zu\n"
+                    "    bytes allocated     %zu\n"
+                    "    blocks              %zu\n"
+                    "    bytes reserved      %zu\n", infile, arena->allocations, arena->bytes_used, arena->block_count, arena->bytes_reserved);
+}
+
+// Debug builds stay unoptimised unless a level is asked for.
+static void make_cflags(unsigned int flags) {
+    char *level = opt_level != NULL ? opt_level : (flags & COMP_DEBUG) ? "" : DEFAULT_OPT_LEVEL;
+    char *arch = march != NULL ? march : "";
+    char *lto = (flags & COMP_LTO) ? "-flto" : "";
+
+    codegen_flags = malloc(strlen(level) + strlen(arch) + strlen(lto) + 3);
+    sprintf(codegen_flags, "%s %s %s", level, arch, lto);
+
+    char *base = (flags & COMP_DEBUG) ? DEBUG_CFLAGS : RELEASE_CFLAGS;
+    cflags = malloc(strlen(base) + strlen(codegen_flags) + 2);
+    sprintf(cflags, "%s %s", base, codegen_flags);
+}
+
+// Every file has to be looked at before the first is emitted, since any of them may link to
+// data an earlier one defines. The names are part of each file's cache key for the same reason.
+static bool collect_linked_names(char **infiles, size_t infile_count) {
+    linked_name_arena = create_arena(ARENA_BLOCK_SIZE);
+    cur_arena = &linked_name_arena;
+    linked_name_table = create_symtab(SYMTAB_INITIAL_SIZE);
+    linked_names = &linked_name_table;
+
+    for (size_t i = 0; i < infile_count; i++)
+        collect_linkage_names(infiles[i], infiles, linked_names);
+
+    cur_arena = NULL;
+
+    for (size_t i = 0; i < linked_names->cap; i++) {
+        if (linked_names->slots[i].var != NULL)
+            cache_add_config(linked_names->slots[i].var->name);
+    }
+
+    // Anything wrong was reported while lexing, parsing would only report it again.
+    return error_count() == 0;
+}
+
 int compile(char **infiles, size_t infile_count, char *outfile, unsigned int flags, char *libs, char *source_includes) {
     int status = EXIT_SUCCESS;
     bool source_only = (flags & COMP_SOURCE_ONLY);
-    char *cmd;
-    size_t cmd_len;
-    char *rm_cmd;
-    size_t rm_cmd_len;
+    ArgList link_args;
+    char **objfiles = NULL;
+    size_t objfile_count = 0;
     bool found_main = false;
+    bool uses_jumps = false;
 
     bool run_exec = (flags & COMP_RUN);
     flags &= ~COMP_RUN;
 
+    // A single program can skip gcc, anything the interpreter can't run still gets built.
+    bool interpret = run_exec && (flags & COMP_INTERPRET) && infile_count == 1 && !source_only;
+
     if (!source_only) {
         // Compile all files to objects then link them all together for the final exectuable.
         flags |= COMP_OBJECT;
 
-        cmd = malloc(strlen(outfile) + 10);
-        sprintf(cmd, "gcc -o %s", outfile);
-        cmd_len = strlen(cmd);
+        link_args = create_arglist();
+        arglist_push(&link_args, cc_path);
+        arglist_push(&link_args, "-o");
+        arglist_push(&link_args, outfile);
+        objfiles = malloc(infile_count * sizeof(char *));
+        make_cflags(flags);
 
-#ifdef _WIN32
-        rm_cmd = mystrdup("del");
-        rm_cmd_len = 3;
-#else
-        rm_cmd = mystrdup("rm");
-        rm_cmd_len = 2;
-#endif
+        // LTO objects are only compiled at the link, so it needs the same optimisations.
+        if (flags & COMP_LTO)
+            arglist_push_split(&link_args, codegen_flags);
+
+        if (cache_dir != NULL)
+            cache_init(cache_dir, cflags, libs, source_includes, flags);
+    }
+
+    if ((flags & COMP_WHOLE_PROGRAM) && !interpret && !collect_linked_names(infiles, infile_count)) {
+        if (!source_only) {
+            delete_arglist(&link_args);
+            free(objfiles);
+        }
+
+        delete_arena(&linked_name_arena);
+        return EXIT_FAILURE;
     }
 
     if (source_only || (flags & COMP_DEBUG))
         // Don't name sources 'a.c'.
         flags &= ~COMP_OUTFILE_SPECIFIED;
 
+    // Each file's gcc job runs in the background while the next file goes through the front end.
     for (size_t i = 0; i < infile_count; i++) {
         char *basefile = NULL;
         extract_cur_dir_and_basefile(infiles[i], &basefile);
         assert(basefile != NULL);
 
-        AST *root = parse_file(infiles[i], infiles, &found_main);
+        // Unchanged files skip the front end and gcc entirely.
+        if (!source_only && !interpret) {
+            char *objfile = replace_file_extension(basefile, "o", true);
+
+            if (cache_fetch(infiles[i], basefile, objfile)) {
+                report_file(infiles[i], true);
+                link_threads = true;
+                arglist_push(&link_args, objfile);
+                objfiles[objfile_count++] = objfile;
+                free(basefile);
+                free(cur_dir);
+                continue;
+            }
+
+            free(objfile);
+        }
+
+        report_file(infiles[i], false);
+        Arena arena = create_arena(ARENA_BLOCK_SIZE);
+        cur_arena = &arena;
+
+        Timer timer = start_timer();
+        AST *root = parse_file(infiles[i], infiles, &found_main, &uses_jumps);
+        report_phase(PHASE_PARSE, &timer);
         free(cur_dir);
 
+        Program *prog = NULL;
+
+        if (interpret && found_main && error_count() == 0) {
+            AST *fallback = NULL;
+            timer = start_timer();
+            prog = create_program(root, &fallback);
+            report_phase(PHASE_EMIT, &timer);
+
+            // Otherwise it looks like -interpret ran it, only slower to start.
+            if (prog == NULL) {
+                if (fallback != NULL && fallback != root)
+                    log_note(fallback->file, fallback->ln, fallback->col);
+                else
+                    log_note(infiles[i], 0, 0);
+
+                fprintf(stderr, "-interpret can't run this program, building it with the c compiler\n");
+            }
+        }
+
+        if (prog != NULL) {
+            if (flags & COMP_MEM_REPORT)
+                print_mem_report(infiles[i], &arena);
+
+            report_memory(&arena);
+
+            delete_arena(&arena);
+            cur_arena = NULL;
+            free(basefile);
+            delete_copybooks();
+            cache_commit(false);
+            delete_arglist(&link_args);
+            free(objfiles);
+            return interpret_program(prog, outfile);
+        }
+
         char *finalfile = NULL;
+        unsigned int file_flags = flags;
+
+        if (!found_main)
+            file_flags |= COMP_NO_MAIN;
+
+        // GO TO and PERFORM THRU jump between labels of the one function main() becomes.
+        if (uses_jumps) {
+            file_flags |= COMP_COMPUTED_GOTO;
+
+            if (file_flags & COMP_NO_MAIN) {
+                log_error(infiles[i], 0, 0);
+                fprintf(stderr, "GO TO and PERFORM THRU can't be used without a main program\n");
+            }
+        }
+
+        int file_status = compile_one_file(root, basefile, infiles[i], outfile, file_flags, libs, source_includes, &finalfile);
 
-        if (found_main)
-            status += compile_one_file(root, basefile, infiles[i], outfile, flags, libs, source_includes, &finalfile);
-        else
-            status += compile_one_file(root, basefile, infiles[i], outfile, flags | COMP_NO_MAIN, libs, source_includes, &finalfile);
+        status += file_status;
 
+        if (flags & COMP_MEM_REPORT)
+            print_mem_report(infiles[i], &arena);
+
+        report_memory(&arena);
+
+        delete_arena(&arena);
+        cur_arena = NULL;
         assert(finalfile != NULL);
 
-        if (source_only) {
+        // Nothing was handed to gcc for a file that failed, so there's no object to link or remove.
+        if (source_only || file_status != EXIT_SUCCESS) {
             free(finalfile);
             continue;
         }
 
-        const size_t len = strlen(finalfile);
-
-        cmd = realloc(cmd, cmd_len + len + 2);
-        strcat(cmd, " ");
-        strcat(cmd, finalfile);
-        cmd_len += len + 1;
+        arglist_push(&link_args, finalfile);
+        objfiles[objfile_count++] = finalfile;
+    }
 
-        rm_cmd = realloc(rm_cmd, rm_cmd_len + len + 2);
-        strcat(rm_cmd, " ");
-        strcat(rm_cmd, finalfile);
-        rm_cmd_len += len + 1;
+    // Every file that could COPY them is done.
+    delete_copybooks();
 
-        free(finalfile);
+    if (linked_names != NULL) {
+        delete_arena(&linked_name_arena);
+        linked_names = NULL;
     }
 
     if (source_only)
         return status;
-    else if (error_count() > 0) {
-        free(cmd);
-        free(rm_cmd);
-        return status;
+
+    status += wait_for_jobs();
+    cache_commit(error_count() == 0);
+
+    if (error_count() == 0) {
+        if (link_threads)
+            arglist_push_split(&link_args, THREAD_FLAGS);
+
+        Timer timer = start_timer();
+        Usage usage;
+        int link_status = run_command(&link_args, &usage);
+        report_child(PHASE_LINK, &timer, &usage);
+
+        if (link_status != 0) {
+            log_error(NULL, 0, 0);
+            fprintf(stderr, "failed to compile\n");
+            status = EXIT_FAILURE;
+        }
     }
 
-    if (system(cmd) != 0) {
-        log_error(NULL, 0, 0);
-        fprintf(stderr, "failed to compile\n");
-        status = EXIT_FAILURE;
+    delete_arglist(&link_args);
+
+    bool removed = true;
+
+    for (size_t i = 0; i < objfile_count; i++) {
+        if (remove(objfiles[i]) != 0)
+            removed = false;
+
+        free(objfiles[i]);
     }
 
-    free(cmd);
+    free(objfiles);
 
-    if (system(rm_cmd) != 0) {
+    if (!removed && error_count() == 0) {
         log_error(NULL, 0, 0);
         fprintf(stderr, "failed to remove objects\n");
         status = EXIT_FAILURE;
     }
 
-    free(rm_cmd);
-
     if (!run_exec || error_count() > 0)
         return status;
 
-    cmd = malloc(strlen(outfile) + 3);
-
-#ifdef _WIN32
-    sprintf(cmd, ".\\%s", outfile);
-#else
-    sprintf(cmd, "./%s", outfile);
-#endif
-
-    int run_status = system(cmd);
+    char *exec = exec_name(outfile);
+    ArgList run_args = create_arglist();
+    arglist_push(&run_args, exec);
+    Timer timer = start_timer();
+    Usage usage;
+    int run_status = run_command(&run_args, &usage);
+    report_child(PHASE_RUN, &timer, &usage);
     (void)run_status; // Don't care about the result.
-    free(cmd);
+    delete_arglist(&run_args);
+    free(exec);
     return status;
 }
 
@@ -161,31 +380,89 @@ void extract_cur_dir_and_basefile(char *path, char **out_filename) {
     free(copy);
 }
 
+// Only SORT's runtime starts threads, SD items are all declared at the top level.
+static bool uses_threads(AST *root) {
+    for (size_t i = 0; i < root->root.size; i++) {
+        if (root->root.items[i]->type == AST_PIC && root->root.items[i]->pic.is_sort)
+            return true;
+    }
+
+    return false;
+}
+
+static ArgList object_args(AST *root, char *objfile, char *source, char *libs) {
+    ArgList args = create_arglist();
+    arglist_push(&args, cc_path);
+    arglist_push_split(&args, cflags);
+
+    // The emitted C doesn't change with it, so neither does the cache key.
+    if (uses_threads(root)) {
+        arglist_push_split(&args, THREAD_FLAGS);
+        link_threads = true;
+    }
+    arglist_push(&args, "-c");
+    arglist_push(&args, "-o");
+    arglist_push(&args, objfile);
+
+    // Standard input has no extension to go by.
+    if (strcmp(source, "-") == 0) {
+        arglist_push(&args, "-x");
+        arglist_push(&args, "c");
+    }
+
+    arglist_push(&args, source);
+    arglist_push_split(&args, libs);
+    return args;
+}
+
+// Emits straight into gcc's standard input, so nothing touches the disk until the object.
+int pipe_one_file(AST *root, char *basefile, char *infile, unsigned int flags, char *libs, char *source_includes, char **out_finalfile) {
+    char *objfile = replace_file_extension(basefile, "o", true);
+    free(basefile);
+
+    ArgList args = object_args(root, objfile, "-", libs);
+    FILE *out = start_piped_job(&args, infile);
+    delete_arglist(&args);
+    *out_finalfile = objfile;
+
+    if (out == NULL)
+        return EXIT_FAILURE;
+
+    Timer timer = start_timer();
+    report_emitted(emit_root(out, root, flags, source_includes));
+    report_phase(PHASE_EMIT, &timer);
+    close_job_input(out);
+    cache_finish_file(objfile);
+    return EXIT_SUCCESS;
+}
+
 int compile_one_file(AST *root, char *basefile, char *infile, char *outfile, unsigned int flags, char *libs, char *source_includes, char **out_finalfile) {
     if (error_count() > 0) {
-        delete_ast(root);
         *out_finalfile = basefile;
         return EXIT_FAILURE;
     }
 
-    char *code = emit_root(root, !(flags & COMP_NO_MAIN), source_includes);
-    delete_ast(root);
+    // Debug builds keep the generated source around, so there's nothing to pipe.
+    if ((flags & COMP_PIPE) && !(flags & (COMP_SOURCE_ONLY | COMP_DEBUG)))
+        return pipe_one_file(root, basefile, infile, flags, libs, source_includes, out_finalfile);
 
-    char *outc = replace_file_extension(!(flags & COMP_OUTFILE_SPECIFIED) ? basefile : outfile, "c", true);
+    // Objects are named after their own source so jobs running side by side never share a temporary.
+    char *outc = replace_file_extension(!(flags & COMP_OUTFILE_SPECIFIED) || (flags & COMP_OBJECT) ? basefile : outfile, "c", true);
 
     FILE *out = fopen(outc, "w");
 
     if (out == NULL) {
         log_error(infile, 0, 0);
         fprintf(stderr, "failed to write to file '%s'\n", outc);
-        free(code);
+        free(basefile);
         *out_finalfile = outc;
         return EXIT_FAILURE;
     }
 
-    fputs(code, out);
+    Timer timer = start_timer();
+    report_emitted(emit_root(out, root, flags, source_includes));
     fclose(out);
-    free(code);
+    report_phase(PHASE_EMIT, &timer);
 
     if (flags & COMP_SOURCE_ONLY) {
         free(basefile);
@@ -193,53 +470,20 @@ int compile_one_file(AST *root, char *basefile, char *infile, char *outfile, uns
         return EXIT_SUCCESS;
     }
 
-    char *cmd;
-    char *cflags = (flags & COMP_DEBUG) ? DEBUG_CFLAGS : RELEASE_CFLAGS;
-
-    if (flags & COMP_OBJECT) {
-        char *objfile = replace_file_extension(basefile, "o", true);
-        cmd = malloc(strlen(cc_path) + strlen(cflags) + strlen(objfile) + strlen(outc) + strlen(libs) + 24);
-        sprintf(cmd, "%s %s -c -o %s %s %s", cc_path, cflags, objfile, outc, libs);
-        *out_finalfile = objfile;
-    } else {
-        cmd = malloc(strlen(cc_path) + strlen(cflags) + strlen(outfile) + strlen(outc) + strlen(libs) + 18);
-        sprintf(cmd, "%s %s -o %s %s %s", cc_path, cflags, outfile, outc, libs);
-        *out_finalfile = mystrdup(outfile);
-    }
-
+    char *objfile = replace_file_extension(basefile, "o", true);
     free(basefile);
 
-    int status = system(cmd);
+    ArgList args = object_args(root, objfile, outc, libs);
 
-    if (!(flags & COMP_DEBUG) && remove(outc) != 0) {
-        log_error(infile, 0, 0);
-        fprintf(stderr, "failed to remove '%s'\n", outc);
+    // Debug builds keep the generated source around.
+    if (flags & COMP_DEBUG) {
+        start_job(&args, infile, NULL);
         free(outc);
-        free(cmd);
-        return status;
-    }
+    } else
+        start_job(&args, infile, outc);
 
-    free(outc);
-
-    if (status != 0) {
-        log_error(infile, 0, 0);
-        fprintf(stderr, "failed to compile\n");
-        free(cmd);
-        return status;
-    }
-
-    if (!(flags & COMP_RUN)) {
-        free(cmd);
-        return EXIT_SUCCESS;
-    }
-
-#ifdef _WIN32
-    sprintf(cmd, ".\\%s", outfile);
-#else
-    sprintf(cmd, "./%s", outfile);
-#endif
-
-    status = system(cmd);
-    free(cmd);
-    return status;
-}
\ No newline at end of file
+    delete_arglist(&args);
+    cache_finish_file(objfile);
+    *out_finalfile = objfile;
+    return EXIT_SUCCESS;
+}
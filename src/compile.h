@@ -7,6 +7,13 @@
 #define COMP_OBJECT (0x08)
 #define COMP_NO_MAIN (0x10)
 #define COMP_DEBUG (0x20)
+#define COMP_MEM_REPORT (0x40)
+#define COMP_PIPE (0x80)
+#define COMP_INTERPRET (0x100)
+#define COMP_TIME_REPORT (0x200)
+#define COMP_LTO (0x400)
+#define COMP_WHOLE_PROGRAM (0x800)
+#define COMP_COMPUTED_GOTO (0x1000)
 
 #include <stdio.h>
 
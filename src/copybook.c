@@ -0,0 +1,208 @@
+#include "copybook.h"
+#include "lexer.h"
+#include "arena.h"
+#include "hash.h"
+#include "error.h"
+#include "utils.h"
+#include "report.h"
+#include "cache.h"
+#include "keyword.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+extern Arena *cur_arena;
+extern char *cache_dir;
+
+static Arena copybook_arena;
+static Copybook *copybooks = NULL;
+static size_t copybook_count = 0;
+
+// Precompiled copybooks are kept in the -cache directory as '<hash of path>.cpt':
+// the magic and a header with the hashes of the cobc build and of the source, then every token as its type, keyword,
+// line, column and value. They're host specific, the cache isn't meant to be shared across machines.
+typedef struct {
+    char magic[4];
+    Hash build; // The cobc and keyword table that lexed it, keyword ids are indexes into that table.
+    Hash source; // Not the mtime, an edit within the same second must not reuse old tokens.
+    uint64_t token_count;
+} PrecompiledHeader;
+
+typedef struct {
+    uint8_t type;
+    uint8_t keyword;
+    uint32_t ln;
+    uint32_t col;
+    uint32_t value_len;
+} PrecompiledToken;
+
+static char *precompiled_path(char *path) {
+    if (cache_dir == NULL)
+        return NULL;
+
+    Hash hash = create_hash();
+    char hex[HASH_HEX_LEN + 1];
+    hash_string(&hash, path);
+    hash_to_hex(&hash, hex);
+
+    char *file = malloc(strlen(cache_dir) + HASH_HEX_LEN + 6);
+    sprintf(file, "%s/%s.cpt", cache_dir, hex);
+    return file;
+}
+
+static bool read_precompiled(Copybook *cb, char *file, PrecompiledHeader *expected) {
+    FILE *f = fopen(file, "rb");
+
+    if (f == NULL)
+        return false;
+
+    PrecompiledHeader header;
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, expected->magic, 4) != 0 || header.build.hi != expected->build.hi
+        || header.build.lo != expected->build.lo || header.source.hi != expected->source.hi || header.source.lo != expected->source.lo || header.token_count == 0) {
+        fclose(f);
+        return false;
+    }
+
+    cb->tokens = malloc(header.token_count * sizeof(Token));
+    cb->token_count = header.token_count;
+
+    for (size_t i = 0; i < cb->token_count; i++) {
+        PrecompiledToken tok;
+
+        if (fread(&tok, sizeof(tok), 1, f) != 1 || tok.keyword >= KW_COUNT) {
+            free(cb->tokens);
+            fclose(f);
+            return false;
+        }
+
+        char *value = arena_alloc(&copybook_arena, tok.value_len + 1);
+
+        if (fread(value, 1, tok.value_len, f) != tok.value_len) {
+            free(cb->tokens);
+            fclose(f);
+            return false;
+        }
+
+        cb->tokens[i] = create_token(tok.type, value, tok.ln, tok.col);
+        cb->tokens[i].keyword = tok.keyword;
+    }
+
+    fclose(f);
+    return true;
+}
+
+static void write_precompiled(Copybook *cb, char *file, PrecompiledHeader *header) {
+    char *tmp = malloc(strlen(file) + 5);
+    sprintf(tmp, "%s.tmp", file);
+
+    FILE *f = fopen(tmp, "wb");
+
+    if (f == NULL) {
+        free(tmp);
+        return;
+    }
+
+    header->token_count = cb->token_count;
+    bool ok = fwrite(header, sizeof(*header), 1, f) == 1;
+
+    for (size_t i = 0; ok && i < cb->token_count; i++) {
+        Token *src = &cb->tokens[i];
+        PrecompiledToken tok;
+
+        // Zero the padding too, so identical copybooks give identical files.
+        memset(&tok, 0, sizeof(tok));
+        tok.type = src->type;
+        tok.keyword = src->keyword;
+        tok.ln = src->ln;
+        tok.col = src->col;
+        tok.value_len = strlen(src->value);
+
+        ok = fwrite(&tok, sizeof(tok), 1, f) == 1 && fwrite(src->value, 1, tok.value_len, f) == tok.value_len;
+    }
+
+    if (fclose(f) != 0 || !ok || rename(tmp, file) != 0)
+        remove(tmp);
+
+    free(tmp);
+}
+
+static bool lex_copybook(Copybook *cb) {
+    const size_t errors = error_count();
+
+    // Token values go to the copybook arena so they outlive the file being compiled.
+    Arena *file_arena = cur_arena;
+    cur_arena = &copybook_arena;
+
+    Timer timer = start_timer();
+    Lexer lex = create_lexer(cb->path, NULL);
+    size_t cap = 32;
+    cb->tokens = malloc(cap * sizeof(Token));
+    cb->token_count = 0;
+
+    Token tok;
+
+    do {
+        tok = lex_next_token(&lex);
+
+        if (cb->token_count == cap) {
+            cap *= 2;
+            cb->tokens = realloc(cb->tokens, cap * sizeof(Token));
+        }
+
+        cb->tokens[cb->token_count++] = tok;
+    } while (tok.type != TOK_EOF);
+
+    delete_lexer(&lex);
+    report_tokens(cb->token_count - 1);
+    report_phase(PHASE_LEX, &timer);
+    cur_arena = file_arena;
+    return error_count() == errors;
+}
+
+// Returns the tokens of the copybook at path, lexing it on first use unless an up to date
+// precompiled copy is found. The caller has to make sure the file exists.
+Copybook *load_copybook(char *path) {
+    for (size_t i = 0; i < copybook_count; i++) {
+        if (strcmp(copybooks[i].path, path) == 0)
+            return &copybooks[i];
+    }
+
+    if (copybook_count == 0)
+        copybook_arena = create_arena(ARENA_BLOCK_SIZE);
+
+    Copybook cb = { .path = arena_strdup(&copybook_arena, path), .tokens = NULL, .token_count = 0 };
+    PrecompiledHeader header = { .magic = COPYBOOK_MAGIC, .build = create_hash(), .source = create_hash(), .token_count = 0 };
+    hash_build(&header.build);
+
+    for (Keyword keyword = KW_NONE + 1; keyword < KW_COUNT; keyword++)
+        hash_string(&header.build, keyword_to_string(keyword));
+
+    char *file = precompiled_path(path);
+
+    // Lexing errors have been reported once already, they'll fail the build anyway.
+    if (file == NULL || !hash_file(&header.source, path))
+        lex_copybook(&cb);
+    else if (!read_precompiled(&cb, file, &header) && lex_copybook(&cb))
+        write_precompiled(&cb, file, &header);
+
+    free(file);
+    copybooks = realloc(copybooks, (copybook_count + 1) * sizeof(Copybook));
+    copybooks[copybook_count++] = cb;
+    return &copybooks[copybook_count - 1];
+}
+
+void delete_copybooks() {
+    for (size_t i = 0; i < copybook_count; i++)
+        free(copybooks[i].tokens);
+
+    free(copybooks);
+    copybooks = NULL;
+
+    if (copybook_count > 0)
+        delete_arena(&copybook_arena);
+
+    copybook_count = 0;
+}
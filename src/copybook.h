@@ -0,0 +1,20 @@
+#ifndef COPYBOOK_H
+#define COPYBOOK_H
+
+#include "token.h"
+#include <stdio.h>
+
+#define COPYBOOK_MAGIC "CBT3"
+
+// The token stream of a copybook, lexed once per build and shared by every file that COPYs it.
+// Tokens and their values outlive the per-file arenas, they're only released by delete_copybooks().
+typedef struct {
+    char *path;
+    Token *tokens;
+    size_t token_count;
+} Copybook;
+
+Copybook *load_copybook(char *path);
+void delete_copybooks();
+
+#endif
@@ -27,6 +27,16 @@ void log_error(char *file, size_t ln, size_t col) {
         fprintf(stderr, ESC_BOLD "%s: " ESC_RED "error: " ESC_NORMAL, file);
 }
 
+// Same place format as log_error(), for something that doesn't stop the build.
+void log_note(char *file, size_t ln, size_t col) {
+    if (file == NULL)
+        fprintf(stderr, ESC_BOLD "cobc: " ESC_CYAN "note: " ESC_NORMAL);
+    else if (ln != 0 && col != 0)
+        fprintf(stderr, ESC_BOLD "%s:%zu:%zu: " ESC_CYAN "note: " ESC_NORMAL, file, ln, col);
+    else
+        fprintf(stderr, ESC_BOLD "%s: " ESC_CYAN "note: " ESC_NORMAL, file);
+}
+
 char *get_error_line(char *file, size_t ln) {
     FILE *f = fopen(file, "r");
     assert(f != NULL);
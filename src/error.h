@@ -12,6 +12,7 @@
 #define ESC_BOLD "\x1b[1m"
 
 void log_error(char *file, size_t ln, size_t col);
+void log_note(char *file, size_t ln, size_t col);
 void show_error(char *file, size_t ln, size_t col);
 size_t error_count();
 
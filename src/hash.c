@@ -0,0 +1,60 @@
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+Hash create_hash() {
+    return (Hash){ .hi = 0x6c62272e07bb0142ULL, .lo = 0x62b821756295c58dULL };
+}
+
+// Multiplies by the FNV-128 prime, 2^88 + 0x13b.
+static void mul_prime(Hash *hash) {
+    uint32_t limbs[4] = { (uint32_t)hash->lo, (uint32_t)(hash->lo >> 32), (uint32_t)hash->hi, (uint32_t)(hash->hi >> 32) };
+    uint64_t carry = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        const uint64_t t = (uint64_t)limbs[i] * 0x13b + carry;
+        limbs[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+
+    const uint64_t shifted = hash->lo << 24;
+    hash->lo = ((uint64_t)limbs[1] << 32) | limbs[0];
+    hash->hi = (((uint64_t)limbs[3] << 32) | limbs[2]) + shifted;
+}
+
+void hash_update(Hash *hash, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash->lo ^= bytes[i];
+        mul_prime(hash);
+    }
+}
+
+// Includes the terminator so consecutive strings can't run into each other.
+void hash_string(Hash *hash, const char *str) {
+    hash_update(hash, str, strlen(str) + 1);
+}
+
+bool hash_file(Hash *hash, const char *path) {
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL)
+        return false;
+
+    char buf[64 * 1024];
+    size_t len;
+
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+        hash_update(hash, buf, len);
+
+    fclose(f);
+    return true;
+}
+
+void hash_to_hex(Hash *hash, char out[HASH_HEX_LEN + 1]) {
+    sprintf(out, "%016llx%016llx", (unsigned long long)hash->hi, (unsigned long long)hash->lo);
+}
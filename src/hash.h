@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HASH_HEX_LEN 32
+
+// 128-bit FNV-1a, wide enough to name cache entries by their contents.
+typedef struct {
+    uint64_t hi;
+    uint64_t lo;
+} Hash;
+
+Hash create_hash();
+void hash_update(Hash *hash, const void *data, size_t len);
+void hash_string(Hash *hash, const char *str);
+bool hash_file(Hash *hash, const char *path);
+void hash_to_hex(Hash *hash, char out[HASH_HEX_LEN + 1]);
+
+#endif
@@ -0,0 +1,646 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "interpreter.h"
+#include "bytecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <setjmp.h>
+
+#define STRING_BUILDER_SIZE 4097
+#define MAX_FRAMES (1024 * 1024)
+
+typedef struct {
+    size_t pc;
+    size_t sp;
+} Frame;
+
+// The same state the generated C keeps in globals.
+static char string_builder[STRING_BUILDER_SIZE];
+static size_t string_builder_pointer;
+static size_t previous_string_statement_size;
+static char spare_string_buffer[STRING_BUILDER_SIZE];
+static bool inspect_found;
+static bool inspect_locked;
+static FILE *last_opened_outfile;
+static FILE **files;
+
+static Value *stack;
+static size_t stack_cap;
+static size_t sp;
+
+static Frame *frames;
+static size_t frame_cap;
+static size_t frame_count;
+
+// Where the compiled program would have called cobol_error() or crashed.
+static jmp_buf runtime_error;
+
+static void fail() {
+    longjmp(runtime_error, 1);
+}
+
+static void push(Value value) {
+    if (sp == stack_cap) {
+        stack_cap *= 2;
+        stack = realloc(stack, stack_cap * sizeof(Value));
+    }
+
+    stack[sp++] = value;
+}
+
+static Value pop() {
+    return stack[--sp];
+}
+
+static bool is_signed_kind(Kind kind) {
+    return kind == KIND_I32 || kind == KIND_I64;
+}
+
+// Integer results wrap to the width of their kind, as they do in C.
+static Value wrap(Kind kind, uint64_t bits) {
+    Value value;
+
+    switch (kind) {
+        case KIND_I32: value.i = (int32_t)(uint32_t)bits; break;
+        case KIND_U32: value.u = (uint32_t)bits; break;
+        case KIND_I64: value.i = (int64_t)bits; break;
+        default: value.u = bits; break;
+    }
+
+    return value;
+}
+
+static Value arithmetic(Opcode op, Kind kind, Value a, Value b) {
+    if (kind == KIND_FLOAT || kind == KIND_DOUBLE) {
+        Value value;
+
+        switch (op) {
+            case OP_ADD: value.f = a.f + b.f; break;
+            case OP_SUB: value.f = a.f - b.f; break;
+            case OP_MUL: value.f = a.f * b.f; break;
+            default: value.f = a.f / b.f; break;
+        }
+
+        if (kind == KIND_FLOAT)
+            value.f = (float)value.f;
+
+        return value;
+    }
+
+    switch (op) {
+        case OP_ADD: return wrap(kind, a.u + b.u);
+        case OP_SUB: return wrap(kind, a.u - b.u);
+        case OP_MUL: return wrap(kind, a.u * b.u);
+        default: break;
+    }
+
+    // Both of these trap in the compiled program.
+    if (b.u == 0)
+        fail();
+
+    if (is_signed_kind(kind)) {
+        const int64_t min = kind == KIND_I32 ? INT32_MIN : INT64_MIN;
+
+        if (a.i == min && b.i == -1)
+            fail();
+
+        return wrap(kind, (uint64_t)(op == OP_DIV ? a.i / b.i : a.i % b.i));
+    }
+
+    return wrap(kind, op == OP_DIV ? a.u / b.u : a.u % b.u);
+}
+
+static bool compare(Opcode op, Kind kind, Value a, Value b) {
+#define COMPARE(x, y) \
+    switch (op) { \
+        case OP_EQ: return x == y; \
+        case OP_NEQ: return x != y; \
+        case OP_LT: return x < y; \
+        case OP_LTE: return x <= y; \
+        case OP_GT: return x > y; \
+        default: return x >= y; \
+    }
+
+    if (kind == KIND_FLOAT || kind == KIND_DOUBLE)
+        COMPARE(a.f, b.f)
+    else if (is_signed_kind(kind))
+        COMPARE(a.i, b.i)
+    else
+        COMPARE(a.u, b.u)
+
+#undef COMPARE
+}
+
+static bool is_true(Kind kind, Value value) {
+    return kind == KIND_FLOAT || kind == KIND_DOUBLE ? value.f != 0.0 : value.u != 0;
+}
+
+// inspect_char == value, where inspect_char is a char.
+static bool char_equals(char c, Value value, Kind kind) {
+    const Kind common = common_kind(KIND_I32, kind);
+    return compare(OP_EQ, common, convert_value((Value){ .i = c }, KIND_I32, common), convert_value(value, kind, common));
+}
+
+// Formats value to out, or into buf when out is NULL.
+static void format_value(FILE *out, char *buf, size_t size, Format *format, Value value) {
+#define FORMAT_ARG(arg) \
+    if (out != NULL) \
+        fprintf(out, format->text, arg); \
+    else \
+        snprintf(buf, size, format->text, arg);
+
+    switch (format->arg) {
+        case ARG_INT: FORMAT_ARG((int)convert_value(value, format->from, KIND_I32).i) break;
+        case ARG_UINT: FORMAT_ARG((unsigned int)convert_value(value, format->from, KIND_U32).u) break;
+        case ARG_LONG: FORMAT_ARG((long)convert_value(value, format->from, KIND_I64).i) break;
+        case ARG_ULONG: FORMAT_ARG((unsigned long)convert_value(value, format->from, KIND_U64).u) break;
+        case ARG_LLONG: FORMAT_ARG((long long)convert_value(value, format->from, KIND_I64).i) break;
+        case ARG_ULLONG: FORMAT_ARG((unsigned long long)convert_value(value, format->from, KIND_U64).u) break;
+        case ARG_SIZE: FORMAT_ARG((size_t)convert_value(value, format->from, KIND_U64).u) break;
+        case ARG_DOUBLE: FORMAT_ARG(value.f) break;
+        case ARG_STRING: FORMAT_ARG(value.s) break;
+    }
+
+#undef FORMAT_ARG
+}
+
+// strncpy(), but the source may overlap the destination.
+static void copy_string(char *dst, char *src, size_t n) {
+    const size_t len = strnlen(src, n);
+    memmove(dst, src, len);
+    memset(dst + len, '\0', n - len);
+}
+
+// strncat() into the string builder, which the compiled program would overflow.
+static void builder_append(char *src, size_t n) {
+    const size_t len = strlen(string_builder);
+    const size_t add = strnlen(src, n);
+
+    if (len + add >= STRING_BUILDER_SIZE)
+        fail();
+
+    memmove(string_builder + len, src, add);
+    string_builder[len + add] = '\0';
+}
+
+static void strip(char *str, char *chars) {
+    str[strcspn(str, chars)] = '\0';
+}
+
+// Parses str the way the generated strtol(), strtoul() or strtod() call does and stores it.
+static void parse_into(unsigned char *dst, CType type, ParseType parse, char *str, bool long_double) {
+    char *endptr;
+    Value value;
+    Kind kind;
+    errno = 0;
+
+    if (parse == PARSE_SIGNED) {
+        value.i = strtol(str, &endptr, 10);
+        kind = KIND_I64;
+    } else if (parse == PARSE_UNSIGNED) {
+        value.u = strtoul(str, &endptr, 10);
+        kind = KIND_U64;
+    } else {
+        value.f = long_double ? (double)strtold(str, &endptr) : strtod(str, &endptr);
+        kind = KIND_DOUBLE;
+    }
+
+    store_value(dst, type, value, kind);
+
+    if (str == endptr || *endptr != '\0' || errno == ERANGE || errno == EINVAL)
+        fail();
+}
+
+static void run_string(StringOp *op) {
+    Value *operand = &stack[sp - op->part_count - 1];
+    string_builder[0] = '\0';
+    string_builder_pointer = 0;
+
+    for (size_t i = 0; i < op->part_count; i++) {
+        StringPart *part = &op->parts[i];
+        Value value = *operand++;
+
+        if (part->type == PART_CAT) {
+            builder_append(value.s, SIZE_MAX);
+            previous_string_statement_size = part->size;
+        } else if (part->type == PART_FORMAT) {
+            format_value(NULL, spare_string_buffer, 4095, part->format, value);
+            previous_string_statement_size = strlen(spare_string_buffer);
+            builder_append(spare_string_buffer, previous_string_statement_size);
+        } else {
+            const size_t size = part->const_size ? part->size : strlen(value.s);
+            builder_append(value.s, size);
+            previous_string_statement_size = size;
+        }
+
+        string_builder_pointer += previous_string_statement_size;
+
+        if (string_builder_pointer >= STRING_BUILDER_SIZE)
+            fail();
+
+        string_builder[string_builder_pointer] = '\0';
+    }
+
+    copy_string(operand->p, string_builder, op->into_width);
+    sp -= op->part_count + 1;
+
+    if (op->push_pointer)
+        push((Value){ .u = string_builder_pointer });
+}
+
+static void run_unstring(UnstringOp *op) {
+    Value *operand = &stack[sp - op->into_count - 1];
+    char *src = operand[0].s;
+
+    if (strlen(src) >= STRING_BUILDER_SIZE)
+        fail();
+
+    string_builder_pointer = 0;
+    memmove(string_builder, src, strlen(src) + 1);
+
+    for (size_t i = 0; i < op->into_count; i++) {
+        if (string_builder_pointer >= STRING_BUILDER_SIZE)
+            fail();
+
+        char *start = string_builder + string_builder_pointer;
+
+        if (op->delim_space) {
+            char *space = strchr(start, ' ');
+            previous_string_statement_size = space != NULL ? (size_t)(space - start) : strlen(src);
+        } else
+            previous_string_statement_size = strlen(spare_string_buffer);
+
+        const size_t size = previous_string_statement_size;
+        copy_string(operand[i + 1].p, start, size >= op->widths[i] ? op->widths[i] : size);
+        string_builder_pointer += previous_string_statement_size + 1;
+    }
+
+    sp -= op->into_count + 1;
+}
+
+static void run_tallying(InspectOp *op, Value *operand) {
+    char *str = (operand++)->s;
+    const size_t len = strlen(str);
+    size_t count = 0;
+
+    for (size_t i = 0; i < op->count; i++) {
+        TallyOp *tally = &op->tallies[i];
+
+        if (tally->type == TALLY_OP_CHARACTERS) {
+            count += len;
+            continue;
+        }
+
+        Value value = *operand++;
+        Value modifier = tally->has_modifier ? *operand++ : value;
+        Kind modifier_kind = tally->has_modifier ? tally->modifier : tally->value;
+        unsigned char *output = (operand++)->p;
+
+        if (tally->after)
+            inspect_found = false;
+
+        for (size_t j = 0; j < len; j++) {
+            const char c = str[j];
+
+            if (tally->before) {
+                if (char_equals(c, modifier, modifier_kind))
+                    break;
+                else if (char_equals(c, value, tally->value))
+                    count++;
+            } else {
+                if (char_equals(c, modifier, modifier_kind) && !inspect_found)
+                    inspect_found = true;
+
+                if (char_equals(c, value, tally->value) && inspect_found)
+                    count++;
+            }
+        }
+
+        store_value(output, tally->output, (Value){ .u = count }, KIND_U64);
+    }
+}
+
+static void run_replacing(InspectOp *op, Value *operand) {
+    char *str = (operand++)->s;
+    const size_t len = strlen(str);
+    inspect_found = inspect_locked = false;
+
+    for (size_t i = 0; i < len; i++) {
+        const char c = str[i];
+        Value *replace_operand = operand;
+
+        for (size_t j = 0; j < op->count; j++) {
+            ReplaceOp *replace = &op->replaces[j];
+            const bool phased = replace->before || replace->after;
+            Value modifier = phased ? *replace_operand++ : (Value){ .i = 0 };
+            Value old = *replace_operand++;
+            Value new = *replace_operand++;
+            bool matched;
+
+            if (phased && char_equals(c, modifier, replace->modifier)) {
+                inspect_found = true;
+                continue;
+            } else if (phased)
+                matched = (replace->before ? !inspect_found : inspect_found) && (!replace->first || !inspect_locked) && char_equals(c, old, replace->old);
+            else
+                matched = char_equals(c, old, replace->old) && (!replace->first || !inspect_locked);
+
+            if (!matched)
+                continue;
+
+            str[i] = (char)convert_value(new, replace->new, KIND_I64).i;
+
+            if (replace->first)
+                inspect_locked = true;
+        }
+    }
+}
+
+static void run_inspect(InspectOp *op) {
+    Value *operand = &stack[sp - op->operand_count];
+
+    if (op->replacing)
+        run_replacing(op, operand);
+    else
+        run_tallying(op, operand);
+
+    sp -= op->operand_count;
+}
+
+static void accept_argv(char *dst, size_t width, int argc, char **argv) {
+    size_t len = 0;
+
+    for (int i = 0; i < argc; i++) {
+        const size_t arg_len = strlen(argv[i]) + (i > 0);
+
+        if (len + arg_len >= width)
+            fail();
+
+        if (i > 0)
+            dst[len] = ' ';
+
+        memcpy(dst + len + (i > 0), argv[i], arg_len - (i > 0));
+        len += arg_len;
+        dst[len] = '\0';
+    }
+}
+
+// Reads a line into dst without its newline the way the compiled line_read()
+// does: past max characters the rest of the line is skipped, and a '\r'
+// before the newline is dropped unless the line was cut.
+static bool read_line(FILE *file, char *dst, size_t max) {
+    if (fgets(dst, (int)max + 1, file) == NULL)
+        return false;
+
+    const size_t len = strcspn(dst, "\n");
+    bool cut = false;
+
+    if (dst[len] != '\n') {
+        for (int c = getc(file); c != EOF && c != '\n'; c = getc(file))
+            cut = true;
+    }
+
+    dst[len] = '\0';
+
+    if (!cut && len > 0 && dst[len - 1] == '\r')
+        dst[len - 1] = '\0';
+
+    return true;
+}
+
+static FILE *open_file(Instruction *ins) {
+    FILE *file = files[ins->arg];
+
+    if (file == NULL)
+        fail();
+
+    return file;
+}
+
+static void execute(Program *prog, int argc, char **argv) {
+    Instruction *code = prog->code;
+    size_t pc = 0;
+
+    for (;;) {
+        Instruction *ins = &code[pc++];
+
+        switch (ins->op) {
+            case OP_PUSH: push(ins->val); break;
+            case OP_ADDR: push((Value){ .p = prog->data + ins->val.u }); break;
+            case OP_INDEX: {
+                const int64_t index = pop().i;
+
+                if (index < 1 || (uint64_t)index > ins->arg)
+                    fail();
+
+                stack[sp - 1].p = (unsigned char *)stack[sp - 1].p + (size_t)(index - 1) * ins->val.u;
+                break;
+            }
+            case OP_OFFSET: stack[sp - 1].p = (unsigned char *)stack[sp - 1].p + ins->val.u; break;
+            case OP_LOAD: stack[sp - 1] = load_value(stack[sp - 1].p, ins->type); break;
+            case OP_STORE: {
+                Value value = pop();
+                store_value(pop().p, ins->type, value, ins->from);
+                break;
+            }
+            case OP_CONV: {
+                Value *value = &stack[sp - 1 - ins->arg];
+                *value = convert_value(*value, ins->from, ins->type);
+                break;
+            }
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_MOD: {
+                Value b = pop();
+                stack[sp - 1] = arithmetic(ins->op, ins->type, stack[sp - 1], b);
+                break;
+            }
+            case OP_EQ:
+            case OP_NEQ:
+            case OP_LT:
+            case OP_LTE:
+            case OP_GT:
+            case OP_GTE: {
+                Value b = pop();
+                stack[sp - 1].i = compare(ins->op, ins->type, stack[sp - 1], b);
+                break;
+            }
+            case OP_NOT: stack[sp - 1].i = !is_true(ins->type, stack[sp - 1]); break;
+            case OP_BOOL: stack[sp - 1].i = is_true(ins->type, stack[sp - 1]); break;
+            case OP_STRCMP: {
+                char *b = pop().s;
+                const int result = strcmp(stack[sp - 1].s, b);
+                stack[sp - 1].i = (result > 0) - (result < 0);
+                break;
+            }
+            case OP_STRLEN: stack[sp - 1].u = strlen(stack[sp - 1].s); break;
+            case OP_JMP: pc = ins->arg; break;
+            case OP_JZ:
+                if (pop().u == 0)
+                    pc = ins->arg;
+                break;
+            case OP_JNZ:
+                if (pop().u != 0)
+                    pc = ins->arg;
+                break;
+            // Short circuits keep the result that decided them.
+            case OP_JZK:
+                if (stack[sp - 1].u == 0)
+                    pc = ins->arg;
+                else
+                    sp--;
+                break;
+            case OP_JNZK:
+                if (stack[sp - 1].u != 0)
+                    pc = ins->arg;
+                else
+                    sp--;
+                break;
+            case OP_POP: sp--; break;
+            case OP_DUP: push(stack[sp - 1]); break;
+            case OP_DEC: stack[sp - 1].u--; break;
+            case OP_CALL:
+                // The compiled program would run out of stack.
+                if (frame_count == MAX_FRAMES)
+                    fail();
+
+                if (frame_count == frame_cap) {
+                    frame_cap *= 2;
+                    frames = realloc(frames, frame_cap * sizeof(Frame));
+                }
+
+                frames[frame_count++] = (Frame){ .pc = pc, .sp = sp };
+                pc = ins->arg;
+                break;
+            case OP_RET:
+                if (frame_count == 0)
+                    return;
+
+                frame_count--;
+                pc = frames[frame_count].pc;
+                sp = frames[frame_count].sp;
+                break;
+            case OP_HALT: return;
+            case OP_DISPLAY: format_value(stdout, NULL, 0, ins->val.p, pop()); break;
+            case OP_NEWLINE: fputc('\n', stdout); break;
+            case OP_WRITE:
+                if (last_opened_outfile == NULL)
+                    fail();
+
+                format_value(last_opened_outfile, NULL, 0, ins->val.p, pop());
+                break;
+            case OP_FORMAT: {
+                Value value = pop();
+                format_value(NULL, pop().p, ins->arg, ins->val.p, value);
+                break;
+            }
+            case OP_STRNCPY: {
+                char *src = pop().s;
+                copy_string(pop().p, src, ins->arg);
+                break;
+            }
+            case OP_PARSE: {
+                char *src = pop().s;
+                parse_into(pop().p, ins->type, ins->from, src, false);
+                break;
+            }
+            case OP_OPEN: {
+                static char *modes[] = { "r", "w", "w+", "a" };
+                char *status = pop().p;
+                char *filename = pop().s;
+                files[ins->arg] = fopen(filename, modes[ins->type]);
+                strcpy(status, files[ins->arg] != NULL ? "00" : "37");
+
+                // WRITEs go to the last file opened for OUTPUT, IO or EXTEND.
+                if (ins->type != 0)
+                    last_opened_outfile = files[ins->arg];
+
+                break;
+            }
+            case OP_CLOSE: {
+                FILE *file = open_file(ins);
+                fclose(file);
+                files[ins->arg] = NULL;
+
+                if (last_opened_outfile == file)
+                    last_opened_outfile = NULL;
+
+                break;
+            }
+            case OP_READ: {
+                FILE *file = open_file(ins);
+                char *into = pop().s;
+                push((Value){ .i = read_line(file, into, ins->val.u) });
+                break;
+            }
+            case OP_ACCEPT: {
+                char *dst = pop().s;
+                char *result = fgets(dst, (int)ins->arg, stdin);
+                (void)result; // The compiled program doesn't check either.
+                strip(dst, "\n");
+                break;
+            }
+            case OP_ACCEPT_NUM: {
+                char *result = fgets(string_builder, 4095, stdin);
+                (void)result;
+                strip(string_builder, "\n");
+                parse_into(pop().p, ins->type, ins->from, string_builder, true);
+                break;
+            }
+            case OP_ACCEPT_ARGV: accept_argv(pop().s, ins->arg, argc, argv); break;
+            case OP_STRING: run_string(ins->val.p); break;
+            case OP_UNSTRING: run_unstring(ins->val.p); break;
+            case OP_INSPECT: run_inspect(ins->val.p); break;
+        }
+    }
+}
+
+static int execute_guarded(Program *prog, int argc, char **argv) {
+    if (setjmp(runtime_error) != 0) {
+        fflush(stdout);
+        fprintf(stderr, "COBOL: CRITICAL RUNTIME ERROR\n");
+        return EXIT_FAILURE;
+    }
+
+    execute(prog, argc, argv);
+    return EXIT_SUCCESS;
+}
+
+int run_program(Program *prog, int argc, char **argv) {
+    memset(string_builder, 0, sizeof(string_builder));
+    memset(spare_string_buffer, 0, sizeof(spare_string_buffer));
+    string_builder_pointer = previous_string_statement_size = 0;
+    inspect_found = inspect_locked = false;
+    last_opened_outfile = NULL;
+    files = calloc(prog->file_count + 1, sizeof(FILE *));
+
+    sp = frame_count = 0;
+    stack_cap = 256;
+    stack = malloc(stack_cap * sizeof(Value));
+    frame_cap = 64;
+    frames = malloc(frame_cap * sizeof(Frame));
+
+    const int status = execute_guarded(prog, argc, argv);
+
+    for (size_t i = 0; i < prog->file_count; i++) {
+        if (files[i] != NULL)
+            fclose(files[i]);
+    }
+
+    fflush(stdout);
+    free(files);
+    free(stack);
+    free(frames);
+    files = NULL;
+    stack = NULL;
+    frames = NULL;
+    return status;
+}
@@ -0,0 +1,9 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "bytecode.h"
+
+// Runs prog the way its compiled executable would, returns its exit status.
+int run_program(Program *prog, int argc, char **argv);
+
+#endif
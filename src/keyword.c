@@ -0,0 +1,261 @@
+// Generated by tools/gen_keywords.py, do not edit.
+
+#include "keyword.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define SLOT_COUNT 512
+#define BUCKET_COUNT 128
+
+static char *keywords[KW_COUNT] = {
+    NULL,
+    "ACCEPT",
+    "ACCESS",
+    "ADD",
+    "ADDRESS",
+    "ADVANCING",
+    "AFTER",
+    "ALL",
+    "AND",
+    "ASCENDING",
+    "ASSIGN",
+    "AT",
+    "BEFORE",
+    "BINARY",
+    "BY",
+    "CALL",
+    "CHARACTERS",
+    "CLOSE",
+    "COMMAND-LINE",
+    "COMP",
+    "COMP-1",
+    "COMP-2",
+    "COMP-3",
+    "COMP-4",
+    "COMP-5",
+    "COMPUTE",
+    "COPY",
+    "DATA",
+    "DELETE",
+    "DELIMITED",
+    "DESCENDING",
+    "DISPLAY",
+    "DIVIDE",
+    "DIVISION",
+    "DOWN",
+    "DUPLICATES",
+    "DYNAMIC",
+    "ELSE",
+    "END",
+    "END-IF",
+    "END-PERFORM",
+    "END-STRING",
+    "END-UNSTRING",
+    "ENVIRONMENT",
+    "EQUAL",
+    "EXIT",
+    "EXTEND",
+    "FALSE",
+    "FD",
+    "FILE",
+    "FILE-CONTROL",
+    "FIRST",
+    "FOR",
+    "FROM",
+    "GIVING",
+    "GO",
+    "GREATER",
+    "I-O",
+    "IDENTIFICATION",
+    "IF",
+    "IN",
+    "INDEXED",
+    "INITIAL",
+    "INPUT",
+    "INPUT-OUTPUT",
+    "INSPECT",
+    "INTO",
+    "INVALID",
+    "IS",
+    "KEY",
+    "LENGTH",
+    "LESS",
+    "LINE",
+    "LINKAGE",
+    "MOD",
+    "MODE",
+    "MOVE",
+    "MULTIPLY",
+    "NEXT",
+    "NO",
+    "NOT",
+    "NULL",
+    "OCCURS",
+    "OF",
+    "ON",
+    "OPEN",
+    "OR",
+    "ORDER",
+    "ORGANIZATION",
+    "OUTPUT",
+    "PACKED-DECIMAL",
+    "PERFORM",
+    "PIC",
+    "POINTER",
+    "PROCEDURE",
+    "PROGRAM",
+    "PROGRAM-ID",
+    "RANDOM",
+    "READ",
+    "RECORD",
+    "RELATIVE",
+    "RELEASE",
+    "REMAINDER",
+    "REPLACING",
+    "RETURN",
+    "RETURNING",
+    "REWRITE",
+    "ROUNDED",
+    "RUN",
+    "SD",
+    "SECTION",
+    "SELECT",
+    "SEQUENTIAL",
+    "SET",
+    "SIZE",
+    "SORT",
+    "SPACE",
+    "START",
+    "STATUS",
+    "STOP",
+    "STRING",
+    "SUBTRACT",
+    "TALLYING",
+    "THAN",
+    "THEN",
+    "THROUGH",
+    "THRU",
+    "TIMES",
+    "TO",
+    "TRUE",
+    "UNSTRING",
+    "UNTIL",
+    "UP",
+    "USAGE",
+    "USING",
+    "VALUE",
+    "VARYING",
+    "WITH",
+    "WORKING-STORAGE",
+    "WRITE",
+    "ZERO",
+    "ZEROES",
+    "ZEROS",
+};
+
+static const uint16_t displacements[BUCKET_COUNT] = {
+    0, 0, 1, 3, 1, 1, 1, 0, 1, 1, 1, 0,
+    1, 0, 1, 0, 0, 1, 1, 0, 0, 2, 1, 0,
+    2, 1, 1, 3, 1, 0, 1, 2, 3, 1, 1, 1,
+    1, 1, 1, 1, 0, 1, 2, 1, 1, 1, 1, 0,
+    2, 0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 2,
+    0, 0, 2, 1, 0, 1, 1, 0, 2, 1, 1, 1,
+    1, 1, 1, 2, 1, 0, 0, 3, 1, 0, 0, 1,
+    2, 2, 0, 0, 0, 2, 2, 7, 0, 1, 0, 0,
+    0, 1, 1, 2, 1, 1, 1, 1, 1, 3, 4, 0,
+    1, 0, 0, 1, 1, 0, 0, 1, 3, 1, 0, 1,
+    1, 1, 0, 0, 2, 0, 0, 2,
+};
+
+static const uint8_t slots[SLOT_COUNT] = {
+    KW_NONE, KW_RELATIVE, KW_NONE, KW_NONE, KW_LESS, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_EQUAL, KW_PROCEDURE, KW_NONE, KW_COMP_5, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_SET, KW_FD, KW_NONE, KW_NONE, KW_SD, KW_END_STRING,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_I_O, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_ZERO,
+    KW_NONE, KW_NONE, KW_COMP_2, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_CLOSE, KW_IF, KW_NONE, KW_DIVIDE, KW_NONE, KW_NONE, KW_NONE,
+    KW_RECORD, KW_READ, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_PIC, KW_NONE, KW_NONE, KW_GIVING, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_START, KW_NONE, KW_NONE, KW_NO, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_ASCENDING, KW_NONE, KW_NONE,
+    KW_SECTION, KW_NONE, KW_NONE, KW_NONE, KW_OF, KW_CHARACTERS, KW_COMPUTE, KW_UNSTRING,
+    KW_NONE, KW_NONE, KW_END_IF, KW_NONE, KW_NONE, KW_OPEN, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_INTO,
+    KW_ASSIGN, KW_ADD, KW_NONE, KW_NONE, KW_NONE, KW_FILE, KW_NONE, KW_NONE,
+    KW_TO, KW_NONE, KW_NONE, KW_USING, KW_NONE, KW_NONE, KW_PERFORM, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_RETURNING, KW_NONE, KW_THROUGH, KW_NONE,
+    KW_TIMES, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_FILE_CONTROL, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_MOVE,
+    KW_NONE, KW_EXIT, KW_NONE, KW_INSPECT, KW_OCCURS, KW_NONE, KW_NONE, KW_ACCEPT,
+    KW_NONE, KW_NONE, KW_NONE, KW_VALUE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_DATA, KW_ADVANCING, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_EXTEND, KW_NONE, KW_NONE,
+    KW_COMP_4, KW_NONE, KW_NONE, KW_NONE, KW_DELIMITED, KW_NONE, KW_ENVIRONMENT, KW_PROGRAM,
+    KW_NONE, KW_NONE, KW_SEQUENTIAL, KW_NONE, KW_NONE, KW_NONE, KW_ROUNDED, KW_COPY,
+    KW_NULL, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_ELSE,
+    KW_INPUT_OUTPUT, KW_NONE, KW_NONE, KW_BY, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_SPACE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_COMP_3, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_POINTER, KW_MOD,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_ALL, KW_THAN, KW_NONE, KW_NONE, KW_AT, KW_BEFORE, KW_RANDOM, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_FALSE, KW_NONE, KW_END, KW_NONE,
+    KW_NONE, KW_NONE, KW_THEN, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_BINARY, KW_NONE, KW_NONE, KW_DELETE, KW_END_UNSTRING,
+    KW_NONE, KW_SELECT, KW_NONE, KW_COMP, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_RELEASE, KW_NONE, KW_USAGE, KW_AFTER, KW_NONE, KW_NONE,
+    KW_NONE, KW_REPLACING, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_ZEROS, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_STOP, KW_DIVISION, KW_UNTIL, KW_INVALID, KW_NONE, KW_NONE, KW_NONE,
+    KW_OR, KW_TRUE, KW_AND, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_REWRITE, KW_NONE, KW_NONE, KW_INDEXED, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_GREATER, KW_NONE, KW_NONE,
+    KW_THRU, KW_NONE, KW_NONE, KW_RUN, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_COMMAND_LINE, KW_NONE, KW_NONE, KW_NONE, KW_LINKAGE, KW_NONE, KW_NONE, KW_NONE,
+    KW_GO, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_FIRST, KW_END_PERFORM, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_STRING, KW_NONE, KW_NONE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_ORGANIZATION, KW_NONE, KW_INPUT, KW_NONE, KW_NONE,
+    KW_NONE, KW_IDENTIFICATION, KW_NONE, KW_NONE, KW_RETURN, KW_NONE, KW_NONE, KW_NONE,
+    KW_SIZE, KW_INITIAL, KW_NONE, KW_NONE, KW_NONE, KW_SUBTRACT, KW_NONE, KW_NONE,
+    KW_NONE, KW_DISPLAY, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_MODE, KW_NONE,
+    KW_NONE, KW_NONE, KW_IN, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_PACKED_DECIMAL,
+    KW_KEY, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_SORT, KW_NONE, KW_NONE,
+    KW_NONE, KW_FOR, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_UP, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_LINE, KW_NONE, KW_NONE, KW_NONE, KW_NOT,
+    KW_COMP_1, KW_NONE, KW_NONE, KW_STATUS, KW_NONE, KW_NONE, KW_NONE, KW_TALLYING,
+    KW_OUTPUT, KW_NONE, KW_NONE, KW_WITH, KW_ON, KW_WRITE, KW_WORKING_STORAGE, KW_NONE,
+    KW_NONE, KW_NONE, KW_NONE, KW_CALL, KW_REMAINDER, KW_NONE, KW_LENGTH, KW_NONE,
+    KW_NONE, KW_NONE, KW_DOWN, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_NONE,
+    KW_DUPLICATES, KW_NONE, KW_NONE, KW_PROGRAM_ID, KW_NONE, KW_NONE, KW_IS, KW_NONE,
+    KW_NONE, KW_MULTIPLY, KW_NONE, KW_NONE, KW_NEXT, KW_NONE, KW_NONE, KW_ACCESS,
+    KW_NONE, KW_NONE, KW_NONE, KW_ORDER, KW_NONE, KW_VARYING, KW_NONE, KW_ZEROES,
+    KW_DESCENDING, KW_FROM, KW_DYNAMIC, KW_NONE, KW_NONE, KW_NONE, KW_NONE, KW_ADDRESS,
+};
+
+static uint32_t hash(const char *str, size_t len, uint32_t seed) {
+    uint32_t h = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+Keyword lookup_keyword(const char *str, size_t len) {
+    const uint32_t seed = displacements[hash(str, len, 2166136261u) % BUCKET_COUNT];
+    const Keyword keyword = slots[hash(str, len, seed) % SLOT_COUNT];
+
+    if (keyword == KW_NONE || strncmp(keywords[keyword], str, len) != 0 || keywords[keyword][len] != '\0')
+        return KW_NONE;
+
+    return keyword;
+}
+
+char *keyword_to_string(Keyword keyword) {
+    return keyword < KW_COUNT ? keywords[keyword] : NULL;
+}
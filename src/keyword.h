@@ -0,0 +1,158 @@
+// Generated by tools/gen_keywords.py, do not edit.
+
+#ifndef KEYWORD_H
+#define KEYWORD_H
+
+#include <stdio.h>
+
+typedef enum {
+    KW_NONE,
+    KW_ACCEPT,
+    KW_ACCESS,
+    KW_ADD,
+    KW_ADDRESS,
+    KW_ADVANCING,
+    KW_AFTER,
+    KW_ALL,
+    KW_AND,
+    KW_ASCENDING,
+    KW_ASSIGN,
+    KW_AT,
+    KW_BEFORE,
+    KW_BINARY,
+    KW_BY,
+    KW_CALL,
+    KW_CHARACTERS,
+    KW_CLOSE,
+    KW_COMMAND_LINE,
+    KW_COMP,
+    KW_COMP_1,
+    KW_COMP_2,
+    KW_COMP_3,
+    KW_COMP_4,
+    KW_COMP_5,
+    KW_COMPUTE,
+    KW_COPY,
+    KW_DATA,
+    KW_DELETE,
+    KW_DELIMITED,
+    KW_DESCENDING,
+    KW_DISPLAY,
+    KW_DIVIDE,
+    KW_DIVISION,
+    KW_DOWN,
+    KW_DUPLICATES,
+    KW_DYNAMIC,
+    KW_ELSE,
+    KW_END,
+    KW_END_IF,
+    KW_END_PERFORM,
+    KW_END_STRING,
+    KW_END_UNSTRING,
+    KW_ENVIRONMENT,
+    KW_EQUAL,
+    KW_EXIT,
+    KW_EXTEND,
+    KW_FALSE,
+    KW_FD,
+    KW_FILE,
+    KW_FILE_CONTROL,
+    KW_FIRST,
+    KW_FOR,
+    KW_FROM,
+    KW_GIVING,
+    KW_GO,
+    KW_GREATER,
+    KW_I_O,
+    KW_IDENTIFICATION,
+    KW_IF,
+    KW_IN,
+    KW_INDEXED,
+    KW_INITIAL,
+    KW_INPUT,
+    KW_INPUT_OUTPUT,
+    KW_INSPECT,
+    KW_INTO,
+    KW_INVALID,
+    KW_IS,
+    KW_KEY,
+    KW_LENGTH,
+    KW_LESS,
+    KW_LINE,
+    KW_LINKAGE,
+    KW_MOD,
+    KW_MODE,
+    KW_MOVE,
+    KW_MULTIPLY,
+    KW_NEXT,
+    KW_NO,
+    KW_NOT,
+    KW_NULL,
+    KW_OCCURS,
+    KW_OF,
+    KW_ON,
+    KW_OPEN,
+    KW_OR,
+    KW_ORDER,
+    KW_ORGANIZATION,
+    KW_OUTPUT,
+    KW_PACKED_DECIMAL,
+    KW_PERFORM,
+    KW_PIC,
+    KW_POINTER,
+    KW_PROCEDURE,
+    KW_PROGRAM,
+    KW_PROGRAM_ID,
+    KW_RANDOM,
+    KW_READ,
+    KW_RECORD,
+    KW_RELATIVE,
+    KW_RELEASE,
+    KW_REMAINDER,
+    KW_REPLACING,
+    KW_RETURN,
+    KW_RETURNING,
+    KW_REWRITE,
+    KW_ROUNDED,
+    KW_RUN,
+    KW_SD,
+    KW_SECTION,
+    KW_SELECT,
+    KW_SEQUENTIAL,
+    KW_SET,
+    KW_SIZE,
+    KW_SORT,
+    KW_SPACE,
+    KW_START,
+    KW_STATUS,
+    KW_STOP,
+    KW_STRING,
+    KW_SUBTRACT,
+    KW_TALLYING,
+    KW_THAN,
+    KW_THEN,
+    KW_THROUGH,
+    KW_THRU,
+    KW_TIMES,
+    KW_TO,
+    KW_TRUE,
+    KW_UNSTRING,
+    KW_UNTIL,
+    KW_UP,
+    KW_USAGE,
+    KW_USING,
+    KW_VALUE,
+    KW_VARYING,
+    KW_WITH,
+    KW_WORKING_STORAGE,
+    KW_WRITE,
+    KW_ZERO,
+    KW_ZEROES,
+    KW_ZEROS,
+    KW_COUNT
+} Keyword;
+
+Keyword lookup_keyword(const char *str, size_t len);
+char *keyword_to_string(Keyword keyword);
+
+#endif
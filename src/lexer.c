@@ -1,7 +1,9 @@
 #include "lexer.h"
 #include "token.h"
+#include "keyword.h"
 #include "utils.h"
 #include "error.h"
+#include "arena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +14,10 @@
 #include <inttypes.h>
 #include <errno.h>
 
+// Token values are allocated from the compilation arena so the parser
+// and AST can point straight at them instead of copying.
+extern Arena *cur_arena;
+
 Lexer create_lexer(char *file, char **main_infiles) {
     FILE *f = fopen(file, "r");
 
@@ -83,7 +89,7 @@ static char peek(Lexer *lex, int offset) {
 }
 
 static Token create_and_step(Lexer *lex, TokenType type, char *value) {
-    Token tok = create_token(type, mystrdup(value), lex->ln, lex->col);
+    Token tok = create_token(type, arena_strdup(cur_arena, value), lex->ln, lex->col);
 
     while (*value) {
         step(lex);
@@ -96,13 +102,13 @@ static Token create_and_step(Lexer *lex, TokenType type, char *value) {
 static Token lex_id(Lexer *lex) {
     size_t col = lex->col;
     size_t realloc_size = 16;
-    char *value = malloc(realloc_size);
+    char *value = arena_alloc(cur_arena, realloc_size);
     size_t len = 0;
 
     while (isalnum(lex->cur) || lex->cur == '_' || lex->cur == '-') {
         if (len + 2 >= realloc_size) {
+            value = arena_realloc(cur_arena, value, realloc_size, realloc_size * 2);
             realloc_size *= 2;
-            value = realloc(value, realloc_size);
         }
 
         value[len++] = isalpha(lex->cur) ? toupper(lex->cur) : lex->cur;
@@ -110,12 +116,18 @@ static Token lex_id(Lexer *lex) {
     }
 
     value[len] = '\0';
-    return create_token(TOK_ID, value, lex->ln, col);
+
+    // Give back the unused tail, the identifier is the newest allocation.
+    value = arena_realloc(cur_arena, value, realloc_size, len + 1);
+
+    Token tok = create_token(TOK_ID, value, lex->ln, col);
+    tok.keyword = lookup_keyword(value, len);
+    return tok;
 }
 
 static Token lex_prefixed_digit(Lexer *lex, size_t col, bool has_minus) {
     size_t realloc_size = 16;
-    char *value = malloc(realloc_size);
+    char *value = arena_alloc(cur_arena, realloc_size);
     size_t len = 0;
 
     if (has_minus)
@@ -137,8 +149,8 @@ static Token lex_prefixed_digit(Lexer *lex, size_t col, bool has_minus) {
             (!is_hex && isdigit(lex->cur) && lex->cur >= '0' && lex->cur <= '7')) {
 
         if (len + 2 >= realloc_size) {
+            value = arena_realloc(cur_arena, value, realloc_size, realloc_size * 2);
             realloc_size *= 2;
-            value = realloc(value, realloc_size);
         }
 
         value[len++] = lex->cur;
@@ -172,7 +184,7 @@ static Token lex_prefixed_digit(Lexer *lex, size_t col, bool has_minus) {
         return create_token(TOK_INT, value, lex->ln, lex->col);
     }
 
-    value = realloc(value, 32);
+    value = arena_realloc(cur_arena, value, realloc_size, 32);
 
     if (has_minus)
         sprintf(value, "%" PRId32, (int32_t)val);
@@ -185,7 +197,7 @@ static Token lex_prefixed_digit(Lexer *lex, size_t col, bool has_minus) {
 static Token lex_digit(Lexer *lex) {
     size_t col = lex->col;
     size_t realloc_size = 16;
-    char *value = malloc(realloc_size);
+    char *value = arena_alloc(cur_arena, realloc_size);
     size_t len = 0;
 
     bool has_decimal = false;
@@ -197,10 +209,8 @@ static Token lex_digit(Lexer *lex) {
         step(lex);
     }
 
-    if (lex->cur == '0' && peek(lex, 1) == 'x') {
-        free(value);
+    if (lex->cur == '0' && peek(lex, 1) == 'x')
         return lex_prefixed_digit(lex, col, has_minus);
-    }
 
     while (isdigit(lex->cur) || (lex->cur == '.' && len > 0 && !has_decimal && isdigit(peek(lex, 1))) ||
             (lex->cur == '_' && isdigit(peek(lex, 1)))) {
@@ -213,8 +223,8 @@ static Token lex_digit(Lexer *lex) {
         }
 
         if (len + 2 >= realloc_size) {
+            value = arena_realloc(cur_arena, value, realloc_size, realloc_size * 2);
             realloc_size *= 2;
-            value = realloc(value, realloc_size);
         }
 
         value[len++] = lex->cur;
@@ -227,7 +237,7 @@ static Token lex_digit(Lexer *lex) {
         step(lex);
 
         if (!has_decimal) {
-            value = realloc(value, len + 3);
+            value = arena_realloc(cur_arena, value, realloc_size, len + 3);
             strcat(value, ".0");
         }
 
@@ -269,7 +279,7 @@ static Token lex_digit(Lexer *lex) {
             return create_token(TOK_INT, value, lex->ln, lex->col);
         }
 
-        value = realloc(value, 32);
+        value = arena_realloc(cur_arena, value, realloc_size, 32);
 
         if (value[0] == '-')
             sprintf(value, "%" PRId32, (int32_t)val);
@@ -282,7 +292,7 @@ static Token lex_digit(Lexer *lex) {
 
 static Token lex_char(Lexer *lex) {
     size_t col = lex->col;
-    char *value = malloc(16);
+    char *value = arena_alloc(cur_arena, 16);
     step(lex);
 
     if (lex->cur == '\\') {
@@ -351,14 +361,14 @@ static Token lex_string(Lexer *lex) {
     size_t col = lex->col;
 
     size_t realloc_size = 16;
-    char *value = malloc(realloc_size);
+    char *value = arena_alloc(cur_arena, realloc_size);
     size_t len = 0;
     step(lex);
 
     while (lex->cur != '\0' && lex->cur != '"') {
         if (len + 2 >= realloc_size) {
+            value = arena_realloc(cur_arena, value, realloc_size, realloc_size * 2);
             realloc_size *= 2;
-            value = realloc(value, realloc_size);
         }
 
         value[len++] = lex->cur;
@@ -368,8 +378,8 @@ static Token lex_string(Lexer *lex) {
         // gets a bit confusing.
         if (lex->cur == '\\' && peek(lex, 1) == '"') {
             if (len + 2 >= realloc_size) {
+                value = arena_realloc(cur_arena, value, realloc_size, realloc_size * 2);
                 realloc_size *= 2;
-                value = realloc(value, realloc_size);
             }
 
             value[len++] = lex->cur;
@@ -395,9 +405,10 @@ static Token lex_string(Lexer *lex) {
     while (lex->cur == '"') {
         Token next = lex_string(lex);
 
-        value = realloc(value, (strlen(value) + strlen(next.value) + 1) * sizeof(char));
-        strcat(value, next.value);
-        free(next.value);
+        char *joined = arena_alloc(cur_arena, (strlen(value) + strlen(next.value) + 1) * sizeof(char));
+        strcpy(joined, value);
+        strcat(joined, next.value);
+        value = joined;
 
         while (isspace(lex->cur))
             step(lex);
@@ -425,7 +436,7 @@ Token lex_next_token(Lexer *lex) {
         return lex_string(lex);
 
     switch (lex->cur) {
-        case '\0': return create_token(TOK_EOF, mystrdup("eof"), lex->ln, lex->col);
+        case '\0': return create_token(TOK_EOF, arena_strdup(cur_arena, "eof"), lex->ln, lex->col);
         case '(': return create_and_step(lex, TOK_LPAREN, "(");
         case ')': return create_and_step(lex, TOK_RPAREN, ")");
         case '.': return create_and_step(lex, TOK_DOT, ".");
@@ -1,5 +1,7 @@
 #include "compile.h"
 #include "error.h"
+#include "process.h"
+#include "report.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +9,19 @@
 
 char *cc_path = "gcc";
 
+// How many gcc jobs may run at the same time.
+unsigned int max_jobs = 1;
+
+// Where unchanged files' objects are kept between builds, NULL if caching is off.
+char *cache_dir = NULL;
+
+// Where the JSON build report goes, NULL if there isn't one.
+char *report_json = NULL;
+
+// -O<level> and -march=<arch> as given, NULL to leave them to the defaults.
+char *opt_level = NULL;
+char *march = NULL;
+
 void usage(const char *prog) {
     printf("usage: %s <command> [options] <files...>\n"
            "commands:\n"
@@ -15,11 +30,23 @@ void usage(const char *prog) {
            "    run                 build and run the executable\n"
            "    source              produce a c file\n"
            "options:\n"
+           "    -cache <directory>  reuse objects of unchanged files from a cache\n"
+           "    -fcomputed-goto     emit the procedure division as one function\n"
+           "    -flto               optimise across files when linking\n"
+           "    -fmem-report        print front end memory statistics\n"
+           "    -freport-json <file> write timings and counters as json\n"
+           "    -ftime-report       print time and memory spent in each phase\n"
+           "    -fwhole-program     keep paragraphs and data private to each file\n"
            "    -g                  build with debugging information\n"
            "    -include <header>   include a c header\n"
+           "    -interpret          run without the c compiler where possible\n"
+           "    -j <jobs>           run up to this many c compiler jobs at once\n"
            "    -l <library>        link with a c library\n"
+           "    -march=<arch>       generate code for this cpu\n"
            "    -no-main            don't add a main function\n"
-           "    -o <output file>    specify the output filename\n", prog);
+           "    -O<level>           optimise the generated c, 0 to 3\n"
+           "    -o <output file>    specify the output filename\n"
+           "    -pipe               pipe the generated c into the c compiler\n", prog);
 }
 
 int main(int argc, char **argv) {
@@ -65,6 +92,36 @@ int main(int argc, char **argv) {
             return EXIT_SUCCESS;
         } else if (strcmp(argv[i], "-g") == 0)
             flags |= COMP_DEBUG;
+        else if (strcmp(argv[i], "-cache") == 0) {
+            if (i == argc - 1) {
+                log_error(NULL, 0, 0);
+                fprintf(stderr, "missing cache directory\n");
+                free(libs);
+                free(source_includes);
+                return EXIT_FAILURE;
+            }
+
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "-flto") == 0)
+            flags |= COMP_LTO;
+        else if (strcmp(argv[i], "-fmem-report") == 0)
+            flags |= COMP_MEM_REPORT;
+        else if (strcmp(argv[i], "-freport-json") == 0) {
+            if (i == argc - 1) {
+                log_error(NULL, 0, 0);
+                fprintf(stderr, "missing report filename\n");
+                free(libs);
+                free(source_includes);
+                return EXIT_FAILURE;
+            }
+
+            report_json = argv[++i];
+        } else if (strcmp(argv[i], "-ftime-report") == 0)
+            flags |= COMP_TIME_REPORT;
+        else if (strcmp(argv[i], "-fcomputed-goto") == 0)
+            flags |= COMP_COMPUTED_GOTO;
+        else if (strcmp(argv[i], "-fwhole-program") == 0)
+            flags |= COMP_WHOLE_PROGRAM;
         else if (strcmp(argv[i], "-l") == 0) {
             if (i == argc - 1) {
                 log_error(NULL, 0, 0);
@@ -101,8 +158,45 @@ int main(int argc, char **argv) {
             strcat(source_includes, argv[i]);
             strcat(source_includes, ".h>\n");
             source_includes_len += len + 15;
+        } else if (strcmp(argv[i], "-interpret") == 0)
+            flags |= COMP_INTERPRET;
+        else if (strcmp(argv[i], "-j") == 0) {
+            const long jobs = i < argc - 1 ? strtol(argv[++i], NULL, 10) : 0;
+
+            if (jobs <= 0 || jobs > MAX_JOBS) {
+                log_error(NULL, 0, 0);
+                fprintf(stderr, "invalid job count\n");
+                free(libs);
+                free(source_includes);
+                return EXIT_FAILURE;
+            }
+
+            max_jobs = jobs;
+        } else if (strncmp(argv[i], "-march=", 7) == 0) {
+            if (argv[i][7] == '\0') {
+                log_error(NULL, 0, 0);
+                fprintf(stderr, "missing architecture\n");
+                free(libs);
+                free(source_includes);
+                return EXIT_FAILURE;
+            }
+
+            march = argv[i];
         } else if (strcmp(argv[i], "-no-main") == 0)
             flags |= COMP_NO_MAIN;
+        else if (strncmp(argv[i], "-O", 2) == 0) {
+            if (argv[i][2] < '0' || argv[i][2] > '3' || argv[i][3] != '\0') {
+                log_error(NULL, 0, 0);
+                fprintf(stderr, "invalid optimisation level '%s'\n", argv[i]);
+                free(libs);
+                free(source_includes);
+                return EXIT_FAILURE;
+            }
+
+            opt_level = argv[i];
+        }
+        else if (strcmp(argv[i], "-pipe") == 0)
+            flags |= COMP_PIPE;
         else if (strcmp(argv[i], "-o") == 0) {
             if (i == argc - 1) {
                 log_error(NULL, 0, 0);
@@ -128,7 +222,12 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
     
+    start_reports();
     int status = compile(infiles, infile_count, outfile, flags, libs, source_includes);
+
+    if (!finish_reports(flags & COMP_TIME_REPORT, report_json))
+        status = EXIT_FAILURE;
+
     free(libs);
     free(source_includes);
     free(infiles);
@@ -4,6 +4,11 @@
 #include "ast.h"
 #include "utils.h"
 #include "error.h"
+#include "arena.h"
+#include "symtab.h"
+#include "cache.h"
+#include "copybook.h"
+#include "report.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,60 +21,48 @@
 
 #define NOP(ln, col) create_ast(AST_NOP, ln, col)
 
-#define IS_MATH(prs) (prs->tok->type == TOK_PLUS || prs->tok->type == TOK_MINUS || prs->tok->type == TOK_STAR || prs->tok->type == TOK_SLASH || strcmp(prs->tok->value, "MOD") == 0)
+#define IS_MATH(prs) (prs->tok->type == TOK_PLUS || prs->tok->type == TOK_MINUS || prs->tok->type == TOK_STAR || prs->tok->type == TOK_SLASH || prs->tok->keyword == KW_MOD)
 
-#define IS_CONDITION(prs) (prs->tok->type == TOK_EQ || prs->tok->type == TOK_EQUAL || prs->tok->type == TOK_NEQ || prs->tok->type == TOK_LT || prs->tok->type == TOK_LTE || prs->tok->type == TOK_GT || prs->tok->type == TOK_GTE || strcmp(prs->tok->value, "IS") == 0 || strcmp(prs->tok->value, "AND") == 0 || strcmp(prs->tok->value, "OR") == 0 || (strcmp(prs->tok->value, "NOT") == 0 && strcmp(peek(prs, 1)->value, "EQUAL") == 0))
+#define IS_CONDITION(prs) (prs->tok->type == TOK_EQ || prs->tok->type == TOK_EQUAL || prs->tok->type == TOK_NEQ || prs->tok->type == TOK_LT || prs->tok->type == TOK_LTE || prs->tok->type == TOK_GT || prs->tok->type == TOK_GTE || prs->tok->keyword == KW_IS || prs->tok->keyword == KW_AND || prs->tok->keyword == KW_OR || (prs->tok->keyword == KW_NOT && peek(prs, 1)->keyword == KW_EQUAL))
 
-// TODO: Implement COMP-3 and COMP-6.
-#define IS_COMP(tok) (strcmp(tok->value, "COMP") == 0 || strcmp(tok->value, "COMP-1") == 0 || strcmp(tok->value, "COMP-2") == 0 || strcmp(tok->value, "COMP-4") == 0 || strcmp(tok->value, "COMP-5") == 0)
-
-#define TABLE_SIZE 10000
+// TODO: Implement COMP-6.
+#define IS_COMP(tok) (tok->keyword == KW_COMP || tok->keyword == KW_COMP_1 || tok->keyword == KW_COMP_2 || tok->keyword == KW_COMP_3 || tok->keyword == KW_PACKED_DECIMAL || tok->keyword == KW_COMP_4 || tok->keyword == KW_COMP_5)
 
 extern char *cur_dir;
+extern Arena *cur_arena;
 //extern ASTList delayed_assigns;
 
-static Variable variables[TABLE_SIZE];
+// Symbols of the file being parsed, copybooks add to the same table.
+static SymbolTable symbols;
 
 // Sometimes we want to return multiple things but we can't,
 // so we just append to this list.
 static ASTList *root_ptr;
 
+// Paragraphs named by GO TO and PERFORM THRU, they only exist as labels
+// in the single function PROCEDURE DIVISION so are checked after parsing.
+static ASTList jump_targets;
+
 static size_t uids = 0;
 
 char *cur_file;
 
-uint32_t hash_FNV1a(const char *data, size_t size) {
-    uint32_t h = 2166136261UL;
-
-    for (size_t i = 0; i < size; i++) {
-        h ^= data[i];
-        h *= 16777619;
-    }
-
-    return h % TABLE_SIZE;
-}
-
+// Returns the symbol for name, which isn't used if it hasn't been declared yet.
 Variable *find_variable(char *file, char *name) {
-    /*
-    char *data = malloc(strlen(file) + strlen(name) + 1);
-    strcpy(data, file);
-    strcat(data, name);
-    */
-
-    // For now, we won't include the filename in the hashing algorithm,
-    // because it messes with finding symbols from other files, a.k.a copybooks.
+    // Copybooks are parsed with their own file but share the symbols
+    // of the file that includes them, so the file isn't part of the key.
     // However, the codebase already passes the file as a parameter everywhere,
     // and this may change later, so we'll just supress the warning for now.
     (void)file;
 
-    char *data = mystrdup(name);
-    Variable *var = &variables[hash_FNV1a(data, strlen(data))];
-    free(data);
-    return var;
+    return symtab_get(&symbols, name);
 }
 
 bool variable_exists(char *file, char *name) {
-    return find_variable(file, name)->used;
+    (void)file;
+
+    Variable *var = symtab_lookup(&symbols, name);
+    return var != NULL && var->used;
 }
 
 Variable *add_variable(char *file, char *name, PictureType type, unsigned int count) {
@@ -90,6 +83,9 @@ Variable *add_variable(char *file, char *name, PictureType type, unsigned int co
     var->is_fd = var->is_index = var->is_label = var->is_linkage_src = var->using_in_proc_div = var->pointer_been_set = false;
     var->fields = NULL;
     var->struct_sym = NULL;
+    var->organization = ORG_NONE;
+    var->access = ACCESS_SEQUENTIAL;
+    var->record = var->fd = var->record_key = NULL;
     var->uid = uids++;
     var->type.pointer_uid = var->uid;
     return var;
@@ -151,35 +147,139 @@ PictureType get_value_type(AST *ast) {
     return (PictureType){ .type = TYPE_SIGNED_NUMERIC, .count = 0 };
 }
 
+// Declared decimals are integers scaled by 10^decimal_places, constants
+// and COMP-1/COMP-2 items stay floating point.
+bool is_fixed_point(PictureType *type) {
+    return (type->type == TYPE_DECIMAL_NUMERIC || type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC) &&
+        type->comp_type != COMP1 && type->comp_type != COMP2 && type->decimal_places > 0;
+}
+
+// COMP-3 items are kept as the packed decimal bytes, two digits a byte and
+// the sign in the last nibble.
+bool is_packed(PictureType *type) {
+    return type->comp_type == COMP3;
+}
+
+// Past 18 digits a number doesn't fit 64 bits and is held in an __int128.
+bool is_wide_numeric(PictureType *type) {
+    if (type->comp_type == COMP1 || type->comp_type == COMP2 || type->comp_type == COMP_POINTER)
+        return false;
+    else if (is_fixed_point(type))
+        return type->places + type->decimal_places > 18;
+
+    return (type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_UNSIGNED_NUMERIC ||
+            type->type == TYPE_SIGNED_SUPRESSED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC) &&
+        type->places > 18;
+}
+
+// An integer literal too long for an AST_INT, parse_constant() keeps its digits as written.
+bool is_long_integer(AST *value) {
+    if (value->type != AST_FLOAT || value->constant.string == NULL)
+        return false;
+
+    char *digits = value->constant.string + (*value->constant.string == '-' || *value->constant.string == '+');
+    return *digits != '\0' && digits[strspn(digits, "0123456789")] == '\0';
+}
+
+static void index_header(Parser *prs, size_t pos) {
+    static const Keyword divisions[DIV_COUNT] = { KW_NONE, KW_IDENTIFICATION, KW_ENVIRONMENT, KW_DATA, KW_PROCEDURE };
+    static const Keyword sections[SECT_COUNT] = { KW_NONE, KW_INPUT_OUTPUT, KW_FILE, KW_LINKAGE, KW_WORKING_STORAGE };
+
+    Token *name = &prs->tokens[pos];
+    Token *header = &prs->tokens[pos + 1];
+
+    if (name->type != TOK_ID || name->keyword == KW_NONE)
+        return;
+
+    if (header->keyword == KW_DIVISION) {
+        for (size_t i = 1; i < DIV_COUNT; i++) {
+            if (prs->division_pos[i] == SIZE_MAX && name->keyword == divisions[i])
+                prs->division_pos[i] = pos;
+        }
+    } else if (header->keyword == KW_SECTION) {
+        for (size_t i = 1; i < SECT_COUNT; i++) {
+            if (prs->section_pos[i] == SIZE_MAX && name->keyword == sections[i])
+                prs->section_pos[i] = pos;
+        }
+    }
+}
+
+static Parser init_parser(char *file, Token *tokens) {
+    Parser prs = (Parser){ .file = file, .tokens = tokens, .token_count = 0, .pos = 0, .program_id = {0},
+        .in_main = false, .cur_div = DIV_NONE, .cur_sect = SECT_NONE, .parse_extra_value = true, .in_set = false };
+
+    for (size_t i = 0; i < DIV_COUNT; i++)
+        prs.division_pos[i] = SIZE_MAX;
+
+    for (size_t i = 0; i < SECT_COUNT; i++)
+        prs.section_pos[i] = SIZE_MAX;
+
+    return prs;
+}
+
+// Points missing headers at the EOF token once every token is in.
+static void finish_parser(Parser *prs) {
+    prs->tok = &prs->tokens[0];
+
+    for (size_t i = 0; i < DIV_COUNT; i++) {
+        if (prs->division_pos[i] == SIZE_MAX)
+            prs->division_pos[i] = prs->token_count - 1;
+    }
+
+    for (size_t i = 0; i < SECT_COUNT; i++) {
+        if (prs->section_pos[i] == SIZE_MAX)
+            prs->section_pos[i] = prs->token_count - 1;
+    }
+}
+
 Parser create_parser(char *file, char **main_infiles) {
+    Timer timer = start_timer();
     Lexer lex = create_lexer(file, main_infiles);
     Token tok;
 
-    Token *tokens = malloc(32 * sizeof(Token));
-    size_t token_count = 0;
+    Parser prs = init_parser(file, malloc(32 * sizeof(Token)));
     size_t token_cap = 32;
 
     while ((tok = lex_next_token(&lex)).type != TOK_EOF) {
         // Extra +1 for the EOF.
-        if (token_count + 2 >= token_cap) {
+        if (prs.token_count + 2 >= token_cap) {
             token_cap *= 2;
-            tokens = realloc(tokens, token_cap * sizeof(Token));
+            prs.tokens = realloc(prs.tokens, token_cap * sizeof(Token));
         }
 
-        tokens[token_count++] = tok;
+        prs.tokens[prs.token_count++] = tok;
+
+        if (tok.keyword != KW_NONE && prs.token_count > 1)
+            index_header(&prs, prs.token_count - 2);
     }
 
     // Add the EOF.
-    tokens[token_count++] = tok;
+    prs.tokens[prs.token_count++] = tok;
     delete_lexer(&lex);
-    return (Parser){ .file = file, .tokens = tokens, .token_count = token_count, .tok = &tokens[0], 
-        .pos = 0, .program_id = {0}, .in_main = false, .cur_div = DIV_NONE, .cur_sect = SECT_NONE, .parse_extra_value = true, .in_set = false };
+    report_tokens(prs.token_count - 1);
+    report_phase(PHASE_LEX, &timer);
+    finish_parser(&prs);
+    return prs;
 }
 
-void delete_parser(Parser *prs) {
-    for (size_t i = 0; i < prs->token_count; i++)
-        delete_token(&prs->tokens[i]);
+// Builds a parser over tokens that were already lexed, like a memoised copybook's.
+// The last token has to be the EOF.
+Parser create_parser_from_tokens(char *file, Token *tokens, size_t token_count) {
+    Parser prs = init_parser(file, malloc(token_count * sizeof(Token)));
+    memcpy(prs.tokens, tokens, token_count * sizeof(Token));
+    prs.token_count = token_count;
 
+    for (size_t i = 1; i < token_count; i++) {
+        if (tokens[i].keyword != KW_NONE)
+            index_header(&prs, i - 1);
+    }
+
+    finish_parser(&prs);
+    return prs;
+}
+
+void delete_parser(Parser *prs) {
+    // Token values are owned by the arena.
     free(prs->tokens);
 }
 
@@ -298,9 +398,9 @@ AST *parse_id(Parser *prs);
 AST *parse_any_no_error(Parser *prs) {
     if (prs->tok->type == TOK_INT || prs->tok->type == TOK_FLOAT || prs->tok->type == TOK_STRING)
         return parse_stmt(prs);
-    else if (strcmp(prs->tok->value, "LENGTH") == 0)
+    else if (prs->tok->keyword == KW_LENGTH)
         return parse_id(prs);
-    else if (strcmp(prs->tok->value, "ADDRESS") == 0)
+    else if (prs->tok->keyword == KW_ADDRESS)
         return parse_id(prs);
 
     Variable *var = find_variable(prs->file, prs->tok->value);
@@ -314,12 +414,12 @@ AST *parse_any_no_error(Parser *prs) {
         ast = create_ast(AST_FIELD, prs->tok->ln, prs->tok->col);
         ast->field.sym = var;
         ast->field.base = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-        ast->field.base->var.name = mystrdup(var->struct_sym->name);
+        ast->field.base->var.name = var->struct_sym->name;
         ast->field.base->var.sym = var->struct_sym;
         ast->field.value = NULL;
     } else {
         ast = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-        ast->var.name = mystrdup(prs->tok->value);
+        ast->var.name = prs->tok->value;
         ast->var.sym = var;
     }
 
@@ -341,7 +441,7 @@ AST *parse_display(Parser *prs, ASTList *root) {
     const size_t col = prs->tok->col;
 
     // This is the end of the display statement, doesn't print a newline, return nothing.
-    if (strcmp(prs->tok->value, "WITH") == 0 && strcmp(peek(prs, 1)->value, "NO") == 0 && strcmp(peek(prs, 2)->value, "ADVANCING") == 0) {
+    if (prs->tok->keyword == KW_WITH && peek(prs, 1)->keyword == KW_NO && peek(prs, 2)->keyword == KW_ADVANCING) {
         eat(prs, TOK_ID);
         eat(prs, TOK_ID);
         eat(prs, TOK_ID);
@@ -357,20 +457,17 @@ AST *parse_display(Parser *prs, ASTList *root) {
 
     // End of display.
     if (LAST_DISPLAY_VALUE_WASNT_VALID(thing)) {
-        delete_ast(thing);
-
         if (!displayed_previously)
             return NOP(ln, col);
 
         // Add the newline at the end of a formatted display.
         AST *nl = create_ast(AST_DISPLAY, prs->tok->ln, prs->tok->col);
         nl->display.value = create_ast(AST_STRING, prs->tok->ln, prs->tok->col);
-        nl->display.value->constant.string = mystrdup("\\n");
+        nl->display.value->constant.string = "\\n";
         nl->display.add_newline = false;
         return nl;
     }
 
-    delete_ast(thing);
     AST *ast = create_ast(AST_DISPLAY, ln, col);
     ast->display.value = parse_value(prs, TYPE_ANY);
 
@@ -393,9 +490,8 @@ AST *parse_display(Parser *prs, ASTList *root) {
     if (LAST_DISPLAY_VALUE_WASNT_VALID(next)) {
         // Invalid thing, stop.
         jump_to(prs, before);
-        delete_ast(next);
 
-        if (strcmp(prs->tok->value, "WITH") == 0 && strcmp(peek(prs, 1)->value, "NO") == 0 && strcmp(peek(prs, 2)->value, "ADVANCING") == 0) {
+        if (prs->tok->keyword == KW_WITH && peek(prs, 1)->keyword == KW_NO && peek(prs, 2)->keyword == KW_ADVANCING) {
             eat(prs, TOK_ID);
             eat(prs, TOK_ID);
             eat(prs, TOK_ID);
@@ -512,39 +608,38 @@ AST *parse_arithmetic(Parser *prs) {
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
+    const Keyword verb = prs->tok->keyword;
     eat(prs, TOK_ID);
 
     AST *value = parse_value(prs, TYPE_ANY);
 
-    if (strcmp(name, "ADD") == 0 && !expect_identifier(prs, "TO")) {
-        delete_ast(value);
+    if (verb == KW_ADD && !expect_identifier(prs, "TO")) {
         eat_until(prs, TOK_DOT);
-        free(name);
         return NOP(ln, col);
-    } else if (strcmp(name, "SUBTRACT") == 0 && !expect_identifier(prs, "FROM")) {
-        delete_ast(value);
+    } else if (verb == KW_SUBTRACT && !expect_identifier(prs, "FROM")) {
         eat_until(prs, TOK_DOT);
-        free(name);
         return NOP(ln, col);
-    } else if (strcmp(name, "MULTIPLY") == 0 && !expect_identifier(prs, "BY")) {
-        delete_ast(value);
+    } else if (verb == KW_MULTIPLY && !expect_identifier(prs, "BY")) {
         eat_until(prs, TOK_DOT);
-        free(name);
         return NOP(ln, col);
-    } else if (strcmp(name, "DIVIDE") == 0 && !expect_identifier(prs, "BY")) {
-        delete_ast(value);
+    } else if (verb == KW_DIVIDE && !expect_identifier(prs, "BY")) {
         eat_until(prs, TOK_DOT);
-        free(name);
         return NOP(ln, col);
     }
 
     eat(prs, TOK_ID);
     AST *right = parse_value(prs, TYPE_ANY);
     AST *give = NULL;
+    bool rounded = false;
+
+    if (prs->tok->keyword == KW_ROUNDED) {
+        eat(prs, TOK_ID);
+        rounded = true;
+    }
 
-    if (strcmp(prs->tok->value, "GIVING") != 0) {
-        if (strcmp(name, "MULTIPLY") == 0 || strcmp(name, "DIVIDE") == 0) {
+    if (prs->tok->keyword != KW_GIVING) {
+        if (verb == KW_MULTIPLY || verb == KW_DIVIDE) {
             log_error(prs->file, ln, col);
             fprintf(stderr, "%s must be given implicitly\n", name);
             show_error(prs->file, ln, col);
@@ -565,10 +660,16 @@ AST *parse_arithmetic(Parser *prs) {
             fprintf(stderr, "giving value isn't a storage value\n");
             show_error(give->file, give->ln, give->col);
         }
+
+        // ROUNDED belongs to the GIVING value when there is one.
+        rounded = prs->tok->keyword == KW_ROUNDED;
+
+        if (rounded)
+            eat(prs, TOK_ID);
     }
 
     // MULTIPLY and DIVIDE can't be implicitly given.
-    if (strcmp(name, "DIVIDE") == 0 && strcmp(prs->tok->value, "REMAINDER") == 0) {
+    if (verb == KW_DIVIDE && prs->tok->keyword == KW_REMAINDER) {
         eat(prs, TOK_ID);
         AST *remainder_dst = parse_value(prs, TYPE_ANY);
 
@@ -576,24 +677,20 @@ AST *parse_arithmetic(Parser *prs) {
             log_error(remainder_dst->file, remainder_dst->ln, remainder_dst->col);
             fprintf(stderr, "remainder value isn't a storage value\n");
             show_error(remainder_dst->file, remainder_dst->ln, remainder_dst->col);
-            delete_ast(remainder_dst);
         } else {
             // Two arithmetics in one, can't return this, so we have to push a MODULUS AST.
             AST *remainder = create_ast(AST_ARITHMETIC, remainder_dst->ln, remainder_dst->col);
             remainder->arithmetic.right = right;
             remainder->arithmetic.dst = remainder_dst;
             remainder->arithmetic.left = value;
-            remainder->arithmetic.name = mystrdup("REMAINDER");
-            remainder->arithmetic.cloned_left = remainder->arithmetic.cloned_right = true;
+            remainder->arithmetic.name = "REMAINDER";
             remainder->arithmetic.implicit_giving = false;
+            remainder->arithmetic.rounded = false;
 
-            if (strcmp(name, "DIVIDE") == 0 && give != NULL) {
+            if (verb == KW_DIVIDE && give != NULL) {
                 //if (right->type == AST_VAR && strcmp(right->var.name, remainder_dst->var.name) == 0) {
                     // Doing a modulus into its own variable, don't want to
                     // overrwrite with a division here.
-                    remainder->arithmetic.cloned_left = remainder->arithmetic.cloned_right = false;
-                    delete_ast(give); // GIVING for the division, not the remainder, don't need it.
-                    free(name);
                     return remainder;
                 //}
             }
@@ -606,7 +703,7 @@ AST *parse_arithmetic(Parser *prs) {
     ast->arithmetic.left = value;
     ast->arithmetic.name = name;
     ast->arithmetic.right = right;
-    ast->arithmetic.cloned_left = ast->arithmetic.cloned_right = false;
+    ast->arithmetic.rounded = rounded;
 
     if (give == NULL)
         ast->arithmetic.implicit_giving = true;
@@ -629,7 +726,7 @@ AST *parse_math(Parser *prs, AST *first, unsigned int type) {
     while (IS_MATH(prs)) {
         AST *oper = create_ast(AST_OPER, prs->tok->ln, prs->tok->col);
 
-        if (strcmp(prs->tok->value, "MOD") == 0)
+        if (prs->tok->keyword == KW_MOD)
             oper->oper = TOK_MOD;
         else
             oper->oper = prs->tok->type;
@@ -647,14 +744,14 @@ AST *parse_oper(Parser *prs) {
     AST *oper = create_ast(AST_OPER, prs->tok->ln, prs->tok->col);
     oper->oper = TOK_EQ; // Fallback.
 
-    if (strcmp(prs->tok->value, "IS") == 0) {
+    if (prs->tok->keyword == KW_IS) {
         eat(prs, TOK_ID);
 
-        if (strcmp(prs->tok->value, "EQUAL") == 0) {
+        if (prs->tok->keyword == KW_EQUAL) {
             oper->oper = TOK_EQ;
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "TO") != 0) {
+            if (prs->tok->keyword != KW_TO) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'TO' following 'EQUAL'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -662,10 +759,10 @@ AST *parse_oper(Parser *prs) {
             }
 
             eat(prs, TOK_ID);
-        } else if (strcmp(prs->tok->value, "LESS") == 0) {
+        } else if (prs->tok->keyword == KW_LESS) {
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "THAN") != 0) {
+            if (prs->tok->keyword != KW_THAN) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'THAN' following 'LESS'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -674,14 +771,14 @@ AST *parse_oper(Parser *prs) {
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "OR") != 0) {
+            if (prs->tok->keyword != KW_OR) {
                 oper->oper = TOK_LT;
                 return oper;
             }
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "EQUAL") != 0) {
+            if (prs->tok->keyword != KW_EQUAL) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'EQUAL' following 'OR'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -690,7 +787,7 @@ AST *parse_oper(Parser *prs) {
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "TO") != 0) {
+            if (prs->tok->keyword != KW_TO) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'TO' following 'EQUAL'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -698,10 +795,10 @@ AST *parse_oper(Parser *prs) {
                 oper->oper = TOK_LTE;
                 eat(prs, TOK_ID);
             }
-        } else if (strcmp(prs->tok->value, "GREATER") == 0) {
+        } else if (prs->tok->keyword == KW_GREATER) {
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "THAN") != 0) {
+            if (prs->tok->keyword != KW_THAN) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'THAN' following 'GREATER'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -710,14 +807,14 @@ AST *parse_oper(Parser *prs) {
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "OR") != 0) {
+            if (prs->tok->keyword != KW_OR) {
                 oper->oper = TOK_GT;
                 return oper;
             }
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "EQUAL") != 0) {
+            if (prs->tok->keyword != KW_EQUAL) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'EQUAL' following 'OR'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -726,7 +823,7 @@ AST *parse_oper(Parser *prs) {
 
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "TO") != 0) {
+            if (prs->tok->keyword != KW_TO) {
                 log_error(prs->file, prs->tok->ln, prs->tok->col);
                 fprintf(stderr, "expected identifier 'TO' following 'EQUAL'\n");
                 show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -735,10 +832,10 @@ AST *parse_oper(Parser *prs) {
                 eat(prs, TOK_ID);
             }
         }
-    } else if (strcmp(prs->tok->value, "NOT") == 0) {
+    } else if (prs->tok->keyword == KW_NOT) {
         eat(prs, TOK_ID);
 
-        if (strcmp(prs->tok->value, "EQUAL") != 0) {
+        if (prs->tok->keyword != KW_EQUAL) {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "expected identifier 'EQUAL' following 'NOT'\n");
             show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -747,7 +844,7 @@ AST *parse_oper(Parser *prs) {
 
         eat(prs, TOK_ID);
 
-        if (strcmp(prs->tok->value, "TO") != 0) {
+        if (prs->tok->keyword != KW_TO) {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "expected identifier 'TO' following 'EQUAL'\n");
             show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -755,10 +852,10 @@ AST *parse_oper(Parser *prs) {
             eat(prs, TOK_ID);
             oper->oper = TOK_NEQ;
         }
-    } else if (strcmp(prs->tok->value, "AND") == 0) {
+    } else if (prs->tok->keyword == KW_AND) {
         oper->oper = TOK_AND;
         eat(prs, TOK_ID);
-    } else if (strcmp(prs->tok->value, "OR") == 0) {
+    } else if (prs->tok->keyword == KW_OR) {
         oper->oper = TOK_OR;
         eat(prs, TOK_ID);
     } else {
@@ -781,9 +878,9 @@ AST *parse_condition(Parser *prs, AST *first) {
         astlist_push(&ast->condition, parse_oper(prs));
         astlist_push(&ast->condition, parse_value(prs, TYPE_ANY));
 
-        if (strcmp(prs->tok->value, "AND") == 0 || strcmp(prs->tok->value, "OR") == 0) {
+        if (prs->tok->keyword == KW_AND || prs->tok->keyword == KW_OR) {
             AST *oper = create_ast(AST_OPER, prs->tok->ln, prs->tok->col);
-            oper->oper = strcmp(prs->tok->value, "AND") == 0 ? TOK_AND : TOK_OR;
+            oper->oper = prs->tok->keyword == KW_AND ? TOK_AND : TOK_OR;
             eat(prs, TOK_ID);
             astlist_push(&ast->condition, oper);
             astlist_push(&ast->condition, parse_value(prs, TYPE_ANY));
@@ -805,15 +902,20 @@ AST *parse_compute(Parser *prs) {
         fprintf(stderr, "compute value isn't a storage value\n");
         show_error(dst->file, dst->ln, dst->col);
 
-        delete_ast(dst);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
 
+    const bool rounded = prs->tok->keyword == KW_ROUNDED;
+
+    if (rounded)
+        eat(prs, TOK_ID);
+
     eat(prs, TOK_EQUAL);
 
     AST *ast = create_ast(AST_COMPUTE, ln, col);
     ast->compute.dst = dst;
+    ast->compute.rounded = rounded;
     ast->compute.math = parse_math(prs, NULL, dst->var.sym->type.type);
     return ast;
 }
@@ -822,7 +924,6 @@ AST *parse_compute(Parser *prs) {
 bool validate_stmt(AST *stmt) {
     switch (stmt->type) {
         case AST_NOP:
-            delete_ast(stmt);
             return false;
         case AST_STOP:
         case AST_STOP_RUN:
@@ -839,6 +940,8 @@ bool validate_stmt(AST *stmt) {
         case AST_PERFORM_COUNT:
         case AST_PERFORM_VARYING:
         case AST_PERFORM_UNTIL:
+        case AST_PERFORM_THRU:
+        case AST_GOTO:
         case AST_CALL:
         case AST_STRING_BUILDER:
         case AST_STRING_SPLITTER:
@@ -847,6 +950,12 @@ bool validate_stmt(AST *stmt) {
         case AST_SELECT:
         case AST_READ:
         case AST_WRITE:
+        case AST_REWRITE:
+        case AST_START:
+        case AST_DELETE:
+        case AST_SORT:
+        case AST_RELEASE:
+        case AST_RETURN:
         case AST_INSPECT:
         case AST_ACCEPT:
         case AST_EXIT:
@@ -870,15 +979,13 @@ AST *parse_if(Parser *prs) {
 
     AST *condition = parse_condition(prs, NULL);
 
-    if (!expect_identifier(prs, "THEN")) {
-        delete_ast(condition);
+    if (!expect_identifier(prs, "THEN"))
         return NOP(ln, col);
-    }
 
     eat(prs, TOK_ID);
     ASTList body = create_astlist();
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-IF") != 0 && strcmp(prs->tok->value, "ELSE") != 0) {
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_IF && prs->tok->keyword != KW_ELSE) {
         AST *stmt = parse_procedure_stmt(prs, &body);
 
         if (validate_stmt(stmt))
@@ -890,15 +997,15 @@ AST *parse_if(Parser *prs) {
     ast->if_stmt.body = body;
     ast->if_stmt.else_body = create_astlist();
 
-    if (strcmp(prs->tok->value, "END-IF") == 0) {
+    if (prs->tok->keyword == KW_END_IF) {
         eat(prs, TOK_ID);
         return ast;
-    } else if (strcmp(prs->tok->value, "ELSE") != 0)
+    } else if (prs->tok->keyword != KW_ELSE)
         return ast;
 
     eat(prs, TOK_ID);
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-IF") != 0) {
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_IF) {
         AST *stmt = parse_procedure_stmt(prs, &ast->if_stmt.else_body);
 
         if (validate_stmt(stmt))
@@ -918,13 +1025,25 @@ AST *parse_not(Parser *prs) {
     return ast;
 }
 
-/*
-AST *parse_goto(Parser *prs, size_t ln, size_t col) {
-    if (!assert_in_division(prs, DIV_PROCEDURE, ln, col))
-        return NOP(ln, col);
+// Takes the paragraph name at the current token as a label.
+AST *parse_jump_target(Parser *prs) {
+    AST *label = create_ast(AST_LABEL, prs->tok->ln, prs->tok->col);
+    label->label = prs->tok->value;
+    eat(prs, TOK_ID);
+
+    astlist_push(&jump_targets, label);
+    return label;
+}
+
+AST *parse_goto(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    eat(prs, TOK_ID);
 
-    if (!expect_identifier(prs, "TO"))
+    if (!expect_identifier(prs, "TO")) {
+        eat_until(prs, TOK_DOT);
         return NOP(ln, col);
+    }
 
     eat(prs, TOK_ID);
 
@@ -937,18 +1056,11 @@ AST *parse_goto(Parser *prs, size_t ln, size_t col) {
         return NOP(ln, col);
     }
 
-    // We don't want to check if this label exists yet, as we want to
-    // be able to jump forwards before a label is defined.
-    // We make sure all labels are checked and resolved after compilation
-    // in resolve_labels().
-
-    AST  *ast = create_ast(AST_GOTO, ln, col);
-    ast->go = create_ast(AST_LABEL, prs->tok->ln, prs->tok->col);
-    ast->go->label = mystrdup(prs->tok->value);
-    eat(prs, TOK_ID);
+    // The label may be declared further down, resolve_jump_targets() checks it.
+    AST *ast = create_ast(AST_GOTO, ln, col);
+    ast->go = parse_jump_target(prs);
     return ast;
 }
-*/
 
 AST *parse_perform_varying(Parser *prs, size_t ln, size_t col) {
     eat(prs, TOK_ID);
@@ -983,11 +1095,10 @@ AST *parse_perform_varying(Parser *prs, size_t ln, size_t col) {
         return NOP(ln, col);
     }
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
     eat(prs, TOK_ID);
 
     if (!expect_identifier(prs, "FROM")) {
-        free(name);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
@@ -996,8 +1107,6 @@ AST *parse_perform_varying(Parser *prs, size_t ln, size_t col) {
     AST *from = parse_value(prs, TYPE_ANY);
 
     if (!expect_identifier(prs, "BY")) {
-        free(name);
-        delete_ast(from);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
@@ -1006,9 +1115,6 @@ AST *parse_perform_varying(Parser *prs, size_t ln, size_t col) {
     AST *by = parse_value(prs, TYPE_ANY);
 
     if (!expect_identifier(prs, "UNTIL")) {
-        free(name);
-        delete_ast(from);
-        delete_ast(by);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
@@ -1026,7 +1132,7 @@ AST *parse_perform_varying(Parser *prs, size_t ln, size_t col) {
     ast->perform_varying.until = parse_condition(prs, NULL);
     ast->perform_varying.body = create_astlist();
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-PERFORM") != 0) {
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_PERFORM) {
         AST *stmt = parse_procedure_stmt(prs, &ast->perform_varying.body);
 
         if (validate_stmt(stmt))
@@ -1048,7 +1154,7 @@ AST *parse_perform_until(Parser *prs, size_t ln, size_t col) {
     ast->perform_until.until = parse_condition(prs, NULL);
     ast->perform_until.body = create_astlist();
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-PERFORM") != 0) {
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_PERFORM) {
         AST *stmt = parse_procedure_stmt(prs, &ast->perform_until.body);
 
         if (validate_stmt(stmt))
@@ -1064,14 +1170,42 @@ AST *parse_perform_until(Parser *prs, size_t ln, size_t col) {
     return ast;
 }
 
+// A paragraph to PERFORM, or a range of them with THRU.
+static AST *parse_perform_target(Parser *prs, size_t ln, size_t col) {
+    // Counted before the paragraph may even be declared, add_variable() keeps it.
+    find_variable(prs->file, prs->tok->value)->performs++;
+
+    AST *perf;
+
+    if (peek(prs, 1)->keyword == KW_THRU || peek(prs, 1)->keyword == KW_THROUGH) {
+        perf = create_ast(AST_PERFORM_THRU, ln, col);
+        perf->perform_thru.first = parse_jump_target(prs);
+        eat(prs, TOK_ID);
+
+        if (!expect_identifier(prs, NULL)) {
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        perf->perform_thru.last = parse_jump_target(prs);
+    } else {
+        perf = create_ast(AST_PERFORM, ln, col);
+        perf->perform = create_ast(AST_LABEL, prs->tok->ln, prs->tok->col);
+        perf->perform->label = prs->tok->value;
+        eat(prs, TOK_ID);
+    }
+
+    return perf;
+}
+
 AST *parse_perform(Parser *prs) {
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
     eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "VARYING") == 0)
+    if (prs->tok->keyword == KW_VARYING)
         return parse_perform_varying(prs, ln, col);
-    else if (strcmp(prs->tok->value, "UNTIL") == 0)
+    else if (prs->tok->keyword == KW_UNTIL)
         return parse_perform_until(prs, ln, col);
     else if (!expect_identifier(prs, NULL)) {
         log_error(prs->file, ln, col);
@@ -1082,56 +1216,47 @@ AST *parse_perform(Parser *prs) {
         return NOP(ln, col);
     }
 
-    AST *ast;
-
-    if (strcmp(peek(prs, 2)->value, "TIMES") == 0 ||
-            strcmp(peek(prs, 1)->value, "UNTIL") == 0) {
-        AST *perf = create_ast(AST_PERFORM, ln, col);
-        perf->perform = create_ast(AST_LABEL, ln, col);
-        perf->perform->label = mystrdup(prs->tok->value);
-        eat(prs, TOK_ID);
+    AST *perf = parse_perform_target(prs, ln, col);
 
-        if (strcmp(prs->tok->value, "UNTIL") == 0) {
-            eat(prs, TOK_ID);
-            ast = create_ast(AST_PERFORM_CONDITION, ln, col);
-            ast->perform_condition.proc =  perf;
-            ast->perform_condition.condition = parse_condition(prs, NULL);
-            return ast;
-        }
+    if (perf->type == AST_NOP)
+        return perf;
 
-        ast = create_ast(AST_PERFORM_COUNT, ln, col);
-        ast->perform_count.proc =  perf;
+    AST *ast;
 
-        if (prs->tok->type != TOK_INT) {
-            log_error(prs->file, prs->tok->ln, prs->tok->col);
-            fprintf(stderr, "expected integer constant TIMES count but found '%s'\n", tokentype_to_string(prs->tok->type));
-            show_error(prs->file, prs->tok->ln, prs->tok->col);
-            ast->perform_count.times = 0;
-        } else {
-            // parse_value() will also handle conversion errors.
-            AST *count = parse_value(prs, TYPE_UNSIGNED_NUMERIC);
-            ast->perform_count.times = (unsigned int)count->constant.i32;
-            delete_ast(count);
-        }
+    if (prs->tok->keyword == KW_UNTIL) {
+        eat(prs, TOK_ID);
+        ast = create_ast(AST_PERFORM_CONDITION, ln, col);
+        ast->perform_condition.proc = perf;
+        ast->perform_condition.condition = parse_condition(prs, NULL);
+        return ast;
+    } else if (peek(prs, 1)->keyword != KW_TIMES)
+        return perf;
 
-        if (expect_identifier(prs, "TIMES"))
-            eat(prs, TOK_ID);
+    ast = create_ast(AST_PERFORM_COUNT, ln, col);
+    ast->perform_count.proc = perf;
 
-        return ast;
+    if (prs->tok->type != TOK_INT) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "expected integer constant TIMES count but found '%s'\n", tokentype_to_string(prs->tok->type));
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+        ast->perform_count.times = 0;
+    } else {
+        // parse_value() will also handle conversion errors.
+        AST *count = parse_value(prs, TYPE_UNSIGNED_NUMERIC);
+        ast->perform_count.times = (unsigned int)count->constant.i32;
     }
 
-    ast = create_ast(AST_PERFORM, ln, col);
-    ast->perform = create_ast(AST_LABEL, prs->tok->ln, prs->tok->col);
-    ast->perform->label = mystrdup(prs->tok->value);
-    eat(prs, TOK_ID);
+    if (expect_identifier(prs, "TIMES"))
+        eat(prs, TOK_ID);
+
     return ast;
 
     /*
 
     ASTList body = create_astlist();
 
-    //while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-PERFORM") != 0 && strcmp(prs->tok->value, "UNTIL") != 0 &&
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "UNTIL") != 0) {
+    //while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_PERFORM && prs->tok->keyword != KW_UNTIL &&
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_UNTIL) {
         AST *stmt = parse_stmt(prs);
 
         if (validate_stmt(stmt))
@@ -1151,7 +1276,7 @@ AST *parse_procedure(Parser *prs) {
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
     eat(prs, TOK_ID);
 
     Variable *var = add_variable(prs->file, name, (PictureType){ .type = TYPE_ANY, .count = 0 }, 0);
@@ -1159,11 +1284,12 @@ AST *parse_procedure(Parser *prs) {
 
     AST *ast = create_ast(AST_PROC, ln, col);
     ast->proc.name = name;
+    ast->proc.sym = var;
     ast->proc.body = create_astlist();
 
     while (prs->tok->type != TOK_EOF) {
         // New procedure or end of program.
-        if (prs->tok->type == TOK_ID && (peek(prs, 1)->type == TOK_DOT || strcmp(prs->tok->value, "END") == 0))
+        if (prs->tok->type == TOK_ID && (peek(prs, 1)->type == TOK_DOT || prs->tok->keyword == KW_END))
             break;
 
         // So we can check for DISPLAY.
@@ -1172,7 +1298,7 @@ AST *parse_procedure(Parser *prs) {
 
         AST *stmt;
         
-        if (strcmp(prs->tok->value, "DISPLAY") == 0) {
+        if (prs->tok->keyword == KW_DISPLAY) {
             first_display = true;
 
             // DISPLAY can push arguments to the root, so we need to
@@ -1374,7 +1500,7 @@ AST *parse_set(Parser *prs) {
         return NOP(ln, col);
     }
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
     eat(prs, TOK_ID);
     */
 
@@ -1382,12 +1508,11 @@ AST *parse_set(Parser *prs) {
 
     AST *dst = parse_value(prs, TYPE_ANY);
 
-    if (strcmp(prs->tok->value, "UP") == 0 || strcmp(prs->tok->value, "DOWN") == 0) {
-        TokenType math = strcmp(prs->tok->value, "UP") == 0 ? TOK_PLUS : TOK_MINUS;
+    if (prs->tok->keyword == KW_UP || prs->tok->keyword == KW_DOWN) {
+        TokenType math = prs->tok->keyword == KW_UP ? TOK_PLUS : TOK_MINUS;
         eat(prs, TOK_ID);
 
         if (!expect_identifier(prs, "BY")) {
-            delete_ast(dst);
             eat_until(prs, TOK_DOT);
             return NOP(ln, col);
         }
@@ -1395,8 +1520,7 @@ AST *parse_set(Parser *prs) {
         eat(prs, TOK_ID);
 
         AST *ast = create_ast(AST_ARITHMETIC, ln, col);
-        ast->arithmetic.name = mystrdup(math == TOK_PLUS ? "ADD" : "SUBTRACT");
-        ast->arithmetic.cloned_left = ast->arithmetic.cloned_right = false;
+        ast->arithmetic.name = math == TOK_PLUS ? "ADD" : "SUBTRACT";
         ast->arithmetic.dst = dst;
         ast->arithmetic.implicit_giving = true;
         ast->arithmetic.left = parse_value(prs, TYPE_ANY);
@@ -1405,7 +1529,6 @@ AST *parse_set(Parser *prs) {
     }
 
     if (!expect_identifier(prs, "TO")) {
-        delete_ast(dst);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
@@ -1450,11 +1573,11 @@ AST *parse_call(Parser *prs) {
     }
 
     AST *ast = create_ast(AST_CALL, ln, col);
-    ast->call.name = mystrdup(prs->tok->value);
+    ast->call.name = prs->tok->value;
     eat(prs, TOK_STRING);
     ast->call.args = create_astlist();
 
-    if (strcmp(prs->tok->value, "USING") == 0) {
+    if (prs->tok->keyword == KW_USING) {
         eat(prs, TOK_ID);
         astlist_push(&ast->call.args, parse_value(prs, TYPE_ANY));
 
@@ -1464,7 +1587,7 @@ AST *parse_call(Parser *prs) {
         }
     }
 
-    if (strcmp(prs->tok->value, "RETURNING") == 0) {
+    if (prs->tok->keyword == KW_RETURNING) {
         eat(prs, TOK_ID);
         ast->call.returning = parse_value(prs, TYPE_ANY);
     } else
@@ -1494,9 +1617,9 @@ StringStatement parse_string_stmt(Parser *prs) {
 
     eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "SPACE") == 0)
+    if (prs->tok->keyword == KW_SPACE)
         stmt.delimit = DELIM_SPACE;
-    else if (strcmp(prs->tok->value, "SIZE") == 0)
+    else if (prs->tok->keyword == KW_SIZE)
         stmt.delimit = DELIM_SIZE;
     else {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -1518,7 +1641,7 @@ AST *parse_unstring(Parser *prs) {
     ast->string_splitter.base = parse_string_stmt(prs);
     ast->string_splitter.into_vars = create_astlist();
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-UNSTRING") != 0 && strcmp(prs->tok->value, "INTO") != 0)
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_UNSTRING && prs->tok->keyword != KW_INTO)
         astlist_push(&ast->string_splitter.into_vars, parse_value(prs, TYPE_ANY));
 
     if (!expect_identifier(prs, "INTO")) {
@@ -1528,7 +1651,7 @@ AST *parse_unstring(Parser *prs) {
 
     eat(prs, TOK_ID);
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "END-UNSTRING") != 0)
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_END_UNSTRING)
         astlist_push(&ast->string_splitter.into_vars, parse_value(prs, TYPE_ANY));
 
     if (expect_identifier(prs, "END-UNSTRING"))
@@ -1550,16 +1673,17 @@ AST *parse_string_builder(Parser *prs) {
 
     AST *ast = create_ast(AST_STRING_BUILDER, ln, col);
     ast->string_builder.base = parse_string_stmt(prs);
-    ast->string_builder.stmts = malloc(4 * sizeof(StringStatement));
+    ast->string_builder.stmts = arena_alloc(cur_arena, 4 * sizeof(StringStatement));
     ast->string_builder.stmt_count = 0;
     ast->string_builder.stmt_cap = 4;
 
-    while (prs->tok->type != TOK_EOF && strcmp(prs->tok->value, "INTO") != 0 && strcmp(prs->tok->value, "END-STRING") != 0) {
+    while (prs->tok->type != TOK_EOF && prs->tok->keyword != KW_INTO && prs->tok->keyword != KW_END_STRING) {
         StringStatement stmt = parse_string_stmt(prs);
 
         if (ast->string_builder.stmt_count + 1 >= ast->string_builder.stmt_cap) {
+            ast->string_builder.stmts = arena_realloc(cur_arena, ast->string_builder.stmts, ast->string_builder.stmt_cap * sizeof(StringStatement),
+                    ast->string_builder.stmt_cap * 2 * sizeof(StringStatement));
             ast->string_builder.stmt_cap *= 2;
-            ast->string_builder.stmts = realloc(ast->string_builder.stmts, ast->string_builder.stmt_cap * sizeof(StringStatement));
         }
 
         ast->string_builder.stmts[ast->string_builder.stmt_count++] = stmt;
@@ -1570,7 +1694,7 @@ AST *parse_string_builder(Parser *prs) {
         ast->string_builder.into_var = parse_value(prs, TYPE_ANY);
     }
 
-    if (strcmp(prs->tok->value, "WITH") == 0 && strcmp(peek(prs, 1)->value, "POINTER") == 0) {
+    if (prs->tok->keyword == KW_WITH && peek(prs, 1)->keyword == KW_POINTER) {
         eat(prs, TOK_ID);
         eat(prs, TOK_ID);
 
@@ -1602,13 +1726,13 @@ AST *parse_open(Parser *prs) {
 
     unsigned int open_type = 0;
 
-    if (strcmp(prs->tok->value, "INPUT") == 0)
+    if (prs->tok->keyword == KW_INPUT)
         open_type = OPEN_INPUT;
-    else if (strcmp(prs->tok->value, "OUTPUT") == 0)
+    else if (prs->tok->keyword == KW_OUTPUT)
         open_type = OPEN_OUTPUT;
-    else if (strcmp(prs->tok->value, "I-O") == 0)
+    else if (prs->tok->keyword == KW_I_O)
         open_type = OPEN_IO;
-    else if (strcmp(prs->tok->value, "EXTEND") == 0)
+    else if (prs->tok->keyword == KW_EXTEND)
         open_type = OPEN_EXTEND;
     else {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -1640,6 +1764,13 @@ AST *parse_open(Parser *prs) {
         fprintf(stderr, "file '%s' is not a file descriptor\n", prs->tok->value);
         show_error(prs->file, prs->tok->ln, prs->tok->col);
 
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    } else if (var->organization == ORG_SORT) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "sort file '%s' is opened and closed by SORT\n", prs->tok->value);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
@@ -1647,7 +1778,7 @@ AST *parse_open(Parser *prs) {
     AST *ast = create_ast(AST_OPEN, ln, col);
     ast->open.type = open_type;
     ast->open.filename = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-    ast->open.filename->var.name = mystrdup(prs->tok->value);
+    ast->open.filename->var.name = prs->tok->value;
     ast->open.filename->var.sym = var;
     eat(prs, TOK_ID);
     return ast;
@@ -1677,23 +1808,60 @@ AST *parse_close(Parser *prs) {
         fprintf(stderr, "file '%s' is not a file descriptor\n", prs->tok->value);
         show_error(prs->file, prs->tok->ln, prs->tok->col);
 
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    } else if (var->organization == ORG_SORT) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "sort file '%s' is opened and closed by SORT\n", prs->tok->value);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
 
     AST *ast = create_ast(AST_CLOSE, ln, col);
     ast->close_filename = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-    ast->close_filename->var.name = mystrdup(prs->tok->value);
+    ast->close_filename->var.name = prs->tok->value;
     ast->close_filename->var.sym = var;
     eat(prs, TOK_ID);
     return ast;
 }
 
-AST *parse_read(Parser *prs) {
-    const size_t ln = prs->tok->ln;
-    const size_t col = prs->tok->col;
+// A condition phrase like AT END or INVALID KEY and the statement after it,
+// then the same phrase after NOT.
+void parse_outcomes(Parser *prs, Keyword first, char *second, ASTList *failed, ASTList *succeeded) {
+    if (prs->tok->keyword == first) {
+        eat(prs, TOK_ID);
+
+        if (!expect_identifier(prs, second)) {
+            eat_until(prs, TOK_DOT);
+            return;
+        }
+
+        eat(prs, TOK_ID);
+
+        // Make this an ASTList instead of a single AST because some statements
+        // can return multiple AST nodes.
+        astlist_push(failed, parse_procedure_stmt(prs, failed));
+    }
+
+    if (prs->tok->keyword != KW_NOT || peek(prs, 1)->keyword != first)
+        return;
+
+    eat(prs, TOK_ID);
+    eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, second)) {
+        eat_until(prs, TOK_DOT);
+        return;
+    }
+
     eat(prs, TOK_ID);
+    astlist_push(succeeded, parse_procedure_stmt(prs, succeeded));
+}
 
+// The file a file statement names, NULL once an error was reported.
+Variable *parse_file_name(Parser *prs) {
     Variable *var = find_variable(prs->file, prs->tok->value);
 
     if (!var->used) {
@@ -1702,120 +1870,546 @@ AST *parse_read(Parser *prs) {
         show_error(prs->file, prs->tok->ln, prs->tok->col);
 
         eat_until(prs, TOK_DOT);
-        return NOP(ln, col);
+        return NULL;
     } else if (!var->is_fd) {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
         fprintf(stderr, "file '%s' is not a file descriptor\n", prs->tok->value);
         show_error(prs->file, prs->tok->ln, prs->tok->col);
 
         eat_until(prs, TOK_DOT);
-        return NOP(ln, col);
+        return NULL;
     }
 
     eat(prs, TOK_ID);
+    return var;
+}
+
+// KEY IS can only name the record or relative key, a file has no other.
+bool parse_record_key(Parser *prs, Variable *fd) {
+    Variable *key = find_variable(prs->file, prs->tok->value);
+
+    if (!key->used || key != fd->record_key) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "'%s' is not the record key of '%s'\n", prs->tok->value, fd->name);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
 
-    if (!expect_identifier(prs, "INTO")) {
         eat_until(prs, TOK_DOT);
-        return NOP(ln, col);
+        return false;
     }
 
     eat(prs, TOK_ID);
+    return true;
+}
 
-    Variable *into = find_variable(prs->file, prs->tok->value);
+// READ, or RETURN which reads the next record of a sort file.
+AST *parse_read(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    const bool is_return = prs->tok->keyword == KW_RETURN;
+    eat(prs, TOK_ID);
 
-    if (!into->used) {
-        log_error(prs->file, prs->tok->ln, prs->tok->col);
-        fprintf(stderr, "undefined variable '%s'\n", prs->tok->value);
-        show_error(prs->file, prs->tok->ln, prs->tok->col);
+    Variable *var = parse_file_name(prs);
 
-        eat_until(prs, TOK_DOT);
+    if (var == NULL)
         return NOP(ln, col);
-    } else if ((into->type.type != TYPE_ALPHABETIC && into->type.type != TYPE_ALPHANUMERIC) ||
-            into->type.count == 0) {
+    else if (is_return != (var->organization == ORG_SORT) || (is_return && var->record == NULL)) {
+        log_error(prs->file, ln, col);
 
-        log_error(prs->file, prs->tok->ln, prs->tok->col);
-        fprintf(stderr, "reading into non-string variable '%s'\n", prs->tok->value);
-        show_error(prs->file, prs->tok->ln, prs->tok->col);
+        if (is_return)
+            fprintf(stderr, "RETURN takes a sort file with a record description\n");
+        else
+            fprintf(stderr, "READ on sort file '%s', RETURN gets its records\n", var->name);
 
+        show_error(prs->file, ln, col);
         eat_until(prs, TOK_DOT);
         return NOP(ln, col);
     }
 
-    eat(prs, TOK_ID);
-    
-    AST *ast = create_ast(AST_READ, ln, col);
+    bool next = false;
+
+    if (prs->tok->keyword == KW_NEXT) {
+        next = true;
+        eat(prs, TOK_ID);
+    }
+
+    if (prs->tok->keyword == KW_RECORD)
+        eat(prs, TOK_ID);
+
+    // Record files read into the FD's record, INTO is optional and copies it.
+    const bool has_record = var->organization != ORG_NONE && var->organization != ORG_LINE_SEQUENTIAL && var->record != NULL;
+    Variable *into = var->record;
+
+    if (!has_record || prs->tok->keyword == KW_INTO) {
+        if (!expect_identifier(prs, "INTO")) {
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        eat(prs, TOK_ID);
+        into = find_variable(prs->file, prs->tok->value);
+
+        if (!into->used) {
+            log_error(prs->file, prs->tok->ln, prs->tok->col);
+            fprintf(stderr, "undefined variable '%s'\n", prs->tok->value);
+            show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        } else if (!has_record && ((into->type.type != TYPE_ALPHABETIC && into->type.type != TYPE_ALPHANUMERIC) ||
+                into->type.count == 0)) {
+
+            log_error(prs->file, prs->tok->ln, prs->tok->col);
+            fprintf(stderr, "reading into non-string variable '%s'\n", prs->tok->value);
+            show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        eat(prs, TOK_ID);
+    }
+
+    if (var->organization == ORG_INDEXED && prs->tok->keyword == KW_KEY) {
+        eat(prs, TOK_ID);
+
+        if (prs->tok->keyword == KW_IS)
+            eat(prs, TOK_ID);
+
+        if (!parse_record_key(prs, var))
+            return NOP(ln, col);
+    }
+
+    AST *ast = create_ast(is_return ? AST_RETURN : AST_READ, ln, col);
     ast->read.fd = create_ast(AST_VAR, ln, col);
-    ast->read.fd->var.name = mystrdup(var->name);
+    ast->read.fd->var.name = var->name;
     ast->read.fd->var.sym = var;
     ast->read.into = create_ast(AST_VAR, ln, col);
-    ast->read.into->var.name = mystrdup(into->name);
+    ast->read.into->var.name = into->name;
     ast->read.into->var.sym = into;
+    ast->read.next = next || (var->organization != ORG_INDEXED && var->organization != ORG_RELATIVE) || var->access == ACCESS_SEQUENTIAL;
     ast->read.at_end_stmts = create_astlist();
     ast->read.not_at_end_stmts = create_astlist();
 
-    if (strcmp(prs->tok->value, "AT") != 0)
-        goto done_at;
-
-    eat(prs, TOK_ID);
+    // Reading on ends at the end of the file, reading by key fails on a missing key.
+    if (ast->read.next)
+        parse_outcomes(prs, KW_AT, "END", &ast->read.at_end_stmts, &ast->read.not_at_end_stmts);
+    else
+        parse_outcomes(prs, KW_INVALID, "KEY", &ast->read.at_end_stmts, &ast->read.not_at_end_stmts);
 
-    if (!expect_identifier(prs, "END")) {
-        eat_until(prs, TOK_DOT);
-        goto done_at;
-    }
+    return ast;
+}
 
+AST *parse_write(Parser *prs) {
+    AST *ast = create_ast(prs->tok->keyword == KW_REWRITE ? AST_REWRITE : AST_WRITE, prs->tok->ln, prs->tok->col);
     eat(prs, TOK_ID);
 
-    // Make this an ASTList instead of a single AST because some statements
-    // can return multiple AST nodes.
-    astlist_push(&ast->read.at_end_stmts, parse_procedure_stmt(prs, &ast->read.at_end_stmts));
-
-done_at:
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    ast->write.value = parse_value(prs, TYPE_ANY);
+    ast->write.invalid_key_stmts = create_astlist();
+    ast->write.not_invalid_key_stmts = create_astlist();
 
-    if (strcmp(prs->tok->value, "NOT") != 0)
-        return ast;
+    Variable *fd = ast->write.value->type == AST_VAR ? ast->write.value->var.sym->fd : NULL;
 
-    eat(prs, TOK_ID);
+    if (ast->type == AST_REWRITE && (fd == NULL || (fd->organization != ORG_INDEXED && fd->organization != ORG_RELATIVE))) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "REWRITE takes the record of an indexed or relative file\n");
+        show_error(prs->file, ln, col);
 
-    if (!expect_identifier(prs, "AT")) {
         eat_until(prs, TOK_DOT);
-        return ast;
+        return NOP(ln, col);
     }
 
-    eat(prs, TOK_ID);
+    if (fd != NULL && fd->organization == ORG_SORT) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "records of sort file '%s' go to SORT with RELEASE\n", fd->name);
+        show_error(prs->file, ln, col);
 
-    if (!expect_identifier(prs, "END")) {
         eat_until(prs, TOK_DOT);
-        return ast;
+        return NOP(ln, col);
     }
 
-    eat(prs, TOK_ID);
-    astlist_push(&ast->read.not_at_end_stmts, parse_procedure_stmt(prs, &ast->read.not_at_end_stmts));
+    parse_outcomes(prs, KW_INVALID, "KEY", &ast->write.invalid_key_stmts, &ast->write.not_invalid_key_stmts);
     return ast;
 }
 
-AST *parse_write(Parser *prs) {
-    AST *ast = create_ast(AST_WRITE, prs->tok->ln, prs->tok->col);
+// START positions the next READ NEXT, DELETE removes the record with the key.
+AST *parse_start_or_delete(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    const bool is_start = prs->tok->keyword == KW_START;
     eat(prs, TOK_ID);
-    ast->write.value = parse_value(prs, TYPE_ANY);
-    return ast;
-}
 
-#define NOPHASE (StringTallyPhase1){ .value = NOP(0, 0), .modifier = NULL }
-#define NOTALLY (StringTally){ .type = TALLY_ALL, .output_count = NOP(0, 0), .phase = NOPHASE }
+    Variable *var = parse_file_name(prs);
 
-StringTallyPhase1 parse_stringtally_phase1(Parser *prs) {
-    StringTallyPhase1 phase = (StringTallyPhase1){ .before = false, .after = false, .modifier = NULL, .value = parse_value(prs, TYPE_ANY) };
+    if (var == NULL)
+        return NOP(ln, col);
+    else if (var->organization != ORG_INDEXED && var->organization != ORG_RELATIVE) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "%s on file '%s' that isn't indexed or relative\n", is_start ? "START" : "DELETE", var->name);
+        show_error(prs->file, ln, col);
 
-    if (strcmp(prs->tok->value, "BEFORE") == 0) {
-        phase.before = true;
-        eat(prs, TOK_ID);
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    } else if (is_start && var->record_key == NULL) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "START on relative file '%s' without a RELATIVE KEY\n", var->name);
+        show_error(prs->file, ln, col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    AST *ast = create_ast(is_start ? AST_START : AST_DELETE, ln, col);
+    ast->keyed.fd = create_ast(AST_VAR, ln, col);
+    ast->keyed.fd->var.name = var->name;
+    ast->keyed.fd->var.sym = var;
+    ast->keyed.relation = TOK_EQUAL;
+    ast->keyed.invalid_key_stmts = create_astlist();
+    ast->keyed.not_invalid_key_stmts = create_astlist();
+
+    if (!is_start && prs->tok->keyword == KW_RECORD)
+        eat(prs, TOK_ID);
+
+    if (is_start && prs->tok->keyword == KW_KEY) {
+        eat(prs, TOK_ID);
+
+        // parse_oper only takes IS before a word like GREATER.
+        if (prs->tok->keyword == KW_IS && peek(prs, 1)->type != TOK_ID)
+            eat(prs, TOK_ID);
+
+        const size_t oper_ln = prs->tok->ln;
+        const size_t oper_col = prs->tok->col;
+        AST *oper = parse_oper(prs);
+        ast->keyed.relation = oper->oper == TOK_EQ ? TOK_EQUAL : oper->oper;
+
+        if (ast->keyed.relation != TOK_EQUAL && ast->keyed.relation != TOK_GT && ast->keyed.relation != TOK_GTE) {
+            log_error(prs->file, oper_ln, oper_col);
+            fprintf(stderr, "START only takes the relations =, > and >=\n");
+            show_error(prs->file, oper_ln, oper_col);
+
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        if (!parse_record_key(prs, var))
+            return NOP(ln, col);
+    }
+
+    parse_outcomes(prs, KW_INVALID, "KEY", &ast->keyed.invalid_key_stmts, &ast->keyed.not_invalid_key_stmts);
+    return ast;
+}
+
+// Keys are compared as C values or strings, which rules out packed items,
+// pointers, groups and tables.
+static bool is_sort_key_type(Variable *key) {
+    PictureType *type = &key->type;
+
+    return key->count == 0 && key->fields == NULL && !is_packed(type) && type->comp_type != COMP_POINTER &&
+        type->type != TYPE_POINTER && type->type != TYPE_ANY;
+}
+
+// A USING or GIVING file of SORT, its records go through its record description.
+static Variable *parse_sort_file(Parser *prs, bool giving) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    Variable *file = parse_file_name(prs);
+
+    if (file == NULL)
+        return NULL;
+
+    PictureType *type = file->record != NULL ? &file->record->type : NULL;
+    const bool lines = file->organization == ORG_NONE || file->organization == ORG_LINE_SEQUENTIAL;
+    char *problem = NULL;
+
+    if (file->organization == ORG_SORT)
+        problem = "is a sort file";
+    else if (type == NULL)
+        problem = "has no record description";
+    else if (lines && ((type->type != TYPE_ALPHABETIC && type->type != TYPE_ALPHANUMERIC) || type->count == 0))
+        problem = "is line sequential but its record isn't PIC X";
+    else if (giving && file->organization == ORG_RELATIVE && file->access != ACCESS_SEQUENTIAL)
+        problem = "is relative but doesn't have sequential access";
+
+    if (problem != NULL) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "can't sort %s file '%s', it %s\n", giving ? "into" : "from", file->name, problem);
+        show_error(prs->file, ln, col);
+
+        eat_until(prs, TOK_DOT);
+        return NULL;
+    }
+
+    return file;
+}
+
+// INPUT PROCEDURE or OUTPUT PROCEDURE, the paragraphs SORT performs.
+static AST *parse_sort_procedure(Parser *prs, size_t ln, size_t col) {
+    eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, "PROCEDURE")) {
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    eat(prs, TOK_ID);
+
+    if (prs->tok->keyword == KW_IS)
+        eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, NULL)) {
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    return parse_perform_target(prs, ln, col);
+}
+
+// SORT sd ON ASCENDING/DESCENDING KEY keys, then USING files or an INPUT
+// PROCEDURE and GIVING a file or an OUTPUT PROCEDURE.
+AST *parse_sort(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, NULL)) {
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    Variable *sd = parse_file_name(prs);
+
+    if (sd == NULL)
+        return NOP(ln, col);
+    else if (sd->organization != ORG_SORT || sd->record == NULL) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "SORT takes a sort file with a record description\n");
+        show_error(prs->file, ln, col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    AST *ast = create_ast(AST_SORT, ln, col);
+    ast->sort.fd = create_ast(AST_VAR, ln, col);
+    ast->sort.fd->var.name = sd->name;
+    ast->sort.fd->var.sym = sd;
+    ast->sort.keys = arena_alloc(cur_arena, 4 * sizeof(SortKey));
+    ast->sort.key_count = 0;
+    ast->sort.key_capacity = 4;
+    ast->sort.using_files = create_astlist();
+    ast->sort.input_procedure = ast->sort.giving_file = ast->sort.output_procedure = NULL;
+
+    // ON and KEY are optional, the keys run until the next keyword.
+    while (prs->tok->keyword == KW_ON || prs->tok->keyword == KW_ASCENDING || prs->tok->keyword == KW_DESCENDING) {
+        if (prs->tok->keyword == KW_ON)
+            eat(prs, TOK_ID);
+
+        if (prs->tok->keyword != KW_ASCENDING && prs->tok->keyword != KW_DESCENDING) {
+            log_error(prs->file, prs->tok->ln, prs->tok->col);
+            fprintf(stderr, "found '%s' when expecting ASCENDING or DESCENDING\n", prs->tok->value);
+            show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        const bool descending = prs->tok->keyword == KW_DESCENDING;
+        eat(prs, TOK_ID);
+
+        if (prs->tok->keyword == KW_KEY)
+            eat(prs, TOK_ID);
+
+        if (prs->tok->keyword == KW_IS)
+            eat(prs, TOK_ID);
+
+        do {
+            if (!expect_identifier(prs, NULL)) {
+                eat_until(prs, TOK_DOT);
+                return NOP(ln, col);
+            }
+
+            Variable *key = find_variable(prs->file, prs->tok->value);
+
+            if (!key->used || (key != sd->record && key->struct_sym != sd->record) || !is_sort_key_type(key)) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "sort key '%s' must be an elementary item of the record of '%s'\n", prs->tok->value, sd->name);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+                eat_until(prs, TOK_DOT);
+                return NOP(ln, col);
+            }
+
+            if (ast->sort.key_count == ast->sort.key_capacity) {
+                ast->sort.keys = arena_realloc(cur_arena, ast->sort.keys, ast->sort.key_capacity * sizeof(SortKey),
+                        ast->sort.key_capacity * 2 * sizeof(SortKey));
+                ast->sort.key_capacity *= 2;
+            }
+
+            ast->sort.keys[ast->sort.key_count++] = (SortKey){ .key = key, .descending = descending };
+            eat(prs, TOK_ID);
+        } while (prs->tok->type == TOK_ID && prs->tok->keyword == KW_NONE);
+    }
+
+    if (ast->sort.key_count == 0) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "SORT needs an ASCENDING or DESCENDING KEY\n");
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    // Records with equal keys always come out in the order they went in.
+    if (prs->tok->keyword == KW_WITH)
+        eat(prs, TOK_ID);
+
+    if (prs->tok->keyword == KW_DUPLICATES) {
+        eat(prs, TOK_ID);
+
+        if (prs->tok->keyword == KW_IN)
+            eat(prs, TOK_ID);
+
+        if (prs->tok->keyword == KW_ORDER)
+            eat(prs, TOK_ID);
+    }
+
+    if (prs->tok->keyword == KW_USING) {
+        eat(prs, TOK_ID);
+
+        do {
+            Variable *file = parse_sort_file(prs, false);
+
+            if (file == NULL)
+                return NOP(ln, col);
+
+            AST *var = create_ast(AST_VAR, ln, col);
+            var->var.name = file->name;
+            var->var.sym = file;
+            astlist_push(&ast->sort.using_files, var);
+        } while (prs->tok->type == TOK_ID && prs->tok->keyword == KW_NONE);
+    } else if (prs->tok->keyword == KW_INPUT) {
+        ast->sort.input_procedure = parse_sort_procedure(prs, ln, col);
+
+        if (ast->sort.input_procedure->type == AST_NOP)
+            return NOP(ln, col);
+    } else {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "found '%s' when expecting USING or INPUT PROCEDURE\n", prs->tok->value);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    if (prs->tok->keyword == KW_GIVING) {
+        eat(prs, TOK_ID);
+
+        if (!expect_identifier(prs, NULL)) {
+            eat_until(prs, TOK_DOT);
+            return NOP(ln, col);
+        }
+
+        Variable *file = parse_sort_file(prs, true);
+
+        if (file == NULL)
+            return NOP(ln, col);
+
+        ast->sort.giving_file = create_ast(AST_VAR, ln, col);
+        ast->sort.giving_file->var.name = file->name;
+        ast->sort.giving_file->var.sym = file;
+    } else if (prs->tok->keyword == KW_OUTPUT) {
+        ast->sort.output_procedure = parse_sort_procedure(prs, ln, col);
+
+        if (ast->sort.output_procedure->type == AST_NOP)
+            return NOP(ln, col);
+    } else {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "found '%s' when expecting GIVING or OUTPUT PROCEDURE\n", prs->tok->value);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    return ast;
+}
+
+// RELEASE hands the record of a sort file, or the FROM item, to the running SORT.
+AST *parse_release(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+    eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, NULL)) {
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    Variable *record = find_variable(prs->file, prs->tok->value);
+
+    if (!record->used || record->fd == NULL || record->fd->organization != ORG_SORT) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "RELEASE takes the record of a sort file\n");
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    eat(prs, TOK_ID);
+
+    AST *ast = create_ast(AST_RELEASE, ln, col);
+    ast->release.fd = create_ast(AST_VAR, ln, col);
+    ast->release.fd->var.name = record->fd->name;
+    ast->release.fd->var.sym = record->fd;
+    ast->release.from = create_ast(AST_VAR, ln, col);
+    ast->release.from->var.name = record->name;
+    ast->release.from->var.sym = record;
+
+    if (prs->tok->keyword != KW_FROM)
+        return ast;
+
+    eat(prs, TOK_ID);
+
+    if (!expect_identifier(prs, NULL)) {
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    Variable *from = find_variable(prs->file, prs->tok->value);
+
+    if (!from->used || from->count > 0 || from->struct_sym != NULL) {
+        log_error(prs->file, prs->tok->ln, prs->tok->col);
+        fprintf(stderr, "RELEASE FROM takes a level 01 item, found '%s'\n", prs->tok->value);
+        show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+        eat_until(prs, TOK_DOT);
+        return NOP(ln, col);
+    }
+
+    ast->release.from->var.name = from->name;
+    ast->release.from->var.sym = from;
+    eat(prs, TOK_ID);
+    return ast;
+}
+
+#define NOPHASE (StringTallyPhase1){ .value = NOP(0, 0), .modifier = NULL }
+#define NOTALLY (StringTally){ .type = TALLY_ALL, .output_count = NOP(0, 0), .phase = NOPHASE }
+
+StringTallyPhase1 parse_stringtally_phase1(Parser *prs) {
+    StringTallyPhase1 phase = (StringTallyPhase1){ .before = false, .after = false, .modifier = NULL, .value = parse_value(prs, TYPE_ANY) };
+
+    if (prs->tok->keyword == KW_BEFORE) {
+        phase.before = true;
+        eat(prs, TOK_ID);
 
         if (expect_identifier(prs, "INITIAL")) {
             eat(prs, TOK_ID);
             phase.modifier = parse_value(prs, TYPE_ANY);
         } else
             eat_until(prs, TOK_DOT);
-    } else if (strcmp(prs->tok->value, "AFTER") == 0) {
+    } else if (prs->tok->keyword == KW_AFTER) {
         phase.after = true;
         eat(prs, TOK_ID);
 
@@ -1861,15 +2455,15 @@ StringTally parse_stringtally(Parser *prs) {
     eat(prs, TOK_ID);
 
     AST *var = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-    var->var.name = mystrdup(output->name);
+    var->var.name = output->name;
     var->var.sym = output;
 
     StringTally tally;
 
-    if (strcmp(prs->tok->value, "CHARACTERS") == 0) {
+    if (prs->tok->keyword == KW_CHARACTERS) {
         eat(prs, TOK_ID);
         return (StringTally){ .type = TALLY_CHARACTERS, .output_count = var, .phase = NOPHASE };
-    } else if (strcmp(prs->tok->value, "ALL") == 0)
+    } else if (prs->tok->keyword == KW_ALL)
         tally.type = TALLY_ALL;
     else {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -1894,9 +2488,9 @@ StringReplace parse_stringreplace(Parser *prs) {
     replace.modifier = NULL;
     replace.before = replace.after = false;
 
-    if (strcmp(prs->tok->value, "ALL") == 0)
+    if (prs->tok->keyword == KW_ALL)
         replace.type = REPLACING_ALL;
-    else if (strcmp(prs->tok->value, "FIRST") == 0)
+    else if (prs->tok->keyword == KW_FIRST)
         replace.type = REPLACING_FIRST;
     else {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -1912,7 +2506,6 @@ StringReplace parse_stringreplace(Parser *prs) {
     replace.old = parse_value(prs, TYPE_ANY);
 
     if (!expect_identifier(prs, "BY")) {
-        delete_ast(replace.old);
         eat_until(prs, TOK_DOT);
         return NOREPLACE;
     }
@@ -1920,7 +2513,7 @@ StringReplace parse_stringreplace(Parser *prs) {
     eat(prs, TOK_ID);
     replace.new = parse_value(prs, TYPE_ANY);
 
-    if (strcmp(prs->tok->value, "BEFORE") == 0) {
+    if (prs->tok->keyword == KW_BEFORE) {
         eat(prs, TOK_ID);
 
         if (expect_identifier(prs, "INITIAL")) {
@@ -1929,7 +2522,7 @@ StringReplace parse_stringreplace(Parser *prs) {
             replace.modifier = parse_value(prs, TYPE_ANY);
         } else
             eat_until(prs, TOK_DOT);
-    } else if (strcmp(prs->tok->value, "AFTER") == 0) {
+    } else if (prs->tok->keyword == KW_AFTER) {
         eat(prs, TOK_ID);
 
         if (expect_identifier(prs, "INITIAL")) {
@@ -1944,14 +2537,14 @@ StringReplace parse_stringreplace(Parser *prs) {
 }
 
 InspectTallying parse_tallying(Parser *prs) {
-    StringTally *tallies = malloc(4 * sizeof(StringTally));
+    StringTally *tallies = arena_alloc(cur_arena, 4 * sizeof(StringTally));
     size_t tally_count = 0;
     size_t tally_capacity = 4;
 
-    while (prs->tok->type != TOK_EOF && strcmp(peek(prs, 1)->value, "FOR") == 0) {
+    while (prs->tok->type != TOK_EOF && peek(prs, 1)->keyword == KW_FOR) {
         if (tally_count + 1 >= tally_capacity) {
+            tallies = arena_realloc(cur_arena, tallies, tally_capacity * sizeof(StringTally), tally_capacity * 2 * sizeof(StringTally));
             tally_capacity *= 2;
-            tallies = realloc(tallies, tally_capacity * sizeof(StringTally));
         }
 
         tallies[tally_count++] = parse_stringtally(prs);
@@ -1961,14 +2554,14 @@ InspectTallying parse_tallying(Parser *prs) {
 }
 
 InspectReplacing parse_replacing(Parser *prs) {
-    StringReplace *replaces = malloc(4 * sizeof(StringReplace));
+    StringReplace *replaces = arena_alloc(cur_arena, 4 * sizeof(StringReplace));
     size_t replace_count = 0;
     size_t replace_capacity = 4;
 
-    while (prs->tok->type != TOK_EOF && (strcmp(prs->tok->value, "ALL") == 0 || strcmp(prs->tok->value, "FIRST") == 0)) { 
+    while (prs->tok->type != TOK_EOF && (prs->tok->keyword == KW_ALL || prs->tok->keyword == KW_FIRST)) { 
         if (replace_count + 1 >= replace_capacity) {
+            replaces = arena_realloc(cur_arena, replaces, replace_capacity * sizeof(StringReplace), replace_capacity * 2 * sizeof(StringReplace));
             replace_capacity *= 2;
-            replaces = realloc(replaces, replace_capacity * sizeof(StringReplace));
         }
 
         replaces[replace_count++] = parse_stringreplace(prs);
@@ -1982,7 +2575,7 @@ AST *parse_inspect_tallying(Parser *prs, Variable *input_string, const size_t ln
     AST *ast = create_ast(AST_INSPECT, ln, col);
     ast->inspect.type = INSPECT_TALLYING;
     ast->inspect.input_string = create_ast(AST_VAR, ln, col);
-    ast->inspect.input_string->var.name = mystrdup(input_string->name);
+    ast->inspect.input_string->var.name = input_string->name;
     ast->inspect.input_string->var.sym = input_string;
     ast->inspect.tallying = parse_tallying(prs);
     return ast;
@@ -1992,7 +2585,7 @@ AST *parse_inspect_replacing(Parser *prs, Variable *input_string, const size_t l
     AST *ast = create_ast(AST_INSPECT, ln, col);
     ast->inspect.type = INSPECT_REPLACING;
     ast->inspect.input_string = create_ast(AST_VAR, ln, col);
-    ast->inspect.input_string->var.name = mystrdup(input_string->name);
+    ast->inspect.input_string->var.name = input_string->name;
     ast->inspect.input_string->var.sym = input_string;
     ast->inspect.replacing = parse_replacing(prs);
     return ast;
@@ -2025,10 +2618,10 @@ AST *parse_inspect(Parser *prs) {
 
     eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "TALLYING") == 0) {
+    if (prs->tok->keyword == KW_TALLYING) {
         eat(prs, TOK_ID);
         return parse_inspect_tallying(prs, var, ln, col);
-    } else if (strcmp(prs->tok->value, "REPLACING") == 0) {
+    } else if (prs->tok->keyword == KW_REPLACING) {
         eat(prs, TOK_ID);
         return parse_inspect_replacing(prs, var, ln, col);
     }
@@ -2071,18 +2664,18 @@ AST *parse_accept(Parser *prs) {
     AST *ast = create_ast(AST_ACCEPT, ln, col);
     ast->accept.dst = parse_value(prs, TYPE_ANY);
     //ast->accept.dst = create_ast(AST_VAR, ln, col);
-    //ast->accept.dst->var.name = mystrdup(prs->tok->value);
+    //ast->accept.dst->var.name = prs->tok->value;
     //ast->accept.dst->var.sym = var;
     //eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "FROM") != 0) {
+    if (prs->tok->keyword != KW_FROM) {
         ast->accept.from = NULL;
         return ast;
     }
 
     eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "COMMAND-LINE") == 0) {
+    if (prs->tok->keyword == KW_COMMAND_LINE) {
         eat(prs, TOK_ID);
         ast->accept.from = create_ast(AST_ARGV, prs->tok->ln, prs->tok->col);
     } else {
@@ -2111,65 +2704,77 @@ AST *parse_exit(Parser *prs) {
 
 AST *parse_not(Parser *prs);
 
-AST *parse_id(Parser *prs) {
+AST *parse_lengthof_or_addressof(Parser *prs) {
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
+    const bool is_length = prs->tok->keyword == KW_LENGTH;
+    eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "NULL") == 0) {
-        eat(prs, TOK_ID);
-        return create_ast(AST_NULL, ln, col);
-    } else if (strcmp(prs->tok->value, "TRUE") == 0 || strcmp(prs->tok->value, "FALSE") == 0) {
-        AST *ast = create_ast(AST_BOOL, ln, col);
-        ast->bool_value = strcmp(prs->tok->value, "TRUE") == 0;
-        eat(prs, TOK_ID);
-        return ast;
-    } else if (strcmp(prs->tok->value, "ZERO") == 0 || strcmp(prs->tok->value, "ZEROS") == 0 || strcmp(prs->tok->value, "ZEROES") == 0) {
-        eat(prs, TOK_ID);
-        return create_ast(AST_ZERO, ln, col);
-    } else if (strcmp(prs->tok->value, "NOT") == 0)
-        return parse_not(prs);
-    else if (strcmp(prs->tok->value, "SPACE") == 0) {
-        eat(prs, TOK_ID);
-        AST *ast = create_ast(AST_INT, ln, col);
-        ast->constant.i32 = ' ';
-        return ast;
-    } else if (strcmp(prs->tok->value, "LENGTH") == 0 || strcmp(prs->tok->value, "ADDRESS") == 0) {
-        const bool is_length = strcmp(prs->tok->value, "LENGTH") == 0;
-        eat(prs, TOK_ID);
+    if (!expect_identifier(prs, "OF"))
+        return NOP(ln, col);
 
-        if (!expect_identifier(prs, "OF"))
-            return NOP(ln, col);
+    eat(prs, TOK_ID);
 
-        eat(prs, TOK_ID);
+    // Set prs->parse_extra_value to false because we don't want
+    // other values getting inside strlen().
+    // For example, LENGTH OF "lsdlk" - 2
+    // We don't want the -2 to be part of the LENGTH OF.
+    // We do allow subscripts though because it's unlikely that they're
+    // used in the wrong place, and we may be subscripting a field or something.
 
-        // Set prs->parse_extra_value to false because we don't want
-        // other values getting inside strlen().
-        // For example, LENGTH OF "lsdlk" - 2
-        // We don't want the -2 to be part of the LENGTH OF.
-        // We do allow subscripts though because it's unlikely that they're
-        // used in the wrong place, and we may be subscripting a field or something.
+    bool before = prs->parse_extra_value;
+    prs->parse_extra_value = false;
 
-        bool before = prs->parse_extra_value;
-        prs->parse_extra_value = false;
+    AST *ast;
+    
+    if (is_length) {
+        ast = create_ast(AST_LENGTHOF, ln, col);
+        ast->lengthof_value = parse_value(prs, TYPE_ANY);
 
-        AST *ast;
-        
-        if (is_length) {
-            ast = create_ast(AST_LENGTHOF, ln, col);
-            ast->lengthof_value = parse_value(prs, TYPE_ANY);
+        if (prs->tok->type == TOK_LPAREN)
+            ast->lengthof_value = parse_subscript(prs, ast->lengthof_value);
+    } else {
+        ast = create_ast(AST_ADDRESSOF, ln, col);
+        ast->addressof_value = parse_value(prs, TYPE_ANY);
 
-            if (prs->tok->type == TOK_LPAREN)
-                ast->lengthof_value = parse_subscript(prs, ast->lengthof_value);
-        } else {
-            ast = create_ast(AST_ADDRESSOF, ln, col);
-            ast->addressof_value = parse_value(prs, TYPE_ANY);
+        if (prs->tok->type == TOK_LPAREN)
+            ast->addressof_value = parse_subscript(prs, ast->addressof_value);
+    }
 
-            if (prs->tok->type == TOK_LPAREN)
-                ast->addressof_value = parse_subscript(prs, ast->addressof_value);
-        }
+    prs->parse_extra_value = before;
+    return ast;
+}
 
-        prs->parse_extra_value = before;
-        return ast;
+AST *parse_id(Parser *prs) {
+    const size_t ln = prs->tok->ln;
+    const size_t col = prs->tok->col;
+
+    switch (prs->tok->keyword) {
+        case KW_NULL:
+            eat(prs, TOK_ID);
+            return create_ast(AST_NULL, ln, col);
+        case KW_TRUE:
+        case KW_FALSE: {
+            AST *ast = create_ast(AST_BOOL, ln, col);
+            ast->bool_value = prs->tok->keyword == KW_TRUE;
+            eat(prs, TOK_ID);
+            return ast;
+        }
+        case KW_ZERO:
+        case KW_ZEROS:
+        case KW_ZEROES:
+            eat(prs, TOK_ID);
+            return create_ast(AST_ZERO, ln, col);
+        case KW_NOT: return parse_not(prs);
+        case KW_SPACE: {
+            eat(prs, TOK_ID);
+            AST *ast = create_ast(AST_INT, ln, col);
+            ast->constant.i32 = ' ';
+            return ast;
+        }
+        case KW_LENGTH:
+        case KW_ADDRESS: return parse_lengthof_or_addressof(prs);
+        default: break;
     }
 
     Variable *sym;
@@ -2177,13 +2782,13 @@ AST *parse_id(Parser *prs) {
     if ((sym = find_variable(prs->file, prs->tok->value))->used) {
         if (sym->is_label) {
             AST *ast = create_ast(AST_LABEL, ln, col);
-            ast->label = mystrdup(prs->tok->value);
+            ast->label = prs->tok->value;
             eat(prs, TOK_ID);
             return ast;
         } else if (sym->struct_sym != NULL) {
             AST *ast = create_ast(AST_FIELD, ln, col);
             ast->field.base = create_ast(AST_VAR, ln, col);
-            ast->field.base->var.name = mystrdup(sym->struct_sym->name);
+            ast->field.base->var.name = sym->struct_sym->name;
             ast->field.base->var.sym = sym->struct_sym;
             ast->field.sym = sym;
             ast->field.value = NULL;
@@ -2192,7 +2797,7 @@ AST *parse_id(Parser *prs) {
         }
 
         AST *ast = create_ast(AST_VAR, ln, col);
-        ast->var.name = mystrdup(prs->tok->value);
+        ast->var.name = prs->tok->value;
         ast->var.sym = sym;
         eat(prs, TOK_ID);
 
@@ -2225,64 +2830,59 @@ AST *parse_procedure_stmt(Parser *prs, ASTList *root) {
     if (prs->tok->type == TOK_EOF)
         return NOP(prs->tok->ln, prs->tok->col);
 
-    if (strcmp(prs->tok->value, "STOP") == 0) {
-        eat(prs, TOK_ID);
-
-        if (expect_identifier(prs, "RUN"))
+    switch (prs->tok->keyword) {
+        case KW_STOP:
             eat(prs, TOK_ID);
 
-        return create_ast(prs->in_main ? AST_STOP_RUN : AST_STOP, prs->tok->ln, prs->tok->col);
-    } else if (strcmp(prs->tok->value, "DISPLAY") == 0) {
-        displayed_previously = false;
-        first_display = true;
-        return parse_display(prs, root);
-    } else if (strcmp(prs->tok->value, "MOVE") == 0)
-        return parse_move(prs);
-    else if (strcmp(prs->tok->value, "ADD") == 0 || strcmp(prs->tok->value, "SUBTRACT") == 0 || 
-            strcmp(prs->tok->value, "MULTIPLY") == 0 || strcmp(prs->tok->value, "DIVIDE") == 0)
-        return parse_arithmetic(prs);
-    else if (strcmp(prs->tok->value, "COMPUTE") == 0)
-        return parse_compute(prs);
-    else if (strcmp(prs->tok->value, "IF") == 0)
-        return parse_if(prs);
-    else if (strcmp(prs->tok->value, "NOT") == 0)
-        return parse_not(prs);
-    else if (strcmp(prs->tok->value, "END") == 0) {
-        eat(prs, TOK_ID);
+            if (expect_identifier(prs, "RUN"))
+                eat(prs, TOK_ID);
 
-        if (expect_identifier(prs, "PROGRAM")) {
+            return create_ast(prs->in_main ? AST_STOP_RUN : AST_STOP, prs->tok->ln, prs->tok->col);
+        case KW_DISPLAY:
+            displayed_previously = false;
+            first_display = true;
+            return parse_display(prs, root);
+        case KW_MOVE: return parse_move(prs);
+        case KW_ADD:
+        case KW_SUBTRACT:
+        case KW_MULTIPLY:
+        case KW_DIVIDE: return parse_arithmetic(prs);
+        case KW_COMPUTE: return parse_compute(prs);
+        case KW_IF: return parse_if(prs);
+        case KW_NOT: return parse_not(prs);
+        case KW_END:
             eat(prs, TOK_ID);
 
-            if (expect_identifier(prs, prs->program_id))
+            if (expect_identifier(prs, "PROGRAM")) {
                 eat(prs, TOK_ID);
-        } else
-            eat_until(prs, TOK_DOT);
 
-        return NOP(prs->tok->ln, prs->tok->col);
-    } else if (strcmp(prs->tok->value, "PERFORM") == 0)
-        return parse_perform(prs);
-    else if (strcmp(prs->tok->value, "SET") == 0)
-        return parse_set(prs);
-    else if (strcmp(prs->tok->value, "CALL") == 0)
-        return parse_call(prs);
-    else if (strcmp(prs->tok->value, "STRING") == 0)
-        return parse_string_builder(prs);
-    else if (strcmp(prs->tok->value, "UNSTRING") == 0)
-        return parse_unstring(prs);
-    else if (strcmp(prs->tok->value, "OPEN") == 0)
-        return parse_open(prs);
-    else if (strcmp(prs->tok->value, "CLOSE") == 0)
-        return parse_close(prs);
-    else if (strcmp(prs->tok->value, "READ") == 0)
-        return parse_read(prs);
-    else if (strcmp(prs->tok->value, "WRITE") == 0)
-        return parse_write(prs);
-    else if (strcmp(prs->tok->value, "INSPECT") == 0)
-        return parse_inspect(prs);
-    else if (strcmp(prs->tok->value, "ACCEPT") == 0)
-        return parse_accept(prs);
-    else if (strcmp(prs->tok->value, "EXIT") == 0)
-        return parse_exit(prs);
+                if (expect_identifier(prs, prs->program_id))
+                    eat(prs, TOK_ID);
+            } else
+                eat_until(prs, TOK_DOT);
+
+            return NOP(prs->tok->ln, prs->tok->col);
+        case KW_PERFORM: return parse_perform(prs);
+        case KW_GO: return parse_goto(prs);
+        case KW_SET: return parse_set(prs);
+        case KW_CALL: return parse_call(prs);
+        case KW_STRING: return parse_string_builder(prs);
+        case KW_UNSTRING: return parse_unstring(prs);
+        case KW_OPEN: return parse_open(prs);
+        case KW_CLOSE: return parse_close(prs);
+        case KW_READ: return parse_read(prs);
+        case KW_WRITE:
+        case KW_REWRITE: return parse_write(prs);
+        case KW_START:
+        case KW_DELETE: return parse_start_or_delete(prs);
+        case KW_SORT: return parse_sort(prs);
+        case KW_RELEASE: return parse_release(prs);
+        case KW_RETURN: return parse_read(prs);
+        case KW_INSPECT: return parse_inspect(prs);
+        case KW_ACCEPT: return parse_accept(prs);
+        case KW_EXIT: return parse_exit(prs);
+        default: break;
+    }
 
     log_error(prs->file, prs->tok->ln, prs->tok->col);
     fprintf(stderr, "invalid clause '%s' in PROCEDURE DIVISION\n", prs->tok->value);
@@ -2294,7 +2894,7 @@ AST *parse_procedure_stmt(Parser *prs, ASTList *root) {
 AST *parse_constant(Parser *prs) {
     if (prs->tok->type == TOK_STRING) {
         AST *ast = create_ast(AST_STRING, prs->tok->ln, prs->tok->col);
-        ast->constant.string = mystrdup(prs->tok->value);
+        ast->constant.string = prs->tok->value;
         eat(prs, TOK_STRING);
         return ast;
     }
@@ -2303,12 +2903,17 @@ AST *parse_constant(Parser *prs) {
     char *endptr;
     errno = 0;
 
-    if (prs->tok->type == TOK_INT) {
+    // Integers too long for i32 keep their digits like decimal literals do,
+    // so items past 18 digits still get them exactly.
+    if (prs->tok->type == TOK_INT && strlen(prs->tok->value) <= 9) {
         ast = create_ast(AST_INT, prs->tok->ln, prs->tok->col);
         ast->constant.i32 = strtoll(prs->tok->value, &endptr, 10);
     } else {
         ast = create_ast(AST_FLOAT, prs->tok->ln, prs->tok->col);
         ast->constant.f64 = strtod(prs->tok->value, &endptr);
+
+        // Fixed point decimals are scaled from the digits, not the double.
+        ast->constant.string = prs->tok->value;
     }
 
     if (endptr == prs->tok->value || *endptr != '\0') {
@@ -2364,9 +2969,9 @@ unsigned int parse_comptype(Parser *prs, AST *ast) {
     // ast is the existing PIC clause from parse_pic().
     // This is not used when called from parse_comp_pic().
 
-    // COMP-1, COMP-2, COMP-3 and COMP-6 are not allowed in PIC clauses.
+    // COMP-1, COMP-2 and COMP-6 are not allowed in PIC clauses.
 
-    if (strcmp(prs->tok->value, "COMP") == 0 || strcmp(prs->tok->value, "COMP-4") == 0 || strcmp(prs->tok->value, "BINARY") == 0) {
+    if (prs->tok->keyword == KW_COMP || prs->tok->keyword == KW_COMP_4 || prs->tok->keyword == KW_BINARY) {
         if (ast != NULL && ast->pic.type.decimal_places > 0) {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "COMP type '%s' used for non-integer variable '%s'\n", prs->tok->value, ast->pic.name);
@@ -2374,7 +2979,7 @@ unsigned int parse_comptype(Parser *prs, AST *ast) {
         }
 
         return COMP4;
-    } else if (strcmp(prs->tok->value, "COMP-1") == 0) {
+    } else if (prs->tok->keyword == KW_COMP_1) {
         if (ast != NULL) {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "COMP type '%s' used in a PIC clause for variable '%s'\n", prs->tok->value, ast->pic.name);
@@ -2382,7 +2987,7 @@ unsigned int parse_comptype(Parser *prs, AST *ast) {
         }
 
         return COMP1;
-    } else if (strcmp(prs->tok->value, "COMP-2") == 0) {
+    } else if (prs->tok->keyword == KW_COMP_2) {
         if (ast != NULL) {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "COMP type '%s' used in a PIC clause for variable '%s'\n", prs->tok->value, ast->pic.name);
@@ -2390,9 +2995,17 @@ unsigned int parse_comptype(Parser *prs, AST *ast) {
         }
 
         return COMP2;
-    } else if (strcmp(prs->tok->value, "COMP-5") == 0)
+    } else if (prs->tok->keyword == KW_COMP_3 || prs->tok->keyword == KW_PACKED_DECIMAL) {
+        if (ast != NULL && (ast->pic.type.type == TYPE_ALPHABETIC || ast->pic.type.type == TYPE_ALPHANUMERIC)) {
+            log_error(prs->file, prs->tok->ln, prs->tok->col);
+            fprintf(stderr, "COMP type '%s' used for non-numeric variable '%s'\n", prs->tok->value, ast->pic.name);
+            show_error(prs->file, prs->tok->ln, prs->tok->col);
+        }
+
+        return COMP3;
+    } else if (prs->tok->keyword == KW_COMP_5)
         return COMP5;
-    else if (strcmp(prs->tok->value, "POINTER") == 0)
+    else if (prs->tok->keyword == KW_POINTER)
         return COMP_POINTER;
     else {
         log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -2413,20 +3026,19 @@ AST *parse_pic(Parser *prs) {
         show_error(level->file, level->ln, level->col);
     }
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
     AST *ast = create_ast(AST_PIC, prs->tok->ln, prs->tok->col);
     eat(prs, TOK_ID);
     ast->pic.level = level->constant.i32;
-    delete_ast(level);
     ast->pic.name = name;
-    ast->pic.is_index = ast->pic.is_fd = ast->pic.is_linkage_src = false;
+    ast->pic.is_index = ast->pic.is_fd = ast->pic.is_sort = ast->pic.is_linkage_src = false;
     ast->pic.count = 0;
     ast->pic.fields = create_astlist();
 
     bool had_pic = false;
 
     // We may be defining a record or a following USAGE IS statement.
-    if (strcmp(prs->tok->value, "PIC") == 0) {
+    if (prs->tok->keyword == KW_PIC) {
         had_pic = true;
         eat(prs, TOK_ID); // PIC
 
@@ -2495,8 +3107,6 @@ AST *parse_pic(Parser *prs) {
                 } else
                     ast->pic.type.places = (unsigned int)size->constant.i32;
 
-                delete_ast(size);
-
                 // Strings are kinda like tables so the place count is the character count yk.
                 if (type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC)
                     ast->pic.type.count = ast->pic.type.places;
@@ -2523,7 +3133,6 @@ AST *parse_pic(Parser *prs) {
 
                 AST *size = parse_constant(prs);
                 ast->pic.type.decimal_places = (unsigned int)size->constant.i32;
-                delete_ast(size);
 
                 eat(prs, TOK_RPAREN);
 
@@ -2535,11 +3144,21 @@ AST *parse_pic(Parser *prs) {
             } else
                 ast->pic.type.decimal_places = 1;
         }
+
+        if (ast->pic.type.type != TYPE_ALPHABETIC && ast->pic.type.type != TYPE_ALPHANUMERIC &&
+                ast->pic.type.places + ast->pic.type.decimal_places > MAX_NUMERIC_DIGITS) {
+            log_error(prs->file, ast->ln, ast->col);
+            fprintf(stderr, "found %u digits in variable '%s' but maximum is %d\n", ast->pic.type.places + ast->pic.type.decimal_places, name, MAX_NUMERIC_DIGITS);
+            show_error(prs->file, ast->ln, ast->col);
+        }
     }
 
-    if (strcmp(prs->tok->value, "USAGE") == 0 && strcmp(peek(prs, 1)->value, "IS") == 0) {
-        eat(prs, TOK_ID);
-        eat(prs, TOK_ID);
+    // USAGE IS can be left out after a PIC clause, like PIC S9(7)V99 COMP-3.
+    if ((prs->tok->keyword == KW_USAGE && peek(prs, 1)->keyword == KW_IS) || (had_pic && IS_COMP(prs->tok))) {
+        if (prs->tok->keyword == KW_USAGE) {
+            eat(prs, TOK_ID);
+            eat(prs, TOK_ID);
+        }
 
         if (IS_COMP(prs->tok))
             ast->pic.type.comp_type = parse_comptype(prs, ast);
@@ -2558,7 +3177,7 @@ AST *parse_pic(Parser *prs) {
         ast->pic.type = (PictureType){ .type = TYPE_SIGNED_NUMERIC, .count = 0 };
     }
 
-    if (strcmp(prs->tok->value, "VALUE") == 0) {
+    if (prs->tok->keyword == KW_VALUE) {
         eat(prs, TOK_ID);
         AST *value = parse_value(prs, ast->pic.type.type);
         ast->pic.value = value;
@@ -2573,7 +3192,7 @@ AST *parse_pic(Parser *prs) {
     } else
         ast->pic.value = NULL;
 
-    if (strcmp(prs->tok->value, "OCCURS") == 0) {
+    if (prs->tok->keyword == KW_OCCURS) {
         eat(prs, TOK_ID);
 
         if (prs->tok->type != TOK_INT) {
@@ -2584,13 +3203,12 @@ AST *parse_pic(Parser *prs) {
         } else {
             AST *size = parse_constant(prs);
             ast->pic.count = (unsigned int)size->constant.i32;
-            delete_ast(size);
         }
 
         if (expect_identifier(prs, "TIMES")) {
             eat(prs, TOK_ID);
 
-            if (strcmp(prs->tok->value, "INDEXED") != 0) 
+            if (prs->tok->keyword != KW_INDEXED) 
                 goto done;
             
             eat(prs, TOK_ID);
@@ -2615,7 +3233,7 @@ AST *parse_pic(Parser *prs) {
             }
 
             AST *pic = create_ast(AST_PIC, prs->tok->ln, prs->tok->col);
-            pic->pic.name = mystrdup(prs->tok->value);
+            pic->pic.name = prs->tok->value;
             pic->pic.level = ast->pic.level;
             pic->pic.fields = create_astlist();
 
@@ -2628,7 +3246,7 @@ AST *parse_pic(Parser *prs) {
             pic->pic.type.places = 0;
             pic->pic.count = 0;
             pic->pic.is_index = true;
-            pic->pic.is_fd = pic->pic.is_linkage_src = false;
+            pic->pic.is_fd = pic->pic.is_sort = pic->pic.is_linkage_src = false;
 
             Variable *var = add_variable(pic->file, pic->pic.name, pic->pic.type, pic->pic.count);
             var->is_index = true;
@@ -2666,14 +3284,13 @@ AST *parse_comp_pic(Parser *prs) {
         show_error(level->file, level->ln, level->col);
     }
 
-    char *name = mystrdup(prs->tok->value);
+    char *name = prs->tok->value;
     eat(prs, TOK_ID);
 
     AST *ast = create_ast(AST_PIC, prs->tok->ln, prs->tok->col);
     ast->pic.level = level->constant.i32;
-    delete_ast(level);
     ast->pic.name = name;
-    ast->pic.is_index = ast->pic.is_fd = ast->pic.is_linkage_src = false;
+    ast->pic.is_index = ast->pic.is_fd = ast->pic.is_sort = ast->pic.is_linkage_src = false;
     ast->pic.count = 0;
     ast->pic.fields = create_astlist();
 
@@ -2693,7 +3310,7 @@ AST *parse_comp_pic(Parser *prs) {
 
     eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "VALUE") == 0) {
+    if (prs->tok->keyword == KW_VALUE) {
         eat(prs, TOK_ID);
         ast->pic.value = parse_value(prs, TYPE_ANY);
     } else
@@ -2710,7 +3327,6 @@ AST *parse_comp_pic(Parser *prs) {
 AST *parse_struct_pic(Parser *prs) {
     AST *level = parse_constant(prs);
     unsigned int level_digit = level->constant.i32;
-    delete_ast(level);
 
     Variable *var = find_variable(prs->file, prs->tok->value);
 
@@ -2725,15 +3341,15 @@ AST *parse_struct_pic(Parser *prs) {
 
     AST *ast = create_ast(AST_PIC, prs->tok->ln, prs->tok->col);
     ast->pic.level = level_digit;
-    ast->pic.name = mystrdup(prs->tok->value);
+    ast->pic.name = prs->tok->value;
     eat(prs, TOK_ID);
     ast->pic.type = (PictureType){ .type = TYPE_POINTER, .count = 0, .places = 0 };
     ast->pic.count = 0;
-    ast->pic.is_fd = ast->pic.is_index = ast->pic.is_linkage_src = false;
+    ast->pic.is_fd = ast->pic.is_sort = ast->pic.is_index = ast->pic.is_linkage_src = false;
     ast->pic.value = NULL;
     ast->pic.fields = create_astlist();
 
-    if (strcmp(prs->tok->value, "OCCURS") == 0) {
+    if (prs->tok->keyword == KW_OCCURS) {
         eat(prs, TOK_ID);
 
         if (prs->tok->type != TOK_INT) {
@@ -2745,7 +3361,6 @@ AST *parse_struct_pic(Parser *prs) {
         } else {
             AST *size = parse_constant(prs);
             ast->pic.count = size->constant.i32;
-            delete_ast(size);
 
             if (expect_identifier(prs, "TIMES"))
                 eat(prs, TOK_ID);
@@ -2761,21 +3376,17 @@ AST *parse_struct_pic(Parser *prs) {
         AST *field_level = parse_constant(prs);
         jump_to(prs, before);
 
-        if ((unsigned int)field_level->constant.i32 <= ast->pic.level) {
-            delete_ast(field_level);
+        if ((unsigned int)field_level->constant.i32 <= ast->pic.level)
             break;
-        }
-
-        delete_ast(field_level);
 
         Token *next2 = peek(prs, 2);
         AST *field;
 
-        if (next2->type == TOK_DOT || strcmp(next2->value, "OCCURS") == 0)
+        if (next2->type == TOK_DOT || next2->keyword == KW_OCCURS)
             field = parse_struct_pic(prs);
-        else if (strcmp(next2->value, "PIC") == 0)
+        else if (next2->keyword == KW_PIC)
             field = parse_pic(prs);
-        else if (strcmp(next2->value, "USAGE") == 0)
+        else if (next2->keyword == KW_USAGE)
             field = parse_comp_pic(prs);
         else {
             assert(false);
@@ -2848,20 +3459,22 @@ void parse_copybook(Parser *prs, size_t ln, size_t col, char *filename, char *pa
         return;
     }
 
+    fclose(f);
+    cache_add_copybook(path);
+
     // Cache then restore cur_file.
-    char *file_cache = mystrdup(cur_file);
+    char *file_cache = cur_file;
     ASTList *root_cache = root_ptr;
 
-    free(cur_file);
-    cur_file = mystrdup(filename);
+    cur_file = arena_strdup(cur_arena, filename);
 
     // This will add symbols to the symbol table and push ASTs
     // to the already assigned root_ptr variable in parse_root().
-    Parser cbprs = create_parser(path, NULL);
+    Copybook *cb = load_copybook(path);
+    Parser cbprs = create_parser_from_tokens(cb->path, cb->tokens, cb->token_count);
     parse_working_storage_section(&cbprs);
     delete_parser(&cbprs);
 
-    free(cur_file);
     cur_file = file_cache;
     root_ptr = root_cache;
 }
@@ -2888,16 +3501,16 @@ AST *parse_copy(Parser *prs) {
     return NOP(ln, col);
 }
 
-bool should_break_from(Parser *prs, char *header) {
-    return prs->tok->type == TOK_EOF || strcmp(peek(prs, 1)->value, header) == 0;
+bool should_break_from(Parser *prs, Keyword header) {
+    return prs->tok->type == TOK_EOF || peek(prs, 1)->keyword == header;
 }
 
 void parse_identification_division(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
         if (!expect_identifier(prs, NULL)) {
@@ -2909,10 +3522,10 @@ void parse_identification_division(Parser *prs) {
             continue;
         }
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
-        if (strcmp(prs->tok->value, "PROGRAM-ID") == 0)
+        if (prs->tok->keyword == KW_PROGRAM_ID)
             astlist_push(root_ptr, parse_program_id(prs));
         else {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -2925,11 +3538,11 @@ void parse_identification_division(Parser *prs) {
 
 // This function looks pretty much exactly like parse_working_storage_section().
 void parse_linkage_section(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION") || should_break_from(prs, "SECTION"))
+        if (should_break_from(prs, KW_DIVISION) || should_break_from(prs, KW_SECTION))
             break;
 
         if (prs->tok->type == TOK_INT) {
@@ -2937,15 +3550,15 @@ void parse_linkage_section(Parser *prs) {
             Token *next = peek(prs, 1);
             Token *ahead = peek(prs, 2);
         
-            if (next->type == TOK_ID && (ahead->type == TOK_DOT || strcmp(ahead->value, "OCCURS") == 0))
+            if (next->type == TOK_ID && (ahead->type == TOK_DOT || ahead->keyword == KW_OCCURS))
                 astlist_push(root_ptr, parse_struct_pic(prs));
             else if (next->type == TOK_ID) {
-                if (strcmp(ahead->value, "PIC") == 0)
+                if (ahead->keyword == KW_PIC)
                     astlist_push(root_ptr, parse_pic(prs));
-                else if (strcmp(ahead->value, "USAGE") == 0)
+                else if (ahead->keyword == KW_USAGE)
                     astlist_push(root_ptr, parse_comp_pic(prs));
             }
-        } else if (strcmp(prs->tok->value, "COPY") == 0)
+        } else if (prs->tok->keyword == KW_COPY)
             astlist_push(root_ptr, parse_copy(prs));
         else {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -2957,11 +3570,11 @@ void parse_linkage_section(Parser *prs) {
 }
 
 void parse_working_storage_section(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION") || should_break_from(prs, "SECTION"))
+        if (should_break_from(prs, KW_DIVISION) || should_break_from(prs, KW_SECTION))
             break;
 
         if (prs->tok->type == TOK_INT) {
@@ -2969,15 +3582,15 @@ void parse_working_storage_section(Parser *prs) {
             Token *next = peek(prs, 1);
             Token *ahead = peek(prs, 2);
         
-            if (next->type == TOK_ID && (ahead->type == TOK_DOT || strcmp(ahead->value, "OCCURS") == 0))
+            if (next->type == TOK_ID && (ahead->type == TOK_DOT || ahead->keyword == KW_OCCURS))
                 astlist_push(root_ptr, parse_struct_pic(prs));
             else if (next->type == TOK_ID) {
-                if (strcmp(ahead->value, "PIC") == 0)
+                if (ahead->keyword == KW_PIC)
                     astlist_push(root_ptr, parse_pic(prs));
-                else if (strcmp(ahead->value, "USAGE") == 0)
+                else if (ahead->keyword == KW_USAGE)
                     astlist_push(root_ptr, parse_comp_pic(prs));
             }
-        } else if (strcmp(prs->tok->value, "COPY") == 0)
+        } else if (prs->tok->keyword == KW_COPY)
             astlist_push(root_ptr, parse_copy(prs));
         else {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -2988,7 +3601,9 @@ void parse_working_storage_section(Parser *prs) {
     }
 }
 
+// FD or SD, a sort file is only used by SORT, RELEASE and RETURN.
 AST *parse_fd(Parser *prs) {
+    const bool is_sort = prs->tok->keyword == KW_SD;
     eat(prs, TOK_ID);
 
     // The WORKING-STORAGE SECTION should be parsed before the FILE SECTION,
@@ -3005,7 +3620,7 @@ AST *parse_fd(Parser *prs) {
     }
 
     AST *ast = create_ast(AST_PIC, prs->tok->ln, prs->tok->col);
-    ast->pic.name = mystrdup(prs->tok->value);
+    ast->pic.name = prs->tok->value;
     eat(prs, TOK_ID);
     ast->pic.is_index = false;
     ast->pic.level = 1;
@@ -3013,15 +3628,32 @@ AST *parse_fd(Parser *prs) {
     ast->pic.value = create_ast(AST_NULL, prs->tok->ln, prs->tok->col);
     ast->pic.is_index = ast->pic.is_linkage_src = false;
     ast->pic.is_fd = true;
+    ast->pic.is_sort = is_sort;
     ast->pic.fields = create_astlist();
 
     var = add_variable(prs->file, ast->pic.name, ast->pic.type, 0);
     var->is_index = var->is_label = false;
     var->is_fd = true;
+    var->organization = is_sort ? ORG_SORT : ORG_NONE;
 
     return ast;
 }
 
+// Keys are compared as raw bytes or as a C integer, which rules out packed,
+// wide and floating point items.
+static bool is_record_key_type(Variable *key) {
+    PictureType *type = &key->type;
+
+    if (key->count > 0 || key->fields != NULL || is_packed(type) || is_wide_numeric(type))
+        return false;
+    else if (type->type == TYPE_ALPHABETIC || type->type == TYPE_ALPHANUMERIC)
+        return type->count > 0;
+
+    return type->comp_type != COMP1 && type->comp_type != COMP2 && type->comp_type != COMP_POINTER &&
+        (is_fixed_point(type) || type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_UNSIGNED_NUMERIC ||
+         type->type == TYPE_SIGNED_SUPRESSED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC);
+}
+
 AST *parse_select(Parser *prs) {
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
@@ -3064,106 +3696,211 @@ AST *parse_select(Parser *prs) {
         return NOP(prs->tok->ln, prs->tok->col);
     }
 
-    char *filename = mystrdup(prs->tok->value);
+    char *filename = prs->tok->value;
     eat(prs, TOK_STRING);
     */
     AST *filename = parse_value(prs, TYPE_ANY);
     unsigned int organization = ORG_NONE;
+    unsigned int access = ACCESS_SEQUENTIAL;
+    Variable *record_key = NULL;
+    bool has_record_key = false;
+    AST *filestatus_var = NULL;
 
-    if (strcmp(prs->tok->value, "ORGANIZATION") == 0) {
-        eat(prs, TOK_ID);
+    // The clauses after ASSIGN can come in any order.
+    while (prs->tok->type != TOK_DOT && prs->tok->type != TOK_EOF && prs->tok->keyword != KW_SELECT) {
+        if (prs->tok->keyword == KW_ORGANIZATION) {
+            eat(prs, TOK_ID);
 
-        if (!expect_identifier(prs, "IS")) {
-            free(filename);
-            eat_until(prs, TOK_DOT);
-            return NOP(prs->tok->ln, prs->tok->col);
-        }
+            if (prs->tok->keyword == KW_IS)
+                eat(prs, TOK_ID);
 
-        eat(prs, TOK_ID);
+            if (prs->tok->keyword == KW_LINE) {
+                eat(prs, TOK_ID);
+
+                if (expect_identifier(prs, "SEQUENTIAL")) {
+                    eat(prs, TOK_ID);
+                    organization = ORG_LINE_SEQUENTIAL;
+                } else
+                    eat_until(prs, TOK_DOT);
+            } else if (prs->tok->keyword == KW_SEQUENTIAL || prs->tok->keyword == KW_INDEXED || prs->tok->keyword == KW_RELATIVE) {
+                if (prs->tok->keyword == KW_SEQUENTIAL)
+                    organization = ORG_SEQUENTIAL;
+                else
+                    organization = prs->tok->keyword == KW_INDEXED ? ORG_INDEXED : ORG_RELATIVE;
+
+                // Fixed length records, as long as the FD's record description.
+                if (var->record == NULL) {
+                    log_error(prs->file, prs->tok->ln, prs->tok->col);
+                    fprintf(stderr, "%s file '%s' has no record description\n", keyword_to_string(prs->tok->keyword), var->name);
+                    show_error(prs->file, prs->tok->ln, prs->tok->col);
+                }
 
-        if (strcmp(prs->tok->value, "LINE") == 0) {
+                eat(prs, TOK_ID);
+            } else {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "invalid file ORGANIZATION '%s'\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
+                eat_until(prs, TOK_DOT);
+            }
+        } else if (prs->tok->keyword == KW_ACCESS) {
             eat(prs, TOK_ID);
 
-            if (expect_identifier(prs, "SEQUENTIAL")) {
+            if (prs->tok->keyword == KW_MODE)
                 eat(prs, TOK_ID);
-                organization = ORG_LINE_SEQUENTIAL;
-            } else
+
+            if (prs->tok->keyword == KW_IS)
+                eat(prs, TOK_ID);
+
+            if (prs->tok->keyword == KW_SEQUENTIAL)
+                access = ACCESS_SEQUENTIAL;
+            else if (prs->tok->keyword == KW_RANDOM)
+                access = ACCESS_RANDOM;
+            else if (prs->tok->keyword == KW_DYNAMIC)
+                access = ACCESS_DYNAMIC;
+            else {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "invalid ACCESS MODE '%s'\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
                 eat_until(prs, TOK_DOT);
-        } else {
-            log_error(prs->file, prs->tok->ln, prs->tok->col);
-            fprintf(stderr, "invalid file ORGANIZATION '%s'\n", prs->tok->value);
-            show_error(prs->file, prs->tok->ln, prs->tok->col);
-            eat_until(prs, TOK_DOT);
-        }
-    }
+                break;
+            }
 
-    AST *filestatus_var = NULL;
+            eat(prs, TOK_ID);
+        } else if (prs->tok->keyword == KW_RECORD || prs->tok->keyword == KW_RELATIVE) {
+            // The record key is a field of the record, the relative key an integer
+            // item outside it that holds the record number.
+            const bool relative = prs->tok->keyword == KW_RELATIVE;
+            has_record_key = true;
+            eat(prs, TOK_ID);
 
-    if (strcmp(prs->tok->value, "FILE") != 0)
-        goto build_ast;
+            if (!expect_identifier(prs, "KEY")) {
+                eat_until(prs, TOK_DOT);
+                break;
+            }
 
-    eat(prs, TOK_ID);
+            eat(prs, TOK_ID);
 
-    if (!expect_identifier(prs, "STATUS")) {
-        eat_until(prs, TOK_DOT);
-        goto build_ast;
-    }
+            if (prs->tok->keyword == KW_IS)
+                eat(prs, TOK_ID);
 
-    eat(prs, TOK_ID);
+            record_key = find_variable(prs->file, prs->tok->value);
 
-    if (!expect_identifier(prs, "IS")) {
-        eat_until(prs, TOK_DOT);
-        goto build_ast;
-    }
+            if (!record_key->used) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "undefined variable '%s'\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
 
-    eat(prs, TOK_ID);
+                record_key = NULL;
+                eat_until(prs, TOK_DOT);
+                break;
+            } else if (relative && (record_key->struct_sym != NULL || !is_record_key_type(record_key) ||
+                    record_key->type.count > 0 || is_fixed_point(&record_key->type))) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "relative key '%s' must be an elementary integer item outside the record\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
 
-    Variable *fstat = find_variable(prs->file, prs->tok->value);
+                record_key = NULL;
+                eat_until(prs, TOK_DOT);
+                break;
+            } else if (!relative && (var->record == NULL || record_key->struct_sym != var->record || !is_record_key_type(record_key))) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "record key '%s' must be a PIC X or binary numeric field of the record of '%s'\n", prs->tok->value, var->name);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
 
-    if (!fstat->used) {
-        log_error(prs->file, prs->tok->ln, prs->tok->col);
-        fprintf(stderr, "undefined variable '%s'\n", prs->tok->value);
-        show_error(prs->file, prs->tok->ln, prs->tok->col);
+                record_key = NULL;
+                eat_until(prs, TOK_DOT);
+                break;
+            }
 
-        filestatus_var = NOP(ln, col);
-        eat_until(prs, TOK_DOT);
-        goto build_ast;
-    } else if (fstat->type.count == 0 || fstat->type.type != TYPE_ALPHANUMERIC) {
-        log_error(prs->file, prs->tok->ln, prs->tok->col);
-        fprintf(stderr, "file status variable '%s' must have type X(02)\n", prs->tok->value);
-        show_error(prs->file, prs->tok->ln, prs->tok->col);
+            eat(prs, TOK_ID);
+        } else if (prs->tok->keyword == KW_FILE) {
+            eat(prs, TOK_ID);
 
-        filestatus_var = NOP(ln, col);
-        eat_until(prs, TOK_DOT);
-        goto build_ast;
+            if (!expect_identifier(prs, "STATUS")) {
+                eat_until(prs, TOK_DOT);
+                break;
+            }
+
+            eat(prs, TOK_ID);
+
+            if (prs->tok->keyword == KW_IS)
+                eat(prs, TOK_ID);
+
+            Variable *fstat = find_variable(prs->file, prs->tok->value);
+
+            if (!fstat->used) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "undefined variable '%s'\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+                filestatus_var = NOP(ln, col);
+                eat_until(prs, TOK_DOT);
+                break;
+            } else if (fstat->type.count == 0 || fstat->type.type != TYPE_ALPHANUMERIC) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "file status variable '%s' must have type X(02)\n", prs->tok->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
+
+                filestatus_var = NOP(ln, col);
+                eat_until(prs, TOK_DOT);
+                break;
+            }
+
+            filestatus_var = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
+            filestatus_var->var.name = prs->tok->value;
+            filestatus_var->var.sym = fstat;
+            eat(prs, TOK_ID);
+        } else {
+            log_error(prs->file, prs->tok->ln, prs->tok->col);
+            fprintf(stderr, "invalid clause '%s' in SELECT\n", prs->tok->value);
+            show_error(prs->file, prs->tok->ln, prs->tok->col);
+            eat_until(prs, TOK_DOT);
+        }
     }
 
-    filestatus_var = create_ast(AST_VAR, prs->tok->ln, prs->tok->col);
-    filestatus_var->var.name = mystrdup(prs->tok->value);
-    filestatus_var->var.sym = fstat;
-    eat(prs, TOK_ID);
+    if (var->organization == ORG_SORT) {
+        // The SELECT of a sort file only names it, the records never reach a file.
+        if (organization != ORG_NONE || access != ACCESS_SEQUENTIAL || has_record_key) {
+            log_error(prs->file, ln, col);
+            fprintf(stderr, "sort file '%s' only takes ASSIGN and FILE STATUS\n", var->name);
+            show_error(prs->file, ln, col);
+        }
 
-build_ast: ;
+        organization = ORG_SORT;
+        record_key = NULL;
+    } else if (organization == ORG_INDEXED && !has_record_key && var->record != NULL) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "indexed file '%s' has no RECORD KEY\n", var->name);
+        show_error(prs->file, ln, col);
+    } else if (organization == ORG_RELATIVE && !has_record_key && access != ACCESS_SEQUENTIAL) {
+        log_error(prs->file, ln, col);
+        fprintf(stderr, "relative file '%s' needs a RELATIVE KEY for random access\n", var->name);
+        show_error(prs->file, ln, col);
+    }
 
     AST *ast = create_ast(AST_SELECT, ln, col);
     ast->select.fd_var = create_ast(AST_VAR, ln, col);
-    ast->select.fd_var->var.name = mystrdup(var->name);
+    ast->select.fd_var->var.name = var->name;
     ast->select.fd_var->var.sym = var;
     ast->select.filename = filename;
     ast->select.filestatus_var = filestatus_var;
     ast->select.organization = organization;
+    ast->select.access = access;
+    var->organization = organization;
+    var->access = access;
+    var->record_key = record_key;
     return ast;
 }
 
 void parse_file_control(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION") || should_break_from(prs, "SECTION"))
+        if (should_break_from(prs, KW_DIVISION) || should_break_from(prs, KW_SECTION))
             break;
 
-        if (strcmp(prs->tok->value, "SELECT") == 0)
+        if (prs->tok->keyword == KW_SELECT)
             astlist_push(root_ptr, parse_select(prs));
         else {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -3175,14 +3912,14 @@ void parse_file_control(Parser *prs) {
 }
 
 void parse_input_output_section(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION") || should_break_from(prs, "SECTION"))
+        if (should_break_from(prs, KW_DIVISION) || should_break_from(prs, KW_SECTION))
             break;
 
-        if (strcmp(prs->tok->value, "FILE-CONTROL") == 0) {
+        if (prs->tok->keyword == KW_FILE_CONTROL) {
             eat(prs, TOK_ID);
             parse_file_control(prs);
             return;
@@ -3196,11 +3933,11 @@ void parse_input_output_section(Parser *prs) {
 }
 
 void parse_environment_division(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
         if (!expect_identifier(prs, NULL)) {
@@ -3208,10 +3945,10 @@ void parse_environment_division(Parser *prs) {
             continue;
         }
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
-        if (strcmp(prs->tok->value, "INPUT-OUTPUT") == 0) {
+        if (prs->tok->keyword == KW_INPUT_OUTPUT) {
             eat(prs, TOK_ID);
 
             if (expect_identifier(prs, "SECTION")) {
@@ -3230,16 +3967,47 @@ void parse_environment_division(Parser *prs) {
 }
 
 void parse_file_section(Parser *prs) {
-    while (!should_break_from(prs, "DIVISION")) {
+    Variable *fd = NULL;
+
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION") || should_break_from(prs, "SECTION"))
+        if (should_break_from(prs, KW_DIVISION) || should_break_from(prs, KW_SECTION))
             break;
 
-        if (strcmp(prs->tok->value, "FD") == 0)
-            astlist_push(root_ptr, parse_fd(prs));
-        else {
+        if (prs->tok->keyword == KW_FD || prs->tok->keyword == KW_SD) {
+            AST *ast = parse_fd(prs);
+            astlist_push(root_ptr, ast);
+            fd = ast->type == AST_PIC ? find_variable(prs->file, ast->pic.name) : NULL;
+        } else if (prs->tok->type == TOK_INT && fd != NULL) {
+            // The first record description after an FD is its record.
+            Token *next = peek(prs, 1);
+            Token *ahead = peek(prs, 2);
+            AST *record = NULL;
+
+            if (next->type == TOK_ID && (ahead->type == TOK_DOT || ahead->keyword == KW_OCCURS))
+                record = parse_struct_pic(prs);
+            else if (next->type == TOK_ID && ahead->keyword == KW_PIC)
+                record = parse_pic(prs);
+            else if (next->type == TOK_ID && ahead->keyword == KW_USAGE)
+                record = parse_comp_pic(prs);
+
+            if (record == NULL) {
+                log_error(prs->file, prs->tok->ln, prs->tok->col);
+                fprintf(stderr, "invalid record description '%s' in FILE SECTION\n", next->value);
+                show_error(prs->file, prs->tok->ln, prs->tok->col);
+                eat_until(prs, TOK_DOT);
+                continue;
+            }
+
+            astlist_push(root_ptr, record);
+
+            if (record->type == AST_PIC && fd->record == NULL) {
+                fd->record = find_variable(prs->file, record->pic.name);
+                fd->record->fd = fd;
+            }
+        } else {
             log_error(prs->file, prs->tok->ln, prs->tok->col);
             fprintf(stderr, "invalid clause '%s' in FILE SECTION\n", prs->tok->value);
             show_error(prs->file, prs->tok->ln, prs->tok->col);
@@ -3250,11 +4018,11 @@ void parse_file_section(Parser *prs) {
 
 /*
 void parse_data_division(Parser *prs, bool ignore_working_storage) {
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
         if (!expect_identifier(prs, NULL)) {
@@ -3262,18 +4030,18 @@ void parse_data_division(Parser *prs, bool ignore_working_storage) {
             continue;
         }
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
-        if (strcmp(prs->tok->value, "WORKING-STORAGE") == 0) {
+        if (prs->tok->keyword == KW_WORKING_STORAGE) {
             if (ignore_working_storage) {
 
                 !!WARNING THIS DOESNT WORK!!
 
-                while (!should_break_from(prs, "DIVISION") && !should_break_from(prs, "SECTION"))
+                while (!should_break_from(prs, KW_DIVISION) && !should_break_from(prs, KW_SECTION))
                     eat(prs, prs->tok->type);
 
-                if (strcmp(peek(prs, 1)->value, "DIVISION") == 0)
+                if (peek(prs, 1)->keyword == KW_DIVISION)
                     return;
 
                 // Found another section, parse it next.
@@ -3288,7 +4056,7 @@ void parse_data_division(Parser *prs, bool ignore_working_storage) {
                 parse_working_storage_section(prs);
             } else
                 eat_until(prs, TOK_DOT);
-        } elseif (strcmp(prs->tok->value, "FILE") == 0) {
+        } elseif (prs->tok->keyword == KW_FILE) {
             eat(prs, TOK_ID);
 
             if (expect_identifier(prs, "SECTION")) {
@@ -3345,22 +4113,22 @@ void parse_using_linkages(Parser *prs) {
 }
 
 void parse_procedure_division(Parser *prs) {
-    if (strcmp(prs->tok->value, "USING") == 0)
+    if (prs->tok->keyword == KW_USING)
         parse_using_linkages(prs);
 
     prs->in_main = true;
 
-    while (!should_break_from(prs, "DIVISION")) {
+    while (!should_break_from(prs, KW_DIVISION)) {
         while (prs->tok->type == TOK_DOT)
             eat(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
         if (!expect_identifier(prs, NULL))
             eat_until(prs, TOK_DOT);
 
-        if (should_break_from(prs, "DIVISION"))
+        if (should_break_from(prs, KW_DIVISION))
             break;
 
         AST *stmt = parse_procedure_stmt(prs, root_ptr);
@@ -3378,7 +4146,8 @@ void parse_division(Parser *prs) {
         return;
     }
 
-    char *division_name = mystrdup(prs->tok->value);
+    char *division_name = prs->tok->value;
+    const Keyword division = prs->tok->keyword;
     const size_t ln = prs->tok->ln;
     const size_t col = prs->tok->col;
     eat(prs, TOK_ID);
@@ -3386,22 +4155,26 @@ void parse_division(Parser *prs) {
     if (expect_identifier(prs, "DIVISION"))
         eat(prs, TOK_ID);
 
-    if (strcmp(division_name, "IDENTIFICATION") == 0)
-        parse_identification_division(prs);
-    else if (strcmp(division_name, "ENVIRONMENT") == 0)
-        parse_environment_division(prs);
-    //else if (strcmp(division_name, "DATA") == 0)
-      //  parse_data_division(prs, false);
-    else if (strcmp(division_name, "PROCEDURE") == 0)
-        parse_procedure_division(prs);
-    else {
-        log_error(prs->file, ln, col);
-        fprintf(stderr, "invalid division '%s'\n", division_name);
-        show_error(prs->file, ln, col);
+    switch (division) {
+        case KW_IDENTIFICATION:
+            parse_identification_division(prs);
+            break;
+        case KW_ENVIRONMENT:
+            parse_environment_division(prs);
+            break;
+        //case KW_DATA:
+          //  parse_data_division(prs, false);
+            //break;
+        case KW_PROCEDURE:
+            parse_procedure_division(prs);
+            break;
+        default:
+            log_error(prs->file, ln, col);
+            fprintf(stderr, "invalid division '%s'\n", division_name);
+            show_error(prs->file, ln, col);
+            break;
     }
 
-    free(division_name);
-
     while (prs->tok->type == TOK_DOT)
         eat(prs, TOK_DOT);
 }
@@ -3428,34 +4201,27 @@ AST *parse_stmt(Parser *prs) {
     return NOP(prs->tok->ln, prs->tok->col);
 }
 
-void eat_until_division(Parser *prs, char *name) {
-    while (prs->tok->type != TOK_EOF && (strcmp(prs->tok->value, name) != 0 || strcmp(peek(prs, 1)->value, "DIVISION") != 0)) {
-        if (prs->tok->type == TOK_ID)
-            eat(prs, TOK_ID);
-        else
-            eat_until(prs, TOK_ID);
-    }
-}
+// GO TO and PERFORM THRU can only name paragraphs of this program.
+void resolve_jump_targets() {
+    for (size_t i = 0; i < jump_targets.size; i++) {
+        AST *label = jump_targets.items[i];
+        Variable *var = symtab_lookup(&symbols, label->label);
 
-void eat_until_section(Parser *prs, char *name) {
-    while (prs->tok->type != TOK_EOF && (strcmp(prs->tok->value, name) != 0 || strcmp(peek(prs, 1)->value, "SECTION") != 0)) {
-        if (prs->tok->type == TOK_ID)
-            eat(prs, TOK_ID);
-        else
-            eat_until(prs, TOK_ID);
+        if (var == NULL || !var->used || !var->is_label) {
+            log_error(label->file, label->ln, label->col);
+            fprintf(stderr, "undefined paragraph '%s'\n", label->label);
+            show_error(label->file, label->ln, label->col);
+        }
     }
 }
 
-void parser_reset(Parser *prs) {
-    prs->pos = 0;
-    prs->tok = &prs->tokens[0];
-}
-
-AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
+AST *parse_file(char *file, char **main_infiles, bool *out_had_main, bool *out_uses_jumps) {
     *out_had_main = false;
-    cur_file = mystrdup(file);
+    jump_targets = create_astlist();
+    cur_file = arena_strdup(cur_arena, file);
     //delayed_assigns = create_astlist();
 
+    symbols = create_symtab(SYMTAB_INITIAL_SIZE);
     Parser prs = create_parser(file, main_infiles);
 
     AST *root = create_ast(AST_ROOT, 1, 1);
@@ -3463,7 +4229,7 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
     root_ptr = &root->root;
 
     // Parse the IDENTIFICATION DIVISION first for the PROGRAM-ID etc.
-    eat_until_division(&prs, "IDENTIFICATION");
+    jump_to(&prs, prs.division_pos[DIV_IDENTIFICATION]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
@@ -3473,9 +4239,7 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_identification_division(&prs);
     }
 
-    parser_reset(&prs);
-
-    eat_until_section(&prs, "LINKAGE");
+    jump_to(&prs, prs.section_pos[SECT_LINKAGE]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
@@ -3486,12 +4250,10 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_linkage_section(&prs);
     }
 
-    parser_reset(&prs);
-
     // Symbols from the WORKING-STORAGE SECTION can be referenced
     // in the DATA DIVISION before the WORKING-STORAGE SECTION,
     // e.g FILE SECTION, so we need to parse this first.
-    eat_until_section(&prs, "WORKING-STORAGE");
+    jump_to(&prs, prs.section_pos[SECT_WORKING_STORAGE]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
@@ -3502,9 +4264,7 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_working_storage_section(&prs);
     }
 
-    parser_reset(&prs);
-
-    eat_until_section(&prs, "FILE");
+    jump_to(&prs, prs.section_pos[SECT_FILE]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
@@ -3515,8 +4275,6 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_file_section(&prs);
     }
 
-    parser_reset(&prs);
-
     // Now make sure we have other symbols from the DATA DIVISION so
     // it can be used in other divisions, like INPUT-OUTPUT SECTION etc.
 
@@ -3526,19 +4284,17 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
     // data division individually, instead of parsing the whole division at once,
     // because redefining symbols are a problem.
     /*
-    eat_until_division(&prs, "DATA");
+    jump_to(&prs, prs.division_pos[DIV_DATA]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
         eat(&prs, TOK_ID);
         parse_data_division(&prs, true);
     }
-
-    parser_reset(&prs);
     */
 
     // Now we can parse FILE-CONTROL stuff if it is used.
-    eat_until_division(&prs, "ENVIRONMENT");
+    jump_to(&prs, prs.division_pos[DIV_ENVIRONMENT]);
 
     if (prs.tok->type != TOK_EOF) {
         eat(&prs, TOK_ID);
@@ -3548,10 +4304,8 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_environment_division(&prs);
     }
 
-    parser_reset(&prs);
-
     // Finally parse the actual program (PROCEDURE DIVISION is optional).
-    eat_until_division(&prs, "PROCEDURE");
+    jump_to(&prs, prs.division_pos[DIV_PROCEDURE]);
 
     if (prs.tok->type != TOK_EOF) {
         *out_had_main = true;
@@ -3559,7 +4313,35 @@ AST *parse_file(char *file, char **main_infiles, bool *out_had_main) {
         parse_division(&prs);
     }
 
+    resolve_jump_targets();
+    *out_uses_jumps = jump_targets.size > 0;
+
     delete_parser(&prs);
-    free(cur_file);
     return root;
 }
+
+// Adds what file's LINKAGE SECTION declares to names, without the 'LS-' the
+// generated C drops. Only the tokens are looked at, the file is parsed later.
+void collect_linkage_names(char *file, char **main_infiles, SymbolTable *names) {
+    Lexer lex = create_lexer(file, main_infiles);
+    Token prev = { .type = TOK_EOF, .keyword = KW_NONE };
+    Token tok;
+    bool in_linkage = false;
+
+    while ((tok = lex_next_token(&lex)).type != TOK_EOF) {
+        if (tok.keyword == KW_SECTION || tok.keyword == KW_DIVISION)
+            in_linkage = prev.keyword == KW_LINKAGE;
+        else if (in_linkage && prev.type == TOK_INT && tok.type == TOK_ID && tok.keyword == KW_NONE) {
+            char *name = tok.value;
+
+            if (strlen(name) > 3 && strncmp(name, "LS-", 3) == 0)
+                name += 3;
+
+            symtab_get(names, name)->used = true;
+        }
+
+        prev = tok;
+    }
+
+    delete_lexer(&lex);
+}
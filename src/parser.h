@@ -3,6 +3,7 @@
 
 #include "token.h"
 #include "ast.h"
+#include "symtab.h"
 #include <stdio.h>
 #include <stdbool.h>
 
@@ -11,7 +12,8 @@ typedef enum {
     DIV_IDENTIFICATION,
     DIV_ENVIRONMENT,
     DIV_DATA,
-    DIV_PROCEDURE
+    DIV_PROCEDURE,
+    DIV_COUNT
 } Division;
 
 typedef enum {
@@ -19,7 +21,8 @@ typedef enum {
     SECT_INPUT_OUTPUT,
     SECT_FILE,
     SECT_LINKAGE,
-    SECT_WORKING_STORAGE
+    SECT_WORKING_STORAGE,
+    SECT_COUNT
 } Section;
 
 typedef struct {
@@ -34,10 +37,23 @@ typedef struct {
     Section cur_sect;
     bool parse_extra_value;
     bool in_set;
+
+    // Token positions of the first header of each DIVISION and SECTION,
+    // recorded while lexing. Missing headers point at the EOF token.
+    size_t division_pos[DIV_COUNT];
+    size_t section_pos[SECT_COUNT];
 } Parser;
 
+// Most digits a numeric picture can have, like ISO COBOL 2002.
+#define MAX_NUMERIC_DIGITS 31
+
 Variable *get_struct_sym(AST *ast);
 PictureType get_value_type(AST *ast);
-AST *parse_file(char *file, char **main_files, bool *out_had_main);
+bool is_fixed_point(PictureType *type);
+bool is_packed(PictureType *type);
+bool is_wide_numeric(PictureType *type);
+bool is_long_integer(AST *value);
+AST *parse_file(char *file, char **main_files, bool *out_had_main, bool *out_uses_jumps);
+void collect_linkage_names(char *file, char **main_infiles, SymbolTable *names);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,340 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+// For wait4(), which returns the resources of the child it waited for.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+#endif
+
+#include "process.h"
+#include "utils.h"
+#include "error.h"
+#include "report.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+extern char **environ;
+#endif
+
+extern unsigned int max_jobs;
+
+typedef struct {
+#ifndef _WIN32
+    pid_t pid;
+#endif
+    char *infile;
+    char *source; // Removed once the job is done, NULL to keep it.
+    Timer timer;
+} Job;
+
+static Job jobs[MAX_JOBS];
+static size_t running = 0;
+
+// For jobs that never ran, or ran on Windows where nothing is measured.
+static Usage no_usage;
+
+ArgList create_arglist() {
+    ArgList list = { .args = malloc(16 * sizeof(char *)), .count = 0, .cap = 16 };
+    list.args[0] = NULL;
+    return list;
+}
+
+void delete_arglist(ArgList *list) {
+    for (size_t i = 0; i < list->count; i++)
+        free(list->args[i]);
+
+    free(list->args);
+}
+
+void arglist_push(ArgList *list, char *arg) {
+    // Keep room for the NULL terminator execvp() wants.
+    if (list->count + 2 > list->cap) {
+        list->cap *= 2;
+        list->args = realloc(list->args, list->cap * sizeof(char *));
+    }
+
+    list->args[list->count++] = mystrdup(arg);
+    list->args[list->count] = NULL;
+}
+
+// Pushes each space separated word of args, for flag strings like "-std=c99 -O1".
+void arglist_push_split(ArgList *list, char *args) {
+    char *copy = mystrdup(args);
+
+    for (char *tok = strtok(copy, " "); tok != NULL; tok = strtok(NULL, " "))
+        arglist_push(list, tok);
+
+    free(copy);
+}
+
+// Joins the arguments into one shell command line.
+static char *join_args(ArgList *list) {
+    size_t len = 1;
+
+    for (size_t i = 0; i < list->count; i++)
+        len += strlen(list->args[i]) + 1;
+
+    char *cmd = calloc(len, sizeof(char));
+
+    for (size_t i = 0; i < list->count; i++) {
+        if (i > 0)
+            strcat(cmd, " ");
+
+        strcat(cmd, list->args[i]);
+    }
+
+    return cmd;
+}
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+
+static int run_shell(ArgList *list) {
+    char *cmd = join_args(list);
+    int status = system(cmd);
+    free(cmd);
+    return status;
+}
+#else
+static pid_t spawn(ArgList *list, posix_spawn_file_actions_t *actions) {
+    pid_t pid;
+
+    if (posix_spawnp(&pid, list->args[0], actions, NULL, list->args, environ) != 0) {
+        log_error(NULL, 0, 0);
+        fprintf(stderr, "failed to run '%s'\n", list->args[0]);
+        return -1;
+    }
+
+    return pid;
+}
+
+static Usage child_usage(struct rusage *ru) {
+    Usage usage = { .cpu = ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6 + ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6 };
+
+#ifdef __APPLE__
+    // Bytes rather than kilobytes.
+    usage.peak_rss = ru->ru_maxrss / 1024;
+#else
+    usage.peak_rss = ru->ru_maxrss;
+#endif
+
+    return usage;
+}
+
+static int wait_for(pid_t pid, Usage *usage) {
+    struct rusage ru;
+    int status;
+
+    if (wait4(pid, &status, 0, &ru) == -1)
+        return EXIT_FAILURE;
+
+    *usage = child_usage(&ru);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+#endif
+
+// Runs a command and waits for it to exit, returns its exit status. usage gets what the
+// command alone used, it stays zero on Windows.
+int run_command(ArgList *list, Usage *usage) {
+    *usage = (Usage){ 0 };
+
+#ifdef _WIN32
+    return run_shell(list);
+#else
+    const pid_t pid = spawn(list, NULL);
+    return pid == -1 ? EXIT_FAILURE : wait_for(pid, usage);
+#endif
+}
+
+// Runs a command and returns everything it wrote to stdout, or NULL if it couldn't be run.
+char *command_output(ArgList *list) {
+    char *cmd = join_args(list);
+    FILE *pipe = popen(cmd, "r");
+    free(cmd);
+
+    if (pipe == NULL)
+        return NULL;
+
+    size_t len = 0;
+    size_t cap = 256;
+    char *output = malloc(cap);
+    size_t n;
+
+    while ((n = fread(output + len, 1, cap - len - 1, pipe)) > 0) {
+        len += n;
+
+        if (cap - len - 1 == 0)
+            output = realloc(output, cap *= 2);
+    }
+
+    output[len] = '\0';
+
+    if (pclose(pipe) != 0) {
+        free(output);
+        return NULL;
+    }
+
+    return output;
+}
+
+static int finish_job(Job *job, int status, Usage *usage) {
+    report_job(job->infile, &job->timer, usage);
+
+    if (job->source != NULL && remove(job->source) != 0) {
+        log_error(job->infile, 0, 0);
+        fprintf(stderr, "failed to remove '%s'\n", job->source);
+    }
+
+    if (status != 0) {
+        log_error(job->infile, 0, 0);
+        fprintf(stderr, "failed to compile\n");
+    }
+
+    free(job->source);
+    return status != 0 ? 1 : 0;
+}
+
+#ifndef _WIN32
+// Waits for any running job to exit, returns 1 if it failed.
+static int reap_job() {
+    struct rusage ru;
+    int status;
+    pid_t pid;
+
+    // The rusage is the reaped job's own, other jobs running alongside don't add to it.
+    while ((pid = wait4(-1, &status, 0, &ru)) != -1) {
+        for (size_t i = 0; i < running; i++) {
+            if (jobs[i].pid != pid)
+                continue;
+
+            Job job = jobs[i];
+            jobs[i] = jobs[--running];
+            Usage usage = child_usage(&ru);
+            return finish_job(&job, WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE, &usage);
+        }
+    }
+
+    // No children left, shouldn't happen while jobs are running.
+    running = 0;
+    return 1;
+}
+#endif
+
+static int failed_jobs = 0;
+
+// Starts compiling a file in the background, blocking while max_jobs are already running.
+// source is owned by the job and removed once it's done.
+void start_job(ArgList *list, char *infile, char *source) {
+    Job job = { .infile = infile, .source = source, .timer = start_timer() };
+
+#ifdef _WIN32
+    failed_jobs += finish_job(&job, run_shell(list), &no_usage);
+#else
+    while (running > 0 && running >= max_jobs)
+        failed_jobs += reap_job();
+
+    if ((job.pid = spawn(list, NULL)) == -1) {
+        failed_jobs += finish_job(&job, EXIT_FAILURE, &no_usage);
+        return;
+    }
+
+    jobs[running++] = job;
+#endif
+}
+
+#ifdef _WIN32
+static char *piped_infile;
+#endif
+
+// Starts compiling a file that reads its source from stdin, returns the stream to write the
+// source to, or NULL if the job couldn't be started. The stream has to be closed with close_job_input().
+FILE *start_piped_job(ArgList *list, char *infile) {
+    Job job = { .infile = infile, .source = NULL, .timer = start_timer() };
+
+#ifdef _WIN32
+    char *cmd = join_args(list);
+    FILE *in = popen(cmd, "w");
+    free(cmd);
+
+    if (in == NULL) {
+        failed_jobs += finish_job(&job, EXIT_FAILURE, &no_usage);
+        return NULL;
+    }
+
+    piped_infile = infile;
+    return in;
+#else
+    while (running > 0 && running >= max_jobs)
+        failed_jobs += reap_job();
+
+    int fds[2];
+
+    if (pipe(fds) != 0) {
+        failed_jobs += finish_job(&job, EXIT_FAILURE, &no_usage);
+        return NULL;
+    }
+
+    // Jobs started later mustn't inherit the write end, or this one never sees EOF.
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+
+    job.pid = spawn(list, &actions);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[0]);
+
+    if (job.pid == -1) {
+        close(fds[1]);
+        failed_jobs += finish_job(&job, EXIT_FAILURE, &no_usage);
+        return NULL;
+    }
+
+    // A compiler that exits early shouldn't take cobc down with it, the job reports the failure.
+    signal(SIGPIPE, SIG_IGN);
+    jobs[running++] = job;
+
+    FILE *in = fdopen(fds[1], "w");
+
+    if (in == NULL)
+        close(fds[1]);
+
+    return in;
+#endif
+}
+
+// Ends the source of a piped job, it keeps compiling in the background.
+void close_job_input(FILE *in) {
+#ifdef _WIN32
+    Job job = { .infile = piped_infile, .source = NULL, .timer = start_timer() };
+    failed_jobs += finish_job(&job, pclose(in), &no_usage);
+#else
+    fclose(in);
+#endif
+}
+
+// Waits for every job to finish, returns how many of them failed.
+int wait_for_jobs() {
+#ifndef _WIN32
+    while (running > 0)
+        failed_jobs += reap_job();
+#endif
+
+    const int failed = failed_jobs;
+    failed_jobs = 0;
+    return failed;
+}
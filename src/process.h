@@ -0,0 +1,28 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include "report.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+#define MAX_JOBS 256
+
+typedef struct {
+    char **args;
+    size_t count;
+    size_t cap;
+} ArgList;
+
+ArgList create_arglist();
+void delete_arglist(ArgList *list);
+void arglist_push(ArgList *list, char *arg);
+void arglist_push_split(ArgList *list, char *args);
+
+int run_command(ArgList *list, Usage *usage);
+char *command_output(ArgList *list);
+void start_job(ArgList *list, char *infile, char *source);
+FILE *start_piped_job(ArgList *list, char *infile);
+void close_job_input(FILE *in);
+int wait_for_jobs();
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "report.h"
+#include "arena.h"
+#include "error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+typedef struct {
+    double wall;
+    double cpu;
+    long peak_rss; // In kilobytes.
+} PhaseStats;
+
+typedef struct {
+    char *infile;
+    bool cached;
+    PhaseStats phases[PHASE_COUNT];
+    size_t tokens;
+    size_t ast_nodes;
+    size_t bytes_emitted;
+
+    bool has_memory;
+    size_t allocations;
+    size_t bytes_allocated;
+    size_t blocks;
+    size_t bytes_reserved;
+} FileReport;
+
+static const char *phase_names[PHASE_COUNT] = { "lex", "parse", "emit", "cc", "link", "run" };
+
+static FileReport *reports;
+static size_t report_count;
+static size_t report_cap;
+
+// Phases that belong to the whole build, and counters from outside any file.
+static FileReport build;
+static Timer build_timer;
+
+// Index into reports of the file being compiled, report_count if none.
+static size_t current;
+
+static double wall_time() {
+    struct timespec ts;
+
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// CPU time of cobc and every child it has waited for.
+static double cpu_time() {
+#ifdef _WIN32
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct rusage self;
+    struct rusage children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    return self.ru_utime.tv_sec + self.ru_utime.tv_usec / 1e6 + self.ru_stime.tv_sec + self.ru_stime.tv_usec / 1e6 +
+        children.ru_utime.tv_sec + children.ru_utime.tv_usec / 1e6 + children.ru_stime.tv_sec + children.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+static long peak_rss() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+    // Bytes rather than kilobytes.
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+Timer start_timer() {
+    return (Timer){ .wall = wall_time(), .cpu = cpu_time() };
+}
+
+static FileReport *current_report() {
+    return current < report_count ? &reports[current] : &build;
+}
+
+void start_reports() {
+    free(reports);
+    reports = NULL;
+    report_count = report_cap = 0;
+    current = 0;
+    memset(&build, 0, sizeof(build));
+    build_timer = start_timer();
+}
+
+void report_file(char *infile, bool cached) {
+    if (report_count == report_cap) {
+        report_cap = report_cap == 0 ? 16 : report_cap * 2;
+        reports = realloc(reports, report_cap * sizeof(FileReport));
+    }
+
+    memset(&reports[report_count], 0, sizeof(FileReport));
+    reports[report_count].infile = infile;
+    reports[report_count].cached = cached;
+    current = report_count++;
+}
+
+static void add_phase(FileReport *report, Phase phase, double wall, double cpu, long rss) {
+    PhaseStats *stats = &report->phases[phase];
+    stats->wall += wall;
+    stats->cpu += cpu;
+
+    if (rss > stats->peak_rss)
+        stats->peak_rss = rss;
+}
+
+void report_phase(Phase phase, Timer *timer) {
+    FileReport *report = phase >= PHASE_LINK ? &build : current_report();
+    double wall = wall_time() - timer->wall;
+    double cpu = cpu_time() - timer->cpu;
+
+    // parse_file() lexes the file and its copybooks itself.
+    if (phase == PHASE_PARSE) {
+        wall -= report->phases[PHASE_LEX].wall;
+        cpu -= report->phases[PHASE_LEX].cpu;
+    }
+
+    add_phase(report, phase, wall, cpu, peak_rss());
+}
+
+// Linking or running the executable, the CPU time and RSS are the child's alone.
+void report_child(Phase phase, Timer *timer, Usage *usage) {
+    add_phase(&build, phase, wall_time() - timer->wall, usage->cpu, usage->peak_rss);
+}
+
+// A gcc job has been waited for, it's timed from spawn to reap but the CPU time
+// and RSS are its own, not those of the jobs that ran alongside it.
+void report_job(char *infile, Timer *timer, Usage *usage) {
+    FileReport *report = &build;
+
+    for (size_t i = 0; i < report_count; i++) {
+        if (reports[i].infile == infile || strcmp(reports[i].infile, infile) == 0) {
+            report = &reports[i];
+            break;
+        }
+    }
+
+    add_phase(report, PHASE_CC, wall_time() - timer->wall, usage->cpu, usage->peak_rss);
+}
+
+void report_tokens(size_t count) {
+    current_report()->tokens += count;
+}
+
+void report_ast_node() {
+    current_report()->ast_nodes++;
+}
+
+void report_emitted(size_t bytes) {
+    current_report()->bytes_emitted += bytes;
+}
+
+void report_memory(Arena *arena) {
+    FileReport *report = current_report();
+    report->has_memory = true;
+    report->allocations = arena->allocations;
+    report->bytes_allocated = arena->bytes_used;
+    report->blocks = arena->block_count;
+    report->bytes_reserved = arena->bytes_reserved;
+}
+
+static double tokens_per_second(FileReport *report) {
+    const double wall = report->phases[PHASE_LEX].wall;
+    return wall > 0.0 ? report->tokens / wall : 0.0;
+}
+
+static void print_phases(FileReport *report, Phase first, Phase last) {
+    fprintf(stderr, "    phase               wall ms     cpu ms  peak rss kB\n");
+
+    for (Phase phase = first; phase <= last; phase++) {
+        PhaseStats *stats = &report->phases[phase];
+        fprintf(stderr, "    %-16s %10.3f %10.3f %12ld\n", phase_names[phase], stats->wall * 1000.0, stats->cpu * 1000.0, stats->peak_rss);
+    }
+}
+
+static void print_report(double total_wall, double total_cpu) {
+    for (size_t i = 0; i < report_count; i++) {
+        FileReport *report = &reports[i];
+        fprintf(stderr, "cobc: time report for '%s':\n", report->infile);
+
+        if (report->cached) {
+            fprintf(stderr, "    cached, nothing was compiled\n");
+            continue;
+        }
+
+        print_phases(report, PHASE_LEX, PHASE_CC);
+        fprintf(stderr, "    tokens              %zu (%.0f per second)\n"
+                        "    ast nodes           %zu\n"
+                        "    bytes emitted       %zu\n", report->tokens, tokens_per_second(report), report->ast_nodes, report->bytes_emitted);
+    }
+
+    fprintf(stderr, "cobc: time report for the build:\n");
+    print_phases(&build, PHASE_LINK, PHASE_RUN);
+    fprintf(stderr, "    %-16s %10.3f %10.3f %12ld\n", "total", total_wall * 1000.0, total_cpu * 1000.0, peak_rss());
+}
+
+static void write_json_string(FILE *out, char *str) {
+    fputc('"', out);
+
+    for (char *c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf(out, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(out, "\\u%04x", (unsigned char)*c);
+        else
+            fputc(*c, out);
+    }
+
+    fputc('"', out);
+}
+
+static void write_json_phases(FILE *out, FileReport *report, Phase first, Phase last) {
+    fprintf(out, "\"phases\": {");
+
+    for (Phase phase = first; phase <= last; phase++) {
+        PhaseStats *stats = &report->phases[phase];
+        fprintf(out, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld}", phase == first ? "" : ", ",
+                phase_names[phase], stats->wall * 1000.0, stats->cpu * 1000.0, stats->peak_rss);
+    }
+
+    fputc('}', out);
+}
+
+static bool write_json(char *path, double total_wall, double total_cpu) {
+    FILE *out = fopen(path, "w");
+
+    if (out == NULL)
+        return false;
+
+    fprintf(out, "{\"version\": 1, \"files\": [");
+
+    for (size_t i = 0; i < report_count; i++) {
+        FileReport *report = &reports[i];
+        fprintf(out, "%s\n  {\"file\": ", i == 0 ? "" : ",");
+        write_json_string(out, report->infile);
+        fprintf(out, ", \"cached\": %s, \"tokens\": %zu, \"tokens_per_second\": %.0f, \"ast_nodes\": %zu, \"bytes_emitted\": %zu, ",
+                report->cached ? "true" : "false", report->tokens, tokens_per_second(report), report->ast_nodes, report->bytes_emitted);
+
+        if (report->has_memory)
+            fprintf(out, "\"memory\": {\"allocations\": %zu, \"bytes_allocated\": %zu, \"blocks\": %zu, \"bytes_reserved\": %zu}, ",
+                    report->allocations, report->bytes_allocated, report->blocks, report->bytes_reserved);
+
+        write_json_phases(out, report, PHASE_LEX, PHASE_CC);
+        fputc('}', out);
+    }
+
+    fprintf(out, "\n], \"build\": {");
+    write_json_phases(out, &build, PHASE_LINK, PHASE_RUN);
+    fprintf(out, ", \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld}}}\n", total_wall * 1000.0, total_cpu * 1000.0, peak_rss());
+
+    return fclose(out) == 0;
+}
+
+bool finish_reports(bool print, char *json_path) {
+    const double total_wall = wall_time() - build_timer.wall;
+    const double total_cpu = cpu_time() - build_timer.cpu;
+    bool ok = true;
+
+    if (print)
+        print_report(total_wall, total_cpu);
+
+    if (json_path != NULL && !write_json(json_path, total_wall, total_cpu)) {
+        log_error(NULL, 0, 0);
+        fprintf(stderr, "failed to write report to '%s'\n", json_path);
+        ok = false;
+    }
+
+    free(reports);
+    reports = NULL;
+    return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "arena.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+typedef enum {
+    // Per input file.
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_EMIT,
+    PHASE_CC,
+
+    // Once per build.
+    PHASE_LINK,
+    PHASE_RUN,
+    PHASE_COUNT
+} Phase;
+
+// A point in time to measure a phase from.
+typedef struct {
+    double wall;
+    double cpu;
+} Timer;
+
+// What a child process used by itself, taken when it was waited for.
+typedef struct {
+    double cpu;
+    long peak_rss; // In kilobytes.
+} Usage;
+
+Timer start_timer();
+
+void start_reports();
+void report_file(char *infile, bool cached);
+void report_phase(Phase phase, Timer *timer);
+void report_job(char *infile, Timer *timer, Usage *usage);
+void report_child(Phase phase, Timer *timer, Usage *usage);
+void report_tokens(size_t count);
+void report_ast_node();
+void report_emitted(size_t bytes);
+void report_memory(Arena *arena);
+
+// Prints the -ftime-report to stderr and writes the JSON report to json_path
+// when they are not NULL, returns false if the JSON couldn't be written.
+bool finish_reports(bool print, char *json_path);
+
+#endif
@@ -0,0 +1,76 @@
+#include "symtab.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+extern Arena *cur_arena;
+
+static uint32_t hash_FNV1a(const char *data) {
+    uint32_t h = 2166136261UL;
+
+    for (; *data != '\0'; data++) {
+        h ^= (unsigned char)*data;
+        h *= 16777619;
+    }
+
+    return h;
+}
+
+// Returns the slot holding name, or the empty slot it would go in.
+static Symbol *find_slot(SymbolTable *table, char *name, uint32_t hash) {
+    // Capacity is always a power of two.
+    const size_t mask = table->cap - 1;
+
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Symbol *slot = &table->slots[i];
+
+        if (slot->var == NULL || (slot->hash == hash && strcmp(slot->var->name, name) == 0))
+            return slot;
+    }
+}
+
+static void grow(SymbolTable *table) {
+    Symbol *old_slots = table->slots;
+    const size_t old_cap = table->cap;
+
+    // The arena hands back zeroed memory, so every new slot starts empty.
+    table->cap *= 2;
+    table->slots = arena_alloc(cur_arena, table->cap * sizeof(Symbol));
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_slots[i].var != NULL)
+            *find_slot(table, old_slots[i].var->name, old_slots[i].hash) = old_slots[i];
+    }
+}
+
+SymbolTable create_symtab(size_t cap) {
+    assert(cap > 0 && (cap & (cap - 1)) == 0);
+    return (SymbolTable){ .slots = arena_alloc(cur_arena, cap * sizeof(Symbol)), .cap = cap, .count = 0 };
+}
+
+Variable *symtab_lookup(SymbolTable *table, char *name) {
+    return find_slot(table, name, hash_FNV1a(name))->var;
+}
+
+Variable *symtab_get(SymbolTable *table, char *name) {
+    const uint32_t hash = hash_FNV1a(name);
+    Symbol *slot = find_slot(table, name, hash);
+
+    if (slot->var != NULL)
+        return slot->var;
+
+    // Keep the load factor under 3/4.
+    if ((table->count + 1) * 4 > table->cap * 3) {
+        grow(table);
+        slot = find_slot(table, name, hash);
+    }
+
+    slot->hash = hash;
+    slot->var = arena_alloc(cur_arena, sizeof(Variable));
+    *slot->var = (Variable){ .name = name, .used = false };
+    table->count++;
+    return slot->var;
+}
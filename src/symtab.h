@@ -0,0 +1,27 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include "ast.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#define SYMTAB_INITIAL_SIZE 256
+
+typedef struct {
+    uint32_t hash;
+    Variable *var;
+} Symbol;
+
+// Open addressing table keyed by variable name. One is created per
+// compiled file (copybooks share their parent's) out of the current arena.
+typedef struct {
+    Symbol *slots;
+    size_t cap;
+    size_t count;
+} SymbolTable;
+
+SymbolTable create_symtab(size_t cap);
+Variable *symtab_lookup(SymbolTable *table, char *name);
+Variable *symtab_get(SymbolTable *table, char *name);
+
+#endif
@@ -5,11 +5,7 @@
 #include <assert.h>
 
 Token create_token(TokenType type, char *value, size_t ln, size_t col) {
-    return (Token){ .type = type, .value = value, .ln = ln, .col = col };
-}
-
-void delete_token(Token *tok) {
-    free(tok->value);
+    return (Token){ .type = type, .keyword = KW_NONE, .value = value, .ln = ln, .col = col };
 }
 
 char *tokentype_to_string(TokenType type) {
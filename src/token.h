@@ -1,6 +1,7 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "keyword.h"
 #include <stdio.h>
 
 typedef enum {
@@ -32,13 +33,13 @@ typedef enum {
 
 typedef struct {
     TokenType type;
+    Keyword keyword; // KW_NONE unless the token is a reserved word.
     char *value;
     size_t ln;
     size_t col;
 } Token;
 
 Token create_token(TokenType type, char *value, size_t ln, size_t col);
-void delete_token(Token *tok);
 char *tokentype_to_string(TokenType type);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "ast.h"
 #include "utils.h"
 #include "parser.h"
+#include "buffer.h"
+#include "symtab.h"
+#include "compile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,21 +14,125 @@
 #include <inttypes.h>
 
 #define INCLUDE_LIBS "#define _RED_COBOL_SOURCE\n#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n#include <stdbool.h>\n#include <assert.h>\n#include <stdint.h>\n#include <ctype.h>\n#include <inttypes.h>\n#include <limits.h>\n#include <errno.h>\n"
-#define INCLUDE_LIBS_LEN strlen(INCLUDE_LIBS)
 
-#define IS_STRING(ttype) ((ttype.type == TYPE_ALPHABETIC || ttype.type == TYPE_ALPHANUMERIC) && ttype.count > 0)
-
-static char *globals;
-static size_t globals_len;
-static size_t globals_cap;
+// Runtime for fixed point decimals, only added to files that use it.
+#define FIXED_TO_STRING "static char fixed_strings[4][64];\nstatic unsigned int fixed_string_next;\nstatic char *fixed_to_string(int64_t value, unsigned int width, unsigned int scale, bool suppress) {\nchar *str = fixed_strings[fixed_string_next++ % 4];\nchar digits[24];\nunsigned int count = 0;\nuint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;\ndo {\ndigits[count++] = '0' + magnitude % 10;\nmagnitude /= 10;\n} while (magnitude > 0 || count <= scale);\nunsigned int low = 0;\nif (suppress)\nwhile (low < scale && digits[low] == '0')\nlow++;\nunsigned int len = (value < 0) + count - scale + (low < scale ? scale - low + 1 : 0);\nsize_t pos = 0;\nif (value < 0)\nstr[pos++] = '-';\nfor (; !suppress && len < width && len < 40; len++)\nstr[pos++] = '0';\nfor (unsigned int i = count; i > scale; i--)\nstr[pos++] = digits[i - 1];\nif (low < scale) {\nstr[pos++] = '.';\nfor (unsigned int i = scale; i > low; i--)\nstr[pos++] = digits[i - 1];\n}\nstr[pos] = '\\0';\nreturn str;\n}\n"
+#define STRING_TO_FIXED "static int64_t string_to_fixed(char *str, unsigned int scale, char **end) {\nchar *c = str;\nwhile (isspace((unsigned char)*c))\nc++;\nconst bool negative = *c == '-';\nif (*c == '-' || *c == '+')\nc++;\nint64_t value = 0;\nunsigned int places = 0;\nbool digits = false;\nfor (; isdigit((unsigned char)*c); c++, digits = true)\nvalue = value * 10 + (*c - '0');\nif (*c == '.')\nfor (c++; isdigit((unsigned char)*c); c++, digits = true)\nif (places < scale) {\nvalue = value * 10 + (*c - '0');\nplaces++;\n}\nfor (; places < scale; places++)\nvalue *= 10;\n*end = digits ? c : str;\nreturn negative ? -value : value;\n}\n"
+
+
+// The same for numbers past 18 digits, printf has nothing for __int128. The
+// digits are cut into 19 digit chunks so most of the work is 64 bit.
+#define WIDE_TO_STRING "static char wide_strings[4][64];\nstatic unsigned int wide_string_next;\nstatic char *wide_to_string(__int128 value, unsigned int digits, unsigned int scale, bool suppress) {\nchar *str = wide_strings[wide_string_next++ % 4];\nchar text[48];\nunsigned int count = 0;\nunsigned __int128 magnitude = value < 0 ? -(unsigned __int128)value : (unsigned __int128)value;\ndo {\nuint64_t part = (uint64_t)(magnitude % 10000000000000000000u);\nmagnitude /= 10000000000000000000u;\nfor (unsigned int i = 0; i < 19 && (part > 0 || magnitude > 0); i++) {\ntext[count++] = '0' + part % 10;\npart /= 10;\n}\n} while (magnitude > 0);\nwhile (count <= scale)\ntext[count++] = '0';\nunsigned int low = 0;\nif (suppress)\nwhile (low < scale && text[low] == '0')\nlow++;\nif (value < 0 && scale > 0 && digits > 0)\ndigits--;\nsize_t pos = 0;\nif (value < 0)\nstr[pos++] = '-';\nfor (unsigned int i = count - scale; !suppress && i < digits; i++)\nstr[pos++] = '0';\nfor (unsigned int i = count; i > scale; i--)\nstr[pos++] = text[i - 1];\nif (low < scale) {\nstr[pos++] = '.';\nfor (unsigned int i = scale; i > low; i--)\nstr[pos++] = text[i - 1];\n}\nstr[pos] = '\\0';\nreturn str;\n}\n"
+#define STRING_TO_WIDE "static __int128 string_to_wide(char *str, unsigned int scale, char **end) {\nchar *c = str;\nwhile (isspace((unsigned char)*c))\nc++;\nconst bool negative = *c == '-';\nif (*c == '-' || *c == '+')\nc++;\n__int128 value = 0;\nunsigned int places = 0;\nbool digits = false;\nfor (; isdigit((unsigned char)*c); c++, digits = true)\nvalue = value * 10 + (*c - '0');\nif (*c == '.')\nfor (c++; isdigit((unsigned char)*c); c++, digits = true)\nif (places < scale) {\nvalue = value * 10 + (*c - '0');\nplaces++;\n}\nfor (; places < scale; places++)\nvalue *= 10;\n*end = digits ? c : str;\nreturn negative ? -value : value;\n}\n"
+
+
+// Packed decimal kernels. Bytes go through the packed_value and packed_byte
+// tables two digits at a time, emit_root() adds those in front. Adding,
+// comparing and printing work on the bytes, only arithmetic that isn't
+// one packed item to another converts to binary.
+#define PACKED_ARITHMETIC "static bool packed_negative(const uint8_t *p, unsigned int digits) {\nconst uint8_t sign = p[digits / 2] & 0x0F;\nreturn sign == 0x0D || sign == 0x0B;\n}\nstatic bool packed_zero(const uint8_t *p, unsigned int digits) {\nif (p[digits / 2] >> 4)\nreturn false;\nfor (unsigned int i = 0; i < digits / 2; i++)\nif (p[i])\nreturn false;\nreturn true;\n}\nstatic unsigned int packed_pair(const uint8_t *p, unsigned int last, unsigned int j) {\nreturn j > last ? 0 : j == 0 ? (unsigned int)(p[last] >> 4) : packed_value[p[last - j]];\n}\nstatic int packed_compare_magnitude(const uint8_t *a, unsigned int a_digits, const uint8_t *b, unsigned int b_digits) {\nfor (unsigned int j = (a_digits > b_digits ? a_digits : b_digits) / 2 + 1; j-- > 0;) {\nconst unsigned int x = packed_pair(a, a_digits / 2, j);\nconst unsigned int y = packed_pair(b, b_digits / 2, j);\nif (x != y)\nreturn x < y ? -1 : 1;\n}\nreturn 0;\n}\nstatic int packed_compare(const uint8_t *a, unsigned int a_digits, const uint8_t *b, unsigned int b_digits) {\nconst bool a_negative = packed_negative(a, a_digits) && !packed_zero(a, a_digits);\nconst bool b_negative = packed_negative(b, b_digits) && !packed_zero(b, b_digits);\nif (a_negative != b_negative)\nreturn a_negative ? -1 : 1;\nconst int magnitude = packed_compare_magnitude(a, a_digits, b, b_digits);\nreturn a_negative ? -magnitude : magnitude;\n}\nstatic void packed_add(uint8_t *dst, unsigned int dst_digits, bool is_signed, const uint8_t *src, unsigned int src_digits, bool subtract) {\nconst bool dst_negative = packed_negative(dst, dst_digits);\nconst bool src_negative = packed_negative(src, src_digits) != subtract;\nconst bool add = dst_negative == src_negative;\nconst bool swap = !add && packed_compare_magnitude(dst, dst_digits, src, src_digits) < 0;\nconst uint8_t *x = swap ? src : dst;\nconst uint8_t *y = swap ? dst : src;\nconst unsigned int x_last = (swap ? src_digits : dst_digits) / 2;\nconst unsigned int y_last = (swap ? dst_digits : src_digits) / 2;\nconst unsigned int last = dst_digits / 2;\nconst bool negative = swap ? src_negative : dst_negative;\nint carry = 0;\nfor (unsigned int j = 0; j <= last; j++) {\nconst int base = j == 0 ? 10 : 100;\nint v = (int)packed_pair(x, x_last, j) + (add ? (int)packed_pair(y, y_last, j) : -(int)packed_pair(y, y_last, j)) + carry;\ncarry = v >= base ? 1 : v < 0 ? -1 : 0;\nv -= carry * base;\nif (j == 0)\ndst[last] = (uint8_t)(v << 4 | (dst[last] & 0x0F));\nelse\ndst[last - j] = packed_byte[v];\n}\nif (dst_digits % 2 == 0)\ndst[0] &= 0x0F;\ndst[last] = (dst[last] & 0xF0) | (!is_signed ? 0x0F : negative && !packed_zero(dst, dst_digits) ? 0x0D : 0x0C);\n}\n"
+#define PACKED_CONVERSIONS "static char packed_strings[4][48];\nstatic unsigned int packed_string_next;\nstatic char *packed_to_string(const uint8_t *p, unsigned int digits, unsigned int scale, bool suppress) {\nchar *str = packed_strings[packed_string_next++ % 4];\nchar text[40];\nconst unsigned int pad = digits % 2 == 0;\nfor (unsigned int i = 0; i < digits; i++) {\nconst unsigned int k = i + pad;\ntext[i] = '0' + (k % 2 == 0 ? p[k / 2] >> 4 : p[k / 2] & 0x0F);\n}\nconst unsigned int point = digits - scale;\nunsigned int first = 0;\nunsigned int end = digits;\nsize_t pos = 0;\nconst bool negative = packed_negative(p, digits) && !packed_zero(p, digits);\nif (suppress) {\nwhile (first + 1 < point && text[first] == '0')\nfirst++;\nwhile (end > point && text[end - 1] == '0')\nend--;\n} else if (negative && scale > 0 && point > 1 && text[0] == '0')\nfirst = 1;\nif (negative)\nstr[pos++] = '-';\nif (point == 0)\nstr[pos++] = '0';\nfor (unsigned int i = first; i < point; i++)\nstr[pos++] = text[i];\nif (end > point) {\nstr[pos++] = '.';\nfor (unsigned int i = point; i < end; i++)\nstr[pos++] = text[i];\n}\nstr[pos] = '\\0';\nreturn str;\n}\n#define PACKED_CONVERT(bits, type, unsigned_type) \\\nstatic type packed_to_int##bits(const uint8_t *p, unsigned int digits) {\\\nconst unsigned int last = digits / 2;\\\ntype value = 0;\\\nfor (unsigned int i = 0; i < last; i++)\\\nvalue = value * 100 + packed_value[p[i]];\\\nvalue = value * 10 + (p[last] >> 4);\\\nreturn packed_negative(p, digits) ? -value : value;\\\n}\\\nstatic void packed_from_int##bits(uint8_t *p, type value, unsigned int digits, bool is_signed) {\\\nconst unsigned int last = digits / 2;\\\nunsigned_type magnitude = value < 0 ? -(unsigned_type)value : (unsigned_type)value;\\\np[last] = (uint8_t)(magnitude % 10 << 4);\\\nmagnitude /= 10;\\\nfor (unsigned int i = last; i-- > 0; magnitude /= 100)\\\np[i] = packed_byte[magnitude % 100];\\\nif (digits % 2 == 0)\\\np[0] &= 0x0F;\\\np[last] |= !is_signed ? 0x0F : value < 0 && !packed_zero(p, digits) ? 0x0D : 0x0C;\\\n}\nPACKED_CONVERT(64, int64_t, uint64_t)\nPACKED_CONVERT(128, __int128, unsigned __int128)\n"
+
+
+// DISPLAY formats into a line buffer with these instead of printf, so no
+// format string is parsed at runtime. Integers go two digits at a time.
+#define DISPLAY_FORMATTERS "static const char display_pairs[] = \"00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899\";\nstatic const uint64_t display_powers[19] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL};\nstatic char *display_uint(char *d, uint64_t value, unsigned int width) {\nchar digits[20];\nchar *p = digits + sizeof(digits);\nfor (; value >= 100; value /= 100) {\np -= 2;\nmemcpy(p, display_pairs + value % 100 * 2, 2);\n}\nif (value >= 10) {\np -= 2;\nmemcpy(p, display_pairs + value * 2, 2);\n} else\n*--p = (char)('0' + value);\nconst size_t len = (size_t)(digits + sizeof(digits) - p);\nfor (; width > len; width--)\n*d++ = '0';\nmemcpy(d, p, len);\nreturn d + len;\n}\nstatic char *display_int(char *d, int64_t value, unsigned int width) {\nif (value < 0) {\n*d++ = '-';\nreturn display_uint(d, -(uint64_t)value, width);\n}\nreturn display_uint(d, (uint64_t)value, width);\n}\nstatic char *display_fixed(char *d, int64_t value, unsigned int width, unsigned int scale) {\nconst uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;\nconst unsigned int used = scale + 1 + (value < 0);\nif (value < 0)\n*d++ = '-';\nd = display_uint(d, magnitude / display_powers[scale], width > used ? width - used : 1);\n*d++ = '.';\nreturn display_uint(d, magnitude % display_powers[scale], scale);\n}\nstatic char *display_string(char *d, const char *str, size_t max) {\nconst char *end = memchr(str, '\\0', max);\nconst size_t len = end == NULL ? max : (size_t)(end - str);\nmemcpy(d, str, len);\nreturn d + len;\n}\n"
+
+
+// Every FD gets one of these next to its FILE pointer. Line sequential READ
+// takes lines out of large blocks, memchr() finds the newlines and each line
+// is copied once, what doesn't fit the record is skipped. Sequential files
+// move fixed length records in and out of whole blocks of them, anything
+// still buffered is written on CLOSE or at exit.
+#define FILE_BUFFER "#define FILE_BLOCK_SIZE (1 << 20)\ntypedef struct FileBuffer {\nFILE *file;\nchar *block;\nsize_t start;\nsize_t end;\nbool writing;\nbool listed;\nstruct FileBuffer *next;\n} FileBuffer;\nstatic FileBuffer *open_files;\nstatic void file_flush(FileBuffer *f) {\nif (f->writing && f->end > 0 && fwrite(f->block, 1, f->end, f->file) != f->end)\ncobol_error();\nf->start = f->end = 0;\n}\nstatic void file_flush_all(void) {\nfor (FileBuffer *f = open_files; f != NULL; f = f->next) {\nif (f->file != NULL)\nfile_flush(f);\n}\n}\nstatic void file_open(FileBuffer *f, FILE *file) {\nif (open_files == NULL)\natexit(file_flush_all);\nif (!f->listed) {\nf->next = open_files;\nopen_files = f;\nf->listed = true;\n}\nf->file = file;\nf->start = f->end = 0;\nf->writing = false;\n}\nstatic void file_close(FileBuffer *f) {\nif (f->file != NULL)\nfile_flush(f);\nfree(f->block);\nf->block = NULL;\nf->file = NULL;\n}\nstatic char *file_block(FileBuffer *f) {\nif (f->block == NULL && (f->block = malloc(FILE_BLOCK_SIZE)) == NULL)\ncobol_error();\nreturn f->block;\n}\nstatic char *line_read(FileBuffer *f, char *dst, size_t max) {\nsize_t len = 0;\nsize_t total = 0;\nbool found = false;\nif (f->file == NULL)\nreturn NULL;\nfor (;;) {\nif (f->start == f->end) {\nf->start = 0;\nf->end = fread(file_block(f), 1, FILE_BLOCK_SIZE, f->file);\nif (f->end == 0)\nbreak;\n}\nconst char *begin = f->block + f->start;\nconst char *newline = memchr(begin, '\\n', f->end - f->start);\nconst size_t n = newline == NULL ? f->end - f->start : (size_t)(newline - begin);\nconst size_t copy = n < max - len ? n : max - len;\nmemcpy(dst + len, begin, copy);\nlen += copy;\ntotal += n;\nf->start += n;\nfound = true;\nif (newline != NULL) {\nf->start++;\nbreak;\n}\n}\nif (!found)\nreturn NULL;\nif (total == len && len > 0 && dst[len - 1] == '\\r')\nlen--;\ndst[len] = '\\0';\nreturn dst;\n}\nstatic bool record_read(FileBuffer *f, void (*unpack)(const char *), size_t size) {\nif (f->file == NULL)\nreturn false;\nif (size > FILE_BLOCK_SIZE) {\nchar *record = malloc(size);\nif (record == NULL)\ncobol_error();\nconst size_t n = fread(record, 1, size, f->file);\nmemset(record + n, ' ', size - n);\nif (n > 0)\nunpack(record);\nfree(record);\nreturn n > 0;\n}\nif (f->start == f->end) {\nf->start = 0;\nf->end = fread(file_block(f), 1, FILE_BLOCK_SIZE / size * size, f->file);\nif (f->end == 0)\nreturn false;\n}\nchar *record = f->block + f->start;\nif (f->end - f->start < size) {\nmemset(record + (f->end - f->start), ' ', size - (f->end - f->start));\nf->end = f->start + size;\n}\nunpack(record);\nf->start += size;\nreturn true;\n}\nstatic void record_write(FileBuffer *f, void (*pack)(char *), size_t size) {\nif (f->file == NULL)\nreturn;\nf->writing = true;\nif (size > FILE_BLOCK_SIZE - f->end)\nfile_flush(f);\nif (size > FILE_BLOCK_SIZE) {\nchar *record = malloc(size);\nif (record == NULL)\ncobol_error();\npack(record);\nif (fwrite(record, 1, size, f->file) != size)\ncobol_error();\nfree(record);\nreturn;\n}\npack(file_block(f) + f->end);\nf->end += size;\n}\nstatic void record_move(void *dst, size_t dst_size, const void *src, size_t src_size) {\nmemcpy(dst, src, dst_size < src_size ? dst_size : src_size);\nif (dst_size > src_size)\nmemset((char *)dst + src_size, 0, dst_size - src_size);\n}\n"
+
+// Sequential and relative records are stored the way COBOL lays them out, not
+// as their C structs: PIC X(n) is n characters padded with spaces, DISPLAY
+// numbers are zoned digits with the sign overpunched on the last one, BINARY
+// is big-endian and everything else is its bytes. Each record gets a pack and
+// an unpack function built from these, see emit_record_layout(). Indexed
+// files keep the struct, the B+tree compares keys where they sit in the
+// record with memcmp() or as native integers.
+#define RECORD_LAYOUT "static char *text_pack(char *p, const char *s, size_t n) {\nconst char *end = memchr(s, '\\0', n);\nconst size_t len = end == NULL ? n : (size_t)(end - s);\nmemcpy(p, s, len);\nmemset(p + len, ' ', n - len);\nreturn p + n;\n}\nstatic const char *text_unpack(const char *p, char *s, size_t n) {\nsize_t len = n;\nwhile (len > 0 && p[len - 1] == ' ')\nlen--;\nmemcpy(s, p, len);\nmemset(s + len, '\\0', n + 1 - len);\nreturn p + n;\n}\nstatic char *bytes_pack(char *p, const void *v, size_t n) {\nmemcpy(p, v, n);\nreturn p + n;\n}\nstatic const char *bytes_unpack(const char *p, void *v, size_t n) {\nmemcpy(v, p, n);\nreturn p + n;\n}\nstatic char *binary_pack(char *p, const void *v, size_t n) {\nconst uint16_t one = 1;\nconst unsigned char *b = v;\nfor (size_t i = 0; i < n; i++)\np[i] = (char)(*(const unsigned char *)&one ? b[n - 1 - i] : b[i]);\nreturn p + n;\n}\nstatic const char *binary_unpack(const char *p, void *v, size_t n) {\nconst uint16_t one = 1;\nunsigned char *b = v;\nfor (size_t i = 0; i < n; i++)\nb[i] = (unsigned char)(*(const unsigned char *)&one ? p[n - 1 - i] : p[i]);\nreturn p + n;\n}\nstatic int zoned_digit(char c, bool *negative) {\nif (c >= '0' && c <= '9')\nreturn c - '0';\nelse if (c >= 'p' && c <= 'y') {\n*negative = true;\nreturn c - 'p';\n} else if (c >= 'A' && c <= 'I')\nreturn c - 'A' + 1;\nelse if (c >= 'J' && c <= 'R') {\n*negative = true;\nreturn c - 'J' + 1;\n} else if (c == '}' || c == '-')\n*negative = true;\nreturn 0;\n}\nstatic char *zoned_pack(char *p, int64_t value, size_t n, bool sign) {\nuint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;\nfor (size_t i = n; i > 0; i--) {\np[i - 1] = (char)('0' + magnitude % 10);\nmagnitude /= 10;\n}\nif (sign && value < 0 && n > 0)\np[n - 1] += 'p' - '0';\nreturn p + n;\n}\nstatic int64_t zoned_unpack(const char *p, size_t n) {\nbool negative = false;\nuint64_t magnitude = 0;\nfor (size_t i = 0; i < n; i++)\nmagnitude = magnitude * 10 + zoned_digit(p[i], &negative);\nreturn negative ? -(int64_t)magnitude : (int64_t)magnitude;\n}\n"
+#define RECORD_LAYOUT_WIDE "static char *zoned_pack_wide(char *p, __int128 value, size_t n, bool sign) {\nunsigned __int128 magnitude = value < 0 ? -(unsigned __int128)value : (unsigned __int128)value;\nfor (size_t i = n; i > 0; i--) {\np[i - 1] = (char)('0' + (int)(magnitude % 10));\nmagnitude /= 10;\n}\nif (sign && value < 0 && n > 0)\np[n - 1] += 'p' - '0';\nreturn p + n;\n}\nstatic __int128 zoned_unpack_wide(const char *p, size_t n) {\nbool negative = false;\nunsigned __int128 magnitude = 0;\nfor (size_t i = 0; i < n; i++)\nmagnitude = magnitude * 10 + zoned_digit(p[i], &negative);\nreturn negative ? -(__int128)magnitude : (__int128)magnitude;\n}\n"
+
+// Indexed files are a B+tree of fixed size pages in one file, page 0 holds
+// the header. Leaves keep whole records sorted by the record key and link to
+// the next leaf for READ NEXT, branches keep separator keys and child pages.
+// Pages go through a small LRU pool and are written back when evicted, on
+// CLOSE or at exit. DELETE doesn't merge pages, a leaf can end up empty.
+#define INDEX_PAGES "#define INDEX_MAGIC 0x58494352u\n#define INDEX_FRAMES 64\n#define INDEX_LEAF 1\n#define INDEX_BRANCH 2\ntypedef struct {\nuint32_t magic;\nuint32_t page_size;\nuint32_t record_size;\nuint32_t key_offset;\nuint32_t key_size;\nuint32_t key_type;\nuint32_t root;\nuint32_t pages;\nuint64_t records;\n} IndexHeader;\ntypedef struct {\nchar *data;\nuint32_t page;\nuint32_t used;\nbool dirty;\n} IndexFrame;\ntypedef struct IndexFile {\nFILE *file;\nIndexHeader header;\nIndexFrame frames[INDEX_FRAMES];\nuint32_t tick;\nuint32_t leaf_capacity;\nuint32_t branch_capacity;\nuint32_t version;\nuint32_t cursor_leaf;\nuint32_t cursor_slot;\nuint32_t cursor_version;\nbool cursor_first;\nbool cursor_inclusive;\nbool writable;\nbool listed;\nchar *cursor_key;\nchar *split_key;\nchar *scratch;\nstruct IndexFile *next;\n} IndexFile;\nstatic IndexFile *open_indexes;\nstatic int index_compare(const IndexFile *ix, const char *a, const char *b) {\nif (ix->header.key_type == 0)\nreturn memcmp(a, b, ix->header.key_size);\nint64_t x = 0, y = 0;\nuint64_t ux = 0, uy = 0;\nswitch (ix->header.key_size) {\ncase 1: { int8_t s, t; memcpy(&s, a, 1); memcpy(&t, b, 1); x = s; y = t; ux = (uint8_t)s; uy = (uint8_t)t; break; }\ncase 2: { int16_t s, t; memcpy(&s, a, 2); memcpy(&t, b, 2); x = s; y = t; ux = (uint16_t)s; uy = (uint16_t)t; break; }\ncase 4: { int32_t s, t; memcpy(&s, a, 4); memcpy(&t, b, 4); x = s; y = t; ux = (uint32_t)s; uy = (uint32_t)t; break; }\ndefault: memcpy(&x, a, 8); memcpy(&y, b, 8); memcpy(&ux, a, 8); memcpy(&uy, b, 8); break;\n}\nif (ix->header.key_type == 2)\nreturn (x > y) - (x < y);\nreturn (ux > uy) - (ux < uy);\n}\nstatic void index_write_frame(IndexFile *ix, IndexFrame *frame) {\nif (fseek(ix->file, (long)frame->page * (long)ix->header.page_size, SEEK_SET) != 0 || fwrite(frame->data, 1, ix->header.page_size, ix->file) != ix->header.page_size)\ncobol_error();\nframe->dirty = false;\n}\nstatic IndexFrame *index_frame(IndexFile *ix, uint32_t page) {\nIndexFrame *victim = &ix->frames[0];\nfor (size_t i = 0; i < INDEX_FRAMES; i++) {\nIndexFrame *frame = &ix->frames[i];\nif (frame->data != NULL && frame->page == page) {\nframe->used = ++ix->tick;\nreturn frame;\n}\nif (frame->used < victim->used)\nvictim = frame;\n}\nif (victim->data == NULL && (victim->data = malloc(ix->header.page_size)) == NULL)\ncobol_error();\nelse if (victim->dirty)\nindex_write_frame(ix, victim);\nvictim->page = page;\nvictim->used = ++ix->tick;\nmemset(victim->data, 0, ix->header.page_size);\nif (fseek(ix->file, (long)page * (long)ix->header.page_size, SEEK_SET) == 0 && fread(victim->data, 1, ix->header.page_size, ix->file) == 0)\nclearerr(ix->file);\nreturn victim;\n}\nstatic char *index_page(IndexFile *ix, uint32_t page, bool dirty) {\nIndexFrame *frame = index_frame(ix, page);\nframe->dirty |= dirty;\nreturn frame->data;\n}\nstatic uint16_t index_count(const char *page) {\nuint16_t count;\nmemcpy(&count, page + 2, 2);\nreturn count;\n}\nstatic void index_set_count(char *page, uint16_t count) {\nmemcpy(page + 2, &count, 2);\n}\nstatic uint32_t index_link(const char *page, size_t i) {\nuint32_t link;\nmemcpy(&link, page + 4 + i * 4, 4);\nreturn link;\n}\nstatic void index_set_link(char *page, size_t i, uint32_t link) {\nmemcpy(page + 4 + i * 4, &link, 4);\n}\nstatic char *index_record(IndexFile *ix, char *leaf, size_t i) {\nreturn leaf + 8 + i * ix->header.record_size;\n}\nstatic char *index_key(IndexFile *ix, char *branch, size_t i) {\nreturn branch + 4 + (ix->branch_capacity + 1) * 4 + i * ix->header.key_size;\n}\nstatic uint32_t index_new_page(IndexFile *ix, uint16_t type) {\nconst uint32_t page = ix->header.pages++;\nchar *data = index_page(ix, page, true);\nmemset(data, 0, ix->header.page_size);\nmemcpy(data, &type, 2);\nreturn page;\n}\n"
+#define INDEX_SEARCH "static uint16_t index_type(const char *page) {\nuint16_t type;\nmemcpy(&type, page, 2);\nreturn type;\n}\nstatic uint32_t index_descend(IndexFile *ix, const char *key, uint32_t *path, size_t *depth) {\nuint32_t page = ix->header.root;\n*depth = 0;\nfor (;;) {\nchar *data = index_page(ix, page, false);\nif (index_type(data) != INDEX_BRANCH)\nreturn page;\nsize_t low = 0, high = index_count(data);\nwhile (low < high) {\nconst size_t mid = (low + high) / 2;\nif (index_compare(ix, key, index_key(ix, data, mid)) >= 0)\nlow = mid + 1;\nelse\nhigh = mid;\n}\nif (*depth < 32)\npath[(*depth)++] = page;\npage = index_link(data, low);\n}\n}\nstatic size_t index_search(IndexFile *ix, char *leaf, const char *key) {\nsize_t low = 0, high = index_count(leaf);\nwhile (low < high) {\nconst size_t mid = (low + high) / 2;\nif (index_compare(ix, index_record(ix, leaf, mid) + ix->header.key_offset, key) < 0)\nlow = mid + 1;\nelse\nhigh = mid;\n}\nreturn low;\n}\n"
+#define INDEX_INSERT "static void index_grow(IndexFile *ix, uint32_t *path, size_t depth, uint32_t child) {\nconst size_t key_size = ix->header.key_size;\nwhile (depth > 0) {\nconst uint32_t page = path[--depth];\nchar *data = index_page(ix, page, true);\nconst size_t count = index_count(data);\nsize_t pos = 0;\nwhile (pos < count && index_compare(ix, ix->split_key, index_key(ix, data, pos)) >= 0)\npos++;\nif (count < ix->branch_capacity) {\nmemmove(index_key(ix, data, pos + 1), index_key(ix, data, pos), (count - pos) * key_size);\nmemcpy(index_key(ix, data, pos), ix->split_key, key_size);\nmemmove(data + 4 + (pos + 2) * 4, data + 4 + (pos + 1) * 4, (count - pos) * 4);\nindex_set_link(data, pos + 1, child);\nindex_set_count(data, (uint16_t)(count + 1));\nreturn;\n}\nchar *keys = ix->scratch;\nchar *links = ix->scratch + (count + 1) * key_size;\nmemcpy(keys, index_key(ix, data, 0), pos * key_size);\nmemcpy(keys + pos * key_size, ix->split_key, key_size);\nmemcpy(keys + (pos + 1) * key_size, index_key(ix, data, pos), (count - pos) * key_size);\nmemcpy(links, data + 4, (pos + 1) * 4);\nmemcpy(links + (pos + 1) * 4, &child, 4);\nmemcpy(links + (pos + 2) * 4, data + 4 + (pos + 1) * 4, (count - pos) * 4);\nconst size_t mid = (count + 1) / 2;\nconst uint32_t right = index_new_page(ix, INDEX_BRANCH);\nchar *right_data = index_page(ix, right, true);\ndata = index_page(ix, page, true);\nmemcpy(index_key(ix, data, 0), keys, mid * key_size);\nmemcpy(data + 4, links, (mid + 1) * 4);\nindex_set_count(data, (uint16_t)mid);\nmemcpy(index_key(ix, right_data, 0), keys + (mid + 1) * key_size, (count - mid) * key_size);\nmemcpy(right_data + 4, links + (mid + 1) * 4, (count - mid + 1) * 4);\nindex_set_count(right_data, (uint16_t)(count - mid));\nmemcpy(ix->split_key, keys + mid * key_size, key_size);\nchild = right;\n}\nconst uint32_t root = index_new_page(ix, INDEX_BRANCH);\nchar *data = index_page(ix, root, true);\nindex_set_link(data, 0, ix->header.root);\nindex_set_link(data, 1, child);\nmemcpy(index_key(ix, data, 0), ix->split_key, key_size);\nindex_set_count(data, 1);\nix->header.root = root;\n}\nstatic const char *index_write(IndexFile *ix, const void *record) {\nconst size_t size = ix->header.record_size;\nconst char *key = (const char *)record + ix->header.key_offset;\nuint32_t path[32];\nsize_t depth;\nif (ix->file == NULL || !ix->writable)\nreturn \"48\";\nconst uint32_t leaf = index_descend(ix, key, path, &depth);\nchar *data = index_page(ix, leaf, true);\nsize_t count = index_count(data);\nsize_t pos = index_search(ix, data, key);\nif (pos < count && index_compare(ix, index_record(ix, data, pos) + ix->header.key_offset, key) == 0)\nreturn \"22\";\nix->version++;\nix->header.records++;\nif (count == ix->leaf_capacity) {\nconst size_t half = pos == count && index_link(data, 0) == 0 ? count : count / 2;\nconst uint32_t right = index_new_page(ix, INDEX_LEAF);\nchar *right_data = index_page(ix, right, true);\ndata = index_page(ix, leaf, true);\nmemcpy(index_record(ix, right_data, 0), index_record(ix, data, half), (count - half) * size);\nindex_set_count(right_data, (uint16_t)(count - half));\nindex_set_link(right_data, 0, index_link(data, 0));\nindex_set_link(data, 0, right);\nindex_set_count(data, (uint16_t)half);\nif (pos > half || half == count) {\npos -= half;\ndata = right_data;\n}\ncount = index_count(data);\nmemmove(index_record(ix, data, pos + 1), index_record(ix, data, pos), (count - pos) * size);\nmemcpy(index_record(ix, data, pos), record, size);\nindex_set_count(data, (uint16_t)(count + 1));\nmemcpy(ix->split_key, index_record(ix, right_data, 0) + ix->header.key_offset, ix->header.key_size);\nindex_grow(ix, path, depth, right);\nreturn \"00\";\n}\nmemmove(index_record(ix, data, pos + 1), index_record(ix, data, pos), (count - pos) * size);\nmemcpy(index_record(ix, data, pos), record, size);\nindex_set_count(data, (uint16_t)(count + 1));\nreturn \"00\";\n}\n"
+#define INDEX_OPERATIONS "static char *index_find(IndexFile *ix, const char *key, uint32_t *leaf, size_t *pos) {\nuint32_t path[32];\nsize_t depth;\n*leaf = index_descend(ix, key, path, &depth);\nchar *data = index_page(ix, *leaf, false);\n*pos = index_search(ix, data, key);\nif (*pos < index_count(data) && index_compare(ix, index_record(ix, data, *pos) + ix->header.key_offset, key) == 0)\nreturn data;\nreturn NULL;\n}\nstatic const char *index_read(IndexFile *ix, void *record) {\nuint32_t leaf;\nsize_t pos;\nif (ix->file == NULL)\nreturn \"47\";\nchar *data = index_find(ix, (char *)record + ix->header.key_offset, &leaf, &pos);\nif (data == NULL)\nreturn \"23\";\nmemcpy(record, index_record(ix, data, pos), ix->header.record_size);\nmemcpy(ix->cursor_key, (char *)record + ix->header.key_offset, ix->header.key_size);\nix->cursor_first = ix->cursor_inclusive = false;\nix->cursor_leaf = leaf;\nix->cursor_slot = (uint32_t)pos + 1;\nix->cursor_version = ix->version;\nreturn \"00\";\n}\nstatic const char *index_rewrite(IndexFile *ix, const void *record) {\nuint32_t leaf;\nsize_t pos;\nif (ix->file == NULL || !ix->writable)\nreturn \"49\";\nif (index_find(ix, (const char *)record + ix->header.key_offset, &leaf, &pos) == NULL)\nreturn \"23\";\nmemcpy(index_record(ix, index_page(ix, leaf, true), pos), record, ix->header.record_size);\nreturn \"00\";\n}\nstatic const char *index_delete(IndexFile *ix, const void *record) {\nuint32_t leaf;\nsize_t pos;\nif (ix->file == NULL || !ix->writable)\nreturn \"49\";\nif (index_find(ix, (const char *)record + ix->header.key_offset, &leaf, &pos) == NULL)\nreturn \"23\";\nchar *data = index_page(ix, leaf, true);\nconst size_t count = index_count(data);\nmemmove(index_record(ix, data, pos), index_record(ix, data, pos + 1), (count - pos - 1) * ix->header.record_size);\nindex_set_count(data, (uint16_t)(count - 1));\nix->header.records--;\nix->version++;\nreturn \"00\";\n}\nstatic void index_seek(IndexFile *ix) {\nuint32_t path[32];\nsize_t depth;\nif (ix->cursor_first) {\nuint32_t page = ix->header.root;\nchar *data = index_page(ix, page, false);\nwhile (index_type(data) == INDEX_BRANCH) {\npage = index_link(data, 0);\ndata = index_page(ix, page, false);\n}\nix->cursor_leaf = page;\nix->cursor_slot = 0;\n} else {\nix->cursor_leaf = index_descend(ix, ix->cursor_key, path, &depth);\nchar *data = index_page(ix, ix->cursor_leaf, false);\nsize_t pos = index_search(ix, data, ix->cursor_key);\nif (!ix->cursor_inclusive && pos < index_count(data) && index_compare(ix, index_record(ix, data, pos) + ix->header.key_offset, ix->cursor_key) == 0)\npos++;\nix->cursor_slot = (uint32_t)pos;\n}\nix->cursor_version = ix->version;\n}\nstatic char *index_cursor(IndexFile *ix) {\nif (ix->cursor_version != ix->version)\nindex_seek(ix);\nfor (;;) {\nchar *data = index_page(ix, ix->cursor_leaf, false);\nif (ix->cursor_slot < index_count(data))\nreturn index_record(ix, data, ix->cursor_slot);\nconst uint32_t next = index_link(data, 0);\nif (next == 0)\nreturn NULL;\nix->cursor_leaf = next;\nix->cursor_slot = 0;\n}\n}\nstatic const char *index_start(IndexFile *ix, const void *record, int relation) {\nconst char *key = (const char *)record + ix->header.key_offset;\nif (ix->file == NULL)\nreturn \"47\";\nmemcpy(ix->cursor_key, key, ix->header.key_size);\nix->cursor_first = false;\nix->cursor_inclusive = relation != '>';\nindex_seek(ix);\nconst char *found = index_cursor(ix);\nif (found == NULL || (relation == '=' && index_compare(ix, found + ix->header.key_offset, key) != 0))\nreturn \"23\";\nreturn \"00\";\n}\nstatic const char *index_next(IndexFile *ix, void *record) {\nif (ix->file == NULL)\nreturn \"47\";\nconst char *found = index_cursor(ix);\nif (found == NULL)\nreturn \"10\";\nmemcpy(record, found, ix->header.record_size);\nmemcpy(ix->cursor_key, found + ix->header.key_offset, ix->header.key_size);\nix->cursor_first = ix->cursor_inclusive = false;\nix->cursor_slot++;\nreturn \"00\";\n}\n"
+#define INDEX_OPEN "static void index_close(IndexFile *ix) {\nif (ix->file == NULL)\nreturn;\nfor (size_t i = 0; i < INDEX_FRAMES; i++) {\nif (ix->frames[i].dirty)\nindex_write_frame(ix, &ix->frames[i]);\nfree(ix->frames[i].data);\nix->frames[i].data = NULL;\nix->frames[i].used = 0;\n}\nif (ix->writable && (fseek(ix->file, 0, SEEK_SET) != 0 || fwrite(&ix->header, sizeof(ix->header), 1, ix->file) != 1))\ncobol_error();\nfclose(ix->file);\nix->file = NULL;\nfree(ix->cursor_key);\nfree(ix->split_key);\nfree(ix->scratch);\n}\nstatic void index_close_all(void) {\nfor (IndexFile *ix = open_indexes; ix != NULL; ix = ix->next)\nindex_close(ix);\n}\nstatic FILE *index_open(IndexFile *ix, const char *name, int mode, size_t record_size, size_t key_offset, size_t key_size, unsigned int key_type) {\nIndexHeader header = { INDEX_MAGIC, 4096, (uint32_t)record_size, (uint32_t)key_offset, (uint32_t)key_size, key_type, 0, 1, 0 };\nFILE *file = mode == 1 ? NULL : fopen(name, mode == 0 ? \"rb\" : \"r+b\");\nindex_close(ix);\nif (file == NULL && mode != 0)\nfile = fopen(name, \"w+b\");\nif (file == NULL)\nreturn NULL;\nif (fread(&ix->header, sizeof(ix->header), 1, file) == 1) {\nif (ix->header.magic != INDEX_MAGIC || ix->header.record_size != record_size || ix->header.key_offset != key_offset || ix->header.key_size != key_size || ix->header.key_type != key_type) {\nfclose(file);\nreturn NULL;\n}\n} else if (mode == 0) {\nfclose(file);\nreturn NULL;\n} else {\nwhile ((header.page_size - 8) / record_size < 4 || (header.page_size - 8) / (key_size + 4) < 4)\nheader.page_size *= 2;\nix->header = header;\n}\nif (!ix->listed) {\nif (open_indexes == NULL)\natexit(index_close_all);\nix->next = open_indexes;\nopen_indexes = ix;\nix->listed = true;\n}\nix->file = file;\nix->writable = mode != 0;\nix->tick = ix->version = 0;\nix->leaf_capacity = (ix->header.page_size - 8) / ix->header.record_size;\nix->branch_capacity = (ix->header.page_size - 8) / (ix->header.key_size + 4);\nif (ix->leaf_capacity > UINT16_MAX)\nix->leaf_capacity = UINT16_MAX;\nif (ix->branch_capacity > UINT16_MAX)\nix->branch_capacity = UINT16_MAX;\nix->cursor_key = malloc(key_size);\nix->split_key = malloc(key_size);\nix->scratch = malloc((ix->branch_capacity + 1) * key_size + (ix->branch_capacity + 2) * 4);\nif (ix->cursor_key == NULL || ix->split_key == NULL || ix->scratch == NULL)\ncobol_error();\nif (ix->header.root == 0)\nix->header.root = index_new_page(ix, INDEX_LEAF);\nix->cursor_first = true;\nix->cursor_version = UINT32_MAX;\nreturn file;\n}\n"
+
+// Relative files put record N at (N - 1) * record size, so every access is
+// one seek and one unbuffered read or write of the packed record. Which slots hold a record is a
+// bitmap kept in memory and saved next to the file as <name>.map, a file
+// without one has a record in every whole slot.
+#define RELATIVE_FILE "typedef struct RelativeFile {\nFILE *file;\nchar *map_name;\nuint8_t *bits;\nsize_t bytes;\nuint64_t slot;\nuint64_t cursor;\nsize_t record_size;\nchar *record;\nbool writable;\nbool dirty;\nbool listed;\nstruct RelativeFile *next;\n} RelativeFile;\nstatic RelativeFile *open_relatives;\nstatic bool relative_used(const RelativeFile *rf, uint64_t slot) {\nreturn slot > 0 && (slot - 1) / 8 < rf->bytes && (rf->bits[(slot - 1) / 8] >> ((slot - 1) % 8) & 1);\n}\nstatic void relative_mark(RelativeFile *rf, uint64_t slot, bool used) {\nconst size_t byte = (size_t)((slot - 1) / 8);\nif (byte >= rf->bytes) {\nsize_t bytes = rf->bytes < 64 ? 64 : rf->bytes;\nwhile (bytes <= byte)\nbytes *= 2;\nuint8_t *bits = realloc(rf->bits, bytes);\nif (bits == NULL)\ncobol_error();\nmemset(bits + rf->bytes, 0, bytes - rf->bytes);\nrf->bits = bits;\nrf->bytes = bytes;\n}\nif (used)\nrf->bits[byte] |= (uint8_t)(1 << (slot - 1) % 8);\nelse\nrf->bits[byte] &= (uint8_t)~(1 << (slot - 1) % 8);\nrf->dirty = true;\n}\nstatic uint64_t relative_find(const RelativeFile *rf, uint64_t slot) {\nuint64_t i = slot > 0 ? slot - 1 : 0;\nwhile (i / 8 < rf->bytes) {\nif (rf->bits[i / 8] == 0)\ni = (i / 8 + 1) * 8;\nelse if (rf->bits[i / 8] >> (i % 8) & 1)\nreturn i + 1;\nelse\ni++;\n}\nreturn 0;\n}\nstatic bool relative_seek(RelativeFile *rf, uint64_t slot) {\nreturn slot > 0 && slot <= (uint64_t)LONG_MAX / rf->record_size && fseek(rf->file, (long)((slot - 1) * rf->record_size), SEEK_SET) == 0;\n}\nstatic const char *relative_read(RelativeFile *rf, void (*unpack)(const char *), uint64_t slot) {\nif (rf->file == NULL)\nreturn \"47\";\nelse if (!relative_used(rf, slot))\nreturn \"23\";\nelse if (!relative_seek(rf, slot) || fread(rf->record, 1, rf->record_size, rf->file) != rf->record_size)\nreturn \"30\";\nunpack(rf->record);\nrf->slot = slot;\nrf->cursor = slot + 1;\nreturn \"00\";\n}\nstatic const char *relative_put(RelativeFile *rf, void (*pack)(char *), uint64_t slot, bool rewrite) {\nif (rf->file == NULL || !rf->writable)\nreturn rewrite ? \"49\" : \"48\";\nelse if (relative_used(rf, slot) != rewrite)\nreturn rewrite ? \"23\" : \"22\";\nelse if (!relative_seek(rf, slot))\nreturn \"24\";\npack(rf->record);\nif (fwrite(rf->record, 1, rf->record_size, rf->file) != rf->record_size)\nreturn \"30\";\nrelative_mark(rf, slot, true);\nrf->slot = slot;\nreturn \"00\";\n}\nstatic const char *relative_write(RelativeFile *rf, void (*pack)(char *), uint64_t slot) {\nreturn relative_put(rf, pack, slot, false);\n}\nstatic const char *relative_rewrite(RelativeFile *rf, void (*pack)(char *), uint64_t slot) {\nreturn relative_put(rf, pack, slot, true);\n}\nstatic const char *relative_delete(RelativeFile *rf, const void *record, uint64_t slot) {\n(void)record;\nif (rf->file == NULL || !rf->writable)\nreturn \"49\";\nelse if (!relative_used(rf, slot))\nreturn \"23\";\nrelative_mark(rf, slot, false);\nrf->slot = slot;\nreturn \"00\";\n}\nstatic const char *relative_start(RelativeFile *rf, const void *record, uint64_t slot, int relation) {\n(void)record;\nif (rf->file == NULL)\nreturn \"47\";\nconst uint64_t found = relative_find(rf, relation == '>' ? slot + 1 : slot);\nif (found == 0 || (relation == '=' && found != slot))\nreturn \"23\";\nrf->cursor = found;\nreturn \"00\";\n}\nstatic const char *relative_next(RelativeFile *rf, void (*unpack)(const char *)) {\nif (rf->file == NULL)\nreturn \"47\";\nconst uint64_t found = relative_find(rf, rf->cursor);\nreturn found == 0 ? \"10\" : relative_read(rf, unpack, found);\n}\n"
+#define RELATIVE_OPEN "static void relative_close(RelativeFile *rf) {\nif (rf->file == NULL)\nreturn;\nif (rf->writable && rf->dirty) {\nsize_t bytes = rf->bytes;\nwhile (bytes > 0 && rf->bits[bytes - 1] == 0)\nbytes--;\nFILE *map = fopen(rf->map_name, \"wb\");\nif (map == NULL || (bytes > 0 && fwrite(rf->bits, 1, bytes, map) != bytes))\ncobol_error();\nfclose(map);\n}\nfclose(rf->file);\nfree(rf->bits);\nfree(rf->map_name);\nfree(rf->record);\nrf->file = NULL;\nrf->bits = NULL;\nrf->map_name = NULL;\nrf->record = NULL;\nrf->bytes = 0;\n}\nstatic void relative_close_all(void) {\nfor (RelativeFile *rf = open_relatives; rf != NULL; rf = rf->next)\nrelative_close(rf);\n}\nstatic void relative_load(RelativeFile *rf) {\nFILE *map = fopen(rf->map_name, \"rb\");\nlong size;\nif (map == NULL) {\nif (fseek(rf->file, 0, SEEK_END) == 0 && (size = ftell(rf->file)) > 0) {\nfor (uint64_t slot = (uint64_t)size / rf->record_size; slot > 0; slot--)\nrelative_mark(rf, slot, true);\n}\nrf->dirty = false;\nreturn;\n}\nif (fseek(map, 0, SEEK_END) == 0 && (size = ftell(map)) > 0) {\nrf->bits = malloc((size_t)size);\nrf->bytes = (size_t)size;\nif (rf->bits == NULL || fseek(map, 0, SEEK_SET) != 0 || fread(rf->bits, 1, rf->bytes, map) != rf->bytes)\ncobol_error();\n}\nfclose(map);\n}\nstatic FILE *relative_open(RelativeFile *rf, const char *name, int mode, size_t record_size) {\nFILE *file = mode == 1 ? NULL : fopen(name, mode == 0 ? \"rb\" : \"r+b\");\nrelative_close(rf);\nif (file == NULL && mode != 0)\nfile = fopen(name, \"w+b\");\nif (file == NULL)\nreturn NULL;\nif (!rf->listed) {\nif (open_relatives == NULL)\natexit(relative_close_all);\nrf->next = open_relatives;\nopen_relatives = rf;\nrf->listed = true;\n}\nsetvbuf(file, NULL, _IONBF, 0);\nrf->file = file;\nrf->record_size = record_size;\nrf->writable = mode != 0;\nrf->dirty = mode == 1;\nrf->slot = 0;\nrf->cursor = 1;\nif ((rf->map_name = malloc(strlen(name) + 5)) == NULL || (rf->record = malloc(record_size)) == NULL)\ncobol_error();\nsprintf(rf->map_name, \"%s.map\", name);\nif (mode != 1)\nrelative_load(rf);\nif (mode == 3) {\nfor (size_t byte = rf->bytes; byte > 0 && rf->slot == 0; byte--) {\nfor (int bit = 7; bit >= 0 && rf->slot == 0; bit--) {\nif (rf->bits[byte - 1] >> bit & 1)\nrf->slot = (uint64_t)(byte - 1) * 8 + (uint64_t)bit + 1;\n}\n}\n}\nreturn file;\n}\n"
+
+// SORT keeps records in memory up to COBOL_SORT_MEMORY bytes, then sorts
+// them into runs on up to COBOL_SORT_THREADS worker threads, each appending
+// its runs to its own file in COBOL_SORT_DIR or TMPDIR, or to tmpfile().
+// Without pthreads the runs are made on the calling thread. Once the input
+// is done, passes merge SORT_FAN_IN consecutive runs at a time until no more
+// than SORT_FAN_IN are left, so each record is rewritten once a pass, and
+// the last merge feeds RETURN. A heap picks the next record of a merge and
+// equal keys come out in the order they were released.
+#define SORT_RUNS "#if !defined(_WIN32) && (defined(_REENTRANT) || defined(__APPLE__))\n#include <pthread.h>\n#include <unistd.h>\n#define SORT_THREADS\n#endif\n#define SORT_MEMORY ((size_t)256 << 20)\n#define SORT_FAN_IN 64\n#define SORT_BLOCK (1 << 20)\n#define SORT_THREADS_MAX 16\n#define SORT_THREAD_RECORDS 1024\ntypedef struct {\nFILE *file;\nchar *name;\n} SortTemp;\ntypedef struct {\nFILE *file;\nfpos_t where;\nsize_t left;\nchar *buffer;\nsize_t pos;\nsize_t len;\nsize_t capacity;\n} SortRun;\ntypedef struct SortFile {\nint (*compare)(const void *, const void *);\nsize_t record_size;\nsize_t capacity;\nsize_t allocated;\nsize_t count;\nsize_t next;\nsize_t threads;\nchar *records;\nchar **order;\nchar **scratch;\nchar *blocks;\nSortTemp temps[SORT_THREADS_MAX + 1];\nSortRun *runs;\nsize_t run_count;\nsize_t run_allocated;\nSortRun *merging;\nsize_t heap[SORT_FAN_IN];\nsize_t heap_size;\nbool pending;\nint state;\nbool listed;\nstruct SortFile *next_sort;\n} SortFile;\nstatic SortFile *open_sorts;\nstatic unsigned int sort_temps;\nstatic size_t sort_memory(void) {\nconst char *env = getenv(\"COBOL_SORT_MEMORY\");\nchar *end;\nunsigned long long memory;\nif (env == NULL || (memory = strtoull(env, &end, 10)) == 0)\nreturn SORT_MEMORY;\nif (*end == 'G' || *end == 'g')\nmemory <<= 30;\nelse if (*end == 'M' || *end == 'm')\nmemory <<= 20;\nelse if (*end == 'K' || *end == 'k')\nmemory <<= 10;\nreturn memory > SIZE_MAX ? SIZE_MAX : (size_t)memory;\n}\nstatic size_t sort_threads(void) {\n#ifdef SORT_THREADS\nconst char *env = getenv(\"COBOL_SORT_THREADS\");\nconst long threads = env != NULL && *env != '\\0' ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);\nreturn threads < 1 ? 1 : threads > SORT_THREADS_MAX ? SORT_THREADS_MAX : (size_t)threads;\n#else\nreturn 1;\n#endif\n}\nstatic void sort_temp(SortTemp *temp) {\nconst char *dir = getenv(\"COBOL_SORT_DIR\");\nif (dir == NULL || *dir == '\\0')\ndir = getenv(\"TMPDIR\");\ntemp->name = NULL;\nif (dir == NULL || *dir == '\\0') {\nif ((temp->file = tmpfile()) == NULL)\ncobol_error();\nreturn;\n}\nif ((temp->name = malloc(strlen(dir) + 32)) == NULL)\ncobol_error();\ndo {\nsprintf(temp->name, \"%s/cobol-sort-%u.tmp\", dir, sort_temps++);\nerrno = 0;\n} while ((temp->file = fopen(temp->name, \"w+bx\")) == NULL && errno == EEXIST && sort_temps != 0);\nif (temp->file == NULL)\ncobol_error();\n}\nstatic void sort_temp_close(SortTemp *temp) {\nif (temp->file != NULL)\nfclose(temp->file);\nif (temp->name != NULL)\nremove(temp->name);\nfree(temp->name);\ntemp->file = NULL;\ntemp->name = NULL;\n}\nstatic void sort_close(SortFile *sf) {\nfor (size_t i = 0; i <= SORT_THREADS_MAX; i++)\nsort_temp_close(&sf->temps[i]);\nfree(sf->records);\nfree(sf->order);\nfree(sf->scratch);\nfree(sf->blocks);\nfree(sf->runs);\nsf->records = sf->blocks = NULL;\nsf->order = sf->scratch = NULL;\nsf->runs = NULL;\nsf->run_count = sf->run_allocated = sf->heap_size = sf->count = sf->allocated = sf->next = 0;\nsf->state = 0;\n}\nstatic void sort_close_all(void) {\nfor (SortFile *sf = open_sorts; sf != NULL; sf = sf->next_sort)\nsort_close(sf);\n}\nstatic void sort_begin(SortFile *sf, size_t record_size, int (*compare)(const void *, const void *)) {\nsort_close(sf);\nif (!sf->listed) {\nif (open_sorts == NULL)\natexit(sort_close_all);\nsf->next_sort = open_sorts;\nopen_sorts = sf;\nsf->listed = true;\n}\nsf->compare = compare;\nsf->record_size = record_size;\nsf->threads = sort_threads();\nsf->capacity = sort_memory() / (record_size + 2 * sizeof(char *));\nif (sf->capacity < SORT_FAN_IN * 4)\nsf->capacity = SORT_FAN_IN * 4;\nsf->state = 1;\n}\n"
+#define SORT_WORKERS "typedef struct {\nFILE *file;\nchar *block;\nsize_t used;\n} SortWriter;\ntypedef struct {\nSortFile *sf;\nSortRun *run;\nchar **order;\nchar **scratch;\nsize_t count;\nSortWriter out;\n} SortWorker;\nstatic void sort_records(char **order, char **scratch, size_t n, int (*compare)(const void *, const void *)) {\nif (n < 16) {\nfor (size_t i = 1; i < n; i++) {\nchar *record = order[i];\nsize_t j = i;\nfor (; j > 0 && compare(order[j - 1], record) > 0; j--)\norder[j] = order[j - 1];\norder[j] = record;\n}\nreturn;\n}\nconst size_t half = n / 2;\nsize_t i = 0, j = half, k = 0;\nsort_records(order, scratch, half, compare);\nsort_records(order + half, scratch, n - half, compare);\nif (compare(order[half - 1], order[half]) <= 0)\nreturn;\nmemcpy(scratch, order, half * sizeof(char *));\nwhile (i < half && j < n)\norder[k++] = compare(order[j], scratch[i]) < 0 ? order[j++] : scratch[i++];\nwhile (i < half)\norder[k++] = scratch[i++];\n}\nstatic void sort_prepare(SortFile *sf) {\nconst size_t n = sf->count > 0 ? sf->count : 1;\nchar **order = realloc(sf->order, n * sizeof(char *));\nchar **scratch = realloc(sf->scratch, (n / 2 + 1) * sizeof(char *));\nif (order != NULL)\nsf->order = order;\nif (scratch != NULL)\nsf->scratch = scratch;\nif (order == NULL || scratch == NULL)\ncobol_error();\nfor (size_t i = 0; i < sf->count; i++)\norder[i] = sf->records + i * sf->record_size;\nsf->next = 0;\n}\nstatic void sort_flush(SortWriter *w) {\nif (w->used > 0 && fwrite(w->block, 1, w->used, w->file) != w->used)\ncobol_error();\nw->used = 0;\n}\nstatic void sort_put(SortWriter *w, const char *record, size_t size) {\nif (size > SORT_BLOCK - w->used)\nsort_flush(w);\nif (size > SORT_BLOCK) {\nif (fwrite(record, size, 1, w->file) != 1)\ncobol_error();\nreturn;\n}\nmemcpy(w->block + w->used, record, size);\nw->used += size;\n}\nstatic SortRun *sort_run_add(SortFile *sf, FILE *file) {\nif (sf->run_count == sf->run_allocated) {\nconst size_t allocated = sf->run_allocated < SORT_FAN_IN ? SORT_FAN_IN : sf->run_allocated * 2;\nSortRun *runs = realloc(sf->runs, allocated * sizeof(SortRun));\nif (runs == NULL)\ncobol_error();\nsf->runs = runs;\nsf->run_allocated = allocated;\n}\nSortRun *run = &sf->runs[sf->run_count++];\nrun->file = file;\nrun->left = 0;\nif (fgetpos(file, &run->where) != 0)\ncobol_error();\nreturn run;\n}\nstatic void *sort_work(void *arg) {\nSortWorker *w = arg;\nsort_records(w->order, w->scratch, w->count, w->sf->compare);\nfor (size_t i = 0; i < w->count; i++)\nsort_put(&w->out, w->order[i], w->sf->record_size);\nsort_flush(&w->out);\nw->run->left = w->count;\nreturn NULL;\n}\nstatic void sort_spill(SortFile *sf) {\nSortWorker workers[SORT_THREADS_MAX];\nsize_t n = sf->count / SORT_THREAD_RECORDS;\nn = n < 1 ? 1 : n > sf->threads ? sf->threads : n;\nsort_prepare(sf);\nif (sf->blocks == NULL && (sf->blocks = malloc(sf->threads * (size_t)SORT_BLOCK)) == NULL)\ncobol_error();\nfor (size_t i = 0; i < n; i++) {\nconst size_t first = sf->count * i / n;\nif (sf->temps[i].file == NULL)\nsort_temp(&sf->temps[i]);\nworkers[i].sf = sf;\nworkers[i].order = sf->order + first;\nworkers[i].scratch = sf->scratch + first / 2;\nworkers[i].count = sf->count * (i + 1) / n - first;\nworkers[i].out.file = sf->temps[i].file;\nworkers[i].out.block = sf->blocks + i * (size_t)SORT_BLOCK;\nworkers[i].out.used = 0;\n}\nconst size_t base = sf->run_count;\nfor (size_t i = 0; i < n; i++)\nsort_run_add(sf, workers[i].out.file);\nfor (size_t i = 0; i < n; i++)\nworkers[i].run = &sf->runs[base + i];\n#ifdef SORT_THREADS\npthread_t threads[SORT_THREADS_MAX];\nbool started[SORT_THREADS_MAX];\nfor (size_t i = 1; i < n; i++)\nstarted[i] = pthread_create(&threads[i], NULL, sort_work, &workers[i]) == 0;\nsort_work(&workers[0]);\nfor (size_t i = 1; i < n; i++) {\nif (started[i])\npthread_join(threads[i], NULL);\nelse\nsort_work(&workers[i]);\n}\n#else\nfor (size_t i = 0; i < n; i++)\nsort_work(&workers[i]);\n#endif\nsf->count = 0;\n}\n"
+#define SORT_MERGE "static bool sort_fill(SortFile *sf, SortRun *run) {\nconst size_t want = run->left < run->capacity ? run->left : run->capacity;\nrun->pos = run->len = 0;\nif (want == 0)\nreturn false;\nif (fsetpos(run->file, &run->where) != 0 || fread(run->buffer, sf->record_size, want, run->file) != want || fgetpos(run->file, &run->where) != 0)\ncobol_error();\nrun->len = want;\nrun->left -= want;\nreturn true;\n}\nstatic bool sort_less(SortFile *sf, size_t a, size_t b) {\nconst SortRun *x = &sf->merging[a];\nconst SortRun *y = &sf->merging[b];\nconst int r = sf->compare(x->buffer + x->pos * sf->record_size, y->buffer + y->pos * sf->record_size);\nreturn r < 0 || (r == 0 && a < b);\n}\nstatic void sort_sift(SortFile *sf, size_t i) {\nfor (;;) {\nconst size_t left = 2 * i + 1;\nsize_t least = i;\nif (left < sf->heap_size && sort_less(sf, sf->heap[left], sf->heap[least]))\nleast = left;\nif (left + 1 < sf->heap_size && sort_less(sf, sf->heap[left + 1], sf->heap[least]))\nleast = left + 1;\nif (least == i)\nreturn;\nconst size_t run = sf->heap[i];\nsf->heap[i] = sf->heap[least];\nsf->heap[least] = run;\ni = least;\n}\n}\nstatic void sort_merge(SortFile *sf, SortRun *runs, size_t n) {\nconst size_t each = sf->allocated / n;\nsf->merging = runs;\nsf->heap_size = 0;\nsf->pending = false;\nfor (size_t i = 0; i < n; i++) {\nruns[i].buffer = sf->records + i * each * sf->record_size;\nruns[i].capacity = each;\nif (sort_fill(sf, &runs[i]))\nsf->heap[sf->heap_size++] = i;\n}\nfor (size_t i = sf->heap_size / 2; i-- > 0;)\nsort_sift(sf, i);\n}\nstatic const char *sort_merge_next(SortFile *sf) {\nif (sf->pending) {\nSortRun *run = &sf->merging[sf->heap[0]];\nif (++run->pos == run->len && !sort_fill(sf, run))\nsf->heap[0] = sf->heap[--sf->heap_size];\nsort_sift(sf, 0);\n}\nif (sf->heap_size == 0)\nreturn NULL;\nSortRun *run = &sf->merging[sf->heap[0]];\nsf->pending = true;\nreturn run->buffer + run->pos * sf->record_size;\n}\nstatic void sort_merge_pass(SortFile *sf) {\nSortTemp *out = &sf->temps[SORT_THREADS_MAX];\nSortWriter writer;\nconst char *record;\nsize_t count = 0;\nsort_temp(out);\nwriter.file = out->file;\nwriter.block = sf->blocks;\nwriter.used = 0;\nfor (size_t first = 0; first < sf->run_count; first += SORT_FAN_IN) {\nconst size_t n = sf->run_count - first < SORT_FAN_IN ? sf->run_count - first : SORT_FAN_IN;\nSortRun merged;\nmerged.file = out->file;\nmerged.left = 0;\nsort_flush(&writer);\nif (fgetpos(out->file, &merged.where) != 0)\ncobol_error();\nsort_merge(sf, sf->runs + first, n);\nwhile ((record = sort_merge_next(sf)) != NULL) {\nsort_put(&writer, record, sf->record_size);\nmerged.left++;\n}\nsf->runs[count++] = merged;\n}\nsort_flush(&writer);\nfor (size_t i = 0; i < SORT_THREADS_MAX; i++)\nsort_temp_close(&sf->temps[i]);\nsf->temps[0] = *out;\nout->file = NULL;\nout->name = NULL;\nsf->run_count = count;\n}\n"
+#define SORT_RELEASE "static void sort_release(SortFile *sf, const void *src, size_t size) {\nif (sf->state != 1)\ncobol_error();\nif (sf->count == sf->capacity)\nsort_spill(sf);\nif (sf->count == sf->allocated) {\nsize_t allocated = sf->allocated < 1024 ? 1024 : sf->allocated * 2;\nif (allocated > sf->capacity)\nallocated = sf->capacity;\nchar *records = realloc(sf->records, allocated * sf->record_size);\nif (records == NULL)\ncobol_error();\nsf->records = records;\nsf->allocated = allocated;\n}\nchar *dst = sf->records + sf->count++ * sf->record_size;\nmemcpy(dst, src, size < sf->record_size ? size : sf->record_size);\nif (size < sf->record_size)\nmemset(dst + size, 0, sf->record_size - size);\n}\nstatic void sort_end_input(SortFile *sf) {\nif (sf->state != 1)\ncobol_error();\nif (sf->run_count > 0 && sf->count > 0)\nsort_spill(sf);\nif (sf->run_count > 0) {\nfree(sf->order);\nfree(sf->scratch);\nsf->order = sf->scratch = NULL;\nwhile (sf->run_count > SORT_FAN_IN)\nsort_merge_pass(sf);\nsort_merge(sf, sf->runs, sf->run_count);\n} else {\nsort_prepare(sf);\nsort_records(sf->order, sf->scratch, sf->count, sf->compare);\n}\nsf->state = 2;\n}\nstatic bool sort_return(SortFile *sf, void *dst, size_t size) {\nconst char *record;\nif (sf->state != 2)\ncobol_error();\nelse if (sf->run_count > 0)\nrecord = sort_merge_next(sf);\nelse\nrecord = sf->next < sf->count ? sf->order[sf->next++] : NULL;\nif (record == NULL)\nreturn false;\nmemcpy(dst, record, size < sf->record_size ? size : sf->record_size);\nif (size > sf->record_size)\nmemset((char *)dst + sf->record_size, 0, size - sf->record_size);\nreturn true;\n}\n"
 
-static char *functions;
-static size_t functions_len;
-static size_t functions_cap;
+#define IS_STRING(ttype) ((ttype.type == TYPE_ALPHABETIC || ttype.type == TYPE_ALPHANUMERIC) && ttype.count > 0)
 
-static char *function_predefs;
-static size_t function_predefs_len;
-static size_t function_predefs_cap;
+// Emitters append straight into these (or into the buffer they're given)
+// so the generated C is built in one linear pass.
+static Buffer globals;
+static Buffer functions;
+static Buffer function_predefs;
+
+// Whole programs keep their paragraphs and data to the file, except for the
+// data other files of the build reach through their LINKAGE SECTION.
+static bool whole_program;
+extern SymbolTable *linked_names;
+
+// With a single function the paragraphs are labels in main() and PERFORM
+// pushes where to come back to, so GO TO, PERFORM THRU and falling into
+// the next paragraph all work like COBOL expects.
+static bool single_function;
+static size_t return_labels;
+
+// Fixed point decimals hold value * 10^decimal_places in an int64_t, so sums
+// are exact and aligning two scales is one multiply or divide. Dividing
+// truncates like COBOL does without ROUNDED.
+static bool uses_fixed_to_string;
+static bool uses_string_to_fixed;
+
+// Expressions with more than 18 digits in them are worked out in __int128,
+// which is set while one is emitted. Smaller ones stay 64 bit.
+static bool wide_math;
+static bool uses_wide_to_string;
+static bool uses_string_to_wide;
+static bool uses_packed;
+static bool uses_display;
+static bool uses_file_buffer;
+static bool uses_record_layout;
+static bool uses_record_layout_wide;
+static bool uses_index_file;
+static bool uses_relative_file;
+static bool uses_sort_file;
+
+// Each SORT statement gets its own key comparison function.
+static size_t sort_compares;
+
+// Standard output is fully buffered, flushed at exit and before ACCEPT.
+#define STDOUT_BUFFER_SIZE (1 << 16)
+
+#define PERFORM_STACK_SIZE 1024
 
 // We can't assign struct field values inside the struct definition,
 // so we'll delay the assign and do it at the start of the main function.
@@ -34,6 +141,10 @@ static size_t function_predefs_cap;
 char *picturetype_to_c(PictureType *type) {
     if (type->comp_type == COMP_POINTER)
         return "void*";
+    else if (is_packed(type))
+        return "uint8_t";
+    else if (is_fixed_point(type))
+        return is_wide_numeric(type) ? "__int128" : "int64_t";
     else if (type->type == TYPE_DECIMAL_NUMERIC || type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC || type->comp_type == COMP1 || type->comp_type == COMP2)
         return type->comp_type == COMP1 ? "float" : "double";
 
@@ -42,450 +153,1294 @@ char *picturetype_to_c(PictureType *type) {
             return type->comp_type == COMP5 ? "short" : "int16_t";
         else if (type->places <= 9)
             return type->comp_type == COMP5 ? "int" : "int32_t";
-        else
+        else if (type->places <= 18)
             return type->comp_type == COMP5 ? "long long" : "int64_t";
+        else
+            return "__int128";
     } else if (type->type == TYPE_UNSIGNED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC) {
         if (type->places <= 4)
             return type->comp_type == COMP5 ? "unsigned short" : "uint16_t";
         else if (type->places <= 9)
             return type->comp_type == COMP5 ? "unsigned int" : "uint32_t";
-        else
+        else if (type->places <= 18)
             return type->comp_type == COMP5 ? "unsigned long long" : "uint64_t";
+        else
+            return "unsigned __int128";
     }
 
     return "char";
 }
 
-char *picturename_to_c(char *name) {
+void emit_picture_name(Buffer *out, char *name) {
     // C can't have '-' in identifiers so just
     // convert them all to underscores.
+    buffer_appendc(out, '_');
 
-    const size_t len = strlen(name);
-    char *copy = malloc(len + 2);
-    copy[0] = '_';
-
-    for (size_t i = 0; i < len; i++) {
-        if (name[i] == '-')
-            copy[i + 1] = '_';
-        else
-            copy[i + 1] = name[i];
-    }
-
-    copy[len + 1] = '\0';
-    return copy;
+    for (char *c = name; *c != '\0'; c++)
+        buffer_appendc(out, *c == '-' ? '_' : *c);
 }
 
-char *emit_stmt(AST *ast);
+void emit_linkage_name(Buffer *out, char *name, bool is_linkage_src) {
+    if (is_linkage_src && strlen(name) > 3 && name[0] == 'L' && name[1] == 'S' && name[2] == '-')
+        // Remove 'LS-' remove linkage variable name.
+        emit_picture_name(out, name + 3);
+    else
+        emit_picture_name(out, name);
+}
 
-char *value_to_string(AST *ast) {
-    char *string;
+void emit_stmt(Buffer *out, AST *ast);
 
+void emit_value(Buffer *out, AST *ast) {
     switch (ast->type) {
         case AST_NOP:
             assert(false && "got a nop");
-            return calloc(1, sizeof(char));
+            return;
         case AST_INT:
-            string = malloc(32);
-            sprintf(string, "%d", ast->constant.i32);
-            return string;
+            buffer_appendf(out, "%d", ast->constant.i32);
+            return;
         case AST_FLOAT:
-            string = malloc(32);
-            sprintf(string, "%lf", ast->constant.f64);
-            return string;
+            buffer_appendf(out, "%lf", ast->constant.f64);
+            return;
         case AST_STRING:
-            string = malloc(strlen(ast->constant.string) + 3);
-            sprintf(string, "\"%s\"", ast->constant.string);
-            return string;
-        case AST_VAR: 
-            if (ast->var.sym->is_linkage_src && strlen(ast->var.name) > 3 && ast->var.name[0] == 'L' &&
-                ast->var.name[1] == 'S' && ast->var.name[2] == '-')
-
-                // Remove 'LS-' remove linkage variable name.
-                return picturename_to_c(ast->var.name + 3);
-
-            return picturename_to_c(ast->var.name);
-        case AST_PARENS: {
-            char *value = value_to_string(ast->parens);
-            string = malloc(strlen(value) + 3);
-            sprintf(string, "(%s)", value);
-            free(value);
-            return string;
-        }
-        case AST_LABEL: return picturename_to_c(ast->label);
+            buffer_appendc(out, '"');
+            buffer_append(out, ast->constant.string);
+            buffer_appendc(out, '"');
+            return;
+        case AST_VAR:
+            emit_linkage_name(out, ast->var.name, ast->var.sym->is_linkage_src);
+            return;
+        case AST_PARENS:
+            buffer_appendc(out, '(');
+            emit_value(out, ast->parens);
+            buffer_appendc(out, ')');
+            return;
+        case AST_LABEL:
+            emit_picture_name(out, ast->label);
+            return;
         case AST_MATH:
         case AST_CONDITION:
         case AST_SUBSCRIPT:
         case AST_LENGTHOF:
         case AST_FIELD:
-        case AST_NOT: return emit_stmt(ast);
-        case AST_BOOL: return mystrdup(ast->bool_value ? "true" : "false");
-        case AST_NULL: return mystrdup("NULL");
-        case AST_ZERO: return mystrdup("0");
-        case AST_ADDRESSOF: {
-            char *value = value_to_string(ast->addressof_value);
-            string = malloc(strlen(value) + 5);
-            sprintf(string, "(&%s)", value);
-            free(value);
-            return string;
-        }
+        case AST_NOT:
+            emit_stmt(out, ast);
+            return;
+        case AST_BOOL:
+            buffer_append(out, ast->bool_value ? "true" : "false");
+            return;
+        case AST_NULL:
+            buffer_append(out, "NULL");
+            return;
+        case AST_ZERO:
+            buffer_appendc(out, '0');
+            return;
+        case AST_ADDRESSOF:
+            buffer_append(out, "(&");
+            emit_value(out, ast->addressof_value);
+            buffer_appendc(out, ')');
+            return;
         default: break;
     }
 
     printf(">>>%s\n", asttype_to_string(ast->type));
-
     assert(false);
-    return calloc(1, sizeof(char));
 }
 
-void append_global(char *global) {
-    const size_t len = strlen(global);
+void emit_display_run(Buffer *out, AST **displays, size_t count);
 
-    if (globals_len + len + 1 >= globals_cap) {
-        while (globals_len + len + 1 >= globals_cap)
-            globals_cap *= 2;
+// Statements one after another, back to back DISPLAY statements and the
+// items of one DISPLAY share a single write.
+static void emit_items(Buffer *out, AST **items, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (items[i]->type != AST_DISPLAY) {
+            emit_stmt(out, items[i]);
+            continue;
+        }
+
+        size_t end = i + 1;
+
+        while (end < count && items[end]->type == AST_DISPLAY)
+            end++;
 
-        globals = realloc(globals, globals_cap);
+        emit_display_run(out, items + i, end - i);
+        i = end - 1;
     }
+}
+
+void emit_list(Buffer *out, ASTList *list) {
+    emit_items(out, list->items, list->size);
+}
 
-    strcat(globals, global);
-    globals_len += len;
+// Storage class of a data item the generated C defines.
+static void emit_storage(Buffer *out, char *name) {
+    if (whole_program && symtab_lookup(linked_names, name) == NULL)
+        buffer_append(out, "static ");
 }
 
-void append_function(char *code) {
-    const size_t len = strlen(code);
+static int64_t power_of_ten(unsigned int n) {
+    int64_t power = 1;
 
-    if (functions_len + len + 1 >= functions_cap) {
-        while (functions_len + len + 1 >= functions_cap)
-            functions_cap *= 2;
+    while (n-- > 0)
+        power *= 10;
 
-        functions = realloc(functions, functions_cap);
-    }
+    return power;
+}
+
+static bool is_storage_value(AST *value) {
+    return value->type == AST_VAR || value->type == AST_SUBSCRIPT || value->type == AST_FIELD;
+}
+
+static bool is_integer_type(PictureType *type) {
+    return (type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_UNSIGNED_NUMERIC ||
+            type->type == TYPE_SIGNED_SUPRESSED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC) &&
+        type->comp_type != COMP1 && type->comp_type != COMP2 && type->comp_type != COMP_POINTER;
+}
 
-    strcat(functions, code);
-    functions_len += len;
+static bool is_signed_type(PictureType *type) {
+    return type->type != TYPE_UNSIGNED_NUMERIC && type->type != TYPE_UNSIGNED_SUPRESSED_NUMERIC;
 }
 
-void append_function_predef(char *code) {
-    const size_t len = strlen(code);
+static unsigned int packed_digits(PictureType *type) {
+    return type->places + type->decimal_places;
+}
 
-    if (function_predefs_len + len + 1 >= function_predefs_cap) {
-        while (function_predefs_len + len + 1 >= function_predefs_cap)
-            function_predefs_cap *= 2;
+// Reads a packed item as its scaled integer.
+static void emit_packed_read(Buffer *out, AST *value, PictureType *type) {
+    uses_packed = true;
+    buffer_append(out, is_wide_numeric(type) ? "packed_to_int128(" : "packed_to_int64(");
+    emit_value(out, value);
+    buffer_appendf(out, ", %u)", packed_digits(type));
+}
 
-        function_predefs = realloc(function_predefs, function_predefs_cap);
+// Starts assigning dst the expression that follows, emit_store_end() finishes
+// it. Packed items are assigned through packed_from_int64().
+static void emit_store_begin(Buffer *out, AST *dst, PictureType *type) {
+    if (is_packed(type)) {
+        uses_packed = true;
+        buffer_append(out, is_wide_numeric(type) ? "packed_from_int128(" : "packed_from_int64(");
+        emit_value(out, dst);
+        buffer_append(out, ", ");
+    } else {
+        emit_value(out, dst);
+        buffer_append(out, " = ");
     }
+}
 
-    strcat(function_predefs, code);
-    function_predefs_len += len;
+static void emit_store_end(Buffer *out, PictureType *type) {
+    if (is_packed(type))
+        buffer_appendf(out, ", %u, %s)", packed_digits(type), is_signed_type(type) ? "true" : "false");
 }
 
-char *emit_stmt(AST *ast);
+// Finds whether an expression reads a fixed point item, and whether it has
+// anything scaled integers can't stand in for, like COMP-2 items.
+static void classify_fixed(AST *value, bool *has_fixed, bool *opaque) {
+    switch (value->type) {
+        case AST_INT:
+        case AST_ZERO:
+        case AST_LENGTHOF: return;
+        case AST_FLOAT:
+            // Integers past 9 digits are exact in scaled integers, not in a double.
+            if (is_long_integer(value))
+                *has_fixed = true;
+
+            return;
+        case AST_PARENS:
+            classify_fixed(value->parens, has_fixed, opaque);
+            return;
+        case AST_MATH:
+            for (size_t i = 0; i < value->math.size; i += 2)
+                classify_fixed(value->math.items[i], has_fixed, opaque);
+            return;
+        case AST_VAR:
+        case AST_SUBSCRIPT:
+        case AST_FIELD: {
+            PictureType type = get_value_type(value);
+
+            if (is_fixed_point(&type) || is_packed(&type))
+                *has_fixed = true;
+            else if (!is_integer_type(&type))
+                *opaque = true;
 
-char *emit_list(ASTList *list) {
-    char *code = malloc(1024);
-    code[0] = '\0';
-    size_t len = 0;
-    size_t cap = 1024;
+            return;
+        }
+        default:
+            *opaque = true;
+            return;
+    }
+}
 
-    for (size_t i = 0; i < list->size; i++) {
-        char *stmt = emit_stmt(list->items[i]);
-        const size_t stmt_len = strlen(stmt);
+static unsigned int math_scale(AST **items, size_t count);
 
-        if (len + stmt_len + 1 >= cap) {
-            while (len + stmt_len + 1 >= cap)
-                cap *= 2;
+// The parser nests the rest of an expression in its values, A * B - C comes
+// out as A * (B - C) and C precedence puts it right again. Scaling needs
+// the terms, so the nested lists are spliced back into one.
+static void flatten_math(AST **items, size_t count, ASTList *flat) {
+    for (size_t i = 0; i < count; i++) {
+        if (items[i]->type == AST_MATH)
+            flatten_math(items[i]->math.items, items[i]->math.size, flat);
+        else
+            astlist_push(flat, items[i]);
+    }
+}
 
-            code = realloc(code, cap);
+// Decimal places a value has without losing any digits.
+static unsigned int fixed_scale(AST *value) {
+    switch (value->type) {
+        case AST_FLOAT: {
+            char *point = value->constant.string == NULL ? NULL : strchr(value->constant.string, '.');
+            return point == NULL ? 0 : (unsigned int)strlen(point + 1);
+        }
+        case AST_PARENS: return fixed_scale(value->parens);
+        case AST_MATH: return math_scale(value->math.items, value->math.size);
+        case AST_VAR:
+        case AST_SUBSCRIPT:
+        case AST_FIELD: {
+            PictureType type = get_value_type(value);
+            return is_fixed_point(&type) ? type.decimal_places : 0;
         }
+        default: break;
+    }
+
+    return 0;
+}
 
-        strcat(code, stmt);
-        free(stmt);
-        len += stmt_len;
+// Products add their scales, quotients come out at whatever scale is asked for.
+static unsigned int math_scale(AST **nested, size_t nested_count) {
+    ASTList flat = create_astlist();
+    flatten_math(nested, nested_count, &flat);
+    AST **items = flat.items;
+    const size_t count = flat.size;
+    unsigned int scale = 0;
+    unsigned int term = fixed_scale(items[0]);
+
+    for (size_t i = 1; i + 1 < count; i += 2) {
+        const TokenType oper = items[i]->oper;
+
+        if (oper == TOK_PLUS || oper == TOK_MINUS) {
+            scale = term > scale ? term : scale;
+            term = fixed_scale(items[i + 1]);
+        } else if (oper == TOK_STAR)
+            term += fixed_scale(items[i + 1]);
+        else if (oper == TOK_MOD)
+            term = 0;
     }
 
-    return code;
+    return term > scale ? term : scale;
 }
 
-char *emit_root(AST *root, bool require_main, char *source_includes) {
-    char *code = malloc(1024);
-    size_t cap = 1024;
-    size_t len;
+static unsigned int math_width(AST **items, size_t count, unsigned int scale);
 
-    if (require_main) {
-        strcpy(code, "int main(int argc, char **argv) {\nglobal_argc = argc;\nglobal_argv = argv;\n");
-        len = 75;
-    } else {
-        code[0] = '\0';
-        len = 0;
+// Digits before the point a value can have.
+static unsigned int integer_digits(AST *value) {
+    unsigned int digits = 1;
+
+    switch (value->type) {
+        case AST_INT:
+            for (long long i = value->constant.i32; i >= 10 || i <= -10; i /= 10)
+                digits++;
+
+            return digits;
+        case AST_ZERO: return 1;
+        case AST_FLOAT: {
+            if (value->constant.string == NULL) {
+                for (double f = value->constant.f64 < 0 ? -value->constant.f64 : value->constant.f64; f >= 10; f /= 10)
+                    digits++;
+
+                return digits;
+            }
+
+            const size_t len = strspn(value->constant.string + (*value->constant.string == '-' || *value->constant.string == '+'), "0123456789");
+            return len > 0 ? (unsigned int)len : 1;
+        }
+        case AST_LENGTHOF: return 10;
+        case AST_VAR:
+        case AST_SUBSCRIPT:
+        case AST_FIELD: {
+            PictureType type = get_value_type(value);
+
+            if (is_fixed_point(&type) || is_integer_type(&type))
+                return type.places > 0 ? type.places : 1;
+
+            break;
+        }
+        default: break;
     }
 
-    globals = malloc(2048);
-    strcpy(globals, "static char string_builder[4097];\nstatic size_t string_builder_pointer;\nstatic size_t previous_string_statement_size;\nstatic char *read_buffer;\nstatic char file_status[3];\nstatic FILE *last_opened_outfile;\nstatic char *inspect_string;\nstatic size_t inspect_count;\nstatic size_t inspect_string_length;\nstatic bool inspect_found;\nstatic bool inspect_locked;\nstatic char *endptr;\nstatic int global_argc;\nstatic char **global_argv;\nstatic char spare_string_buffer[4097];\n__attribute__((noreturn)) static void cobol_error() {\nfprintf(stderr, \"COBOL: CRITICAL RUNTIME ERROR\\n\");\nexit(EXIT_FAILURE);\n}\n");
+    return 18;
+}
 
-    globals_len = strlen(globals);
-    globals_cap = 2048;
+// Digits of value * 10^scale, including the intermediates it takes to get there.
+static unsigned int fixed_width(AST *value, unsigned int scale) {
+    if (value->type == AST_PARENS)
+        return fixed_width(value->parens, scale);
+    else if (value->type == AST_MATH)
+        return math_width(value->math.items, value->math.size, scale);
 
-    functions = malloc(1024);
-    functions[0] = '\0';
-    functions_len = 0;
-    functions_cap = 1024;
+    return integer_digits(value) + scale;
+}
 
-    function_predefs = malloc(1024);
-    function_predefs[0] = '\0';
-    function_predefs_len = 0;
-    function_predefs_cap = 1024;
-    
-    /*
-    for (size_t i = 0; i < delayed_assigns.size; i++) {
-        char *stmt = emit_stmt(delayed_assigns.items[i]);
-        const size_t stmt_len = strlen(stmt);
+// Follows emit_fixed_math(): products add their digits, a quotient has at
+// most the digits of its rescaled dividend and a sum carries one more.
+static unsigned int math_width(AST **nested, size_t nested_count, unsigned int scale) {
+    ASTList flat = create_astlist();
+    flatten_math(nested, nested_count, &flat);
+    AST **items = flat.items;
+    const size_t count = flat.size;
+    unsigned int width = 0;
+    unsigned int widest_term = 0;
+    size_t terms = 0;
+
+    for (size_t i = 0; i < count; i += 2, terms++) {
+        unsigned int term;
+
+        if (i + 1 == count || items[i + 1]->oper == TOK_PLUS || items[i + 1]->oper == TOK_MINUS)
+            term = fixed_width(items[i], scale);
+        else {
+            unsigned int term_scale = fixed_scale(items[i]);
+            term = fixed_width(items[i], term_scale);
+
+            for (; i + 2 < count && items[i + 1]->oper != TOK_PLUS && items[i + 1]->oper != TOK_MINUS; i += 2) {
+                const TokenType oper = items[i + 1]->oper;
+                const unsigned int factor_scale = oper == TOK_MOD ? 0 : fixed_scale(items[i + 2]);
+                const unsigned int factor = fixed_width(items[i + 2], factor_scale);
+
+                if (oper == TOK_STAR) {
+                    term += factor;
+                    term_scale += factor_scale;
+                } else if (oper == TOK_SLASH) {
+                    term = term - term_scale + scale + factor_scale;
+                    term_scale = scale;
+                } else {
+                    term = factor;
+                    term_scale = 0;
+                }
+
+                width = term > width ? term : width;
+                width = factor > width ? factor : width;
+            }
 
-        if (len + stmt_len + 1 >= cap) {
-            cap *= 2;
-            code = realloc(code, cap);
+            term = term - term_scale + scale;
         }
 
-        strcat(code, stmt);
-        free(stmt);
-        len += stmt_len;
+        width = term > width ? term : width;
+        widest_term = term > widest_term ? term : widest_term;
     }
-    */
 
-    for (size_t i = 0; i < root->root.size; i++) {
-        char *stmt = emit_stmt(root->root.items[i]);
-        const size_t stmt_len = strlen(stmt);
+    if (terms > 1 && widest_term + 1 > width)
+        width = widest_term + 1;
+
+    return width;
+}
+
+// The digits of a literal scaled exactly, the double it was parsed into may not be.
+static long long literal_to_fixed(AST *literal, unsigned int scale) {
+    if (literal->constant.string == NULL)
+        return (long long)(literal->constant.f64 * (double)power_of_ten(scale));
+
+    char *c = literal->constant.string;
+    const bool negative = *c == '-';
+
+    if (*c == '-' || *c == '+')
+        c++;
+
+    long long value = 0;
+    unsigned int places = 0;
+
+    for (; *c >= '0' && *c <= '9'; c++)
+        value = value * 10 + (*c - '0');
+
+    if (*c == '.') {
+        for (c++; *c >= '0' && *c <= '9' && places < scale; c++, places++)
+            value = value * 10 + (*c - '0');
+    }
+
+    for (; places < scale; places++)
+        value *= 10;
+
+    return negative ? -value : value;
+}
+
+// Appends oper 10^n, split in factors that fit a long long.
+static void emit_power_of_ten(Buffer *out, const char *oper, unsigned int n) {
+    while (n > 0) {
+        const unsigned int step = n > 18 ? 18 : n;
+        buffer_appendf(out, "%s%lldLL", oper, (long long)power_of_ten(step));
+        n -= step;
+    }
+}
+
+// Appends the constant value * 10^zeros, at __int128 width in wide math.
+static void emit_scaled_constant(Buffer *out, long long value, unsigned int zeros) {
+    if (!wide_math) {
+        buffer_appendf(out, "%lldLL", value * (long long)power_of_ten(zeros));
+        return;
+    }
+
+    buffer_appendf(out, "((__int128)%lldLL", value);
+    emit_power_of_ten(out, " * ", zeros);
+    buffer_appendc(out, ')');
+}
+
+// Appends expr, which is at scale from, aligned to scale to.
+static void emit_rescaled(Buffer *out, Buffer *expr, unsigned int from, unsigned int to) {
+    if (from == to) {
+        buffer_append_n(out, expr->data, expr->len);
+        return;
+    }
+
+    buffer_appendc(out, '(');
+    buffer_append_n(out, expr->data, expr->len);
+    emit_power_of_ten(out, from < to ? " * " : " / ", from < to ? to - from : from - to);
+    buffer_appendc(out, ')');
+}
+
+// Appends a literal at scale as an __int128, built from 18 digit chunks
+// since C has no constants that wide.
+static void emit_wide_literal(Buffer *out, AST *literal, unsigned int scale) {
+    char digits[80];
+    size_t count = 0;
+    unsigned int places = 0;
+    char *c = literal->constant.string;
+    const bool negative = *c == '-';
 
-        if (len + stmt_len + 13 >= cap) {
-            cap *= 2;
-            code = realloc(code, cap);
+    if (*c == '-' || *c == '+')
+        c++;
+
+    for (; *c >= '0' && *c <= '9' && count < 40; c++)
+        digits[count++] = *c;
+
+    if (*c == '.') {
+        for (c++; *c >= '0' && *c <= '9' && places < scale; c++, places++)
+            digits[count++] = *c;
+    }
+
+    for (; places < scale || count == 0; places++)
+        digits[count++] = '0';
+
+    buffer_append(out, negative ? "(-(" : "((");
+
+    for (size_t start = 0; start < count;) {
+        const size_t len = (count - start) % 18 == 0 ? 18 : (count - start) % 18;
+        long long chunk = 0;
+
+        for (size_t i = start; i < start + len; i++)
+            chunk = chunk * 10 + (digits[i] - '0');
+
+        buffer_appendf(out, start > 0 ? " + (__int128)%lldLL" : "(__int128)%lldLL", chunk);
+        start += len;
+        emit_power_of_ten(out, " * ", (unsigned int)(count - start));
+    }
+
+    buffer_append(out, "))");
+}
+
+static void emit_fixed_math(Buffer *out, AST **items, size_t count, unsigned int scale);
+
+// Emits value * 10^scale as an int64_t expression, or __int128 in wide math.
+static void emit_fixed(Buffer *out, AST *value, unsigned int scale) {
+    switch (value->type) {
+        case AST_INT:
+            emit_scaled_constant(out, value->constant.i32, scale);
+            return;
+        case AST_ZERO:
+            buffer_append(out, "0LL");
+            return;
+        case AST_FLOAT:
+            if (wide_math && value->constant.string != NULL)
+                emit_wide_literal(out, value, scale);
+            else
+                buffer_appendf(out, "%lldLL", literal_to_fixed(value, scale));
+
+            return;
+        case AST_PARENS:
+            emit_fixed(out, value->parens, scale);
+            return;
+        case AST_MATH:
+            emit_fixed_math(out, value->math.items, value->math.size, scale);
+            return;
+        default: break;
+    }
+
+    PictureType type = is_storage_value(value) ? get_value_type(value) : (PictureType){ .type = TYPE_UNSIGNED_NUMERIC };
+    Buffer raw = create_buffer(64);
+
+    // Widening the values is enough to do every product in 128 bits.
+    if (is_packed(&type)) {
+        if (wide_math)
+            buffer_append(&raw, "(__int128)");
+
+        emit_packed_read(&raw, value, &type);
+        emit_rescaled(out, &raw, type.decimal_places, scale);
+    } else if (is_fixed_point(&type)) {
+        if (wide_math)
+            buffer_append(&raw, "(__int128)");
+
+        emit_value(&raw, value);
+        emit_rescaled(out, &raw, type.decimal_places, scale);
+    } else if (is_integer_type(&type)) {
+        buffer_append(&raw, wide_math ? "(__int128)" : "(int64_t)");
+        emit_value(&raw, value);
+        emit_rescaled(out, &raw, 0, scale);
+    } else {
+        buffer_append(out, wide_math ? "(__int128)(" : "(int64_t)(");
+        emit_value(out, value);
+        buffer_appendf(out, " * 1e%u)", scale);
+    }
+
+    delete_buffer(&raw);
+}
+
+// Terms are summed at scale, products are kept at their own scale until
+// the term ends and quotients are worked out at scale.
+static void emit_fixed_math(Buffer *out, AST **nested, size_t nested_count, unsigned int scale) {
+    ASTList flat = create_astlist();
+    flatten_math(nested, nested_count, &flat);
+    AST **items = flat.items;
+    const size_t count = flat.size;
+    buffer_appendc(out, '(');
+
+    for (size_t i = 0; i < count; i += 2) {
+        if (i > 0)
+            buffer_append(out, items[i - 1]->oper == TOK_PLUS ? " + " : " - ");
+
+        // A term on its own goes straight to scale, constants are folded.
+        if (i + 1 == count || items[i + 1]->oper == TOK_PLUS || items[i + 1]->oper == TOK_MINUS) {
+            emit_fixed(out, items[i], scale);
+            continue;
+        }
+
+        Buffer term = create_buffer(64);
+        unsigned int term_scale = fixed_scale(items[i]);
+        emit_fixed(&term, items[i], term_scale);
+
+        for (; i + 2 < count && items[i + 1]->oper != TOK_PLUS && items[i + 1]->oper != TOK_MINUS; i += 2) {
+            const TokenType oper = items[i + 1]->oper;
+            AST *factor = items[i + 2];
+            const unsigned int factor_scale = oper == TOK_MOD ? 0 : fixed_scale(factor);
+            Buffer next = create_buffer(term.len + 64);
+            buffer_appendc(&next, '(');
+
+            if (oper == TOK_STAR) {
+                buffer_append_n(&next, term.data, term.len);
+                buffer_append(&next, " * ");
+                term_scale += factor_scale;
+            } else if (oper == TOK_SLASH) {
+                emit_rescaled(&next, &term, term_scale, scale + factor_scale);
+                buffer_append(&next, " / ");
+                term_scale = scale;
+            } else {
+                emit_rescaled(&next, &term, term_scale, 0);
+                buffer_append(&next, " % ");
+                term_scale = 0;
+            }
+
+            emit_fixed(&next, factor, factor_scale);
+            buffer_appendc(&next, ')');
+            delete_buffer(&term);
+            term = next;
         }
 
-        strcat(code, stmt);
-        free(stmt);
-        len += stmt_len;
+        emit_rescaled(out, &term, term_scale, scale);
+        delete_buffer(&term);
     }
 
-    strcat(code, "return 0;\n}\n");
-    len += 13;
+    buffer_appendc(out, ')');
+}
 
-    char *total;
+// Reads a value as a plain C number, fixed point items become doubles.
+static void emit_number(Buffer *out, AST *value) {
+    if (is_storage_value(value)) {
+        PictureType type = get_value_type(value);
+
+        if (is_packed(&type) && type.decimal_places == 0) {
+            emit_packed_read(out, value, &type);
+            return;
+        } else if (is_packed(&type)) {
+            buffer_append(out, "((double)");
+            emit_packed_read(out, value, &type);
+            buffer_appendf(out, " / 1e%u)", type.decimal_places);
+            return;
+        } else if (is_fixed_point(&type)) {
+            buffer_append(out, "((double)");
+            emit_value(out, value);
+            buffer_appendf(out, " / 1e%u)", type.decimal_places);
+            return;
+        }
+    }
+
+    emit_value(out, value);
+}
+
+static void emit_math_items(Buffer *out, AST **items, size_t count);
+
+// Digits a store into type keeps, 0 when it has no picture to truncate to.
+static unsigned int picture_digits(PictureType *type) {
+    if (is_packed(type) || (!is_fixed_point(type) && !is_integer_type(type)))
+        return 0;
+
+    return type->places + (is_fixed_point(type) ? type->decimal_places : 0);
+}
+
+// A result of width digits stored into type loses its high-order digits
+// like COBOL does, instead of wrapping in the C type. emit_truncate_end()
+// closes it, results that always fit are left alone.
+static bool emit_truncate_begin(Buffer *out, PictureType *type, unsigned int width) {
+    const unsigned int digits = picture_digits(type);
+
+    if (digits == 0 || width <= digits)
+        return false;
+
+    buffer_appendc(out, '(');
+    return true;
+}
+
+static void emit_truncate_end(Buffer *out, PictureType *type, bool truncate) {
+    if (!truncate)
+        return;
+
+    // 10^19 and up only fit an __int128.
+    const bool was_wide = wide_math;
+    wide_math = was_wide || picture_digits(type) > 18;
+    buffer_append(out, ") % ");
+    emit_scaled_constant(out, 1, picture_digits(type));
+    wide_math = was_wide;
+}
+
+// How emit_assign_math() works out dst = the expression in items.
+typedef struct {
+    PictureType dst_type;
+    unsigned int dst_scale;
+    unsigned int scale;
+    bool wide;
+    bool plain;
+} AssignPlan;
+
+static AssignPlan plan_assign(AST *dst, AST **items, size_t count, bool rounded) {
+    AssignPlan plan = { .dst_type = get_value_type(dst) };
+    const bool dst_fixed = is_fixed_point(&plan.dst_type);
+    bool has_fixed = false;
+    bool opaque = false;
 
-    if (require_main) {
-        total = malloc(INCLUDE_LIBS_LEN + len + globals_len + functions_len + function_predefs_len + strlen(source_includes) + 28);
-        sprintf(total, "%s%s%s%s%s%s", source_includes, INCLUDE_LIBS, globals, function_predefs, functions, code);
+    plan.dst_scale = dst_fixed ? plan.dst_type.decimal_places : 0;
+
+    for (size_t i = 0; i < count; i += 2)
+        classify_fixed(items[i], &has_fixed, &opaque);
+
+    plan.scale = opaque ? 0 : math_scale(items, count);
+
+    if (plan.scale < plan.dst_scale + rounded)
+        plan.scale = plan.dst_scale + rounded;
+
+    plan.wide = !opaque && (is_wide_numeric(&plan.dst_type) || math_width(items, count, plan.scale) > 18);
+    plan.plain = (!dst_fixed && !is_packed(&plan.dst_type) && !has_fixed && !plan.wide) || opaque ||
+        (!dst_fixed && !is_integer_type(&plan.dst_type));
+    return plan;
+}
+
+bool is_plain_assign(AST *dst, AST **items, size_t count, bool rounded, unsigned int *digits) {
+    AssignPlan plan = plan_assign(dst, items, count, rounded);
+    const unsigned int width = math_width(items, count, plan.dst_scale);
+    *digits = width > picture_digits(&plan.dst_type) ? picture_digits(&plan.dst_type) : 0;
+    return plan.plain;
+}
+
+// dst = the expression in items. Either side being fixed point, or the
+// digits not fitting 64 bits, does the whole thing in scaled integers,
+// aligned to dst at the end. ROUNDED works out one more digit than dst
+// keeps and adds half of it away from zero.
+static void emit_assign_math(Buffer *out, AST *dst, AST **items, size_t count, bool rounded) {
+    AssignPlan plan = plan_assign(dst, items, count, rounded);
+    PictureType dst_type = plan.dst_type;
+    const unsigned int dst_scale = plan.dst_scale;
+    const unsigned int scale = plan.scale;
+    const bool wide = plan.wide;
+
+    if (plan.plain) {
+        const bool dst_fixed = is_fixed_point(&dst_type);
+        const bool dst_packed = is_packed(&dst_type);
+        emit_store_begin(out, dst, &dst_type);
+        const bool truncate = emit_truncate_begin(out, &dst_type, math_width(items, count, dst_scale));
+
+        if (dst_fixed || dst_packed) {
+            buffer_appendf(out, "(%s)((", dst_packed ? (is_wide_numeric(&dst_type) ? "__int128" : "int64_t") : picturetype_to_c(&dst_type));
+            emit_math_items(out, items, count);
+            buffer_appendf(out, ") * 1e%u)", dst_type.decimal_places);
+        } else if (truncate) {
+            // The result may be a double, % needs it as an integer.
+            buffer_appendf(out, "(%s)(", is_wide_numeric(&dst_type) ? "__int128" : "int64_t");
+            emit_math_items(out, items, count);
+            buffer_appendc(out, ')');
+        } else
+            emit_math_items(out, items, count);
+
+        emit_truncate_end(out, &dst_type, truncate);
+        emit_store_end(out, &dst_type);
+        buffer_append(out, ";\n");
+        return;
+    }
+
+    Buffer expr = create_buffer(128);
+    wide_math = wide;
+    emit_fixed_math(&expr, items, count, scale);
+
+    // Rounding can carry into one more digit.
+    const unsigned int width = math_width(items, count, scale) - scale + dst_scale + rounded;
+
+    if (rounded && scale > dst_scale) {
+        Buffer half = create_buffer(64);
+        emit_scaled_constant(&half, 5, scale - dst_scale - 1);
+
+        buffer_appendf(out, "{\nconst %s fixed_result = ", wide ? "__int128" : "int64_t");
+        buffer_append_n(out, expr.data, expr.len);
+        buffer_append(out, ";\n");
+        emit_store_begin(out, dst, &dst_type);
+        const bool truncate = emit_truncate_begin(out, &dst_type, width);
+        buffer_append(out, "(fixed_result + (fixed_result < 0 ? -");
+        buffer_append_n(out, half.data, half.len);
+        buffer_append(out, " : ");
+        buffer_append_n(out, half.data, half.len);
+        buffer_append(out, "))");
+        emit_power_of_ten(out, " / ", scale - dst_scale);
+        emit_truncate_end(out, &dst_type, truncate);
+        emit_store_end(out, &dst_type);
+        buffer_append(out, ";\n}\n");
+        delete_buffer(&half);
     } else {
-        total = malloc(INCLUDE_LIBS_LEN + globals_len + functions_len + function_predefs_len + strlen(source_includes) + 28);
-        sprintf(total, "%s%s%s%s%s", source_includes, INCLUDE_LIBS, globals, function_predefs, functions);
+        emit_store_begin(out, dst, &dst_type);
+        const bool truncate = emit_truncate_begin(out, &dst_type, width);
+        emit_rescaled(out, &expr, scale, dst_scale);
+        emit_truncate_end(out, &dst_type, truncate);
+        emit_store_end(out, &dst_type);
+        buffer_append(out, ";\n");
+    }
+
+    delete_buffer(&expr);
+    wide_math = false;
+}
+
+// The argument that goes with emit_format_specifier().
+static void emit_format_argument(Buffer *out, AST *value, PictureType *type) {
+    const bool suppress = type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC ||
+        type->type == TYPE_SIGNED_SUPRESSED_NUMERIC || type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC;
+
+    if (is_packed(type)) {
+        // The digits come straight from the nibbles.
+        uses_packed = true;
+        buffer_append(out, "packed_to_string(");
+        emit_value(out, value);
+        buffer_appendf(out, ", %u, %u, %s)", packed_digits(type), type->decimal_places, suppress ? "true" : "false");
+        return;
+    } else if (is_wide_numeric(type)) {
+        // Integers pad like %.<places>d, decimals like fixed_to_string().
+        uses_wide_to_string = true;
+        buffer_append(out, "wide_to_string(");
+        emit_value(out, value);
+        buffer_appendf(out, ", %u, %u, %s)", type->places, is_fixed_point(type) ? type->decimal_places : 0, suppress ? "true" : "false");
+        return;
+    } else if (!is_fixed_point(type)) {
+        emit_value(out, value);
+        return;
     }
 
-    free(code);
-    free(globals);
-    free(functions);
-    free(function_predefs);
+    // Same digits as %0<width>.<places>lf, suppressed pictures drop the zeros %g would.
+    uses_fixed_to_string = true;
+    buffer_append(out, "fixed_to_string(");
+    emit_value(out, value);
+    buffer_appendf(out, ", %u, %u, %s)", type->places + type->decimal_places + 1, type->decimal_places,
+        type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC ? "true" : "false");
+}
+
+// The tables go from a byte to its two digits and back.
+static void emit_packed_runtime(Buffer *out) {
+    buffer_append(out, "static const uint8_t packed_value[256] = {");
+
+    for (unsigned int i = 0; i < 256; i++)
+        buffer_appendf(out, i > 0 ? ", %u" : "%u", (i >> 4) * 10 + (i & 0x0F));
+
+    buffer_append(out, "};\nstatic const uint8_t packed_byte[100] = {");
+
+    for (unsigned int i = 0; i < 100; i++)
+        buffer_appendf(out, i > 0 ? ", %u" : "%u", (i / 10) << 4 | i % 10);
+
+    buffer_append(out, "};\n");
+    buffer_append(out, PACKED_ARITHMETIC);
+    buffer_append(out, PACKED_CONVERSIONS);
+}
+
+size_t emit_root(FILE *out, AST *root, unsigned int flags, char *source_includes) {
+    const bool require_main = !(flags & COMP_NO_MAIN);
+    whole_program = flags & COMP_WHOLE_PROGRAM;
+    single_function = (flags & COMP_COMPUTED_GOTO) && require_main;
+    return_labels = 0;
+    uses_fixed_to_string = uses_string_to_fixed = false;
+    uses_wide_to_string = uses_string_to_wide = false;
+    uses_packed = uses_display = uses_file_buffer = uses_index_file = uses_relative_file = uses_sort_file = false;
+    sort_compares = 0;
+    uses_record_layout = uses_record_layout_wide = false;
+    Buffer code = create_buffer(4096);
+
+    if (require_main)
+        buffer_appendf(&code, "int main(int argc, char **argv) {\nstatic char stdout_buffer[%d];\nsetvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));\nglobal_argc = argc;\nglobal_argv = argv;\n", STDOUT_BUFFER_SIZE);
+
+    globals = create_buffer(4096);
+    buffer_append(&globals, "static char string_builder[4097];\nstatic size_t string_builder_pointer;\nstatic size_t previous_string_statement_size;\nstatic char *read_buffer;\nstatic char file_status[3];\nstatic FILE *last_opened_outfile;\nstatic char *inspect_string;\nstatic size_t inspect_count;\nstatic size_t inspect_string_length;\nstatic bool inspect_found;\nstatic bool inspect_locked;\nstatic char *endptr;\nstatic int global_argc;\nstatic char **global_argv;\nstatic char spare_string_buffer[4097];\n__attribute__((noreturn)) static void cobol_error() {\nfprintf(stderr, \"COBOL: CRITICAL RUNTIME ERROR\\n\");\nexit(EXIT_FAILURE);\n}\n");
+
+    if (single_function)
+        buffer_appendf(&globals, "typedef struct {\nvoid *ret;\nvoid *last;\n} PerformFrame;\nstatic PerformFrame perform_stack[%d];\nstatic size_t perform_sp;\n", PERFORM_STACK_SIZE);
+
+    functions = create_buffer(4096);
+    function_predefs = create_buffer(1024);
+
+    /*
+    for (size_t i = 0; i < delayed_assigns.size; i++)
+        emit_stmt(&code, delayed_assigns.items[i]);
+    */
+
+    // Statements are still emitted without a main function, they can add globals and functions.
+    emit_list(&code, &root->root);
+    buffer_append(&code, "return 0;\n}\n");
+
+    if (uses_fixed_to_string)
+        buffer_append(&globals, FIXED_TO_STRING);
+
+    if (uses_string_to_fixed)
+        buffer_append(&globals, STRING_TO_FIXED);
+
+    if (uses_wide_to_string)
+        buffer_append(&globals, WIDE_TO_STRING);
+
+    if (uses_string_to_wide)
+        buffer_append(&globals, STRING_TO_WIDE);
+
+    if (uses_packed)
+        emit_packed_runtime(&globals);
+
+    if (uses_display)
+        buffer_append(&globals, DISPLAY_FORMATTERS);
+
+    size_t written = fwrite(source_includes, 1, strlen(source_includes), out);
+    written += fwrite(INCLUDE_LIBS, 1, strlen(INCLUDE_LIBS), out);
+    written += buffer_write(&globals, out);
+    written += buffer_write(&function_predefs, out);
+    written += buffer_write(&functions, out);
+
+    if (require_main)
+        written += buffer_write(&code, out);
+
+    delete_buffer(&code);
+    delete_buffer(&globals);
+    delete_buffer(&functions);
+    delete_buffer(&function_predefs);
     //delete_astlist(&delayed_assigns);
-    return total;
+    return written;
 }
 
-char *emit_stop(AST *ast) {
+void emit_stop(Buffer *out, AST *ast) {
     (void)ast;
-    return mystrdup("return;\n");
+    buffer_append(out, single_function ? "return 0;\n" : "return;\n");
 }
 
-char *emit_stop_run(AST *ast) {
+void emit_stop_run(Buffer *out, AST *ast) {
     (void)ast;
-    return mystrdup("return 0;\n");
+    buffer_append(out, "return 0;\n");
 }
 
-char *picturetype_to_format_specifier(PictureType *type) {
-    char *spec = malloc(32);
+void emit_format_specifier(Buffer *out, PictureType *type) {
+    if (is_fixed_point(type) || is_wide_numeric(type) || is_packed(type)) {
+        buffer_append(out, "%s");
+        return;
+    }
 
     if (type->comp_type > 0) {
         if (type->comp_type == COMP_POINTER)
-            strcpy(spec, "%p");
+            buffer_append(out, "%p");
         else if (type->comp_type == COMP1)
-            strcpy(spec, "%f");
+            buffer_append(out, "%f");
         else if (type->comp_type == COMP2)
-            strcpy(spec, "%lf");
+            buffer_append(out, "%lf");
         else {
             if (type->places <= 9)
-                strcpy(spec, type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_SIGNED_SUPRESSED_NUMERIC ? "%d" : "%u");
+                buffer_append(out, type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_SIGNED_SUPRESSED_NUMERIC ? "%d" : "%u");
             else
-                strcpy(spec, type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_SIGNED_SUPRESSED_NUMERIC ? "%lld" : "%zu");
+                buffer_append(out, type->type == TYPE_SIGNED_NUMERIC || type->type == TYPE_SIGNED_SUPRESSED_NUMERIC ? "%lld" : "%zu");
         }
     } else if (type->type == TYPE_DECIMAL_NUMERIC) {
         // Constant.
         if (type->places == 0 && type->decimal_places == 0)
-            strcpy(spec, "%.2lf");
+            buffer_append(out, "%.2lf");
         else
-            sprintf(spec, "%%0%u.%ulf", type->places + type->decimal_places + 1, type->decimal_places);
+            buffer_appendf(out, "%%0%u.%ulf", type->places + type->decimal_places + 1, type->decimal_places);
     } else if (type->type == TYPE_SIGNED_NUMERIC) {
         // Constant.
         if (type->places == 0)
-            strcpy(spec, "%d");
+            buffer_append(out, "%d");
         else if (type->places <= 9)
-            sprintf(spec, "%%.%ud", type->places);
+            buffer_appendf(out, "%%.%ud", type->places);
         else
-            sprintf(spec, "%%.%uld", type->places);
+            buffer_appendf(out, "%%.%uld", type->places);
     } else if (type->type == TYPE_UNSIGNED_NUMERIC) {
         // Constant.
         if (type->places == 0)
-            strcpy(spec, "%u");
+            buffer_append(out, "%u");
         else if (type->places <= 9)
-            sprintf(spec, "%%.%uu", type->places);
+            buffer_appendf(out, "%%.%uu", type->places);
         else
-            sprintf(spec, "%%.%ulu", type->places);
+            buffer_appendf(out, "%%.%ulu", type->places);
     } else if (type->type == TYPE_DECIMAL_SUPRESSED_NUMERIC)
-        strcpy(spec, "%g");
+        buffer_append(out, "%g");
     else if (type->type == TYPE_SIGNED_SUPRESSED_NUMERIC)
-        strcpy(spec, type->places <= 9 ? "%d" : "%lld");
+        buffer_append(out, type->places <= 9 ? "%d" : "%lld");
     else if (type->type == TYPE_UNSIGNED_SUPRESSED_NUMERIC)
-        strcpy(spec, type->places <= 9 ? "%u" : "%llu");
+        buffer_append(out, type->places <= 9 ? "%u" : "%llu");
     else if (type->count == 0)
-        strcpy(spec, "%c");
+        buffer_append(out, "%c");
     else
-        sprintf(spec, "%%.%us", type->places);
+        buffer_appendf(out, "%%.%us", type->places);
+}
+
+// Appends one DISPLAY item to the line at d, returns the most bytes it can take.
+static size_t emit_display_item(Buffer *out, AST *value) {
+    PictureType type = get_value_type(value);
+    const bool is_signed = type.type == TYPE_SIGNED_NUMERIC || type.type == TYPE_SIGNED_SUPRESSED_NUMERIC;
+
+    if (value->type == AST_STRING) {
+        const size_t len = strlen(value->constant.string);
+        buffer_append(out, "memcpy(d, \"");
+        buffer_append(out, value->constant.string);
+        buffer_append(out, "\", sizeof(\"");
+        buffer_append(out, value->constant.string);
+        buffer_append(out, "\") - 1);\nd += sizeof(\"");
+        buffer_append(out, value->constant.string);
+        buffer_append(out, "\") - 1;\n");
+        return len;
+    } else if (IS_STRING(type)) {
+        buffer_append(out, "d = display_string(d, ");
+        emit_value(out, value);
+        buffer_appendf(out, ", %u);\n", type.places);
+        return type.places;
+    } else if ((type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC) && type.comp_type == 0) {
+        buffer_append(out, "*d++ = ");
+        emit_value(out, value);
+        buffer_append(out, ";\n");
+        return 1;
+    } else if (is_packed(&type) || is_wide_numeric(&type) || (is_fixed_point(&type) && type.type == TYPE_DECIMAL_SUPRESSED_NUMERIC)) {
+        // These already have their own formatters.
+        buffer_append(out, "d = display_string(d, ");
+        emit_format_argument(out, value, &type);
+        buffer_append(out, ", 64);\n");
+        return 64;
+    } else if (is_fixed_point(&type)) {
+        buffer_append(out, "d = display_fixed(d, ");
+        emit_value(out, value);
+        buffer_appendf(out, ", %u, %u);\n", type.places + type.decimal_places + 1, type.decimal_places);
+        return type.places + type.decimal_places + 21;
+    } else if (type.comp_type != COMP_POINTER && type.comp_type != COMP1 && type.comp_type != COMP2 &&
+            (is_signed || type.type == TYPE_UNSIGNED_NUMERIC || type.type == TYPE_UNSIGNED_SUPRESSED_NUMERIC)) {
+        // Pictures pad to their digits like %.<places>d, Z pictures and COMP don't pad.
+        const bool pad = type.comp_type == 0 && (type.type == TYPE_SIGNED_NUMERIC || type.type == TYPE_UNSIGNED_NUMERIC);
+        buffer_append(out, is_signed ? "d = display_int(d, " : "d = display_uint(d, ");
+        emit_value(out, value);
+        buffer_appendf(out, ", %u);\n", pad ? type.places : 0);
+        return (pad ? type.places : 0) + 21;
+    }
 
-    return spec;
+    // Floating point and pointers still go through snprintf, %f of a double can take 317 bytes.
+    buffer_append(out, "d += snprintf(d, 352, \"");
+    emit_format_specifier(out, &type);
+    buffer_append(out, "\", ");
+    emit_format_argument(out, value, &type);
+    buffer_append(out, ");\n");
+    return 352;
 }
 
-char *emit_display(AST *ast) {
-    AST *value = ast->display.value;
-    char *arg = value_to_string(value);
-    PictureType type = get_value_type(ast->display.value);
+// The items of back to back DISPLAY statements are formatted into one line
+// buffer sized for the widest they can get, then written at once.
+void emit_display_run(Buffer *out, AST **displays, size_t count) {
+    Buffer items = create_buffer(256);
+    size_t capacity = 1;
 
-    char *spec = picturetype_to_format_specifier(&type);
-    char *code = malloc(strlen(arg) + strlen(spec) + 42);
-    sprintf(code, "printf(\"%s\", %s);\n", spec, arg);
-    free(spec);
+    for (size_t i = 0; i < count; i++) {
+        capacity += emit_display_item(&items, displays[i]->display.value);
 
-    if (ast->display.add_newline)
-        strcat(code, "fputc('\\n', stdout);\n");
+        if (displays[i]->display.add_newline) {
+            buffer_append(&items, "*d++ = '\\n';\n");
+            capacity++;
+        }
+    }
 
-    free(arg);
-    return code;
+    uses_display = true;
+    buffer_appendf(out, "{\nchar display_line[%zu];\nchar *d = display_line;\n", capacity);
+    buffer_append_n(out, items.data, items.len);
+    buffer_append(out, "fwrite(display_line, 1, (size_t)(d - display_line), stdout);\n}\n");
+    delete_buffer(&items);
 }
 
-char *emit_pic(AST *ast) {
-    const char *type = picturetype_to_c(&ast->pic.type);
-    char *name;
+void emit_display(Buffer *out, AST *ast) {
+    emit_display_run(out, &ast, 1);
+}
 
-    if (ast->pic.is_linkage_src && strlen(ast->pic.name) > 3 && ast->pic.name[0] == 'L' &&
-        ast->pic.name[1] == 'S' && ast->pic.name[2] == '-') {
+// VALUE of a packed item as its bytes, false for values that aren't numbers.
+static bool emit_packed_constant(Buffer *out, AST *value, PictureType *type) {
+    const unsigned int digits = packed_digits(type);
+    char text[80];
+    size_t len = 0;
+    bool negative = false;
 
-        // Remove 'LS-' remove linkage variable name.
-        name = picturename_to_c(ast->pic.name + 3);
-    } else
-        name = picturename_to_c(ast->pic.name);
+    if (value->type == AST_INT) {
+        negative = value->constant.i32 < 0;
+        len = (size_t)snprintf(text, sizeof(text), "%lld", negative ? -(long long)value->constant.i32 : (long long)value->constant.i32);
+    } else if (value->type == AST_ZERO)
+        text[len++] = '0';
+    else if (value->type != AST_FLOAT || value->constant.string == NULL)
+        return false;
+
+    unsigned int places = 0;
+
+    if (value->type == AST_FLOAT) {
+        char *c = value->constant.string;
+        negative = *c == '-';
+
+        if (*c == '-' || *c == '+')
+            c++;
+
+        for (; *c >= '0' && *c <= '9' && len < 40; c++)
+            text[len++] = *c;
+
+        if (*c == '.') {
+            for (c++; *c >= '0' && *c <= '9' && places < type->decimal_places; c++, places++)
+                text[len++] = *c;
+        }
+    }
+
+    for (; places < type->decimal_places; places++)
+        text[len++] = '0';
+
+    // Nibbles: a pad nibble for an even digit count, the digits, then the sign.
+    uint8_t nibbles[64] = { 0 };
+    const unsigned int count = digits + 1 + (digits % 2 == 0);
+    bool zero = true;
+
+    for (unsigned int i = 0; i < digits && i < len; i++) {
+        nibbles[count - 2 - i] = (uint8_t)(text[len - 1 - i] - '0');
+        zero &= nibbles[count - 2 - i] == 0;
+    }
+
+    nibbles[count - 1] = !is_signed_type(type) ? 0x0F : negative && !zero ? 0x0D : 0x0C;
+    buffer_appendc(out, '{');
 
-    char *code;
+    for (unsigned int i = 0; i < count; i += 2)
+        buffer_appendf(out, i > 0 ? ", 0x%02X" : "0x%02X", nibbles[i] << 4 | nibbles[i + 1]);
+
+    buffer_appendc(out, '}');
+    return true;
+}
+
+void emit_pic(AST *ast, bool in_struct) {
+    const char *type = picturetype_to_c(&ast->pic.type);
 
     if ((ast->pic.type.type == TYPE_ALPHABETIC || ast->pic.type.type == TYPE_ALPHANUMERIC) && ast->pic.type.count > 0)
         // Account for the null byte.
         ast->pic.type.count++;
 
-    if (ast->pic.value == NULL) {
-        code = malloc(strlen(name) + strlen(type) + 32);
+    if (ast->pic.is_sort) {
+        if (!uses_sort_file) {
+            buffer_append(&globals, SORT_RUNS);
+            buffer_append(&globals, SORT_WORKERS);
+            buffer_append(&globals, SORT_MERGE);
+            buffer_append(&globals, SORT_RELEASE);
+        }
 
-        if (ast->pic.type.count > 0) {
-            if (ast->pic.count > 0)
-                sprintf(code, "%s %s[%u][%u];\n", type, name, ast->pic.count, ast->pic.type.count);
-            else
-                sprintf(code, "%s %s[%u];\n", type, name, ast->pic.type.count);
-        } else if (ast->pic.count > 0)
-            sprintf(code, "%s %s[%u];\n", type, name, ast->pic.count);
-        else
-            sprintf(code, "%s %s;\n", type, name);
-    } else {
-        char *value = value_to_string(ast->pic.value);
-        code = malloc(strlen(name) + strlen(value) + strlen(type) + 32);
-
-        if (ast->pic.is_fd)
-            sprintf(code, "FILE *%s = NULL;\n", name);
-        else if (ast->pic.type.count > 0) {
-            if (ast->pic.count > 0)
-                sprintf(code, "%s %s[%u][%u];\n", type, name, ast->pic.count, ast->pic.type.count);
-            else
-                sprintf(code, "%s %s[%u] = %s;\n", type, name, ast->pic.type.count, value);
-        } else if (ast->pic.count > 0)
-            sprintf(code, "%s %s[%u] = %s;\n", type, name, ast->pic.count, value);
+        uses_sort_file = true;
+        emit_storage(&globals, ast->pic.name);
+        buffer_append(&globals, "SortFile ");
+        emit_picture_name(&globals, ast->pic.name);
+        buffer_append(&globals, "SORT;\n");
+        return;
+    } else if (ast->pic.value != NULL && ast->pic.is_fd) {
+        // The buffer's type has to come before the first file.
+        if (!uses_file_buffer)
+            buffer_append(&globals, FILE_BUFFER);
+
+        uses_file_buffer = true;
+
+        if (ast->pic.is_linkage_src)
+            buffer_append(&globals, "extern ");
+        else if (!in_struct)
+            emit_storage(&globals, ast->pic.name);
+
+        buffer_append(&globals, "FILE *");
+        emit_linkage_name(&globals, ast->pic.name, ast->pic.is_linkage_src);
+        buffer_append(&globals, " = NULL;\n");
+
+        if (ast->pic.is_linkage_src)
+            buffer_append(&globals, "extern ");
+        else if (!in_struct)
+            emit_storage(&globals, ast->pic.name);
+
+        buffer_append(&globals, "FileBuffer ");
+        emit_linkage_name(&globals, ast->pic.name, ast->pic.is_linkage_src);
+        buffer_append(&globals, "BUFFER;\n");
+        return;
+    }
+
+    if (ast->pic.is_linkage_src)
+        buffer_append(&globals, "extern ");
+    else if (!in_struct)
+        emit_storage(&globals, ast->pic.name);
+
+    buffer_append(&globals, type);
+    buffer_appendc(&globals, ' ');
+    emit_linkage_name(&globals, ast->pic.name, ast->pic.is_linkage_src);
+
+    // Tables of strings can't be initialised from a single value.
+    bool has_value = ast->pic.value != NULL && !(ast->pic.type.count > 0 && ast->pic.count > 0);
+
+    if (ast->pic.type.count > 0) {
+        if (ast->pic.count > 0)
+            buffer_appendf(&globals, "[%u][%u]", ast->pic.count, ast->pic.type.count);
         else
-            sprintf(code, "%s %s = %s;\n", type, name, value);
+            buffer_appendf(&globals, "[%u]", ast->pic.type.count);
+    } else if (ast->pic.count > 0)
+        buffer_appendf(&globals, "[%u]", ast->pic.count);
+
+    // Packed items are their bytes, PIC S9(n) COMP-3 takes n / 2 + 1.
+    if (is_packed(&ast->pic.type)) {
+        buffer_appendf(&globals, "[%u]", packed_digits(&ast->pic.type) / 2 + 1);
+        Buffer bytes = create_buffer(64);
+
+        if (has_value && ast->pic.count == 0 && emit_packed_constant(&bytes, ast->pic.value, &ast->pic.type)) {
+            buffer_append(&globals, " = ");
+            buffer_append_n(&globals, bytes.data, bytes.len);
+        }
 
-        free(value);
+        delete_buffer(&bytes);
+        buffer_append(&globals, ";\n");
+        return;
     }
 
-    free(name);
-
-    if (ast->pic.is_linkage_src) {
-        char *temp = malloc(strlen(code) + 10);
-        sprintf(temp, "extern %s", code);
-        free(code);
-        code = temp;
+    if (has_value) {
+        buffer_append(&globals, " = ");
+
+        if (is_fixed_point(&ast->pic.type) && ast->pic.value->type != AST_STRING) {
+            wide_math = is_wide_numeric(&ast->pic.type);
+            emit_fixed(&globals, ast->pic.value, ast->pic.type.decimal_places);
+            wide_math = false;
+        } else if (is_integer_type(&ast->pic.type) && is_long_integer(ast->pic.value)) {
+            wide_math = is_wide_numeric(&ast->pic.type) || fixed_width(ast->pic.value, 0) > 18;
+            emit_fixed(&globals, ast->pic.value, 0);
+            wide_math = false;
+        } else
+            emit_value(&globals, ast->pic.value);
     }
 
-    append_global(code);
-    free(code);
-    return calloc(1, sizeof(char));
+    buffer_append(&globals, ";\n");
 }
 
-char *emit_struct_pic(AST *ast) {
-    char *name = picturename_to_c(ast->pic.name);
-    const size_t name_len = strlen(name);
-    append_global("typedef struct {\n");
+void emit_struct_pic(AST *ast) {
+    buffer_append(&globals, "typedef struct {\n");
 
     for (size_t i = 0; i < ast->pic.fields.size; i++) {
         AST *field = ast->pic.fields.items[i];
         assert(field->pic.fields.size == 0);
-        // emit_pic() returns '\0'.
-        free(emit_stmt(field));
+        emit_pic(field, true);
     }
-    
-    char *def = malloc(name_len + 13);
-    sprintf(def, "} %sSTRUCT;\n", name);
-    append_global(def);
-    free(def);
 
-    char *code = malloc((name_len * 2) + 64);
+    buffer_append(&globals, "} ");
+    emit_picture_name(&globals, ast->pic.name);
+    buffer_append(&globals, "STRUCT;\n");
+
+    if (!ast->pic.is_linkage_src)
+        emit_storage(&globals, ast->pic.name);
+
+    emit_picture_name(&globals, ast->pic.name);
+    buffer_append(&globals, "STRUCT ");
+    emit_picture_name(&globals, ast->pic.name);
 
     if (ast->pic.count > 0)
-        sprintf(code, "%sSTRUCT %s[%u];\n", name, name, ast->pic.count);
+        buffer_appendf(&globals, "[%u]", ast->pic.count);
+
+    buffer_append(&globals, ";\n");
+}
+
+// Stores the number in the string str into dst, leaving endptr after it.
+static void emit_string_to_fixed(Buffer *out, AST *dst, PictureType *type, AST *str) {
+    emit_store_begin(out, dst, type);
+
+    if (is_wide_numeric(type)) {
+        uses_string_to_wide = true;
+        buffer_append(out, "string_to_wide(");
+    } else {
+        uses_string_to_fixed = true;
+        buffer_append(out, "string_to_fixed(");
+    }
+
+    if (str != NULL)
+        emit_value(out, str);
     else
-        sprintf(code, "%sSTRUCT %s;\n", name, name);
+        buffer_append(out, "string_builder");
 
-    free(name);
-    append_global(code);
-    free(code);
-    return calloc(1, sizeof(char));
+    buffer_appendf(out, ", %u, &endptr)", is_fixed_point(type) ? type->decimal_places : 0);
+    emit_store_end(out, type);
+    buffer_append(out, ";\n");
 }
 
-char *emit_move(AST *ast) {
-    char *dst = value_to_string(ast->move.dst);
-    char *src = value_to_string(ast->move.src);
-    char *code;
+// Whether value is a packed item laid out like type, so the bytes can be
+// used as they are.
+static bool is_same_packed(PictureType *type, AST *value) {
+    if (!is_packed(type) || !is_storage_value(value))
+        return false;
 
-    PictureType dst_type = get_value_type(ast->move.dst);
-    PictureType src_type = get_value_type(ast->move.src);
+    PictureType other = get_value_type(value);
+    return is_packed(&other) && packed_digits(&other) == packed_digits(type) &&
+        other.decimal_places == type->decimal_places && is_signed_type(&other) == is_signed_type(type);
+}
 
-    if (dst_type.comp_type == COMP_POINTER) {
-        code = malloc(strlen(src) + strlen(dst) + 64);
+void emit_move(Buffer *out, AST *ast) {
+    AST *dst = ast->move.dst;
+    AST *src = ast->move.src;
 
-        if (ast->move.is_set)
-            sprintf(code, "%s = (POINTERTYPE%zu*)%s;\n", dst, dst_type.pointer_uid, src);
-        else {
+    PictureType dst_type = get_value_type(dst);
+    PictureType src_type = get_value_type(src);
+
+    if (dst_type.comp_type == COMP_POINTER) {
+        if (ast->move.is_set) {
+            emit_value(out, dst);
+            buffer_appendf(out, " = (POINTERTYPE%zu*)", dst_type.pointer_uid);
+        } else {
             // Some statements require explicit casting and dereferencing.
-            if (ast->move.dst->type == AST_SUBSCRIPT && ast->move.dst->subscript.base->type != AST_FIELD)
-                sprintf(code, "%s = %s;\n", dst, src);
-            else
-                sprintf(code, "*((POINTERTYPE%zu*)%s) = %s;\n", dst_type.pointer_uid, dst, src);
+            if (dst->type == AST_SUBSCRIPT && dst->subscript.base->type != AST_FIELD)
+                emit_value(out, dst);
+            else {
+                buffer_appendf(out, "*((POINTERTYPE%zu*)", dst_type.pointer_uid);
+                emit_value(out, dst);
+                buffer_appendc(out, ')');
+            }
+
+            buffer_append(out, " = ");
         }
+
+        emit_value(out, src);
+        buffer_append(out, ";\n");
     } else if (IS_STRING(dst_type) && IS_STRING(src_type)) {
-        code = malloc(strlen(src) + strlen(dst) + 64);
-        sprintf(code, "strncpy(%s, %s, %u);\n", dst, src, dst_type.count + 1);
+        buffer_append(out, "strncpy(");
+        emit_value(out, dst);
+        buffer_append(out, ", ");
+        emit_value(out, src);
+        buffer_appendf(out, ", %u);\n", dst_type.count + 1);
     } else if (IS_STRING(dst_type)) {
-        char *spec = picturetype_to_format_specifier(&src_type);
-        code = malloc(strlen(src) + strlen(dst) + strlen(spec) + 64);
-        sprintf(code, "snprintf(%s, %u, \"%s\", %s);\n", dst, dst_type.count + 1, spec, src);
-        free(spec);
+        buffer_append(out, "snprintf(");
+        emit_value(out, dst);
+        buffer_appendf(out, ", %u, \"", dst_type.count + 1);
+        emit_format_specifier(out, &src_type);
+        buffer_append(out, "\", ");
+        emit_format_argument(out, src, &src_type);
+        buffer_append(out, ");\n");
+    } else if (IS_STRING(src_type) && (is_fixed_point(&dst_type) || is_wide_numeric(&dst_type) || is_packed(&dst_type))) {
+        buffer_append(out, "errno = 0;\n");
+        emit_string_to_fixed(out, dst, &dst_type, src);
+        buffer_append(out, "if (");
+        emit_value(out, src);
+        buffer_append(out, " == endptr || *endptr != '\\0')\ncobol_error();\n");
     } else if (IS_STRING(src_type)) {
         char *conv;
 
@@ -496,122 +1451,106 @@ char *emit_move(AST *ast) {
         else
             conv = "d";
 
-        code = malloc((strlen(src) * 2) + strlen(dst) + strlen(conv) + 133);
-        sprintf(code, "errno = 0;\n"
-                      "%s = strto%s(%s, &endptr%s;\n"
-                      "if (%s == endptr || *endptr != '\\0' || errno == ERANGE || errno == EINVAL)\ncobol_error();\n", 
-                      dst, conv, src, dst_type.type == TYPE_DECIMAL_NUMERIC ? ")" : ", 10)", src);
-    } else {
-        code = malloc(strlen(src) + strlen(dst) + 10);
-        sprintf(code, "%s = %s;\n", dst, src);
-    }
-
-    free(dst);
-    free(src);
-    return code;
+        buffer_append(out, "errno = 0;\n");
+        emit_value(out, dst);
+        buffer_appendf(out, " = strto%s(", conv);
+        emit_value(out, src);
+        buffer_append(out, dst_type.type == TYPE_DECIMAL_NUMERIC ? ", &endptr);\n" : ", &endptr, 10);\n");
+        buffer_append(out, "if (");
+        emit_value(out, src);
+        buffer_append(out, " == endptr || *endptr != '\\0' || errno == ERANGE || errno == EINVAL)\ncobol_error();\n");
+    } else if (is_same_packed(&dst_type, src)) {
+        buffer_append(out, "memcpy(");
+        emit_value(out, dst);
+        buffer_append(out, ", ");
+        emit_value(out, src);
+        buffer_appendf(out, ", %u);\n", packed_digits(&dst_type) / 2 + 1);
+    } else
+        emit_assign_math(out, dst, &src, 1, false);
 }
 
-char *emit_arithmetic(AST *ast) {
-    char *left = value_to_string(ast->arithmetic.left);
-    char *right = value_to_string(ast->arithmetic.right);
-    char *dst;
-
-    if (ast->arithmetic.implicit_giving)
-        dst = value_to_string(ast->arithmetic.right);
-    else
-        dst = value_to_string(ast->arithmetic.dst);
-
-    char *code = malloc(strlen(left) + strlen(right) + strlen(dst) + 27);
+void emit_arithmetic(Buffer *out, AST *ast) {
+    AST *left = ast->arithmetic.left;
+    AST *right = ast->arithmetic.right;
+    AST oper = { .type = AST_OPER };
+    AST *items[3] = { left, &oper, right };
 
     if (strcmp(ast->arithmetic.name, "ADD") == 0)
-        sprintf(code, "%s = %s + %s;\n", dst, left, right);
-    else if (strcmp(ast->arithmetic.name, "SUBTRACT") == 0)
-        sprintf(code, "%s = %s - %s;\n", dst, right, left);
-    else if (strcmp(ast->arithmetic.name, "MULTIPLY") == 0)
-        sprintf(code, "%s = %s * %s;\n", dst, left, right);
+        oper.oper = TOK_PLUS;
+    else if (strcmp(ast->arithmetic.name, "SUBTRACT") == 0) {
+        items[0] = right;
+        oper.oper = TOK_MINUS;
+        items[2] = left;
+    } else if (strcmp(ast->arithmetic.name, "MULTIPLY") == 0)
+        oper.oper = TOK_STAR;
     else if (strcmp(ast->arithmetic.name, "DIVIDE") == 0)
-        sprintf(code, "%s = %s / %s;\n", dst, left, right);
+        oper.oper = TOK_SLASH;
     else
-        sprintf(code, "%s = (long long)%s %% %s;\n", dst, left, right);
+        oper.oper = TOK_MOD;
+
+    // ADD and SUBTRACT between packed items of the same scale stay in BCD.
+    PictureType dst_type = get_value_type(right);
+    PictureType src_type = get_value_type(left);
+
+    if ((oper.oper == TOK_PLUS || oper.oper == TOK_MINUS) && ast->arithmetic.implicit_giving && !ast->arithmetic.rounded &&
+            is_packed(&dst_type) && is_storage_value(left) && is_packed(&src_type) && src_type.decimal_places == dst_type.decimal_places) {
+        uses_packed = true;
+        buffer_append(out, "packed_add(");
+        emit_value(out, right);
+        buffer_appendf(out, ", %u, %s, ", packed_digits(&dst_type), is_signed_type(&dst_type) ? "true" : "false");
+        emit_value(out, left);
+        buffer_appendf(out, ", %u, %s);\n", packed_digits(&src_type), oper.oper == TOK_MINUS ? "true" : "false");
+        return;
+    }
 
-    free(left);
-    free(right);
-    free(dst);
-    return code;
+    emit_assign_math(out, ast->arithmetic.implicit_giving ? right : ast->arithmetic.dst, items, 3, ast->arithmetic.rounded);
 }
 
-char *emit_math(AST *ast) {
-    char *values = malloc(32);
-    values[0] = '\0';
-    size_t values_len = 0;
-    size_t values_cap = 32;
+static void emit_math_items(Buffer *out, AST **items, size_t count) {
     bool has_mod = false;
 
-    for (size_t i = 1; i < ast->math.size; i += 2) {
-        if (ast->math.items[i]->oper == TOK_MOD) {
+    for (size_t i = 1; i < count; i += 2) {
+        if (items[i]->oper == TOK_MOD) {
             has_mod = true;
-            continue;
+            break;
         }
     }
 
-    for (size_t i = 0; i < ast->math.size; i++) {
-        AST *value = ast->math.items[i];
-        char *value_string;
-        
-        if (value->type == AST_OPER) {
-            value_string = malloc(2);
+    for (size_t i = 0; i < count; i++) {
+        AST *value = items[i];
 
+        if (value->type == AST_OPER) {
             if (value->oper == TOK_PLUS)
-                strcpy(value_string, "+");
+                buffer_appendc(out, '+');
             else if (value->oper == TOK_MINUS)
-                strcpy(value_string, "-");
+                buffer_appendc(out, '-');
             else if (value->oper == TOK_STAR)
-                strcpy(value_string, "*");
+                buffer_appendc(out, '*');
             else if (value->oper == TOK_SLASH)
-                strcpy(value_string, "/");
+                buffer_appendc(out, '/');
             else {
-                strcpy(value_string, "%");
+                buffer_appendc(out, '%');
                 has_mod = true;
             }
-        } else
-            value_string = value_to_string(value);
-
-        const size_t value_len = strlen(value_string);
-
-        if (values_len + value_len + 15 >= values_cap) {
-            while (values_len + value_len + 15 >= values_cap)
-                values_cap *= 2;
-
-            values = realloc(values, values_cap);
-        }
+        } else {
+            if (has_mod)
+                buffer_append(out, "(long long)");
 
-        if (value->type != AST_OPER && has_mod) {
-            strcat(values, "(long long)");
-            values_len += 12;
+            emit_number(out, value);
         }
 
-        strcat(values, value_string);
-
-        values_len += value_len;
-        free(value_string);
-
-        if (i != ast->math.size - 1)
-            strcat(values, " ");
+        if (i != count - 1)
+            buffer_appendc(out, ' ');
     }
-
-    return values;
 }
 
-char *emit_compute(AST *ast) {
-    char *dst = value_to_string(ast->compute.dst);
-    char *math = value_to_string(ast->compute.math);
-
-    char *values = malloc(strlen(dst) + strlen(math) + 10);
-    sprintf(values, "%s = %s;\n", dst, math);
+void emit_math(Buffer *out, AST *ast) {
+    emit_math_items(out, ast->math.items, ast->math.size);
+}
 
-    free(dst);
-    free(math);
-    return values;
+void emit_compute(Buffer *out, AST *ast) {
+    AST *math = ast->compute.math;
+    emit_assign_math(out, ast->compute.dst, math->math.items, math->math.size, ast->compute.rounded);
 }
 
 char *oper_to_string(TokenType oper) {
@@ -630,794 +1569,1368 @@ char *oper_to_string(TokenType oper) {
     return "||";
 }
 
-char *emit_condition(AST *ast) {
-    char *values = malloc(32);
-    strcpy(values, "(");
-    size_t values_len = 1;
-    size_t values_cap = 32;
+static bool is_comparison(TokenType oper) {
+    return oper == TOK_EQ || oper == TOK_EQUAL || oper == TOK_NEQ || oper == TOK_LT ||
+        oper == TOK_LTE || oper == TOK_GT || oper == TOK_GTE;
+}
+
+// Compares at the larger scale of the two sides, false if neither is fixed point.
+static bool emit_fixed_comparison(Buffer *out, AST *left, TokenType oper, AST *right) {
+    bool has_fixed = false;
+    bool opaque = false;
+    classify_fixed(left, &has_fixed, &opaque);
+    classify_fixed(right, &has_fixed, &opaque);
+
+    if (!has_fixed || opaque)
+        return false;
+
+    PictureType left_type = get_value_type(left);
+    PictureType right_type = get_value_type(right);
+
+    // Packed items of the same scale are compared digit by digit.
+    if (is_storage_value(left) && is_storage_value(right) && is_packed(&left_type) && is_packed(&right_type) &&
+            left_type.decimal_places == right_type.decimal_places) {
+        buffer_append(out, "(packed_compare(");
+        emit_value(out, left);
+        buffer_appendf(out, ", %u, ", packed_digits(&left_type));
+        emit_value(out, right);
+        buffer_appendf(out, ", %u) %s 0)", packed_digits(&right_type), oper_to_string(oper));
+        return true;
+    }
+
+    const unsigned int left_scale = fixed_scale(left);
+    const unsigned int right_scale = fixed_scale(right);
+    const unsigned int scale = left_scale > right_scale ? left_scale : right_scale;
+
+    wide_math = fixed_width(left, scale) > 18 || fixed_width(right, scale) > 18;
+    emit_fixed(out, left, scale);
+    buffer_appendf(out, " %s ", oper_to_string(oper));
+    emit_fixed(out, right, scale);
+    wide_math = false;
+    return true;
+}
+
+void emit_condition(Buffer *out, AST *ast) {
+    buffer_appendc(out, '(');
 
     for (size_t i = 0; i < ast->condition.size; i++) {
         AST *value = ast->condition.items[i];
-        char *value_string;
-        
-        if (value->type == AST_OPER) {
-            value_string = malloc(3);
-            strcpy(value_string, oper_to_string(value->oper));
-        } else {
+
+        if (value->type == AST_OPER)
+            buffer_append(out, oper_to_string(value->oper));
+        else {
             PictureType type = get_value_type(value);
 
             // Check for when we need to do strcmp().
-            if (i + 2 < ast->condition.size && 
+            if (i + 2 < ast->condition.size &&
                     (type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC) && type.count > 0) {
 
-                char *lhs = value_to_string(value);
-                char *oper = oper_to_string(ast->condition.items[i + 1]->oper);
-                char *rhs = value_to_string(ast->condition.items[i + 2]);
-
-                value_string = malloc(strlen(lhs) + strlen(rhs) + strlen(oper) + 20);
-                sprintf(value_string, "strcmp(%s, %s) %s 0", lhs, rhs, oper);
-
-                free(lhs);
-                free(rhs);
+                buffer_append(out, "strcmp(");
+                emit_value(out, value);
+                buffer_append(out, ", ");
+                emit_value(out, ast->condition.items[i + 2]);
+                buffer_appendf(out, ") %s 0", oper_to_string(ast->condition.items[i + 1]->oper));
 
                 i += 2; // Skip the rest of the condition values as we did them here.
-            } else
-                value_string = value_to_string(value);
+            } else if (i + 2 < ast->condition.size && is_comparison(ast->condition.items[i + 1]->oper) &&
+                    emit_fixed_comparison(out, value, ast->condition.items[i + 1]->oper, ast->condition.items[i + 2]))
+                i += 2;
+            else
+                emit_number(out, value);
         }
 
-        const size_t value_len = strlen(value_string);
-
-        if (values_len + value_len + 16 >= values_cap) {
-            while (values_len + value_len + 15 >= values_cap)
-                values_cap *= 2;
+        if (i != ast->condition.size - 1)
+            buffer_appendc(out, ' ');
+    }
 
-            values = realloc(values, values_cap);
-        }
+    buffer_appendc(out, ')');
+}
 
-        strcat(values, value_string);
-        free(value_string);
-        values_len += value_len;
+void emit_if(Buffer *out, AST *ast) {
+    buffer_append(out, "if ");
+    emit_condition(out, ast->if_stmt.condition);
+    buffer_append(out, " {\n");
+    emit_list(out, &ast->if_stmt.body);
 
-        if (i != ast->math.size - 1)
-            strcat(values, " ");
+    if (ast->if_stmt.else_body.size > 0) {
+        buffer_append(out, "} else {\n");
+        emit_list(out, &ast->if_stmt.else_body);
     }
 
-    strcat(values, ")");
-    return values;
+    buffer_append(out, "}\n");
 }
 
-char *emit_if(AST *ast) {
-    char *condition = emit_condition(ast->if_stmt.condition);
-    char *body = emit_list(&ast->if_stmt.body);
-    char *code;
-    
-    if (ast->if_stmt.else_body.size > 0) {
-        char *else_body = emit_list(&ast->if_stmt.else_body);
-        code = malloc(strlen(condition) + strlen(body) + strlen(else_body) + 27);
-        sprintf(code, "if %s {\n%s} else {\n%s}\n", condition, body, else_body);
-        free(else_body);
-    } else {
-        code = malloc(strlen(condition) + strlen(body) + 15);
-        sprintf(code, "if %s {\n%s}\n", condition, body);
-    }
-
-    free(body);
-    free(condition);
-    return code;
+void emit_not(Buffer *out, AST *ast) {
+    buffer_append(out, "!(");
+    emit_value(out, ast->not_value);
+    buffer_appendc(out, ')');
+}
+
+void emit_label(Buffer *out, AST *ast) {
+    emit_picture_name(out, ast->label);
+    buffer_append(out, ":\n");
+}
+
+void emit_goto(Buffer *out, AST *ast) {
+    buffer_append(out, "goto ");
+    emit_value(out, ast->go);
+    buffer_append(out, ";\n");
 }
 
-char *emit_not(AST *ast) {
-    char *value = value_to_string(ast->not_value);
-    char *code = malloc(strlen(value) + 4);
-    sprintf(code, "!(%s)", value);
-    free(value);
-    return code;
+// Pushes the return address and the paragraph whose end pops it, then jumps to first.
+static void emit_jump_and_return(Buffer *out, AST *first, AST *last) {
+    const size_t ret = return_labels++;
+
+    buffer_appendf(out, "{\nif (perform_sp == %d)\ncobol_error();\nperform_stack[perform_sp++] = (PerformFrame){ &&ret_%zu, &&end", PERFORM_STACK_SIZE, ret);
+    emit_value(out, last);
+    buffer_append(out, " };\ngoto ");
+    emit_value(out, first);
+    buffer_appendf(out, ";\nret_%zu:;\n}\n", ret);
 }
 
-char *emit_label(AST *ast) {
-    char *name = picturename_to_c(ast->label);
-    char *code = malloc(strlen(name) + 4);
-    sprintf(code, "%s:\n", name); 
-    free(name);
-    return code;
+void emit_perform(Buffer *out, AST *ast) {
+    if (single_function) {
+        emit_jump_and_return(out, ast->perform, ast->perform);
+        return;
+    }
+
+    emit_value(out, ast->perform);
+    buffer_append(out, "();\n");
 }
 
-/*
-char *emit_goto(AST *ast) {
-    char *label = value_to_string(ast->go);
-    char *code = malloc(strlen(label) + 10);
-    sprintf(code, "goto %s;\n", label);
-    free(label);
-    return code;
+void emit_perform_thru(Buffer *out, AST *ast) {
+    assert(single_function);
+    emit_jump_and_return(out, ast->perform_thru.first, ast->perform_thru.last);
 }
-*/
 
-char *emit_perform(AST *ast) {
-    char *label = value_to_string(ast->perform);
-    char *code = malloc(strlen(label) + 7);
-    sprintf(code, "%s();\n", label);
-    free(label);
-    return code;
+// The paragraph is a label and falls through into the next one unless
+// its end is where the innermost PERFORM stops.
+static void emit_paragraph(Buffer *out, AST *ast) {
+    emit_picture_name(out, ast->proc.name);
+    buffer_append(out, ":;\n");
+
+    // The parser nests the paragraphs that follow this one in its body.
+    size_t nested = 0;
+
+    while (nested < ast->proc.body.size && ast->proc.body.items[nested]->type != AST_PROC)
+        nested++;
+
+    emit_items(out, ast->proc.body.items, nested);
+
+    buffer_append(out, "end");
+    emit_picture_name(out, ast->proc.name);
+    buffer_append(out, ":\nif (perform_sp > 0 && perform_stack[perform_sp - 1].last == &&end");
+    emit_picture_name(out, ast->proc.name);
+    buffer_append(out, ")\ngoto *perform_stack[--perform_sp].ret;\n");
+
+    for (size_t i = nested; i < ast->proc.body.size; i++)
+        emit_stmt(out, ast->proc.body.items[i]);
 }
 
-char *emit_procedure(AST *ast) {
-    char *body = emit_list(&ast->proc.body);
-    char *name = picturename_to_c(ast->proc.name);
-    char *code = malloc(strlen(name) + strlen(body) + 18);
-    sprintf(code, "void %s() {\n%s}\n", name, body);
-    free(body);
-    append_function(code);
+void emit_procedure(Buffer *out, AST *ast) {
+    if (single_function) {
+        emit_paragraph(out, ast);
+        return;
+    }
 
-    sprintf(code, "void %s();\n", name);
-    append_function_predef(code);
-    free(code);
-    free(name);
-    return calloc(1, sizeof(char));
+    // The body goes through its own buffer because any procedures
+    // nested in it have to land in functions before this one.
+    Buffer body = create_buffer(1024);
+    emit_list(&body, &ast->proc.body);
+
+    // Paragraphs can only be performed from their own program, gcc inlines
+    // the ones performed from a single place once it knows nothing else calls them.
+    const char *storage = "";
+
+    if (whole_program)
+        storage = ast->proc.sym->performs == 1 ? "static inline " : "static ";
+
+    buffer_append(&functions, storage);
+    buffer_append(&functions, "void ");
+    emit_picture_name(&functions, ast->proc.name);
+    buffer_append(&functions, "() {\n");
+    buffer_append_n(&functions, body.data, body.len);
+    buffer_append(&functions, "}\n");
+    delete_buffer(&body);
+
+    buffer_append(&function_predefs, storage);
+    buffer_append(&function_predefs, "void ");
+    emit_picture_name(&function_predefs, ast->proc.name);
+    buffer_append(&function_predefs, "();\n");
 }
 
-char *emit_perform_condition(AST *ast) {
-    char *stmt = emit_stmt(ast->perform_condition.proc);
-    char *condition = emit_stmt(ast->perform_condition.condition);
-    char *code = malloc(strlen(stmt) + strlen(condition) + 17);
-    sprintf(code, "while (!(%s))\n%s", condition, stmt);
-    free(stmt);
-    free(condition);
-    return code;
+void emit_perform_condition(Buffer *out, AST *ast) {
+    buffer_append(out, "while (!(");
+    emit_stmt(out, ast->perform_condition.condition);
+    buffer_append(out, "))\n");
+    emit_stmt(out, ast->perform_condition.proc);
 }
 
-char *emit_perform_count(AST *ast) {
-    char *stmt = emit_stmt(ast->perform_count.proc);
-    char *code = malloc(strlen(stmt) + 41);
-    sprintf(code, "for (unsigned int i = 0; i < %u; i++)\n%s", ast->perform_count.times, stmt);
-    free(stmt);
-    return code;
+void emit_perform_count(Buffer *out, AST *ast) {
+    buffer_appendf(out, "for (unsigned int i = 0; i < %u; i++)\n", ast->perform_count.times);
+    emit_stmt(out, ast->perform_count.proc);
 }
 
-char *emit_perform_varying(AST *ast) {
-    char *iter = value_to_string(ast->perform_varying.var);
-    char *from = value_to_string(ast->perform_varying.from);
-    char *by = value_to_string(ast->perform_varying.by);
-    char *condition = value_to_string(ast->perform_varying.until);
-    char *body = emit_list(&ast->perform_varying.body);
+void emit_perform_varying(Buffer *out, AST *ast) {
+    AST *var = ast->perform_varying.var;
+    PictureType type = get_value_type(var);
+    bool has_fixed = is_fixed_point(&type) || is_packed(&type);
+    bool opaque = !has_fixed && !is_integer_type(&type);
+    classify_fixed(ast->perform_varying.from, &has_fixed, &opaque);
+    classify_fixed(ast->perform_varying.by, &has_fixed, &opaque);
+
+    // FROM and BY are scaled to the variable when any of them is fixed point.
+    const bool fixed = has_fixed && !opaque;
+    const unsigned int scale = is_fixed_point(&type) ? type.decimal_places : 0;
+    wide_math = fixed && is_wide_numeric(&type);
+
+    buffer_append(out, "for (");
+    emit_store_begin(out, var, &type);
 
-    char *code = malloc((strlen(iter) * 2) + strlen(from) + strlen(by) + strlen(condition) + strlen(body) + 32);
-    sprintf(code, "for (%s = %s; !%s; %s += %s) {\n%s}\n", iter, from, condition, iter, by, body);
+    if (fixed)
+        emit_fixed(out, ast->perform_varying.from, scale);
+    else
+        emit_number(out, ast->perform_varying.from);
+
+    emit_store_end(out, &type);
+    buffer_append(out, "; !");
+    emit_value(out, ast->perform_varying.until);
+    buffer_append(out, "; ");
+
+    // Packed items can't be added to in place, they're read back and stored.
+    if (is_packed(&type)) {
+        emit_store_begin(out, var, &type);
+
+        if (fixed)
+            emit_fixed(out, var, scale);
+        else
+            emit_number(out, var);
+
+        buffer_append(out, " + ");
+    } else {
+        emit_value(out, var);
+        buffer_append(out, " += ");
+    }
 
-    free(body);
-    free(condition);
-    free(by);
-    free(from);
-    free(iter);
-    return code;
+    if (fixed)
+        emit_fixed(out, ast->perform_varying.by, scale);
+    else
+        emit_number(out, ast->perform_varying.by);
+
+    emit_store_end(out, &type);
+    wide_math = false;
+
+    buffer_append(out, ") {\n");
+    emit_list(out, &ast->perform_varying.body);
+    buffer_append(out, "}\n");
 }
 
-char *emit_perform_until(AST *ast) {
-    char *condition = emit_stmt(ast->perform_until.until);
-    char *body = emit_list(&ast->perform_until.body);
+void emit_perform_until(Buffer *out, AST *ast) {
+    buffer_append(out, "while (!");
+    emit_stmt(out, ast->perform_until.until);
+    buffer_append(out, ") {\n");
+    emit_list(out, &ast->perform_until.body);
+    buffer_append(out, "}\n");
+}
 
-    char *code = malloc(strlen(condition) + strlen(body) + 41);
-    sprintf(code, "while (!%s) {\n%s}\n", condition, body);
+void emit_subscript(Buffer *out, AST *ast) {
+    AST *base = ast->subscript.base;
 
-    free(condition);
-    free(body);
-    return code;
-}
+    if (base->type == AST_FIELD) {
+        emit_picture_name(out, get_struct_sym(base)->name);
+        buffer_append(out, "[(size_t)(");
+        emit_value(out, ast->subscript.index);
+        buffer_append(out, " - 1)].");
+        emit_picture_name(out, base->field.sym->name);
+        return;
+    }
 
-char *emit_subscript(AST *ast) {
-    char *base = value_to_string(ast->subscript.base);
-    char *index = value_to_string(ast->subscript.index);
-    char *code;
-    PictureType type = get_value_type(ast->subscript.base);
+    PictureType type = get_value_type(base);
 
     // Pointer subscripts require explicit casts.
     if (type.comp_type == COMP_POINTER) {
-        char *temp = malloc(strlen(base) + 64);
-        sprintf(temp, "((POINTERTYPE%zu*)%s)", type.pointer_uid, base);
-        free(base);
-        base = temp;
-    } 
-    
-    if (ast->subscript.base->type == AST_FIELD) {
-        char *struct_name = picturename_to_c(get_struct_sym(ast->subscript.base)->name);
-        char *field_name = picturename_to_c(ast->subscript.base->field.sym->name);
-
-        code = malloc(strlen(struct_name) + strlen(field_name) + strlen(index) + 64);
-        sprintf(code, "%s[(size_t)(%s - 1)].%s", struct_name, index, field_name);
-
-        free(struct_name);
-        free(field_name);
-    } else if (ast->subscript.value == NULL) {
-        code = malloc(strlen(base) + strlen(index) + 64);
-        sprintf(code, "%s[(size_t)(%s - 1)]", base, index);
-    } else {
-        char *value = value_to_string(ast->subscript.value);
-        code = malloc(strlen(base) + strlen(index) + strlen(value) + 64);
-        sprintf(code, "%s[(size_t)(%s - 1)] = %s;\n", base, index, value);
-        free(value);
-    }
+        buffer_appendf(out, "((POINTERTYPE%zu*)", type.pointer_uid);
+        emit_value(out, base);
+        buffer_appendc(out, ')');
+    } else
+        emit_value(out, base);
 
-    free(base);
-    free(index);
-    return code;
+    buffer_append(out, "[(size_t)(");
+    emit_number(out, ast->subscript.index);
+    buffer_append(out, " - 1)]");
+
+    if (ast->subscript.value != NULL) {
+        buffer_append(out, " = ");
+        emit_value(out, ast->subscript.value);
+        buffer_append(out, ";\n");
+    }
 }
 
-char *emit_call(AST *ast) {
-    char *code;
-    
-    if (ast->call.returning == NULL) {
-        code = malloc(strlen(ast->call.name) + 8);
-        sprintf(code, "%s(", ast->call.name);
-    } else {
-        char *returning = value_to_string(ast->call.returning);
-        code = malloc(strlen(returning) + strlen(ast->call.name) + 32);
-        sprintf(code, "%s = %s(", returning, ast->call.name);
-        free(returning);
+void emit_call(Buffer *out, AST *ast) {
+    if (ast->call.returning != NULL) {
+        emit_value(out, ast->call.returning);
+        buffer_append(out, " = ");
     }
 
-    size_t len = strlen(code);
+    buffer_append(out, ast->call.name);
+    buffer_appendc(out, '(');
 
     for (size_t i = 0; i < ast->call.args.size; i++) {
-        char *arg = value_to_string(ast->call.args.items[i]);
-        const size_t arg_len = strlen(arg);
-
-        code = realloc(code, len + arg_len + 7);
-        strcat(code, arg);
-        free(arg);
-        len += arg_len;
+        emit_number(out, ast->call.args.items[i]);
 
-        if (i != ast->call.args.size - 1) {
-            strcat(code, ", ");
-            len += 2;
-        }
+        if (i != ast->call.args.size - 1)
+            buffer_append(out, ", ");
     }
 
-    strcat(code, ");\n");
-    return code;
+    buffer_append(out, ");\n");
 }
 
-void emit_string_stmt_previous_size(StringStatement *stmt, char *value, char **increment, char **size, bool stmt_already_loaded, PictureType *type) {
+void emit_string_stmt_previous_size(Buffer *out, StringStatement *stmt, bool stmt_already_loaded, PictureType *type, bool emit_size) {
     // stmt_already_loaded means that the string value is already in string_builder,
     // we don't want to check stmt->value for constants.
-
-    *increment = malloc((strlen(value) * 2) + 256);
-    *size = malloc(strlen(value) + 128);
+    //
+    // emit_size picks between the statement that sets previous_string_statement_size
+    // and the expression for the size itself.
 
     if (!stmt_already_loaded && stmt->value->type == AST_STRING) {
         // Strings can be done at compile time.
+        const size_t size = stmt->delimit == DELIM_SIZE ? strlen(stmt->value->constant.string) : strcspn(stmt->value->constant.string, " ");
 
-        if (stmt->delimit == DELIM_SIZE) {
-            sprintf(*increment, "previous_string_statement_size = %zu;\n", strlen(stmt->value->constant.string));
-            sprintf(*size, "%zu", strlen(stmt->value->constant.string));
-        } else {
-            sprintf(*increment, "previous_string_statement_size = %zu;\n", strcspn(stmt->value->constant.string, " "));
-
-            char *temp = strchr(stmt->value->constant.string, ' ');
+        if (emit_size)
+            buffer_appendf(out, "%zu", size);
+        else
+            buffer_appendf(out, "previous_string_statement_size = %zu;\n", size);
+    }
 
-            if (temp != NULL)
-                sprintf(*size, "%zu", (size_t)(temp - stmt->value->constant.string));
-            else
-                sprintf(*size, "%zu", strlen(stmt->value->constant.string));
-        }
-    } 
-    
     // If a non-string is DELIMETED BY SPACE then we want it to be treated as DELIMETED BY SIZE
     // here because there aren't any spaces in a non-string.
     else if (stmt->delimit == DELIM_SIZE || (type != NULL && (type->type != TYPE_ALPHABETIC || type->type != TYPE_ALPHANUMERIC || type->count == 0))) {
+        if (!emit_size)
+            buffer_append(out, "previous_string_statement_size = ");
+
         if (type != NULL && (type->type == TYPE_ALPHABETIC || type->type == TYPE_ALPHANUMERIC) && type->count > 0) {
-            sprintf(*increment, "previous_string_statement_size = strlen(%s);\n", value);
-            sprintf(*size, "strlen(%s)", value);
-        } else {
+            buffer_append(out, "strlen(");
+            emit_value(out, stmt->value);
+            buffer_appendc(out, ')');
+        } else
             // spare_string_buffer will be formatted as a string from the non-string value.
-            strcpy(*increment, "previous_string_statement_size = strlen(spare_string_buffer);\n");
-            strcpy(*size, "strlen(spare_string_buffer)");
-        }
-    } else {
+            buffer_append(out, "strlen(spare_string_buffer)");
+
+        if (!emit_size)
+            buffer_append(out, ";\n");
+    } else if (emit_size)
+        buffer_append(out, "previous_string_statement_size");
+    else {
         // The +1 at the end of the increment is important because it skips the space character,
         // otherwise the next search would start at the space character, and return 0 size.
-        sprintf(*increment, "endptr = strchr(string_builder + string_builder_pointer, ' ');\n"
-                            "if (endptr != NULL)\nprevious_string_statement_size = endptr - (string_builder + string_builder_pointer);\n"
-                            "else\nprevious_string_statement_size = strlen(%s);\n", value);
-
-        strcpy(*size, "previous_string_statement_size");
+        buffer_append(out, "endptr = strchr(string_builder + string_builder_pointer, ' ');\n"
+                           "if (endptr != NULL)\nprevious_string_statement_size = endptr - (string_builder + string_builder_pointer);\n"
+                           "else\nprevious_string_statement_size = strlen(");
+        emit_value(out, stmt->value);
+        buffer_append(out, ");\n");
     }
 }
 
-char *emit_string_stmt(StringStatement *stmt) {
-    char *value = value_to_string(stmt->value);
-    char *increment = NULL;
-    char *size = NULL;
+void emit_string_stmt(Buffer *out, StringStatement *stmt) {
     PictureType type = get_value_type(stmt->value);
-    emit_string_stmt_previous_size(stmt, value, &increment, &size, false, &type);
-
-    assert(increment != NULL);
-    assert(size != NULL);
-
-    char *code = malloc(strlen(value) + strlen(increment) + strlen(size) + 128);
 
     // Avoid stringop-overflow error from using strncat with string literals delimited by size.
-    if (stmt->value->type == AST_STRING && stmt->delimit == DELIM_SIZE)
-        sprintf(code, "strcat(string_builder, %s);\n"
-                      "%s", value, increment);
+    if (stmt->value->type == AST_STRING && stmt->delimit == DELIM_SIZE) {
+        buffer_append(out, "strcat(string_builder, ");
+        emit_value(out, stmt->value);
+        buffer_append(out, ");\n");
+        emit_string_stmt_previous_size(out, stmt, false, &type, false);
+    }
 
     // Non-string needs to be formatted first.
     else if (type.type != TYPE_ALPHABETIC && type.type != TYPE_ALPHANUMERIC && type.count == 0) {
-        char *spec = picturetype_to_format_specifier(&type);
-        sprintf(code, "snprintf(spare_string_buffer, 4095, \"%s\", %s);\n"
-                      "%s"
-                      "strncat(string_builder, spare_string_buffer, previous_string_statement_size);\n", spec, value, increment);
-        free(spec);
+        buffer_append(out, "snprintf(spare_string_buffer, 4095, \"");
+        emit_format_specifier(out, &type);
+        buffer_append(out, "\", ");
+        emit_format_argument(out, stmt->value, &type);
+        buffer_append(out, ");\n");
+        emit_string_stmt_previous_size(out, stmt, false, &type, false);
+        buffer_append(out, "strncat(string_builder, spare_string_buffer, previous_string_statement_size);\n");
     }
 
     // Some size statements require setting up the endptr variable for searching for a space.
-    else if (stmt->delimit == DELIM_SPACE)
-        sprintf(code, "%s"
-                      "strncat(string_builder, %s, %s);\n", increment, value, size);
-    else
-        sprintf(code, "strncat(string_builder, %s, %s);\n"
-                      "%s", value, size, increment);
+    else if (stmt->delimit == DELIM_SPACE) {
+        emit_string_stmt_previous_size(out, stmt, false, &type, false);
+        buffer_append(out, "strncat(string_builder, ");
+        emit_value(out, stmt->value);
+        buffer_append(out, ", ");
+        emit_string_stmt_previous_size(out, stmt, false, &type, true);
+        buffer_append(out, ");\n");
+    } else {
+        buffer_append(out, "strncat(string_builder, ");
+        emit_value(out, stmt->value);
+        buffer_append(out, ", ");
+        emit_string_stmt_previous_size(out, stmt, false, &type, true);
+        buffer_append(out, ");\n");
+        emit_string_stmt_previous_size(out, stmt, false, &type, false);
+    }
+}
+
+void emit_unstring(Buffer *out, AST *ast) {
+    StringStatement *base = &ast->string_splitter.base;
 
-    free(value);
-    free(increment);
-    free(size);
-    return code;
+    buffer_append(out, "string_builder[0] = string_builder_pointer = 0;\n"
+                       "strcpy(string_builder, ");
+    emit_value(out, base->value);
+    buffer_append(out, ");\n");
+
+    for (size_t i = 0; i < ast->string_splitter.into_vars.size; i++) {
+        AST *var = ast->string_splitter.into_vars.items[i];
+        PictureType type = get_value_type(var);
+
+        emit_string_stmt_previous_size(out, base, true, NULL, false);
+        buffer_append(out, "strncpy(");
+        emit_value(out, var);
+        buffer_append(out, ", string_builder + string_builder_pointer, ");
+        emit_string_stmt_previous_size(out, base, true, NULL, true);
+        buffer_appendf(out, " >= %u ? %u : ", type.count + 1, type.count + 1);
+        emit_string_stmt_previous_size(out, base, true, NULL, true);
+        buffer_append(out, ");\n"
+                           "string_builder_pointer += previous_string_statement_size + 1;\n");
+    }
 }
 
-char *emit_unstring(AST *ast) {
-    char *base = value_to_string(ast->string_splitter.base.value);
-    char *code = malloc(strlen(base) + 77);
-    sprintf(code, "string_builder[0] = string_builder_pointer = 0;\n"
-                  "strcpy(string_builder, %s);\n", base);
+void emit_string_builder(Buffer *out, AST *ast) {
+    buffer_append(out, "string_builder[0] = string_builder_pointer = 0;\n");
+    emit_string_stmt(out, &ast->string_builder.base);
+    buffer_append(out, "string_builder_pointer += previous_string_statement_size;\n"
+                       "string_builder[string_builder_pointer] = '\\0';\n");
+
+    for (size_t i = 0; i < ast->string_builder.stmt_count; i++) {
+        emit_string_stmt(out, &ast->string_builder.stmts[i]);
+        buffer_append(out, "string_builder_pointer += previous_string_statement_size;\n"
+                           "string_builder[string_builder_pointer] = '\\0';\n");
+    }
+
+    PictureType vartype = get_value_type(ast->string_builder.into_var);
+    buffer_append(out, "strncpy(");
+    emit_value(out, ast->string_builder.into_var);
+    buffer_appendf(out, ", string_builder, %u);\n", vartype.count + 1);
 
-    size_t code_len = strlen(code);
+    if (ast->string_builder.with_pointer == NULL)
+        return;
 
-    char *increment;
-    char *size;
-    emit_string_stmt_previous_size(&ast->string_splitter.base, base, &increment, &size, true, NULL);
-    assert(increment != NULL);
-    assert(size != NULL);
+    emit_value(out, ast->string_builder.with_pointer);
+    buffer_append(out, " = string_builder_pointer;\n");
+}
 
-    for (size_t i = 0; i < ast->string_splitter.into_vars.size; i++) {
-        char *var = value_to_string(ast->string_splitter.into_vars.items[i]);
-        PictureType type = get_value_type(ast->string_splitter.into_vars.items[i]);
-        char *into = malloc(strlen(var) + strlen(increment) + (strlen(size) * 2) + 420);
-        sprintf(into, "%s"
-                      "strncpy(%s, string_builder + string_builder_pointer, %s >= %u ? %u : %s);\n"
-                      "string_builder_pointer += previous_string_statement_size + 1;\n", increment, var, size, type.count + 1, type.count + 1, size);
+// A PIC X record leaves out its null byte, everything else is stored as it is in memory.
+static void emit_record_size(Buffer *out, Variable *record) {
+    buffer_append(out, "sizeof(");
+    emit_picture_name(out, record->name);
+    buffer_append(out, IS_STRING(record->type) ? ") - 1" : ")");
+}
 
-        free(var);
-        const size_t len = strlen(into);
+// How many zoned digits a DISPLAY number takes in a sequential record, 0 when
+// the item isn't one.
+static unsigned int zoned_digits(PictureType *type) {
+    if (type->comp_type != 0 || is_packed(type) || !(is_integer_type(type) || is_fixed_point(type)))
+        return 0;
 
-        code = realloc(code, code_len + len + 1);
-        strcat(code, into);
-        free(into);
-        code_len += len;
+    return type->places + (is_fixed_point(type) ? type->decimal_places : 0);
+}
+
+// Packs or unpacks one item of a record at p, elem is its C expression.
+static void emit_item_layout(Buffer *out, PictureType *type, const char *elem, bool pack) {
+    const unsigned int digits = zoned_digits(type);
+    const char *wide = is_wide_numeric(type) ? "_wide" : "";
+
+    if (IS_STRING((*type)))
+        buffer_appendf(out, "p = text_%s(p, %s, sizeof(%s) - 1);\n", pack ? "pack" : "unpack", elem, elem);
+    else if ((type->type == TYPE_ALPHABETIC || type->type == TYPE_ALPHANUMERIC) && pack)
+        buffer_appendf(out, "*p++ = %s == '\\0' ? ' ' : %s;\n", elem, elem);
+    else if (type->type == TYPE_ALPHABETIC || type->type == TYPE_ALPHANUMERIC)
+        buffer_appendf(out, "%s = *p == ' ' ? '\\0' : *p;\np++;\n", elem);
+    else if (digits > 0 && pack)
+        buffer_appendf(out, "p = zoned_pack%s(p, %s, %u, %s);\n", wide, elem, digits, is_signed_type(type) ? "true" : "false");
+    else if (digits > 0)
+        buffer_appendf(out, "%s = zoned_unpack%s(p, %u);\np += %u;\n", elem, wide, digits, digits);
+    else {
+        // COMP-3 already is its COBOL bytes. COMP-1, COMP-2, COMP-5 and pointers
+        // are native, and so would a group nested in the record be, the parser
+        // has no group fields yet.
+        const bool binary = type->comp_type == COMP4 && is_integer_type(type) && !is_packed(type);
+        buffer_appendf(out, "p = %s_%s(p, &%s, sizeof(%s));\n", binary ? "binary" : "bytes", pack ? "pack" : "unpack", elem, elem);
     }
+}
 
-    free(base);
-    free(size);
-    free(increment);
-    return code;
+// The bytes one item of a record takes in the file.
+static void emit_item_length(Buffer *out, PictureType *type, const char *elem) {
+    const unsigned int digits = zoned_digits(type);
+
+    if (IS_STRING((*type)))
+        buffer_appendf(out, "(sizeof(%s) - 1)", elem);
+    else if (type->type == TYPE_ALPHABETIC || type->type == TYPE_ALPHANUMERIC)
+        buffer_append(out, "1");
+    else if (digits > 0)
+        buffer_appendf(out, "%u", digits);
+    else
+        buffer_appendf(out, "sizeof(%s)", elem);
 }
 
-char *emit_string_builder(AST *ast) {
-    char *base = emit_string_stmt(&ast->string_builder.base);
-    char *code = malloc(strlen(base) + 156);
-    sprintf(code, "string_builder[0] = string_builder_pointer = 0;\n"
-                  "%s"
-                  "string_builder_pointer += previous_string_statement_size;\n"
-                  "string_builder[string_builder_pointer] = '\\0';\n", base);
+// C expression for a record or one of its fields, indexed by r and i when
+// they repeat or by 0 when only the size of one element matters.
+static void emit_item_name(Buffer *out, Variable *record, AST *field, bool first) {
+    emit_picture_name(out, record->name);
 
-    free(base);
-    size_t code_len = strlen(code);
+    if (record->count > 0)
+        buffer_append(out, first ? "[0]" : "[r]");
 
-    for (size_t i = 0; i < ast->string_builder.stmt_count; i++) {
-        char *stmt = emit_string_stmt(&ast->string_builder.stmts[i]);
-        const size_t len = strlen(stmt);
+    if (field == NULL)
+        return;
+
+    buffer_appendc(out, '.');
+    emit_picture_name(out, field->pic.name);
 
-        code = realloc(code, code_len + len + 207);
-        strcat(code, stmt);
-        free(stmt);
+    if (field->pic.count > 0)
+        buffer_append(out, first ? "[0]" : "[i]");
+}
+
+// A sequential or relative file's record as it is stored: _RECLENGTH bytes
+// that _RECPACK() writes and _RECUNPACK() reads back, field after field at
+// their COBOL offsets without the NUL terminators and padding of the struct.
+static void emit_record_layout(Variable *record) {
+    const size_t fields = record->fields != NULL ? record->fields->size : 0;
+    const size_t items = fields > 0 ? fields : 1;
+
+    if (!uses_record_layout)
+        buffer_append(&globals, RECORD_LAYOUT);
+
+    uses_record_layout = true;
 
-        strcat(code, "string_builder_pointer += previous_string_statement_size;\n"
-                     "string_builder[string_builder_pointer] = '\\0';\n");
-        code_len += len + 106;
+    for (size_t i = 0; i < items && !uses_record_layout_wide; i++) {
+        PictureType *type = fields > 0 ? &record->fields->items[i]->pic.type : &record->type;
+
+        if (zoned_digits(type) > 0 && is_wide_numeric(type)) {
+            buffer_append(&globals, RECORD_LAYOUT_WIDE);
+            uses_record_layout_wide = true;
+        }
     }
-    
-    char *var = value_to_string(ast->string_builder.into_var);
-    PictureType vartype = get_value_type(ast->string_builder.into_var);
-    char *into = malloc(strlen(var) + 64);
 
-    sprintf(into, "strncpy(%s, string_builder, %u);\n", var, vartype.count + 1);
-    free(var);
-    size_t len = strlen(into);
+    buffer_append(&globals, "#define ");
+    emit_picture_name(&globals, record->name);
+    buffer_append(&globals, "LENGTH ((size_t)");
 
-    code = realloc(code, code_len + len + 1);
-    strcat(code, into);
-    free(into);
+    if (record->count > 0)
+        buffer_appendf(&globals, "%u * ", record->count);
 
-    if (ast->string_builder.with_pointer == NULL)
-        return code;
+    buffer_appendc(&globals, '(');
+
+    for (size_t i = 0; i < items; i++) {
+        AST *field = fields > 0 ? record->fields->items[i] : NULL;
+        Buffer elem = create_buffer(64);
+        emit_item_name(&elem, record, field, true);
+
+        if (i > 0)
+            buffer_append(&globals, " + ");
+
+        if (field != NULL && field->pic.count > 0)
+            buffer_appendf(&globals, "%u * ", field->pic.count);
+
+        emit_item_length(&globals, field != NULL ? &field->pic.type : &record->type, elem.data);
+        delete_buffer(&elem);
+    }
+
+    buffer_append(&globals, "))\n");
+
+    for (int pack = 1; pack >= 0; pack--) {
+        buffer_append(&globals, "static void ");
+        emit_picture_name(&globals, record->name);
+        buffer_append(&globals, pack ? "PACK(char *p) {\n" : "UNPACK(const char *p) {\n");
+
+        if (record->count > 0)
+            buffer_appendf(&globals, "for (size_t r = 0; r < %u; r++) {\n", record->count);
 
-    char *pointer = value_to_string(ast->string_builder.with_pointer);
-    code = realloc(code, code_len + len + strlen(pointer) + 28);
-    strcat(code, pointer);
-    free(pointer);
-    strcat(code, " = string_builder_pointer;\n");
-    return code;
+        for (size_t i = 0; i < items; i++) {
+            AST *field = fields > 0 ? record->fields->items[i] : NULL;
+            Buffer elem = create_buffer(64);
+            emit_item_name(&elem, record, field, false);
+
+            if (field != NULL && field->pic.count > 0)
+                buffer_appendf(&globals, "for (size_t i = 0; i < %u; i++) {\n", field->pic.count);
+
+            emit_item_layout(&globals, field != NULL ? &field->pic.type : &record->type, elem.data, pack);
+
+            if (field != NULL && field->pic.count > 0)
+                buffer_append(&globals, "}\n");
+
+            delete_buffer(&elem);
+        }
+
+        if (record->count > 0)
+            buffer_append(&globals, "}\n");
+
+        buffer_append(&globals, "}\n");
+    }
 }
 
-char *emit_open(AST *ast) {
-    char *var = value_to_string(ast->open.filename);
-    char *name = picturename_to_c(ast->open.filename->var.name);
+// An indexed file's key as index_open() takes it: offset in the record, size
+// and 0 to compare bytes, 1 for unsigned and 2 for signed integers.
+static void emit_key_layout(Buffer *out, Variable *fd) {
+    Variable *key = fd->record_key;
+
+    buffer_append(out, "(size_t)((char *)&");
+    emit_picture_name(out, fd->record->name);
+    buffer_appendc(out, '.');
+    emit_picture_name(out, key->name);
+    buffer_append(out, " - (char *)&");
+    emit_picture_name(out, fd->record->name);
+    buffer_append(out, "), sizeof(");
+    emit_picture_name(out, fd->record->name);
+    buffer_appendc(out, '.');
+    emit_picture_name(out, key->name);
+    buffer_append(out, IS_STRING(key->type) ? ") - 1, 0" : is_fixed_point(&key->type) || is_signed_type(&key->type) ? "), 2" : "), 1");
+}
+
+void emit_open(Buffer *out, AST *ast) {
+    char *name = ast->open.filename->var.name;
+    Variable *fd = ast->open.filename->var.sym;
+    const bool indexed = fd->organization == ORG_INDEXED && fd->record_key != NULL;
+    const bool relative = fd->organization == ORG_RELATIVE && fd->record != NULL;
+    const bool binary = fd->organization == ORG_SEQUENTIAL;
     char *mode;
 
     if (ast->open.type == OPEN_INPUT)
-        mode = "r";
+        mode = binary ? "rb" : "r";
     else if (ast->open.type == OPEN_OUTPUT)
-        mode = "w";
+        mode = binary ? "wb" : "w";
     else if (ast->open.type == OPEN_IO)
-        mode = "w+";
+        mode = binary ? "w+b" : "w+";
     else
-        mode = "a";
+        mode = binary ? "ab" : "a";
+
+    emit_picture_name(out, name);
+
+    if (indexed) {
+        // The file pointer only tells if the file opened, the index owns it.
+        buffer_append(out, " = index_open(&");
+        emit_picture_name(out, name);
+        buffer_append(out, "INDEX, ");
+        emit_value(out, ast->open.filename);
+        buffer_appendf(out, "FILENAME, %d, ", ast->open.type);
+        emit_record_size(out, fd->record);
+        buffer_append(out, ", ");
+        emit_key_layout(out, fd);
+        buffer_append(out, ");\n");
+    } else if (relative) {
+        buffer_append(out, " = relative_open(&");
+        emit_picture_name(out, name);
+        buffer_append(out, "RELATIVE, ");
+        emit_value(out, ast->open.filename);
+        buffer_appendf(out, "FILENAME, %d, ", ast->open.type);
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, "LENGTH);\n");
+    } else {
+        buffer_append(out, " = fopen(");
+        emit_value(out, ast->open.filename);
+        buffer_appendf(out, "FILENAME, \"%s\");\n", mode);
+    }
 
     // TODO: Implement all file status errors, 37 is just for
     // FILE NOT OPEN, which is usually for wrong modes, but there are others.
-    char *code = malloc(strlen(var) + strlen(mode) + (strlen(name) * 4) + 101);
+    buffer_append(out, "strcpy(");
+    emit_picture_name(out, name);
+    buffer_append(out, "STATUS, ");
+    emit_picture_name(out, name);
+    buffer_append(out, " != NULL ? \"00\" : \"37\");\n");
 
-    if (ast->open.type == OPEN_INPUT)
-        sprintf(code, "%s = fopen(%sFILENAME, \"%s\");\n"
-                      "strcpy(%sSTATUS, %s != NULL ? \"00\" : \"37\");\n", name, var, mode, name, name);
+    if (indexed || relative)
+        return;
 
-    // Need to assign the last opened output file for WRITEs with OUTPUT, IO or EXTEND.
-    else
-        sprintf(code, "%s = fopen(%sFILENAME, \"%s\");\n"
-                      "strcpy(%sSTATUS, %s != NULL ? \"00\" : \"37\");\n"
-                      "last_opened_outfile = %s;\n", name, var, mode, name, name, name);
+    buffer_append(out, "file_open(&");
+    emit_picture_name(out, name);
+    buffer_append(out, "BUFFER, ");
+    emit_picture_name(out, name);
+    buffer_append(out, ");\n");
 
-    free(var);
-    free(name);
-    return code;
+    // Need to assign the last opened output file for WRITEs with OUTPUT, IO or EXTEND.
+    if (ast->open.type != OPEN_INPUT) {
+        buffer_append(out, "last_opened_outfile = ");
+        emit_picture_name(out, name);
+        buffer_append(out, ";\n");
+    }
 }
 
-char *emit_close(AST *ast) {
-    char *name = picturename_to_c(ast->close_filename->var.name);
-    char *code = malloc(strlen(name) + 17);
-    sprintf(code, "fclose(%s);\n", name);
-    free(name);
-    return code;
+void emit_close(Buffer *out, AST *ast) {
+    const unsigned int organization = ast->close_filename->var.sym->organization;
+
+    if (organization == ORG_INDEXED || organization == ORG_RELATIVE) {
+        buffer_append(out, organization == ORG_INDEXED ? "index_close(&" : "relative_close(&");
+        emit_picture_name(out, ast->close_filename->var.name);
+        buffer_append(out, organization == ORG_INDEXED ? "INDEX);\n" : "RELATIVE);\n");
+        return;
+    }
+
+    buffer_append(out, "file_close(&");
+    emit_picture_name(out, ast->close_filename->var.name);
+    buffer_append(out, "BUFFER);\nfclose(");
+    emit_picture_name(out, ast->close_filename->var.name);
+    buffer_append(out, ");\n");
 }
 
-char *emit_select(AST *ast) {
-    char *name = picturename_to_c(ast->select.fd_var->var.name);
-    char *filestatus = ast->select.filestatus_var == NULL ? calloc(1, sizeof(char)) : picturename_to_c(ast->select.filestatus_var->var.name);
-    char *filename = value_to_string(ast->select.filename);
+void emit_select(AST *ast) {
+    char *name = ast->select.fd_var->var.name;
 
-    char *code = malloc((strlen(name) * 2) + strlen(filename) + strlen(filestatus) + 52);
+    buffer_append(&globals, "#define ");
+    emit_picture_name(&globals, name);
+    buffer_append(&globals, "FILENAME ");
+    emit_value(&globals, ast->select.filename);
+    buffer_append(&globals, "\n#define ");
+    emit_picture_name(&globals, name);
+    buffer_append(&globals, "STATUS ");
 
     if (ast->select.filestatus_var == NULL)
-    // Copy into a junk buffer since a file status variable wasn't specified.
-        sprintf(code, "#define %sFILENAME %s\n"
-                      "#define %sSTATUS file_status\n", name, filename, name);
+        // Copy into a junk buffer since a file status variable wasn't specified.
+        buffer_append(&globals, "file_status");
     else
-        sprintf(code, "#define %sFILENAME %s\n"
-                      "#define %sSTATUS %s\n", name, filename, name, filestatus);
+        emit_picture_name(&globals, ast->select.filestatus_var->var.name);
+
+    buffer_appendc(&globals, '\n');
+
+    if ((ast->select.organization == ORG_SEQUENTIAL || ast->select.organization == ORG_RELATIVE) && ast->select.fd_var->var.sym->record != NULL)
+        emit_record_layout(ast->select.fd_var->var.sym->record);
+
+    if (ast->select.organization == ORG_RELATIVE) {
+        if (!uses_relative_file) {
+            buffer_append(&globals, RELATIVE_FILE);
+            buffer_append(&globals, RELATIVE_OPEN);
+        }
 
-    free(filename);
-    free(name);
-    free(filestatus);
-    append_global(code);
+        uses_relative_file = true;
+        emit_storage(&globals, name);
+        buffer_append(&globals, "RelativeFile ");
+        emit_picture_name(&globals, name);
+        buffer_append(&globals, "RELATIVE;\n");
+        return;
+    } else if (ast->select.organization != ORG_INDEXED)
+        return;
+
+    if (!uses_index_file) {
+        buffer_append(&globals, INDEX_PAGES);
+        buffer_append(&globals, INDEX_SEARCH);
+        buffer_append(&globals, INDEX_INSERT);
+        buffer_append(&globals, INDEX_OPERATIONS);
+        buffer_append(&globals, INDEX_OPEN);
+    }
 
-    free(code);
-    return calloc(1, sizeof(char));
+    uses_index_file = true;
+    emit_storage(&globals, name);
+    buffer_append(&globals, "IndexFile ");
+    emit_picture_name(&globals, name);
+    buffer_append(&globals, "INDEX;\n");
 }
 
-char *emit_read(AST *ast) {
-    char *fd = picturename_to_c(ast->read.fd->var.name);
-    char *into = picturename_to_c(ast->read.into->var.name);
-    char *at_end = emit_list(&ast->read.at_end_stmts);
-    char *not_at_end = emit_list(&ast->read.not_at_end_stmts);
-    char *code = malloc(strlen(fd) + (strlen(into) * 4) + strlen(at_end) + strlen(not_at_end) + 109);
+// AT END or INVALID KEY and their NOT. A READ failed when it left read_buffer
+// NULL, an operation on an indexed file when fd's status isn't 0x.
+static void emit_outcomes(Buffer *out, char *fd, ASTList *failed, ASTList *succeeded) {
+    if (failed->size == 0 && succeeded->size == 0)
+        return;
 
-    // Note: we also do strcspn() which removes any trailing newlines if present.
+    buffer_append(out, "if (");
 
-    if (ast->read.at_end_stmts.size == 0) {
-        if (ast->read.not_at_end_stmts.size == 0)
-            sprintf(code, "read_buffer = fgets(%s, sizeof(%s) - 1, %s);\n"
-                           "%s[strcspn(%s, \"\\n\\r\")] = '\\0';\n", into, into, fd, into, into);
-        else
-            sprintf(code, "read_buffer = fgets(%s, sizeof(%s) - 1, %s);\n"
-                           "%s[strcspn(%s, \"\\n\\r\")] = '\\0';\n"
-                          "if (read_buffer != NULL) {\n%s}\n", into, into, fd, into, into, not_at_end);
+    if (fd == NULL)
+        buffer_append(out, "read_buffer");
+    else {
+        emit_picture_name(out, fd);
+        buffer_append(out, "STATUS[0]");
+    }
+
+    if (failed->size == 0) {
+        buffer_append(out, fd == NULL ? " != NULL) {\n" : " == '0') {\n");
+        emit_list(out, succeeded);
     } else {
-        if (ast->read.not_at_end_stmts.size != 0)
-            sprintf(code, "read_buffer = fgets(%s, sizeof(%s) - 1, %s);\n"
-                           "%s[strcspn(%s, \"\\n\\r\")] = '\\0';\n"
-                          "if (read_buffer == NULL) {\n%s} else {\n%s}\n", into, into, fd, into, into, at_end, not_at_end);
-        else
-            sprintf(code, "read_buffer = fgets(%s, sizeof(%s) - 1, %s);\n"
-                           "%s[strcspn(%s, \"\\n\\r\")] = '\\0';\n"
-                          "if (read_buffer == NULL) {\n%s}\n", into, into, fd, into, into, at_end);
+        buffer_append(out, fd == NULL ? " == NULL) {\n" : " != '0') {\n");
+        emit_list(out, failed);
+
+        if (succeeded->size != 0) {
+            buffer_append(out, "} else {\n");
+            emit_list(out, succeeded);
+        }
     }
 
-    free(fd);
-    free(into);
-    free(at_end);
-    free(not_at_end);
-    return code;
+    buffer_append(out, "}\n");
 }
 
-char *emit_write(AST *ast) {
-    char *value = value_to_string(ast->write.value);
-    PictureType type = get_value_type(ast->write.value);
-    char *spec = picturetype_to_format_specifier(&type);
+// The record number of a relative file operation. Sequential access writes
+// after the last record and rewrites or deletes the one read last.
+static void emit_relative_slot(Buffer *out, Variable *fd, ASTType type) {
+    if (fd->access == ACCESS_SEQUENTIAL && type != AST_START && type != AST_READ) {
+        emit_picture_name(out, fd->name);
+        buffer_append(out, type == AST_WRITE ? "RELATIVE.slot + 1" : "RELATIVE.slot");
+        return;
+    }
 
-    char *code = malloc(strlen(value) + strlen(spec) + 41);
-    sprintf(code, "fprintf(last_opened_outfile, \"%s\", %s);\n", spec, value);
+    buffer_append(out, "(uint64_t)");
+    emit_picture_name(out, fd->record_key->name);
+}
 
-    free(spec);
-    free(value);
-    return code;
+// Sets the relative key to the record number the last READ NEXT or WRITE used.
+static void emit_relative_key_update(Buffer *out, Variable *fd) {
+    if (fd->record_key == NULL)
+        return;
+
+    buffer_append(out, "if (");
+    emit_picture_name(out, fd->name);
+    buffer_append(out, "STATUS[0] == '0')\n");
+    emit_picture_name(out, fd->record_key->name);
+    buffer_append(out, " = ");
+    emit_picture_name(out, fd->name);
+    buffer_append(out, "RELATIVE.slot;\n");
 }
 
-char *emit_stringtally_phase1(StringTallyPhase1 *phase) {
-    char *value = value_to_string(phase->value);
-    char *modifier = phase->modifier == NULL ? mystrdup(value) : value_to_string(phase->modifier);
-    char *code = malloc(strlen(value) + strlen(modifier) + 128);
+// WRITE, REWRITE, START and DELETE on an indexed or relative file. Indexed
+// files take the key from the record, relative files a record number.
+static void emit_keyed_call(Buffer *out, Variable *fd, ASTType type, char *extra, ASTList *invalid, ASTList *valid) {
+    const bool relative = fd->organization == ORG_RELATIVE;
+    char *operation = type == AST_WRITE ? "write" : type == AST_REWRITE ? "rewrite" : type == AST_START ? "start" : "delete";
+
+    buffer_append(out, "strcpy(");
+    emit_picture_name(out, fd->name);
+    buffer_appendf(out, "STATUS, %s_%s(&", relative ? "relative" : "index", operation);
+    emit_picture_name(out, fd->name);
+    buffer_append(out, relative ? "RELATIVE, " : "INDEX, ");
+
+    // Relative records are written in their COBOL layout.
+    if (relative && (type == AST_WRITE || type == AST_REWRITE)) {
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, "PACK");
+    } else {
+        buffer_appendc(out, '&');
+        emit_picture_name(out, fd->record->name);
+    }
+
+    if (relative) {
+        buffer_append(out, ", ");
+        emit_relative_slot(out, fd, type);
+    }
 
-    if (phase->before)
-        sprintf(code, "if (inspect_char == %s)\nbreak;\nelse if (inspect_char == %s)\ninspect_count++;\n", modifier, value);
-    else
-        sprintf(code, "if (inspect_char == %s && !inspect_found)\ninspect_found = true;\nif (inspect_char == %s && inspect_found)\ninspect_count++;\n", modifier, value);
+    buffer_appendf(out, "%s));\n", extra);
 
-    free(value);
-    free(modifier);
-    return code;
+    if (relative && type == AST_WRITE && fd->access == ACCESS_SEQUENTIAL)
+        emit_relative_key_update(out, fd);
+
+    emit_outcomes(out, fd->name, invalid, valid);
 }
 
-char *emit_stringtally_for_all(StringTally *tally) {
-    char *phases = emit_stringtally_phase1(&tally->phase);
-    char *code = malloc(strlen(phases) + 126);
+void emit_read(Buffer *out, AST *ast) {
+    char *fd = ast->read.fd->var.name;
+    char *into = ast->read.into->var.name;
+    Variable *record = ast->read.fd->var.sym->record;
+
+    const unsigned int organization = ast->read.fd->var.sym->organization;
+
+    if (organization != ORG_NONE && organization != ORG_LINE_SEQUENTIAL && record != NULL) {
+        // A whole record goes into the FD's record, then INTO copies it.
+        if (organization == ORG_INDEXED || organization == ORG_RELATIVE) {
+            // Read by key or on from the last record, the status tells if there was one.
+            buffer_append(out, "strcpy(");
+            emit_picture_name(out, fd);
+            buffer_appendf(out, "STATUS, %s_%s(&", organization == ORG_INDEXED ? "index" : "relative", ast->read.next ? "next" : "read");
+            emit_picture_name(out, fd);
+            buffer_append(out, organization == ORG_INDEXED ? "INDEX, &" : "RELATIVE, ");
+            emit_picture_name(out, record->name);
+
+            if (organization == ORG_RELATIVE)
+                buffer_append(out, "UNPACK");
+
+            if (organization == ORG_RELATIVE && !ast->read.next) {
+                buffer_append(out, ", ");
+                emit_relative_slot(out, ast->read.fd->var.sym, AST_READ);
+            }
 
-    if (tally->phase.after)
-        sprintf(code, "inspect_found = false;\nfor (size_t i = 0; i < inspect_string_length; i++) {\nconst char inspect_char = inspect_string[i];\n%s}\n", phases);
-    else
-        sprintf(code, "for (size_t i = 0; i < inspect_string_length; i++) {\nconst char inspect_char = inspect_string[i];\n%s}\n", phases);
+            buffer_append(out, "));\n");
+
+            if (organization == ORG_RELATIVE && ast->read.next)
+                emit_relative_key_update(out, ast->read.fd->var.sym);
+
+            buffer_append(out, "read_buffer = ");
+            emit_picture_name(out, fd);
+            buffer_append(out, "STATUS[0] == '0' ? (char *)&");
+            emit_picture_name(out, record->name);
+            buffer_append(out, " : NULL;\n");
+        } else if (organization == ORG_SORT) {
+            buffer_append(out, "read_buffer = sort_return(&");
+            emit_picture_name(out, fd);
+            buffer_append(out, "SORT, &");
+            emit_picture_name(out, record->name);
+            buffer_append(out, ", ");
+            emit_record_size(out, record);
+            buffer_append(out, ") ? (char *)&");
+            emit_picture_name(out, record->name);
+            buffer_append(out, " : NULL;\n");
+        } else {
+            buffer_append(out, "read_buffer = record_read(&");
+            emit_picture_name(out, fd);
+            buffer_append(out, "BUFFER, ");
+            emit_picture_name(out, record->name);
+            buffer_append(out, "UNPACK, ");
+            emit_picture_name(out, record->name);
+            buffer_append(out, "LENGTH) ? (char *)&");
+            emit_picture_name(out, record->name);
+            buffer_append(out, " : NULL;\n");
+        }
+
+        if (ast->read.into->var.sym != record) {
+            buffer_append(out, "if (read_buffer != NULL)\nrecord_move(&");
+            emit_picture_name(out, into);
+            buffer_append(out, ", ");
+            emit_record_size(out, ast->read.into->var.sym);
+            buffer_append(out, ", &");
+            emit_picture_name(out, record->name);
+            buffer_append(out, ", ");
+            emit_record_size(out, record);
+            buffer_append(out, ");\n");
+        }
+    } else {
+        // The line comes without its newline, NULL at the end of the file.
+        buffer_append(out, "read_buffer = line_read(&");
+        emit_picture_name(out, fd);
+        buffer_append(out, "BUFFER, ");
+        emit_picture_name(out, into);
+        buffer_append(out, ", sizeof(");
+        emit_picture_name(out, into);
+        buffer_append(out, ") - 1);\n");
+    }
 
-    free(phases);
-    return code;
+    emit_outcomes(out, NULL, &ast->read.at_end_stmts, &ast->read.not_at_end_stmts);
 }
 
-char *emit_stringtally(StringTally *tally) {
-    if (tally->type == TALLY_CHARACTERS)
-        return mystrdup("inspect_count += inspect_string_length;\n");
+void emit_write(Buffer *out, AST *ast) {
+    PictureType type = get_value_type(ast->write.value);
+    Variable *fd = ast->write.value->type == AST_VAR ? ast->write.value->var.sym->fd : NULL;
+
+    if (fd != NULL && (fd->organization == ORG_INDEXED || fd->organization == ORG_RELATIVE)) {
+        emit_keyed_call(out, fd, ast->type, "", &ast->write.invalid_key_stmts, &ast->write.not_invalid_key_stmts);
+        return;
+    } else if (fd != NULL && fd->organization == ORG_SEQUENTIAL) {
+        // Records of sequential files go to their own file in their COBOL layout.
+        buffer_append(out, "record_write(&");
+        emit_picture_name(out, fd->name);
+        buffer_append(out, "BUFFER, ");
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, "PACK, ");
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, "LENGTH);\n");
+        return;
+    }
 
-    char *code;
+    buffer_append(out, "fprintf(last_opened_outfile, \"");
+    emit_format_specifier(out, &type);
+    buffer_append(out, "\", ");
+    emit_format_argument(out, ast->write.value, &type);
+    buffer_append(out, ");\n");
+}
 
-    if (tally->type == TALLY_ALL)
-        code = emit_stringtally_for_all(tally);
-    else {
-        assert(false);
-        return calloc(1, sizeof(char));
+// The key of a sort record, the record itself when it is elementary.
+static void emit_sort_key(Buffer *out, Variable *record, Variable *key) {
+    emit_picture_name(out, record->name);
+
+    if (key != record) {
+        buffer_appendc(out, '.');
+        emit_picture_name(out, key->name);
     }
+}
+
+// Where the key starts in the record at p.
+static void emit_sort_key_address(Buffer *out, const char *p, Variable *record, Variable *key) {
+    buffer_append(out, p);
+
+    if (key == record)
+        return;
 
-    char *output = value_to_string(tally->output_count);
-    code = realloc(code, (strlen(code) + strlen(output) + 20));
-    strcat(code, output);
-    strcat(code, " = inspect_count;\n");
-    free(output);
-    return code;
+    buffer_append(out, " + ((char *)&");
+    emit_sort_key(out, record, key);
+    buffer_append(out, " - (char *)&");
+    emit_picture_name(out, record->name);
+    buffer_appendc(out, ')');
 }
 
-char *emit_stringreplace(StringReplace *replace) {
-    char *old = value_to_string(replace->old);
-    char *new = value_to_string(replace->new);
-    char *modifier = replace->modifier == NULL ? calloc(1, sizeof(char)) : value_to_string(replace->modifier);
-    char *code = malloc(strlen(old) + strlen(new) + strlen(modifier) + 163);
+// A qsort() style comparison of two records on the SORT's keys in order,
+// descending keys compare the records the other way round.
+static void emit_sort_compare(AST *ast, size_t compare) {
+    Variable *record = ast->sort.fd->var.sym->record;
+
+    buffer_appendf(&globals, "static int sort_compare_%zu(const void *a, const void *b) {\nconst char *x = a;\nconst char *y = b;\nint r;\n", compare);
+
+    for (size_t i = 0; i < ast->sort.key_count; i++) {
+        Variable *key = ast->sort.keys[i].key;
+        const char *first = ast->sort.keys[i].descending ? "y" : "x";
+        const char *second = ast->sort.keys[i].descending ? "x" : "y";
+
+        if (IS_STRING(key->type)) {
+            buffer_append(&globals, "if ((r = strncmp(");
+            emit_sort_key_address(&globals, first, record, key);
+            buffer_append(&globals, ", ");
+            emit_sort_key_address(&globals, second, record, key);
+            buffer_append(&globals, ", sizeof(");
+            emit_sort_key(&globals, record, key);
+            buffer_append(&globals, ") - 1)) != 0)\nreturn r;\n");
+            continue;
+        }
 
-    if (replace->type == REPLACING_FIRST) {
-        if (replace->before)
-            sprintf(code, "if (inspect_char == %s)\ninspect_found = true;\nelse if (!inspect_found && !inspect_locked && inspect_char == %s) {\ninspect_string[i] = %s;\ninspect_locked = true;\n}\n", modifier, old, new);
-        else if (replace->after)
-            sprintf(code, "if (inspect_char == %s)\ninspect_found = true;\nelse if (inspect_found && !inspect_locked && inspect_char == %s) {\ninspect_string[i] = %s;\ninspect_locked = true;\n}\n", modifier, old, new);
-        else
-            sprintf(code, "if (inspect_char == %s && !inspect_locked) {\ninspect_string[i] = %s;\ninspect_locked = true;\n}\n", old, new);
+        const char *type = picturetype_to_c(&key->type);
+
+        buffer_appendf(&globals, "{\n%s u, v;\nmemcpy(&u, ", strcmp(type, "char") == 0 ? "unsigned char" : type);
+        emit_sort_key_address(&globals, first, record, key);
+        buffer_append(&globals, ", sizeof(u));\nmemcpy(&v, ");
+        emit_sort_key_address(&globals, second, record, key);
+        buffer_append(&globals, ", sizeof(v));\nif (u != v)\nreturn u < v ? -1 : 1;\n}\n");
+    }
+
+    buffer_append(&globals, "return 0;\n}\n");
+}
+
+// Releases every record of a USING file or writes every sorted record to the
+// GIVING file, with the statements a program would use to do it by hand.
+static void emit_sort_file(Buffer *out, Variable *sd, AST *file, bool giving) {
+    Variable *fd = file->var.sym;
+    AST record = { .type = AST_VAR };
+    record.var.name = fd->record->name;
+    record.var.sym = fd->record;
+
+    AST open = { .type = AST_OPEN };
+    open.open.filename = file;
+    open.open.type = giving ? OPEN_OUTPUT : OPEN_INPUT;
+    emit_open(out, &open);
+
+    buffer_append(out, "if (");
+    emit_picture_name(out, fd->name);
+    buffer_append(out, giving ? " != NULL) {\nwhile (sort_return(&" : " != NULL) {\nfor (;;) {\n");
+
+    if (giving) {
+        emit_picture_name(out, sd->name);
+        buffer_append(out, "SORT, &");
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, ", ");
+        emit_record_size(out, fd->record);
+        buffer_append(out, ")) {\n");
+
+        if (fd->organization == ORG_NONE || fd->organization == ORG_LINE_SEQUENTIAL) {
+            // WRITE doesn't end the line, each record is one.
+            buffer_append(out, "fprintf(");
+            emit_picture_name(out, fd->name);
+            buffer_append(out, ", \"%s\\n\", ");
+            emit_picture_name(out, fd->record->name);
+            buffer_append(out, ");\n");
+        } else {
+            AST write = { .type = AST_WRITE };
+            write.write.value = &record;
+            write.write.invalid_key_stmts = create_astlist();
+            write.write.not_invalid_key_stmts = create_astlist();
+            emit_write(out, &write);
+        }
     } else {
-        if (replace->before)
-            sprintf(code, "if (inspect_char == %s)\ninspect_found = true;\nelse if (!inspect_found && inspect_char == %s)\ninspect_string[i] = %s;\n", modifier, old, new);
-        else if (replace->after)
-            sprintf(code, "if (inspect_char == %s)\ninspect_found = true;\nelse if (inspect_found && inspect_char == %s)\ninspect_string[i] = %s;\n", modifier, old, new);
-        else
-            sprintf(code, "if (inspect_char == %s)\ninspect_string[i] = %s;\n", old, new);
+        AST read = { .type = AST_READ };
+        read.read.fd = file;
+        read.read.into = &record;
+        read.read.next = true;
+        read.read.at_end_stmts = create_astlist();
+        read.read.not_at_end_stmts = create_astlist();
+        emit_read(out, &read);
+
+        buffer_append(out, "if (read_buffer == NULL)\nbreak;\nsort_release(&");
+        emit_picture_name(out, sd->name);
+        buffer_append(out, "SORT, &");
+        emit_picture_name(out, fd->record->name);
+        buffer_append(out, ", ");
+        emit_record_size(out, fd->record);
+        buffer_append(out, ");\n");
     }
 
-    free(old);
-    free(new);
-    free(modifier);
-    return code;
+    buffer_append(out, "}\n}\n");
+
+    AST close = { .type = AST_CLOSE };
+    close.close_filename = file;
+    emit_close(out, &close);
+}
+
+void emit_sort(Buffer *out, AST *ast) {
+    Variable *sd = ast->sort.fd->var.sym;
+    const size_t compare = sort_compares++;
+
+    emit_sort_compare(ast, compare);
+
+    buffer_append(out, "sort_begin(&");
+    emit_picture_name(out, sd->name);
+    buffer_append(out, "SORT, ");
+    emit_record_size(out, sd->record);
+    buffer_appendf(out, ", sort_compare_%zu);\n", compare);
+
+    if (ast->sort.input_procedure != NULL)
+        emit_stmt(out, ast->sort.input_procedure);
+
+    for (size_t i = 0; i < ast->sort.using_files.size; i++)
+        emit_sort_file(out, sd, ast->sort.using_files.items[i], false);
+
+    buffer_append(out, "sort_end_input(&");
+    emit_picture_name(out, sd->name);
+    buffer_append(out, "SORT);\n");
+
+    if (ast->sort.output_procedure != NULL)
+        emit_stmt(out, ast->sort.output_procedure);
+    else
+        emit_sort_file(out, sd, ast->sort.giving_file, true);
+
+    buffer_append(out, "sort_close(&");
+    emit_picture_name(out, sd->name);
+    buffer_append(out, "SORT);\n");
+}
+
+void emit_release(Buffer *out, AST *ast) {
+    Variable *from = ast->release.from->var.sym;
+
+    buffer_append(out, "sort_release(&");
+    emit_picture_name(out, ast->release.fd->var.name);
+    buffer_append(out, "SORT, &");
+    emit_picture_name(out, from->name);
+    buffer_append(out, ", ");
+    emit_record_size(out, from);
+    buffer_append(out, ");\n");
 }
 
-char *emit_inspect_combine(AST *ast, char *stmt_code) {
-    char *input_string = value_to_string(ast->inspect.input_string);
-    char *code = malloc(strlen(input_string) + strlen(stmt_code) + 91);
-    sprintf(code, "inspect_string = %s;\n"
-                  "inspect_string_length = strlen(inspect_string);\n"
-                  "inspect_count = 0;\n"
-                  "%s", input_string, stmt_code);
+void emit_stringtally_phase1(Buffer *out, StringTallyPhase1 *phase) {
+    AST *modifier = phase->modifier == NULL ? phase->value : phase->modifier;
 
-    free(stmt_code);
-    free(input_string);
-    return code;
+    buffer_append(out, "if (inspect_char == ");
+    emit_value(out, modifier);
+
+    if (phase->before) {
+        buffer_append(out, ")\nbreak;\nelse if (inspect_char == ");
+        emit_value(out, phase->value);
+        buffer_append(out, ")\ninspect_count++;\n");
+    } else {
+        buffer_append(out, " && !inspect_found)\ninspect_found = true;\nif (inspect_char == ");
+        emit_value(out, phase->value);
+        buffer_append(out, " && inspect_found)\ninspect_count++;\n");
+    }
 }
 
-char *emit_inspect_tallying(AST *ast) {
-    char *tallies = calloc(1, sizeof(char));
-    size_t tally_len = 0;
+void emit_stringtally_for_all(Buffer *out, StringTally *tally) {
+    if (tally->phase.after)
+        buffer_append(out, "inspect_found = false;\n");
+
+    buffer_append(out, "for (size_t i = 0; i < inspect_string_length; i++) {\nconst char inspect_char = inspect_string[i];\n");
+    emit_stringtally_phase1(out, &tally->phase);
+    buffer_append(out, "}\n");
+}
 
-    for (size_t i = 0; i < ast->inspect.tallying.tally_count; i++) {
-        char *tally = emit_stringtally(&ast->inspect.tallying.tallies[i]);
-        const size_t len = strlen(tally);
+void emit_stringtally(Buffer *out, StringTally *tally) {
+    if (tally->type == TALLY_CHARACTERS) {
+        buffer_append(out, "inspect_count += inspect_string_length;\n");
+        return;
+    }
 
-        tallies = realloc(tallies, tally_len + len + 1);
-        strcat(tallies, tally);
-        free(tally);
-        tally_len += len;
+    if (tally->type == TALLY_ALL)
+        emit_stringtally_for_all(out, tally);
+    else {
+        assert(false);
+        return;
     }
 
-    return emit_inspect_combine(ast, tallies);
+    emit_value(out, tally->output_count);
+    buffer_append(out, " = inspect_count;\n");
 }
 
-char *emit_inspect_replacing(AST *ast) {
-    char *replaces = calloc(1, sizeof(char));
-    size_t replaces_len = 0;
+void emit_stringreplace(Buffer *out, StringReplace *replace) {
+    if (replace->before || replace->after) {
+        buffer_append(out, "if (inspect_char == ");
 
-    for (size_t i = 0; i < ast->inspect.replacing.replace_count; i++) {
-        char *replace = emit_stringreplace(&ast->inspect.replacing.replaces[i]);
-        const size_t len = strlen(replace);
+        if (replace->modifier != NULL)
+            emit_value(out, replace->modifier);
 
-        replaces = realloc(replaces, replaces_len + len + 1);
-        strcat(replaces, replace);
-        free(replace);
-        replaces_len += len;
+        buffer_append(out, ")\ninspect_found = true;\n");
+        buffer_append(out, replace->before ? "else if (!inspect_found && " : "else if (inspect_found && ");
+
+        if (replace->type == REPLACING_FIRST)
+            buffer_append(out, "!inspect_locked && ");
+
+        buffer_append(out, "inspect_char == ");
+    } else
+        buffer_append(out, "if (inspect_char == ");
+
+    emit_value(out, replace->old);
+
+    if (replace->type == REPLACING_FIRST) {
+        buffer_append(out, replace->before || replace->after ? ") {\n" : " && !inspect_locked) {\n");
+        buffer_append(out, "inspect_string[i] = ");
+        emit_value(out, replace->new);
+        buffer_append(out, ";\ninspect_locked = true;\n}\n");
+    } else {
+        buffer_append(out, ")\ninspect_string[i] = ");
+        emit_value(out, replace->new);
+        buffer_append(out, ";\n");
     }
+}
 
-    char *code = malloc(strlen(replaces) + 143);
-    sprintf(code, "inspect_found = inspect_locked = false;\nfor (size_t i = 0; i < inspect_string_length; i++) {\nconst char inspect_char = inspect_string[i];\n%s}\n", replaces);
-    free(replaces);
-    return emit_inspect_combine(ast, code);
+void emit_inspect_header(Buffer *out, AST *ast) {
+    buffer_append(out, "inspect_string = ");
+    emit_value(out, ast->inspect.input_string);
+    buffer_append(out, ";\n"
+                       "inspect_string_length = strlen(inspect_string);\n"
+                       "inspect_count = 0;\n");
 }
 
-char *emit_inspect(AST *ast) {
-    if (ast->inspect.type == INSPECT_TALLYING)
-        return emit_inspect_tallying(ast);
-    else if (ast->inspect.type == INSPECT_REPLACING)
-        return emit_inspect_replacing(ast);
+void emit_inspect_tallying(Buffer *out, AST *ast) {
+    emit_inspect_header(out, ast);
 
-    assert(false);
-    return calloc(1, sizeof(char));
+    for (size_t i = 0; i < ast->inspect.tallying.tally_count; i++)
+        emit_stringtally(out, &ast->inspect.tallying.tallies[i]);
 }
 
-char *emit_accept_argv(AST *ast) {
-    char *dst = value_to_string(ast->accept.dst);
-    char *code = malloc((strlen(dst) * 3) + 116);
+void emit_inspect_replacing(Buffer *out, AST *ast) {
+    emit_inspect_header(out, ast);
+    buffer_append(out, "inspect_found = inspect_locked = false;\nfor (size_t i = 0; i < inspect_string_length; i++) {\nconst char inspect_char = inspect_string[i];\n");
+
+    for (size_t i = 0; i < ast->inspect.replacing.replace_count; i++)
+        emit_stringreplace(out, &ast->inspect.replacing.replaces[i]);
 
-    sprintf(code, "strcpy(%s, global_argv[0]);\n"
-                  "for (int i = 1; i < global_argc; i++) {\n"
-                  "strcat(%s, \" \");\n"
-                  "strcat(%s, global_argv[i]);\n"
-                  "}\n", dst, dst, dst);
+    buffer_append(out, "}\n");
+}
+
+void emit_inspect(Buffer *out, AST *ast) {
+    if (ast->inspect.type == INSPECT_TALLYING)
+        emit_inspect_tallying(out, ast);
+    else if (ast->inspect.type == INSPECT_REPLACING)
+        emit_inspect_replacing(out, ast);
+    else
+        assert(false);
+}
 
-    free(dst);
-    return code;
+void emit_accept_argv(Buffer *out, AST *ast) {
+    buffer_append(out, "strcpy(");
+    emit_value(out, ast->accept.dst);
+    buffer_append(out, ", global_argv[0]);\n"
+                       "for (int i = 1; i < global_argc; i++) {\n"
+                       "strcat(");
+    emit_value(out, ast->accept.dst);
+    buffer_append(out, ", \" \");\n"
+                       "strcat(");
+    emit_value(out, ast->accept.dst);
+    buffer_append(out, ", global_argv[i]);\n"
+                       "}\n");
 }
 
-char *emit_accept(AST *ast) {
+void emit_accept(Buffer *out, AST *ast) {
     assert(ast->accept.dst->type == AST_VAR);
 
-    if (ast->accept.from != NULL && ast->accept.from->type == AST_ARGV)
-        return emit_accept_argv(ast);
+    if (ast->accept.from != NULL && ast->accept.from->type == AST_ARGV) {
+        emit_accept_argv(out, ast);
+        return;
+    }
 
     PictureType type = get_value_type(ast->accept.dst);
-    char *dst = value_to_string(ast->accept.dst);
-    char *code = malloc((strlen(dst) * 3) + 238);
+    buffer_append(out, "fflush(stdout);\n");
 
     // Also removes the trailing newline if found.
     // TODO: Use read_buffer to check for shit?
-    if ((type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC) && type.count > 0)
-        sprintf(code, "read_buffer = fgets(%s, %u, stdin);\n"
-                      "%s[strcspn(%s, \"\\n\")] = '\\0';\n", dst, type.count + 1, dst, dst);
-    else if (type.type == TYPE_DECIMAL_NUMERIC)
-        sprintf(code, "read_buffer = fgets(string_builder, 4095, stdin);\n"
-                      "string_builder[strcspn(string_builder, \"\\n\")] = '\\0';\n"
-                      "%s = strtold(string_builder, &endptr);\n"
-                      "if (string_builder == endptr || *endptr != '\\0' || errno == ERANGE || errno == EINVAL)\ncobol_error();\n", dst);
-    else
-        sprintf(code, "read_buffer = fgets(string_builder, 4095, stdin);\n"
-                      "string_builder[strcspn(string_builder, \"\\n\")] = '\\0';\n"
-                      "%s = strto%s(string_builder, &endptr, 10);\n"
-                      "if (string_builder == endptr || *endptr != '\\0' || errno == ERANGE || errno == EINVAL)\ncobol_error();\n", dst, type.type == TYPE_SIGNED_NUMERIC ? "l" : "ul");
+    if ((type.type == TYPE_ALPHABETIC || type.type == TYPE_ALPHANUMERIC) && type.count > 0) {
+        buffer_append(out, "read_buffer = fgets(");
+        emit_value(out, ast->accept.dst);
+        buffer_appendf(out, ", %u, stdin);\n", type.count + 1);
+        emit_value(out, ast->accept.dst);
+        buffer_append(out, "[strcspn(");
+        emit_value(out, ast->accept.dst);
+        buffer_append(out, ", \"\\n\")] = '\\0';\n");
+        return;
+    }
+
+    buffer_append(out, "read_buffer = fgets(string_builder, 4095, stdin);\n"
+                       "string_builder[strcspn(string_builder, \"\\n\")] = '\\0';\n");
+
+    if (is_fixed_point(&type) || is_wide_numeric(&type) || is_packed(&type))
+        emit_string_to_fixed(out, ast->accept.dst, &type, NULL);
+    else {
+        emit_value(out, ast->accept.dst);
 
+        if (type.type == TYPE_DECIMAL_NUMERIC)
+            buffer_append(out, " = strtold(string_builder, &endptr);\n");
+        else
+            buffer_appendf(out, " = strto%s(string_builder, &endptr, 10);\n", type.type == TYPE_SIGNED_NUMERIC ? "l" : "ul");
+    }
 
-    free(dst);
-    return code;
+    buffer_append(out, "if (string_builder == endptr || *endptr != '\\0' || errno == ERANGE || errno == EINVAL)\ncobol_error();\n");
 }
 
-char *emit_lengthof(AST *ast) {
-    char *value = value_to_string(ast->lengthof_value);
-    char *code = malloc(strlen(value) + 11);
+void emit_lengthof(Buffer *out, AST *ast) {
     PictureType type = get_value_type(ast->lengthof_value);
 
-    if (IS_STRING(type))
-        sprintf(code, "strlen(%s)", value);
-    else
-        sprintf(code, "sizeof(%s)", value);
-
-    free(value);
-    return code;
+    buffer_append(out, IS_STRING(type) ? "strlen(" : "sizeof(");
+    emit_value(out, ast->lengthof_value);
+    buffer_appendc(out, ')');
 }
 
-char *emit_field(AST *ast) {
+void emit_field(Buffer *out, AST *ast) {
     assert(ast->field.value == NULL);
 
-    char *base = value_to_string(ast->field.base);
-    char *name = picturename_to_c(ast->field.sym->name);
-    char *code = malloc(strlen(base) + strlen(name) + 6);
-    sprintf(code, "%s.%s", base, name);
-    free(name);
-    free(base);
-    return code;
+    emit_value(out, ast->field.base);
+    buffer_appendc(out, '.');
+    emit_picture_name(out, ast->field.sym->name);
 }
 
-char *emit_set_pointer_type(AST *ast) {
-    char *name = picturename_to_c(ast->set_pointer_type.sym->name);
-    char *type = picturetype_to_c(&ast->set_pointer_type.type);
-    char *code = malloc((strlen(name) * 2) + strlen(type) + 128);
-    sprintf(code, "#undef POINTERTYPE%zu\n"
-                  "#define POINTERTYPE%zu %s\n", ast->set_pointer_type.sym->uid, ast->set_pointer_type.sym->uid, type);
-
-    free(name);
-    return code;
+void emit_set_pointer_type(Buffer *out, AST *ast) {
+    buffer_appendf(out, "#undef POINTERTYPE%zu\n"
+                        "#define POINTERTYPE%zu %s\n", ast->set_pointer_type.sym->uid, ast->set_pointer_type.sym->uid, picturetype_to_c(&ast->set_pointer_type.type));
 }
 
-char *emit_stmt(AST *ast) {
+void emit_stmt(Buffer *out, AST *ast) {
     switch (ast->type) {
-        case AST_NOP: return calloc(1, sizeof(char));
-        case AST_STOP_RUN: return emit_stop_run(ast);
-        case AST_STOP: return emit_stop(ast);
-        case AST_DISPLAY: return emit_display(ast);
-        case AST_PIC: return ast->pic.fields.size > 0 ? emit_struct_pic(ast) : emit_pic(ast);
-        case AST_MOVE: return emit_move(ast);
-        case AST_ARITHMETIC: return emit_arithmetic(ast);
-        case AST_COMPUTE: return emit_compute(ast);
-        case AST_MATH: return emit_math(ast);
-        case AST_IF: return emit_if(ast);
-        case AST_CONDITION: return emit_condition(ast);
-        case AST_NOT: return emit_not(ast);
-        case AST_LABEL: return emit_label(ast);
-        case AST_PERFORM: return emit_perform(ast);
-        case AST_PROC: return emit_procedure(ast);
-        case AST_PERFORM_CONDITION: return emit_perform_condition(ast);
-        case AST_PERFORM_COUNT: return emit_perform_count(ast);
-        case AST_PERFORM_VARYING: return emit_perform_varying(ast);
-        case AST_PERFORM_UNTIL: return emit_perform_until(ast);
-        case AST_SUBSCRIPT: return emit_subscript(ast);
-        case AST_CALL: return emit_call(ast);
-        case AST_STRING_BUILDER: return emit_string_builder(ast);
-        case AST_STRING_SPLITTER: return emit_unstring(ast);
-        case AST_OPEN: return emit_open(ast);
-        case AST_CLOSE: return emit_close(ast);
-        case AST_SELECT: return emit_select(ast);
-        case AST_READ: return emit_read(ast);
-        case AST_WRITE: return emit_write(ast);
-        case AST_INSPECT: return emit_inspect(ast);
-        case AST_ACCEPT: return emit_accept(ast);
-        case AST_EXIT: return mystrdup("exit(EXIT_SUCCESS);\n");
-        case AST_LENGTHOF: return emit_lengthof(ast);
-        case AST_FIELD: return emit_field(ast);
-        case AST_SET_POINTER_TYPE: return emit_set_pointer_type(ast);
+        case AST_NOP: return;
+        case AST_STOP_RUN: emit_stop_run(out, ast); return;
+        case AST_STOP: emit_stop(out, ast); return;
+        case AST_DISPLAY: emit_display(out, ast); return;
+        case AST_PIC:
+            if (ast->pic.fields.size > 0)
+                emit_struct_pic(ast);
+            else
+                emit_pic(ast, false);
+            return;
+        case AST_MOVE: emit_move(out, ast); return;
+        case AST_ARITHMETIC: emit_arithmetic(out, ast); return;
+        case AST_COMPUTE: emit_compute(out, ast); return;
+        case AST_MATH: emit_math(out, ast); return;
+        case AST_IF: emit_if(out, ast); return;
+        case AST_CONDITION: emit_condition(out, ast); return;
+        case AST_NOT: emit_not(out, ast); return;
+        case AST_LABEL: emit_label(out, ast); return;
+        case AST_PERFORM: emit_perform(out, ast); return;
+        case AST_PROC: emit_procedure(out, ast); return;
+        case AST_PERFORM_CONDITION: emit_perform_condition(out, ast); return;
+        case AST_PERFORM_COUNT: emit_perform_count(out, ast); return;
+        case AST_PERFORM_VARYING: emit_perform_varying(out, ast); return;
+        case AST_PERFORM_UNTIL: emit_perform_until(out, ast); return;
+        case AST_PERFORM_THRU: emit_perform_thru(out, ast); return;
+        case AST_GOTO: emit_goto(out, ast); return;
+        case AST_SUBSCRIPT: emit_subscript(out, ast); return;
+        case AST_CALL: emit_call(out, ast); return;
+        case AST_STRING_BUILDER: emit_string_builder(out, ast); return;
+        case AST_STRING_SPLITTER: emit_unstring(out, ast); return;
+        case AST_OPEN: emit_open(out, ast); return;
+        case AST_CLOSE: emit_close(out, ast); return;
+        case AST_SELECT: emit_select(ast); return;
+        case AST_READ:
+        case AST_RETURN: emit_read(out, ast); return;
+        case AST_WRITE:
+        case AST_REWRITE: emit_write(out, ast); return;
+        case AST_START:
+            emit_keyed_call(out, ast->keyed.fd->var.sym, AST_START, ast->keyed.relation == TOK_EQUAL ? ", '='" : ast->keyed.relation == TOK_GT ? ", '>'" : ", 0", &ast->keyed.invalid_key_stmts, &ast->keyed.not_invalid_key_stmts);
+            return;
+        case AST_DELETE: emit_keyed_call(out, ast->keyed.fd->var.sym, AST_DELETE, "", &ast->keyed.invalid_key_stmts, &ast->keyed.not_invalid_key_stmts); return;
+        case AST_SORT: emit_sort(out, ast); return;
+        case AST_RELEASE: emit_release(out, ast); return;
+        case AST_INSPECT: emit_inspect(out, ast); return;
+        case AST_ACCEPT: emit_accept(out, ast); return;
+        case AST_EXIT: buffer_append(out, "exit(EXIT_SUCCESS);\n"); return;
+        case AST_LENGTHOF: emit_lengthof(out, ast); return;
+        case AST_FIELD: emit_field(out, ast); return;
+        case AST_SET_POINTER_TYPE: emit_set_pointer_type(out, ast); return;
         default: break;
     }
 
     printf(">>>>%s\n", asttype_to_string(ast->type));
     assert(false);
-    return calloc(1, sizeof(char));
-}
\ No newline at end of file
+}
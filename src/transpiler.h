@@ -2,8 +2,20 @@
 #define TRANSPILER_H
 
 #include "ast.h"
+#include "buffer.h"
+#include <stdio.h>
 #include <stdbool.h>
 
-char *emit_root(AST *root, bool require_main, char *source_includes);
+// Writes the generated C for root to out, returns the number of bytes written.
+// Only COMP_NO_MAIN and COMP_WHOLE_PROGRAM of flags change what's emitted.
+size_t emit_root(FILE *out, AST *root, unsigned int flags, char *source_includes);
+
+// The printf() conversion the generated C uses for a value of type.
+void emit_format_specifier(Buffer *out, PictureType *type);
+
+// Whether dst = the expression in items is left to C's own arithmetic instead
+// of scaled integers. digits is then what the result is truncated to, 0 when
+// it always fits dst.
+bool is_plain_assign(AST *dst, AST **items, size_t count, bool rounded, unsigned int *digits);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# Measures how cobc's compile time and memory grow with program size. Each
+# step doubles the paragraphs, data items and copybooks of a program from
+# tools/gen_program.py, and the growth exponent of every phase is fitted
+# over the steps. An exponent near 1 is linear, anything well above it is
+# a quadratic rescan or copy waiting to bite. Build cobc first:
+#
+#     make bench-compile
+#     python3 tools/bench_compile.py [options]
+
+import argparse
+import csv
+import json
+import math
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gen_program import NAME, generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Only the front end unless --cc is given, gcc's own scaling is not ours to fix.
+PHASES = ["lex", "parse", "emit"]
+
+FIELDS = ["paragraphs", "items", "copybooks", "depth", "tokens", "ast_nodes", "bytes_emitted", "lex_ms", "parse_ms", "emit_ms", "cc_ms", "total_ms", "process_ms", "peak_rss_kb", "arena_bytes"]
+
+
+def fail(message):
+    print(f"bench_compile: {message}", file=sys.stderr)
+    sys.exit(1)
+
+
+# Older compilers without -freport-json only get the whole process timed.
+def supports_report(cobc):
+    result = subprocess.run([cobc, "--help"], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    return b"-freport-json" in result.stdout
+
+
+def compile_once(args, workdir):
+    command = [args.cobc, "object" if args.cc else "source"]
+
+    if args.report:
+        command += ["-freport-json", "report.json"]
+
+    start = time.perf_counter()
+    proc = subprocess.Popen(command + args.flags + [NAME + ".CBL"], cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = proc.stdout.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+
+    if proc.returncode != 0:
+        sys.stderr.write(output.decode(errors="replace"))
+        fail("cobc failed on a generated program")
+
+    data = None
+
+    if args.report:
+        with open(os.path.join(workdir, "report.json")) as f:
+            data = json.load(f)
+
+        os.remove(os.path.join(workdir, "report.json"))
+
+    # ru_maxrss is in kilobytes on Linux.
+    return data, elapsed * 1000, usage.ru_maxrss
+
+
+# The fastest of the runs, the others only add scheduling noise.
+def measure(args, workdir, paragraphs, items, copybooks):
+    generate(paragraphs, items, args.depth, copybooks, workdir)
+    best = None
+
+    for _ in range(args.runs):
+        data, process_ms, process_rss = compile_once(args, workdir)
+        row = dict.fromkeys(FIELDS)
+        row.update({
+            "paragraphs": paragraphs,
+            "items": items,
+            "copybooks": copybooks,
+            "depth": args.depth,
+            "process_ms": round(process_ms, 3),
+            "peak_rss_kb": process_rss,
+        })
+
+        if data is not None:
+            file = data["files"][0]
+            row.update({
+                "tokens": file["tokens"],
+                "ast_nodes": file["ast_nodes"],
+                "bytes_emitted": file["bytes_emitted"],
+                "arena_bytes": file["memory"]["bytes_reserved"],
+            })
+
+            for phase in PHASES + ["cc"]:
+                row[phase + "_ms"] = file["phases"][phase]["wall_ms"]
+
+            row["total_ms"] = round(sum(row[phase + "_ms"] for phase in PHASES + (["cc"] if args.cc else [])), 3)
+        else:
+            row["total_ms"] = row["process_ms"]
+
+        if best is None or row["total_ms"] < best["total_ms"]:
+            best = row
+
+    for name in os.listdir(workdir):
+        if name.endswith((".c", ".o", ".CPY", ".CBL")):
+            os.remove(os.path.join(workdir, name))
+
+    return best
+
+
+def format_cell(value):
+    if value is None:
+        return "-"
+
+    return f"{value:.1f}" if isinstance(value, float) else str(value)
+
+
+# Least squares slope of log(y) against log(x): y grows like x to this power.
+def exponent(xs, ys):
+    points = [(math.log(x), math.log(y)) for x, y in zip(xs, ys) if x > 0 and y > 0]
+
+    if len(points) < 2:
+        return None
+
+    mx = sum(x for x, _ in points) / len(points)
+    my = sum(y for _, y in points) / len(points)
+    var = sum((x - mx) ** 2 for x, _ in points)
+    return sum((x - mx) * (y - my) for x, y in points) / var if var > 0 else None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure how cobc scales with program size.")
+    parser.add_argument("--cobc", default=os.path.join(ROOT, "cobc"), help="compiler to measure")
+    parser.add_argument("--flags", default="", help="extra options for cobc")
+    parser.add_argument("--paragraphs", type=int, default=250, help="paragraphs in the smallest program")
+    parser.add_argument("--items", type=int, default=1250, help="data items in the smallest program")
+    parser.add_argument("--copybooks", type=int, default=5, help="copybooks in the smallest program")
+    parser.add_argument("--depth", type=int, default=6, help="IF nesting in each paragraph")
+    parser.add_argument("--steps", type=int, default=6, help="times to double the program")
+    parser.add_argument("--runs", type=int, default=3, help="compiles per size, the fastest counts")
+    parser.add_argument("--cc", action="store_true", help="include the C compiler")
+    parser.add_argument("--max-exponent", type=float, default=1.3, help="growth exponent that fails the run")
+    parser.add_argument("--json", default="bench_compile.json", help="JSON report, '' for none")
+    parser.add_argument("--csv", default="bench_compile.csv", help="CSV report, '' for none")
+    args = parser.parse_args()
+    args.cobc = os.path.abspath(args.cobc)
+    args.flags = shlex.split(args.flags)
+
+    if args.runs < 1 or args.steps < 2:
+        fail("need at least one run and two steps")
+
+    if not os.path.exists(args.cobc):
+        fail(f"'{args.cobc}' doesn't exist, run make first")
+
+    args.report = supports_report(args.cobc)
+
+    workdir = tempfile.mkdtemp(prefix="cobc-scale-")
+    rows = []
+    print(f"{'paras':>7} {'items':>8} {'books':>5} {'tokens':>9} {'lex ms':>9} {'parse ms':>9} {'emit ms':>9} {'cc ms':>9} {'cobc ms':>9} {'rss MB':>8}")
+
+    try:
+        for step in range(args.steps):
+            scale = 1 << step
+            row = measure(args, workdir, args.paragraphs * scale, args.items * scale, args.copybooks * scale)
+            rows.append(row)
+            cells = [format_cell(row[column]) for column in ["tokens", "lex_ms", "parse_ms", "emit_ms", "cc_ms", "process_ms"]]
+            print(f"{row['paragraphs']:>7} {row['items']:>8} {row['copybooks']:>5} " + " ".join(f"{cell:>9}" for cell in cells) + f" {row['peak_rss_kb'] / 1024:>8.1f}")
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    # Fitted over the larger half, small programs are dominated by start up.
+    fitted = rows[len(rows) // 2 - 1:] if len(rows) > 3 else rows
+    sizes = [row["paragraphs"] for row in fitted]
+    columns = ["process_ms", "peak_rss_kb"]
+
+    if args.report:
+        columns = [phase + "_ms" for phase in PHASES] + (["cc_ms"] if args.cc else []) + ["total_ms", "bytes_emitted"] + columns
+
+    exponents = {column: exponent(sizes, [row[column] for row in fitted]) for column in columns}
+    failed = [column for column, value in exponents.items() if value is not None and value > args.max_exponent]
+    print("growth exponents against program size (1.0 is linear):")
+
+    for column, value in exponents.items():
+        mark = "  SUPER-LINEAR" if column in failed else ""
+        print(f"    {column:<14} {'-' if value is None else f'{value:.2f}'}{mark}")
+
+    if args.json:
+        report = {
+            "cobc": args.cobc,
+            "flags": args.flags,
+            "cc": args.cc,
+            "max_exponent": args.max_exponent,
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "sizes": rows,
+            "exponents": {column: None if value is None else round(value, 3) for column, value in exponents.items()},
+        }
+
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=4)
+            f.write("\n")
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
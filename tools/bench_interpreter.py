@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Times 'cobc run' through gcc against 'cobc run -interpret' on every program
+# in examples/, and checks both print the same thing. Build cobc first:
+#
+#     make && python3 tools/bench_interpreter.py [runs]
+
+import glob
+import os
+import subprocess
+import sys
+import time
+
+COBC = os.path.join(".", "cobc")
+OUTFILE = "bench_interpreter.out"
+
+# Built from more than one file, or pops up a window.
+SKIP = {"LINKAGE", "LINKAGESRC", "MESSAGEBOX"}
+
+# Answers for the examples that ACCEPT.
+STDIN = b"examples/HELLOWORLD.CBL\nJohn\n"
+
+
+def run(path, interpret):
+    args = [COBC, "run", "-o", OUTFILE, path]
+
+    if interpret:
+        args.insert(2, "-interpret")
+
+    start = time.perf_counter()
+    result = subprocess.run(args, input=STDIN, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    elapsed = time.perf_counter() - start
+
+    # An executable is only left behind when the interpreter fell back to gcc.
+    built = os.path.exists(OUTFILE)
+
+    if built:
+        os.remove(OUTFILE)
+
+    return elapsed, result.stdout, built
+
+
+def main():
+    runs = int(sys.argv[1]) if len(sys.argv) > 1 else 3
+    total_gcc = total_interp = 0.0
+
+    print(f"{'program':<12} {'gcc ms':>10} {'interp ms':>10} {'speedup':>8}  notes")
+
+    for path in sorted(glob.glob(os.path.join("examples", "*.CBL"))):
+        name = os.path.splitext(os.path.basename(path))[0]
+
+        if name in SKIP:
+            continue
+
+        gcc = min(run(path, False)[0] for _ in range(runs))
+        interp_runs = [run(path, True) for _ in range(runs)]
+        interp = min(elapsed for elapsed, _, _ in interp_runs)
+        notes = []
+
+        if interp_runs[0][2]:
+            notes.append("fell back to gcc")
+        elif interp_runs[0][1].replace(OUTFILE.encode(), b"") != run(path, False)[1].replace(OUTFILE.encode(), b""):
+            notes.append("OUTPUT DIFFERS")
+
+        total_gcc += gcc
+        total_interp += interp
+        print(f"{name:<12} {gcc * 1000:>10.1f} {interp * 1000:>10.1f} {gcc / interp:>7.1f}x  {', '.join(notes)}")
+
+    print(f"{'total':<12} {total_gcc * 1000:>10.1f} {total_interp * 1000:>10.1f} {total_gcc / total_interp:>7.1f}x")
+
+    # Left behind by WRITE.CBL.
+    if os.path.exists(os.path.join("examples", "write.txt")):
+        os.remove(os.path.join("examples", "write.txt"))
+
+
+if __name__ == "__main__":
+    main()
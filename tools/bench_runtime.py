@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+# Builds every workload in bench/ with cobc, times repeated runs of the
+# executables and writes the results as JSON and CSV. Build cobc first:
+#
+#     make bench
+#     python3 tools/bench_runtime.py [options] [workloads...]
+#
+# Pass --baseline with an earlier JSON report to flag workloads that got
+# slower or started printing something different.
+
+import argparse
+import csv
+import glob
+import hashlib
+import json
+import os
+import platform
+import resource
+import shlex
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH_DIR = os.path.join(ROOT, "bench")
+
+# FILEIO.CBL copies this to bench-output.txt in the directory it runs in.
+IO_INPUT = "bench-input.txt"
+IO_OUTPUT = "bench-output.txt"
+IO_LINE = b"0123456789 the quick brown fox jumps over the lazy dog 0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ\n"
+
+FIELDS = ["workload", "runs", "min_ms", "median_ms", "mean_ms", "stdev_ms", "user_ms", "sys_ms", "build_ms", "output_sha1", "status"]
+
+
+def fail(message):
+    print(f"bench_runtime: {message}", file=sys.stderr)
+    sys.exit(1)
+
+
+def make_io_input(workdir, megabytes):
+    path = os.path.join(workdir, IO_INPUT)
+    lines = max(1, megabytes * 1024 * 1024 // len(IO_LINE))
+    chunk = IO_LINE * 8192
+
+    with open(path, "wb") as f:
+        for _ in range(lines // 8192):
+            f.write(chunk)
+
+        f.write(IO_LINE * (lines % 8192))
+
+    return os.path.getsize(path)
+
+
+def build(cobc, flags, source, exe, workdir):
+    args = [cobc, "build"] + flags + ["-o", exe, source]
+    start = time.perf_counter()
+    result = subprocess.run(args, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    elapsed = time.perf_counter() - start
+
+    if result.returncode != 0 or not os.path.exists(os.path.join(workdir, exe)):
+        sys.stderr.write(result.stdout.decode(errors="replace"))
+        return None
+
+    return elapsed
+
+
+# Standard output goes to a file so DISPLAY pays for real writes, not a terminal.
+def run_once(exe, workdir):
+    outpath = os.path.join(workdir, "stdout.txt")
+    before = resource.getrusage(resource.RUSAGE_CHILDREN)
+
+    with open(outpath, "wb") as out:
+        start = time.perf_counter()
+        result = subprocess.run([os.path.join(".", exe)], cwd=workdir, stdin=subprocess.DEVNULL, stdout=out)
+        elapsed = time.perf_counter() - start
+
+    after = resource.getrusage(resource.RUSAGE_CHILDREN)
+    digest = hashlib.sha1()
+
+    with open(outpath, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+
+    os.remove(outpath)
+    return elapsed, after.ru_utime - before.ru_utime, after.ru_stime - before.ru_stime, result.returncode, digest.hexdigest()
+
+
+def bench(name, source, args, workdir, io_size):
+    exe = name.lower() + ".bin"
+    build_time = build(args.cobc, args.flags, source, exe, workdir)
+    row = {"workload": name, "runs": 0, "build_ms": None, "output_sha1": None, "status": "ok"}
+
+    if build_time is None:
+        row["status"] = "build failed"
+        return row
+
+    row["build_ms"] = round(build_time * 1000, 3)
+    times, user, system, digests = [], [], [], set()
+
+    for _ in range(args.warmup):
+        run_once(exe, workdir)
+
+    for _ in range(args.runs):
+        elapsed, utime, stime, code, digest = run_once(exe, workdir)
+
+        if code != 0:
+            row["status"] = f"exited with {code}"
+            break
+
+        times.append(elapsed)
+        user.append(utime)
+        system.append(stime)
+        digests.add(digest)
+
+    if name == "FILEIO" and row["status"] == "ok":
+        copied = os.path.join(workdir, IO_OUTPUT)
+
+        if not os.path.exists(copied) or os.path.getsize(copied) != io_size:
+            row["status"] = "output file differs"
+
+        if os.path.exists(copied):
+            os.remove(copied)
+
+    os.remove(os.path.join(workdir, exe))
+
+    if not times:
+        return row
+
+    if len(digests) > 1:
+        row["status"] = "output changes between runs"
+
+    row.update({
+        "runs": len(times),
+        "min_ms": round(min(times) * 1000, 3),
+        "median_ms": round(statistics.median(times) * 1000, 3),
+        "mean_ms": round(statistics.mean(times) * 1000, 3),
+        "stdev_ms": round(statistics.stdev(times) * 1000, 3) if len(times) > 1 else 0.0,
+        "user_ms": round(statistics.mean(user) * 1000, 3),
+        "sys_ms": round(statistics.mean(system) * 1000, 3),
+        "output_sha1": digests.pop(),
+    })
+
+    return row
+
+
+# Medians are compared since a single lucky run says little about a regression.
+def compare(rows, baseline_path, threshold):
+    with open(baseline_path) as f:
+        baseline = {row["workload"]: row for row in json.load(f)["workloads"]}
+
+    regressed = False
+
+    for row in rows:
+        old = baseline.get(row["workload"])
+
+        if old is None or row.get("median_ms") is None or old.get("median_ms") is None:
+            continue
+
+        ratio = row["median_ms"] / old["median_ms"]
+        row["baseline_median_ms"] = old["median_ms"]
+        row["ratio"] = round(ratio, 3)
+
+        if ratio > threshold:
+            row["status"] = f"{ratio:.2f}x slower"
+            regressed = True
+
+        if old.get("output_sha1") is not None and old["output_sha1"] != row["output_sha1"]:
+            row["status"] = "OUTPUT DIFFERS"
+            regressed = True
+
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Time executables built by cobc.")
+    parser.add_argument("workloads", nargs="*", help="names of bench/*.CBL to run, all by default")
+    parser.add_argument("--cobc", default=os.path.join(ROOT, "cobc"), help="compiler to build with")
+    parser.add_argument("--flags", default="", help="extra options for 'cobc build'")
+    parser.add_argument("--runs", type=int, default=5, help="timed runs per workload")
+    parser.add_argument("--warmup", type=int, default=1, help="untimed runs before timing")
+    parser.add_argument("--io-mb", type=int, default=256, help="size of the FILEIO input file")
+    parser.add_argument("--json", default="bench_runtime.json", help="JSON report, '' for none")
+    parser.add_argument("--csv", default="bench_runtime.csv", help="CSV report, '' for none")
+    parser.add_argument("--baseline", help="earlier JSON report to compare against")
+    parser.add_argument("--threshold", type=float, default=1.10, help="slowdown that counts as a regression")
+    args = parser.parse_args()
+    args.cobc = os.path.abspath(args.cobc)
+    args.flags = shlex.split(args.flags)
+
+    if args.runs < 1:
+        fail("need at least one run")
+
+    if not os.path.exists(args.cobc):
+        fail(f"'{args.cobc}' doesn't exist, run make first")
+
+    sources = {os.path.splitext(os.path.basename(path))[0]: path for path in sorted(glob.glob(os.path.join(BENCH_DIR, "*.CBL")))}
+    names = [name.upper() for name in args.workloads] or list(sources)
+
+    for name in names:
+        if name not in sources:
+            fail(f"unknown workload '{name}'")
+
+    workdir = tempfile.mkdtemp(prefix="cobc-bench-")
+    rows = []
+
+    try:
+        io_size = make_io_input(workdir, args.io_mb) if "FILEIO" in names else 0
+        print(f"{'workload':<10} {'min ms':>10} {'median ms':>10} {'stdev ms':>9} {'user ms':>10} {'sys ms':>9}  status")
+
+        for name in names:
+            row = bench(name, sources[name], args, workdir, io_size)
+            rows.append(row)
+
+            if row["runs"] == 0:
+                print(f"{name:<10} {'-':>10} {'-':>10} {'-':>9} {'-':>10} {'-':>9}  {row['status']}")
+            else:
+                print(f"{name:<10} {row['min_ms']:>10.1f} {row['median_ms']:>10.1f} {row['stdev_ms']:>9.1f} {row['user_ms']:>10.1f} {row['sys_ms']:>9.1f}  {row['status']}")
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    regressed = compare(rows, args.baseline, args.threshold) if args.baseline else False
+
+    if args.baseline:
+        for row in rows:
+            if "ratio" in row:
+                print(f"{row['workload']:<10} {row['baseline_median_ms']:>10.1f} -> {row['median_ms']:.1f} ms ({row['ratio']:.2f}x)  {row['status']}")
+
+    if args.json:
+        report = {
+            "cobc": args.cobc,
+            "flags": args.flags,
+            "runs": args.runs,
+            "io_mb": args.io_mb,
+            "machine": platform.machine(),
+            "system": platform.platform(),
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "workloads": rows,
+        }
+
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=4)
+            f.write("\n")
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS, extrasaction="ignore")
+            writer.writeheader()
+            writer.writerows(rows)
+
+    if regressed or any(row["status"] != "ok" for row in rows):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Checks that -cache never hands out stale results: a program is built from
+# the cache after its copybook is edited without changing its size or
+# modification time, which is what an edit within the same second looks
+# like, and has to print what a build without the cache prints. Then the
+# precompiled copybook is made to look like another cobc build wrote it,
+# with different tokens, and has to be lexed again. Build cobc first:
+#
+#     make check
+#     python3 tools/check_cache.py [--cobc path]
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXAMPLES = os.path.join(ROOT, "examples")
+
+
+def fail(message):
+    print(f"check_cache: {message}", file=sys.stderr)
+    sys.exit(1)
+
+
+def build_and_run(cobc, workdir, cache):
+    command = [cobc, "build"] + (["-cache", "cache"] if cache else []) + ["-o", "copy.bin", "COPY.CBL"]
+    result = subprocess.run(command, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout.decode(errors="replace"))
+        fail("cobc failed on COPY.CBL")
+
+    output = subprocess.run([os.path.join(".", "copy.bin")], cwd=workdir, stdout=subprocess.PIPE).stdout
+    os.remove(os.path.join(workdir, "copy.bin"))
+    return output.decode(errors="replace").strip()
+
+
+# Same size and same timestamps as before, only the contents differ.
+def edit_in_place(path, old, new):
+    st = os.stat(path)
+
+    with open(path) as f:
+        text = f.read()
+
+    with open(path, "w") as f:
+        f.write(text.replace(old, new))
+
+    os.utime(path, ns=(st.st_atime_ns, st.st_mtime_ns))
+
+
+# Rewrites every precompiled copybook as if another cobc build had lexed it
+# to different tokens, and drops the objects so the copybooks are needed.
+def plant_foreign_tokens(cache, old, new):
+    for name in os.listdir(cache):
+        path = os.path.join(cache, name)
+
+        if name.endswith(".cpt"):
+            with open(path, "rb") as f:
+                data = bytearray(f.read())
+
+            # The build hash follows the magic, aligned to 8 bytes.
+            data[8:24] = bytes(b ^ 0xFF for b in data[8:24])
+
+            with open(path, "wb") as f:
+                f.write(bytes(data).replace(old.encode(), new.encode()))
+        else:
+            os.remove(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check that cached builds follow copybook edits.")
+    parser.add_argument("--cobc", default=os.path.join(ROOT, "cobc"), help="compiler to check")
+    args = parser.parse_args()
+    args.cobc = os.path.abspath(args.cobc)
+
+    if not os.path.exists(args.cobc):
+        fail(f"'{args.cobc}' doesn't exist, run make first")
+
+    workdir = tempfile.mkdtemp(prefix="cobc-check-")
+    failed = False
+
+    try:
+        for name in ["COPY.CBL", "COPYBOOK.CPY"]:
+            shutil.copy(os.path.join(EXAMPLES, name), workdir)
+
+        copybook = os.path.join(workdir, "COPYBOOK.CPY")
+        steps = [("first build", None), ("same second edit", ("John", "Jane")), ("edit back", ("Jane", "John"))]
+
+        for step, edit in steps:
+            if edit is not None:
+                edit_in_place(copybook, *edit)
+
+            # Twice from the cache, once to fill it after the edit and once to hit it.
+            expected = build_and_run(args.cobc, workdir, False)
+            outputs = [build_and_run(args.cobc, workdir, True) for _ in range(2)]
+            ok = all(output == expected for output in outputs)
+            failed = failed or not ok
+            print(f"{step:<18} {'ok' if ok else 'STALE'}  expected '{expected}', cached '{outputs[0]}', '{outputs[1]}'")
+
+        plant_foreign_tokens(os.path.join(workdir, "cache"), "John", "Jack")
+        expected = build_and_run(args.cobc, workdir, False)
+        output = build_and_run(args.cobc, workdir, True)
+        ok = output == expected
+        failed = failed or not ok
+        print(f"{'other cobc build':<18} {'ok' if ok else 'STALE'}  expected '{expected}', cached '{output}'")
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
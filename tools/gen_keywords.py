@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+# Generates src/keyword.h and src/keyword.c, a perfect hash from COBOL
+# reserved words to the Keyword enum. Run it again after editing KEYWORDS:
+#
+#     python3 tools/gen_keywords.py
+
+import os
+
+KEYWORDS = [
+    "ACCEPT", "ACCESS", "ADD", "ADDRESS", "ADVANCING", "AFTER", "ALL", "AND", "ASCENDING", "ASSIGN", "AT",
+    "BEFORE", "BINARY", "BY",
+    "CALL", "CHARACTERS", "CLOSE", "COMMAND-LINE", "COMP", "COMP-1", "COMP-2", "COMP-3",
+    "COMP-4", "COMP-5", "COMPUTE", "COPY",
+    "DATA", "DELETE", "DELIMITED", "DESCENDING", "DISPLAY", "DIVIDE", "DIVISION", "DOWN",
+    "DUPLICATES", "DYNAMIC",
+    "ELSE", "END", "END-IF", "END-PERFORM", "END-STRING", "END-UNSTRING", "ENVIRONMENT",
+    "EQUAL", "EXIT", "EXTEND",
+    "FALSE", "FD", "FILE", "FILE-CONTROL", "FIRST", "FOR", "FROM",
+    "GIVING", "GO", "GREATER",
+    "I-O", "IDENTIFICATION", "IF", "IN", "INDEXED", "INITIAL", "INPUT", "INPUT-OUTPUT", "INSPECT",
+    "INTO", "INVALID", "IS",
+    "KEY",
+    "LENGTH", "LESS", "LINE", "LINKAGE",
+    "MOD", "MODE", "MOVE", "MULTIPLY",
+    "NEXT", "NO", "NOT", "NULL",
+    "OCCURS", "OF", "ON", "OPEN", "OR", "ORDER", "ORGANIZATION", "OUTPUT",
+    "PACKED-DECIMAL", "PERFORM", "PIC", "POINTER", "PROCEDURE", "PROGRAM", "PROGRAM-ID",
+    "RANDOM", "READ", "RECORD", "RELATIVE", "RELEASE", "REMAINDER", "REPLACING", "RETURN", "RETURNING",
+    "REWRITE", "ROUNDED",
+    "RUN",
+    "SD", "SECTION", "SELECT", "SEQUENTIAL", "SET", "SIZE", "SORT", "SPACE", "START", "STATUS", "STOP", "STRING",
+    "SUBTRACT",
+    "TALLYING", "THAN", "THEN", "THROUGH", "THRU", "TIMES", "TO", "TRUE",
+    "UNSTRING", "UNTIL", "UP", "USAGE", "USING",
+    "VALUE", "VARYING",
+    "WITH", "WORKING-STORAGE", "WRITE",
+    "ZERO", "ZEROES", "ZEROS",
+]
+
+FNV_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+
+def fnv1a(word, seed):
+    h = seed
+    for c in word.encode():
+        h = ((h ^ c) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def build(keywords):
+    slot_count = 1
+    while slot_count < len(keywords) * 2:
+        slot_count *= 2
+
+    bucket_count = slot_count // 4
+    buckets = [[] for _ in range(bucket_count)]
+
+    for word in keywords:
+        buckets[fnv1a(word, FNV_BASIS) % bucket_count].append(word)
+
+    slots = [None] * slot_count
+    displacements = [0] * bucket_count
+
+    # Place the biggest buckets first, each gets the first seed that
+    # moves all of its words into free slots.
+    for b in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+
+        for seed in range(1, 1 << 16):
+            taken = [fnv1a(word, seed) % slot_count for word in buckets[b]]
+
+            if len(set(taken)) == len(taken) and all(slots[s] is None for s in taken):
+                for word, s in zip(buckets[b], taken):
+                    slots[s] = word
+
+                displacements[b] = seed
+                break
+        else:
+            raise SystemExit("no perfect hash found")
+
+    return slot_count, bucket_count, slots, displacements
+
+
+def enum_name(word):
+    return "KW_" + word.replace("-", "_")
+
+
+def main():
+    keywords = sorted(set(KEYWORDS))
+
+    # The slot table stores keywords as uint8_t.
+    if len(keywords) >= 255:
+        raise SystemExit("too many keywords for the slot table")
+
+    slot_count, bucket_count, slots, displacements = build(keywords)
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+
+    with open(os.path.join(root, "keyword.h"), "w") as f:
+        f.write("// Generated by tools/gen_keywords.py, do not edit.\n\n")
+        f.write("#ifndef KEYWORD_H\n#define KEYWORD_H\n\n#include <stdio.h>\n\n")
+        f.write("typedef enum {\n    KW_NONE,\n")
+        f.write("".join("    %s,\n" % enum_name(word) for word in keywords))
+        f.write("    KW_COUNT\n} Keyword;\n\n")
+        f.write("Keyword lookup_keyword(const char *str, size_t len);\n")
+        f.write("char *keyword_to_string(Keyword keyword);\n\n#endif\n")
+
+    with open(os.path.join(root, "keyword.c"), "w") as f:
+        f.write("// Generated by tools/gen_keywords.py, do not edit.\n\n")
+        f.write('#include "keyword.h"\n#include <stdio.h>\n#include <string.h>\n#include <stdint.h>\n\n')
+        f.write("#define SLOT_COUNT %d\n#define BUCKET_COUNT %d\n\n" % (slot_count, bucket_count))
+        f.write("static char *keywords[KW_COUNT] = {\n    NULL,\n")
+        f.write("".join('    "%s",\n' % word for word in keywords))
+        f.write("};\n\n")
+        f.write("static const uint16_t displacements[BUCKET_COUNT] = {\n")
+
+        for i in range(0, bucket_count, 12):
+            f.write("    " + ", ".join(str(d) for d in displacements[i:i + 12]) + ",\n")
+
+        f.write("};\n\n")
+        f.write("static const uint8_t slots[SLOT_COUNT] = {\n")
+
+        for i in range(0, slot_count, 8):
+            f.write("    " + ", ".join(enum_name(w) if w else "KW_NONE" for w in slots[i:i + 8]) + ",\n")
+
+        f.write("};\n\n")
+        f.write("""static uint32_t hash(const char *str, size_t len, uint32_t seed) {
+    uint32_t h = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= %uu;
+    }
+
+    return h;
+}
+
+Keyword lookup_keyword(const char *str, size_t len) {
+    const uint32_t seed = displacements[hash(str, len, %uu) %% BUCKET_COUNT];
+    const Keyword keyword = slots[hash(str, len, seed) %% SLOT_COUNT];
+
+    if (keyword == KW_NONE || strncmp(keywords[keyword], str, len) != 0 || keywords[keyword][len] != '\\0')
+        return KW_NONE;
+
+    return keyword;
+}
+
+char *keyword_to_string(Keyword keyword) {
+    return keyword < KW_COUNT ? keywords[keyword] : NULL;
+}
+""" % (FNV_PRIME, FNV_BASIS))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# Generates a large COBOL program to stress the front end: N paragraphs,
+# M data items split between the program and copybooks, and IF statements
+# nested D deep in every paragraph. The program compiles and runs, the
+# procedure division performs every paragraph once.
+#
+#     python3 tools/gen_program.py -n 1000 -m 5000 -d 8 -c 20 -o /tmp/big
+
+import argparse
+import os
+
+NAME = "BIGPROG"
+
+# Fields per group item, the rest of the items are elementary.
+GROUP_FIELDS = 4
+
+
+def item_name(i):
+    return f"WS-ITEM-{i:06d}"
+
+
+# Data items in blocks of 10: a group item, then elementary items.
+def data_lines(first, count):
+    lines = []
+    i = first
+
+    while i < first + count:
+        if (i - first) % 10 == 0 and i + GROUP_FIELDS <= first + count:
+            lines.append(f"       01 WS-GROUP-{i:06d}.")
+
+            for j in range(GROUP_FIELDS):
+                lines.append(f"           05 {item_name(i + j)} PIC 9(09).")
+
+            i += GROUP_FIELDS
+            continue
+
+        if i % 3 == 0:
+            lines.append(f"       01 {item_name(i)} PIC X(32) VALUE \"ITEM {i}\".")
+        else:
+            lines.append(f"       01 {item_name(i)} PIC 9(09) VALUE {i % 1000}.")
+
+        i += 1
+
+    return lines
+
+
+# Paragraphs only use elementary items, group item fields need subscripts.
+def is_elementary_numeric(i, first, count):
+    in_group = (i - first) % 10 < GROUP_FIELDS and (i - first) // 10 * 10 + first + GROUP_FIELDS <= first + count
+    return not in_group and i % 3 != 0
+
+
+def paragraph_lines(p, depth, numeric):
+    a = numeric[p % len(numeric)]
+    b = numeric[(p * 7 + 1) % len(numeric)]
+    lines = [f"       PARA-{p:06d}."]
+    indent = "           "
+
+    for d in range(depth):
+        lines.append(f"{indent}IF {item_name(a)} < {(p + d) % 900 + 100} THEN")
+        indent += "    "
+        lines.append(f"{indent}ADD {d + 1} TO {item_name(a)}")
+
+    lines.append(f"{indent}COMPUTE {item_name(b)} = ({item_name(a)} * 3 + {p % 97}) / 7")
+    lines.append(f"{indent}MOVE {item_name(b)} TO {item_name(a)}")
+
+    for d in reversed(range(depth)):
+        indent = indent[:-4]
+        lines.append(f"{indent}ELSE")
+        lines.append(f"{indent}    SUBTRACT 1 FROM {item_name(a)}")
+        lines.append(f"{indent}END-IF")
+
+    lines[-1] += "."
+    lines.append("")
+    return lines
+
+
+def generate(paragraphs, items, depth, copybooks, outdir):
+    os.makedirs(outdir, exist_ok=True)
+
+    # Copybooks take an even share of the items between them.
+    per_book = items // (copybooks + 1) if copybooks > 0 else 0
+    local = items - per_book * copybooks
+    numeric = []
+    blocks = [(0, local)] + [(local + b * per_book, per_book) for b in range(copybooks)]
+
+    for first, count in blocks:
+        numeric += [i for i in range(first, first + count) if is_elementary_numeric(i, first, count)]
+
+    if not numeric:
+        raise SystemExit("gen_program: need at least one numeric data item")
+
+    for b in range(copybooks):
+        first, count = blocks[b + 1]
+
+        with open(os.path.join(outdir, f"BOOK{b:04d}.CPY"), "w") as f:
+            f.write(f"      * Copybook {b} of {copybooks}.\n")
+            f.write("\n".join(data_lines(first, count)) + "\n")
+
+    lines = [
+        "       IDENTIFICATION DIVISION.",
+        f"       PROGRAM-ID. {NAME}.",
+        "       DATA DIVISION.",
+        "       WORKING-STORAGE SECTION.",
+    ]
+    lines += data_lines(0, local)
+    lines += [f"           COPY BOOK{b:04d}." for b in range(copybooks)]
+    lines.append("       PROCEDURE DIVISION.")
+    lines += [f"           PERFORM PARA-{p:06d}." for p in range(paragraphs)]
+    lines += [f"           DISPLAY {item_name(numeric[0])}.", "           STOP RUN.", ""]
+
+    for p in range(paragraphs):
+        lines += paragraph_lines(p, depth, numeric)
+
+    lines.append(f"       END PROGRAM {NAME}.")
+    path = os.path.join(outdir, f"{NAME}.CBL")
+
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+    return path
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a large COBOL program.")
+    parser.add_argument("-n", "--paragraphs", type=int, default=100)
+    parser.add_argument("-m", "--items", type=int, default=500)
+    parser.add_argument("-d", "--depth", type=int, default=4, help="IF nesting in each paragraph")
+    parser.add_argument("-c", "--copybooks", type=int, default=4)
+    parser.add_argument("-o", "--outdir", default=".")
+    args = parser.parse_args()
+    print(generate(args.paragraphs, args.items, args.depth, args.copybooks, args.outdir))
+
+
+if __name__ == "__main__":
+    main()